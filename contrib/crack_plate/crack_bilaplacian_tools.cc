@@ -551,10 +551,11 @@ void bilaplacian_crack_problem::init_mixed_elements(void) {
     
   
    for (dal::bv_visitor ip(mesh.points().index()); !ip.finished(); ++ip) {
-                    bgeot::base_node& P = mesh.points()[ip];
+                    bgeot::base_node P = mesh.points()[ip];
 	            if( gmm::abs(P[1]) < seuil_select){
 		      cout << "deplace de (" << P[0] << " ; " << P[1] << ") a : " ;
 		      P[1] = 0. ;
+		      mesh.points().set_node(ip, P);
 		      cout << P[1] << "\n" ;
 	            }
     } 
@@ -648,6 +648,192 @@ static void test_new_assembly(int N, int NX, int pK) {
 }
 
 
+// Comparison of the interpreter and of the native code for a nonlinear
+// elasticity law (compressible neo-Hookean), for the residual and the tangent
+// matrix. The first assembly with native code includes the compilation of
+// the generated code by the system compiler (unless it is already in the
+// cache directory).
+static void test_native_code(int N, int NX, int pK) {
+
+  cout << "\n\n-------------------------------------\n"
+       <<     "Native code in dimension " << N << " with P" << pK
+       <<     " elements"
+       <<   "\n-------------------------------------"
+       << endl << endl;
+
+  getfem::mesh m;
+  char Ns[5]; sprintf(Ns, "%d", N);
+  char Ks[5]; sprintf(Ks, "%d", pK);
+  bgeot::pgeometric_trans pgt =
+    bgeot::geometric_trans_descriptor
+    ((std::string("GT_PK(") + Ns + ",1)").c_str());
+  std::vector<size_type> nsubdiv(N, NX);
+  getfem::regular_unit_mesh(m, nsubdiv, pgt);
+
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_finite_element(m.convex_index(), getfem::fem_descriptor
+                          ((std::string("FEM_PK(") + Ns + "," + Ks
+                            + ")").c_str()));
+  mf_u.set_qdim(dim_type(N));
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(m.convex_index(), dim_type(2*pK));
+
+  std::vector<scalar_type> U(mf_u.nb_dof());
+  gmm::fill_random(U); gmm::scale(U, scalar_type(0.001));
+  size_type ndofu = mf_u.nb_dof();
+  cout << "ndofu = " << ndofu << endl;
+
+  getfem::ga_workspace workspace;
+  base_vector mu(1, 2.0), kappa(1, 5.0);
+  workspace.add_fixed_size_constant("mu", mu);
+  workspace.add_fixed_size_constant("kappa", kappa);
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, ndofu), U);
+  workspace.add_expression("(mu*(Id(meshdim)+Grad_u)+(kappa*log(Det(Id("
+                           "meshdim)+Grad_u))-mu)*Inv(Id(meshdim)+Grad_u'))"
+                           ":Grad_Test_u", mim);
+  getfem::model_real_sparse_matrix K(ndofu, ndofu);
+  workspace.set_assembled_matrix(K);
+
+  chrono ch;
+  for (size_type order = 1; order < 3; ++order) {
+    cout << (order == 1 ? "Residual" : "Tangent matrix") << endl;
+    workspace.set_native_code(false);
+    workspace.assembly(order);
+    ch.init(); ch.tic(); workspace.assembly(order); ch.toc();
+    cout << "Elapsed time with the interpreter " << ch.elapsed() << endl;
+    workspace.set_native_code(true);
+    ch.init(); ch.tic(); workspace.assembly(order); ch.toc();
+    cout << "Elapsed time with native code, first assembly " << ch.elapsed()
+         << " (" << workspace.nb_native_kernels() << " kernel)" << endl;
+    ch.init(); ch.tic(); workspace.assembly(order); ch.toc();
+    cout << "Elapsed time with native code " << ch.elapsed() << endl;
+  }
+}
+
+// Effect of the fusion of the chains of element-wise instructions
+// (set_instruction_optimization) on tangent matrices whose sums and scalar
+// multiplications are done on the tensors of the second test functions.
+static void test_instruction_fusion(int N, int NX, int pK) {
+
+  cout << "\n\n-------------------------------------\n"
+       <<     "Instruction fusion in dimension " << N << " with P" << pK
+       <<     " elements"
+       <<   "\n-------------------------------------"
+       << endl << endl;
+
+  getfem::mesh m;
+  char Ns[5]; sprintf(Ns, "%d", N);
+  char Ks[5]; sprintf(Ks, "%d", pK);
+  bgeot::pgeometric_trans pgt =
+    bgeot::geometric_trans_descriptor
+    ((std::string("GT_PK(") + Ns + ",1)").c_str());
+  std::vector<size_type> nsubdiv(N, NX);
+  getfem::regular_unit_mesh(m, nsubdiv, pgt);
+
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_finite_element(m.convex_index(), getfem::fem_descriptor
+                          ((std::string("FEM_PK(") + Ns + "," + Ks
+                            + ")").c_str()));
+  mf_u.set_qdim(dim_type(N));
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(m.convex_index(), dim_type(2*pK));
+
+  std::vector<scalar_type> U(mf_u.nb_dof());
+  gmm::fill_random(U); gmm::scale(U, scalar_type(0.001));
+  size_type ndofu = mf_u.nb_dof();
+  cout << "ndofu = " << ndofu << endl;
+
+  const char *expressions[] = {
+    "(Grad_Test2_u*mu+Grad_Test2_u*Grad_u*lambda+Grad_Test2_u*Grad_u'*mu)"
+    "*0.5:Grad_Test_u",
+    "(Grad_Test2_u+Grad_Test2_u')*mu:Grad_Test_u",
+    "(Test2_u*mu+Test2_u*lambda-Test2_u/lambda).Test_u"
+  };
+  chrono ch;
+  for (const char *expr : expressions) {
+    getfem::ga_workspace workspace;
+    base_vector mu(1, 2.0), lambda(1, 5.0);
+    workspace.add_fixed_size_constant("mu", mu);
+    workspace.add_fixed_size_constant("lambda", lambda);
+    workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, ndofu), U);
+    workspace.add_expression(expr, mim);
+    getfem::model_real_sparse_matrix K(ndofu, ndofu);
+    workspace.set_assembled_matrix(K);
+    cout << expr << endl;
+    for (bool fusion : {false, true}) {
+      workspace.set_instruction_optimization(fusion);
+      workspace.assembly(2);
+      ch.init(); ch.tic();
+      for (size_type i = 0; i < 4; ++i) workspace.assembly(2);
+      ch.toc();
+      cout << "Elapsed time " << (fusion ? "with   " : "without")
+           << " instruction fusion " << ch.elapsed()/4. << endl;
+    }
+  }
+}
+
+// Effect of the execution of the arithmetic instructions on chunks of
+// elements (set_element_batching) on a residual and on tangent matrices.
+static void test_element_batching(int N, int NX, int pK) {
+
+  cout << "\n\n-------------------------------------\n"
+       <<     "Element batching in dimension " << N << " with P" << pK
+       <<     " elements"
+       <<   "\n-------------------------------------"
+       << endl << endl;
+
+  getfem::mesh m;
+  char Ns[5]; sprintf(Ns, "%d", N);
+  char Ks[5]; sprintf(Ks, "%d", pK);
+  bgeot::pgeometric_trans pgt =
+    bgeot::geometric_trans_descriptor
+    ((std::string("GT_PK(") + Ns + ",1)").c_str());
+  std::vector<size_type> nsubdiv(N, NX);
+  getfem::regular_unit_mesh(m, nsubdiv, pgt);
+
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_finite_element(m.convex_index(), getfem::fem_descriptor
+                          ((std::string("FEM_PK(") + Ns + "," + Ks
+                            + ")").c_str()));
+  mf_u.set_qdim(dim_type(N));
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(m.convex_index(), dim_type(2*pK));
+
+  std::vector<scalar_type> U(mf_u.nb_dof());
+  gmm::fill_random(U); gmm::scale(U, scalar_type(0.001));
+  size_type ndofu = mf_u.nb_dof();
+  cout << "ndofu = " << ndofu << endl;
+
+  const char *expressions[] = {
+    "((Grad_u+Grad_u')*mu+Trace(Grad_u)*lambda*Id(meshdim)):Grad_Test_u",
+    "((Grad_Test2_u+Grad_Test2_u')*mu"
+    "+Trace(Grad_Test2_u)*lambda*Id(meshdim)):Grad_Test_u",
+    "(Test2_u*mu).Test_u"
+  };
+  size_type orders[] = { 1, 2, 2 };
+  chrono ch;
+  for (size_type i = 0; i < 3; ++i) {
+    getfem::ga_workspace workspace;
+    base_vector mu(1, 2.0), lambda(1, 5.0);
+    workspace.add_fixed_size_constant("mu", mu);
+    workspace.add_fixed_size_constant("lambda", lambda);
+    workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, ndofu), U);
+    workspace.add_expression(expressions[i], mim);
+    getfem::model_real_sparse_matrix K(ndofu, ndofu);
+    workspace.set_assembled_matrix(K);
+    cout << expressions[i] << endl;
+    for (size_type nb : {0, 16, 64}) {
+      workspace.set_element_batching(nb);
+      workspace.assembly(orders[i]);
+      ch.init(); ch.tic();
+      for (size_type j = 0; j < 4; ++j) workspace.assembly(orders[i]);
+      ch.toc();
+      cout << "Elapsed time with chunks of " << nb << " elements "
+           << ch.elapsed()/4. << endl;
+    }
+  }
+}
+
 int main(int /* argc */, char * /* argv */[]) {
 
   GMM_SET_EXCEPTION_DEBUG; // Exceptions make a memory fault, to debug.
@@ -711,6 +897,23 @@ int main(int /* argc */, char * /* argv */[]) {
   // Laplacian            : 0.36 | 0.76 | 0.09 | 0.14 | 0.01 | 0.21 |
   // Homogeneous elas     : 2.74 | 5.23 | 0.82 | 1.41 | 0.01 | 1.32 |
   // Non-homogeneous elast: 2.66 | 47.4 | 0.82 | 1.41 | 0.01 | 1.24 |
+  if (all || only_one == 6) // ndofu = 46875
+    test_native_code(3, 12, 2);
+  //                    interp | native (first assembly)
+  // Residual           :  0.11 |  0.12 ( 0.12)
+  // Tangent matrix     :  1.41 |  1.20 ( 1.18)
+  if (all || only_one == 7) // ndofu = 46875
+    test_instruction_fusion(3, 12, 2);
+  //                     without | with fusion
+  // Elasticity tangent :  0.99    |  0.94
+  // Symmetric gradient :  0.68    |  0.67
+  // Vector mass        :  0.17    |  0.14
+  if (all || only_one == 8) // ndofu = 46875
+    test_element_batching(3, 12, 2);
+  //                     chunks of 0 | 16 | 64 elements
+  // Elastic residual   :  0.05 | 0.17 | 0.17
+  // Elastic tangent    :  0.46 | 0.57 | 0.56
+  // Vector mass        :  0.07 | 0.14 | 0.12
 
   // Conclusions :
   // - Deactivation of debug test has no sensible effect.
@@ -49,7 +49,7 @@ void gf_cont_struct(getfemint::mexargs_in& in, getfemint::mexargs_out& out) {
        name of the solver to be used for the incorporated linear systems
        (the default value is 'auto', which lets getfem choose itself);
        possible values are 'superlu', 'mumps' (if supported), 'cg/ildlt',
-       'gmres/ilu' and 'gmres/ilut';
+       'gmres/ilu', 'gmres/ilut', 'cg/amg' and 'gmres/amg';
     - 'h_init', @scalar HIN
        initial step size (the default value is 1e-2);
     - 'h_max', @scalar HMAX
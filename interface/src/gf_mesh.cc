@@ -277,7 +277,7 @@ regular_simplices_mesh(getfem::mesh *pmesh, getfemint::mexargs_in &in) {
   }
 
   for (dal::bv_visitor i(pmesh->points().index()); !i.finished(); ++i) {
-    getfem::base_node &p = pmesh->points()[i];
+    getfem::base_node p = pmesh->points()[i];
     for (unsigned k=0; k < N; ++k) {
       unsigned ii = unsigned(p[k] + 1e-6);
       assert(ii < xyz[k].size());
@@ -288,6 +288,7 @@ regular_simplices_mesh(getfem::mesh *pmesh, getfemint::mexargs_in &in) {
       if (noised && ii != 0 && ii != nsubdiv[k])
 	p[k] += diff[k] * gmm::random(double()) * 0.2 / K;
     }
+    pmesh->points().set_node(i, p);
   }
   pmesh->points().resort();
 }
@@ -133,9 +133,11 @@ void gf_mesh_set(getfemint::mexargs_in& m_in,
        darray P = in.pop().to_darray
        (pmesh->dim(),
         int(pmesh->points().index().last_true()+1));
+       getfem::base_node pt(pmesh->dim());
        for (dal::bv_visitor i(pmesh->points().index()); !i.finished(); ++i) {
          for (unsigned k=0; k < pmesh->dim(); ++k)
-           pmesh->points()[i][k] = P(k,i);
+           pt[k] = P(k,i);
+         pmesh->points().set_node(i, pt);
        }
        );
 
@@ -379,12 +381,16 @@ void gf_mesh_set(getfemint::mexargs_in& m_in,
     be consecutively numbered from @MATLAB{1 to MESH:GET('max pid')
     (resp. MESH:GET('max cvid'))}@SCILAB{1 to MESH:GET('max pid')
     (resp. MESH:GET('max cvid'))}@PYTHON{``0`` to
-    ``MESH:GET('max pid')-1`` (resp. ``MESH:GET('max cvid')-1``)}.@*/
+    ``MESH:GET('max pid')-1`` (resp. ``MESH:GET('max cvid')-1``)}.
+    `with_renumbering` selects the renumbering of the convexes: 0 for
+    none, 1 (default) for Cuthill-McKee, 2 (resp. 3) for an ordering of
+    the convexes and points along a Hilbert (resp. Morton) curve.@*/
     sub_command
       ("optimize structure", 0, 1, 0, 0,
-       bool with_renumbering = true;
-       if (in.remaining()) with_renumbering = (in.pop().to_integer(0,1) != 0);
-       pmesh->optimize_structure(with_renumbering);
+       int with_renumbering = 1;
+       if (in.remaining()) with_renumbering = in.pop().to_integer(0,3);
+       pmesh->optimize_structure
+       (getfem::mesh::renumbering_method(with_renumbering));
        );
 
 
@@ -409,7 +409,9 @@ void gf_model_get(getfemint::mexargs_in& m_in,
        select explicitely the solver used for the linear systems (the
        default value is 'auto', which lets getfem choose itself).
        Possible values are 'superlu', 'mumps' (if supported),
-       'cg/ildlt', 'gmres/ilu' and 'gmres/ilut'.
+       'cg/ildlt', 'gmres/ilu', 'gmres/ilut', 'cg/amg' and 'gmres/amg'
+       (algebraic multigrid preconditioner, optionally followed by
+       '/jacobi', '/gauss_seidel' or '/chebyshev' for the smoother).
     - 'lsearch', @str LINE_SEARCH_NAME
        select explicitely the line search method used for the linear systems (the
        default value is 'default').
@@ -21,252 +21,311 @@
 
 
 #include "getfem/bgeot_kdtree.h"
+#include "getfem/bgeot_node_tab.h"
+#include "getfem/getfem_omp.h"
+#include <numeric>
 
 namespace bgeot {
-  
-  /* leafs contains a list of points */
-  struct kdtree_leaf : public kdtree_elt_base {
-    kdtree_tab_type::const_iterator it;
-    kdtree_leaf(kdtree_tab_type::const_iterator begin, 
-		kdtree_tab_type::const_iterator end) : 
-      kdtree_elt_base(unsigned(std::distance(begin,end))) { it = begin; }
-  };
-  
-  struct kdtree_node : public kdtree_elt_base {
-    scalar_type split_v;
-    std::unique_ptr<kdtree_elt_base> left, right; /* left: <=v, right: >v */
-    kdtree_node(scalar_type v, std::unique_ptr<kdtree_elt_base> &&left_,
-		std::unique_ptr<kdtree_elt_base> &&right_) : 
-      kdtree_elt_base(0), split_v(v),
-      left(std::move(left_)), right(std::move(right_)) {}
-  };
 
-  typedef kdtree_tab_type::iterator ITER;
-  
-  /* sorting of kdtree_tab_type with respect to a component of the points */
+  /* sorting of point indexes with respect to one of their components */
   struct component_sort {
-    unsigned dir; 
-    component_sort(unsigned d) : dir(d) {}
-    bool operator()(const index_node_pair& a, const index_node_pair& b) 
-    { return a.n.at(dir) < b.n.at(dir); }
-  };
-  /* splitting of kdtree_tab_type with respect to a given value */
-  /*struct component_split { 
-    unsigned dir; scalar_type v;
-    component_split(unsigned d, scalar_type v_) : dir(d), v(v_) {}
-    bool operator()(const index_node_pair& a) 
-    { return (a.n.at(dir) <= v); }
+    const scalar_type *c;
+    component_sort(const scalar_type *c_) : c(c_) {}
+    bool operator()(size_type a, size_type b) const { return c[a] < c[b]; }
   };
-  */
 
-  static ITER partition(ITER begin, ITER end, unsigned dir, scalar_type median) {
-    --end;
-    do {
-      while (begin <= end && (*begin).n.at(dir) <= median) ++begin; 
-      while (begin <= end && (*end).n.at(dir) > median) --end;
-      if (begin < end) { begin->swap(*end); ++begin; --end; } else break;
-    } while (1);
-    return begin;
-  }
-  /* 
-     build (recursively) a complete tree for points in the interval
-     [begin, end[ dir is the splitting direction.
-     (may be ameliorated doing a single sort on each component at the begining)
+  /*
+     build the flat tree of the points pts. The tree is built level by
+     level: each node is split at the median of its points with respect to
+     the component of largest spread, and the nodes of a level are
+     processed in parallel. The coordinates are stored at the end in the
+     order of the leaves.
   */
-  static std::unique_ptr<kdtree_elt_base> build_tree_(ITER begin,
-						      ITER end, unsigned dir) {
-    if (begin == end) return 0;
-    size_type npts = std::distance(begin,end);
-    if (npts > kdtree_elt_base::PTS_PER_LEAF) {
-      ITER itmedian;
-      scalar_type median;
-      size_type N = begin->n.size();
-      unsigned ndir_tests = unsigned(dir/N); dir = unsigned(dir % N);
-      if (npts > 50) {
-	/* too much points for an exact median: estimation of the median .. */
-        std::vector<index_node_pair> v(30);
-        //random_sample(begin,end,v.begin(),v.end());
-	for (size_type i=0; i < v.size(); ++i) 
-	  v[i] = begin[rand() % npts];
-        std::sort(v.begin(), v.end(), component_sort(dir));
-        median = (v[v.size()/2-1].n.at(dir)+v[v.size()/2].n.at(dir))/2;
-        //itmedian = std::partition(begin,end,component_split(dir, median));
-	itmedian = partition(begin,end,dir,median);
-	/*ITER it = begin; cout << "}"; while (it < end) { 
-	  if (it == itmedian) cout << "<|>"; else cout << " ";
-	  cout << (*it).n[dir];
-	  ++it;
-	  } cout << "}\n";*/
+  static void build_flat_tree_(kdtree_flat &t, const kdtree_tab_type &pts,
+                               dim_type N) {
+    size_type n = pts.size();
+    t.n = n; t.depth = 0;
+    while (((n + (size_type(1) << t.depth) - 1) >> t.depth)
+           > kdtree_flat::PTS_PER_LEAF) ++(t.depth);
+    size_type nb_nodes = (size_type(1) << t.depth) - 1;
+    t.split_v.resize(nb_nodes); t.split_dir.resize(nb_nodes);
+    t.perm.resize(n);
+    std::iota(t.perm.begin(), t.perm.end(), size_type(0));
 
-      } else {
-	/* exact median computation */
-        std::sort(begin, end, component_sort(dir));
-        itmedian = begin + npts/2 - 1;
-        median = (*itmedian).n[dir];
-        while (itmedian < end && (*itmedian).n[dir] == median) itmedian++;
-      }
-      if (itmedian == end) /* could not split the set (all points have same value for component 'dir' !) */
-	if (ndir_tests == N-1) /* tested all N direction ? so all points are strictly the same */
-	  return std::make_unique<kdtree_leaf>(begin,end); 
-        else return std::make_unique<kdtree_node>
-	       (median, 
-		build_tree_(begin, itmedian, unsigned((dir+1)%N + (ndir_tests+1)*N)), std::unique_ptr<kdtree_node>());
-      else { /* the general case */
-	assert((*itmedian).n[dir] >= median && median >= (*(itmedian-1)).n[dir]);
-	return std::make_unique<kdtree_node>
-	  (median, build_tree_(begin, itmedian, unsigned((dir+1)%N)), 
-	   build_tree_(itmedian,end, unsigned((dir+1)%N)));
+    std::vector<scalar_type> c0(N*n);
+    getfem::parallel_chunks(n, [&](size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i)
+        for (dim_type k = 0; k < N; ++k) c0[k*n+i] = pts[i].n[k];
+    });
+
+    std::vector<size_type> bnd = {0, n}, nbnd;
+    for (unsigned l = 0; l < t.depth; ++l) {
+      size_type nb = bnd.size() - 1, first = nb - 1;
+      getfem::parallel_chunks(nb, [&](size_type i0, size_type i1) {
+        for (size_type i = i0; i < i1; ++i) {
+          size_type b = bnd[i], e = bnd[i+1], m = b + (e-b)/2;
+          dim_type dir = 0;
+          scalar_type spread(-1);
+          for (dim_type k = 0; k < N; ++k) {
+            const scalar_type *c = &c0[k*n];
+            scalar_type cmin = c[t.perm[b]], cmax = cmin;
+            for (size_type j = b+1; j < e; ++j) {
+              cmin = std::min(cmin, c[t.perm[j]]);
+              cmax = std::max(cmax, c[t.perm[j]]);
+            }
+            if (cmax - cmin > spread) { spread = cmax - cmin; dir = k; }
+          }
+          const scalar_type *c = &c0[dir*n];
+          std::nth_element(t.perm.begin()+b, t.perm.begin()+m,
+                           t.perm.begin()+e, component_sort(c));
+          t.split_v[first+i] = c[t.perm[m]];
+          t.split_dir[first+i] = dir;
+        }
+      });
+      nbnd.resize(2*nb+1);
+      for (size_type i = 0; i < nb; ++i) {
+        nbnd[2*i] = bnd[i]; nbnd[2*i+1] = bnd[i] + (bnd[i+1]-bnd[i])/2;
       }
-    } else {
-      return std::make_unique<kdtree_leaf>(begin,end);
+      nbnd[2*nb] = n;
+      bnd.swap(nbnd);
     }
+
+    t.coords.resize(N*n);
+    getfem::parallel_chunks(n, [&](size_type j0, size_type j1) {
+      for (dim_type k = 0; k < N; ++k)
+        for (size_type j = j0; j < j1; ++j)
+          t.coords[k*n+j] = c0[k*n+t.perm[j]];
+    });
   }
 
   /* avoid pushing too much arguments on the stack for points_in_box_ */
   struct points_in_box_data_ {
+    const kdtree_flat *t;
     base_node::const_iterator bmin;
     base_node::const_iterator bmax;
-    kdtree_tab_type *ipts;
-    size_type N;
+    std::vector<size_type> *ipts;
+    dim_type N;
   };
 
-  /* recursive lookup for points inside a given box */
-  static void points_in_box_(const points_in_box_data_& p,
-			     const kdtree_elt_base *t, unsigned dir) {
-    if (!t->isleaf()) {
-      const kdtree_node *tn = static_cast<const kdtree_node*>(t);
-      if (p.bmin[dir] <= tn->split_v && tn->left.get())
-        points_in_box_(p, tn->left.get(), unsigned((dir+1)%p.N));
-      if (p.bmax[dir] > tn->split_v && tn->right)
-        points_in_box_(p, tn->right.get(), unsigned((dir+1)%p.N));
+  /* recursive lookup for points inside a given box. The points equal
+     to the split value may lie on both sides. */
+  static void points_in_box_(const points_in_box_data_& p, size_type node,
+                             unsigned level, size_type b, size_type e) {
+    const kdtree_flat &t = *(p.t);
+    if (level < t.depth) {
+      size_type m = b + (e-b)/2;
+      dim_type dir = t.split_dir[node];
+      if (p.bmin[dir] <= t.split_v[node])
+        points_in_box_(p, 2*node+1, level+1, b, m);
+      if (p.bmax[dir] >= t.split_v[node])
+        points_in_box_(p, 2*node+2, level+1, m, e);
     } else {
-      const kdtree_leaf *tl = static_cast<const kdtree_leaf*>(t);
-      kdtree_tab_type::const_iterator itpt = tl->it;
-      for (size_type i=tl->n;i; --i, ++itpt) {
+      for (size_type j = b; j < e; ++j) {
         bool is_in = true;
-        base_node::const_iterator it=itpt->n.const_begin();
-        for (size_type k=0; k < p.N; ++k) {
-	  //cout << "test: k=" << k << ", " << it[k] << ", p.bmin[k]=" << p.bmin[k] << ", p.bmax[k]=" << p.bmax[k] << "\n";
-          if (it[k] < p.bmin[k] || it[k] > p.bmax[k]) {
-	    is_in = false; break; 
-	  }
+        for (dim_type k = 0; k < p.N && is_in; ++k) {
+          scalar_type x = t.coords[k*t.n+j];
+          is_in = (x >= p.bmin[k] && x <= p.bmax[k]);
         }
-        if (is_in) p.ipts->push_back(*itpt);
+        if (is_in) p.ipts->push_back(t.perm[j]);
       }
     }
   }
 
-  /* avoid pushing too much arguments on the stack for nearest_neighbor_ */
-  struct nearest_neighbor_data_ {
+  /* candidate for the k nearest neighbors: square of the distance and
+     position in the tree order. */
+  typedef std::pair<scalar_type, size_type> knn_candidate;
+
+  /* avoid pushing too much arguments on the stack for k_nearest_ */
+  struct k_nearest_data_ {
+    const kdtree_flat *t;
     base_node::const_iterator pos;
-    index_node_pair *ipt;
-    size_type N;
-    mutable scalar_type dist2;
-    base_node::iterator vec_to_tree_elm;
+    dim_type N;
+    size_type k;
+    scalar_type *off; /* lower bound of the distance to the current node,
+                         component by component */
+    std::vector<knn_candidate> *best; /* max-heap of the best candidates */
   };
 
-  /* recursive lookup for the nearest neighbor point at a given position */
-  static void nearest_neighbor_assist(const nearest_neighbor_data_& p,
-			              const kdtree_elt_base *t, unsigned dir) {
-    scalar_type dist2(0);
-    for (size_type k=0; k < p.N; ++k)
-      dist2 += p.vec_to_tree_elm[k] * p.vec_to_tree_elm[k];
-    if (dist2 > p.dist2 && p.dist2 > scalar_type(0)) return;
-
-    if (!t->isleaf()) {
-      const kdtree_node *tn = static_cast<const kdtree_node*>(t);
-      scalar_type tmp = p.vec_to_tree_elm[dir];
-      scalar_type dist = p.pos[dir] - tn->split_v;
-      if (tn->left.get()) {
-        if (dist > tmp) p.vec_to_tree_elm[dir] = dist;
-        nearest_neighbor_assist(p, tn->left.get(), unsigned((dir+1)%p.N));
-        p.vec_to_tree_elm[dir] = tmp;
-      }
-      if (tn->right) {
-        if (-dist > tmp) p.vec_to_tree_elm[dir] = -dist;
-        nearest_neighbor_assist(p, tn->right.get(), unsigned((dir+1)%p.N));
-        p.vec_to_tree_elm[dir] = tmp;
+  /* recursive lookup for the k nearest neighbors. off2 is a lower bound of
+     the square of the distance between pos and the points of the node. */
+  static void k_nearest_(const k_nearest_data_& p, size_type node,
+                         unsigned level, size_type b, size_type e,
+                         scalar_type off2) {
+    std::vector<knn_candidate> &best = *(p.best);
+    if (best.size() == p.k && off2 > best.front().first) return;
+    const kdtree_flat &t = *(p.t);
+    if (level < t.depth) {
+      size_type m = b + (e-b)/2;
+      dim_type dir = t.split_dir[node];
+      scalar_type diff = p.pos[dir] - t.split_v[node], old = p.off[dir];
+      scalar_type off = std::max(old, gmm::abs(diff));
+      scalar_type far2 = off2 - old*old + off*off;
+      if (diff <= scalar_type(0)) {
+        k_nearest_(p, 2*node+1, level+1, b, m, off2);
+        p.off[dir] = off;
+        k_nearest_(p, 2*node+2, level+1, m, e, far2);
+      } else {
+        k_nearest_(p, 2*node+2, level+1, m, e, off2);
+        p.off[dir] = off;
+        k_nearest_(p, 2*node+1, level+1, b, m, far2);
       }
+      p.off[dir] = old;
     } else {
-      // find the nearest neighbor inside the leaf
-      const kdtree_leaf *tl = static_cast<const kdtree_leaf*>(t);
-      kdtree_tab_type::const_iterator itpt = tl->it;
-      for (size_type i=tl->n;i; --i, ++itpt) {
-        dist2 = scalar_type(0);
-        base_node::const_iterator it=itpt->n.const_begin();
-        for (size_type k=0; k < p.N; ++k) {
-          scalar_type dist = it[k] - p.pos[k];
-          dist2 += dist * dist;
+      /* distances computed component by component on contiguous arrays */
+      scalar_type d2[kdtree_flat::PTS_PER_LEAF];
+      size_type nl = e - b;
+      for (size_type j = 0; j < nl; ++j) d2[j] = scalar_type(0);
+      for (dim_type k = 0; k < p.N; ++k) {
+        const scalar_type *c = &t.coords[k*t.n+b];
+        scalar_type x = p.pos[k];
+        for (size_type j = 0; j < nl; ++j) {
+          scalar_type a = c[j] - x;
+          d2[j] += a*a;
         }
-        if (dist2 < p.dist2 || p.dist2 < scalar_type(0)){
-          *(p.ipt) = *itpt;
-          p.dist2 = dist2;
+      }
+      for (size_type j = 0; j < nl; ++j) {
+        if (best.size() < p.k) {
+          best.push_back(knn_candidate(d2[j], b+j));
+          std::push_heap(best.begin(), best.end());
+        } else if (d2[j] < best.front().first) {
+          std::pop_heap(best.begin(), best.end());
+          best.back() = knn_candidate(d2[j], b+j);
+          std::push_heap(best.begin(), best.end());
         }
       }
     }
   }
 
-  static void nearest_neighbor_main(const nearest_neighbor_data_& p,
-			            const kdtree_elt_base *t, unsigned dir) {
-    if (!t->isleaf()) {
-      const kdtree_node *tn = static_cast<const kdtree_node*>(t);
-      scalar_type dist = p.pos[dir] - tn->split_v;
-      if ((dist <= scalar_type(0) && tn->left.get()) || !tn->right.get()) {
-        nearest_neighbor_main(p, tn->left.get(), unsigned((dir+1)%p.N));
-      } else if (tn->right.get()) {
-        nearest_neighbor_main(p, tn->right.get(), unsigned((dir+1)%p.N));
-      } else {
-        assert(false);
-      }
-      // check the possibility of points at the opposite side of the current
-      // tree node which are closer to pos as the current minimum distance
-      if (dist * dist <= p.dist2) {
-        for (size_type k=0; k < p.N; ++k) p.vec_to_tree_elm[k] = 0.;
-        if ((dist <= scalar_type(0) && tn->right.get()) || !tn->left.get()) {
-          p.vec_to_tree_elm[dir] = -dist;
-          nearest_neighbor_assist(p, tn->right.get(), unsigned((dir+1)%p.N));
-        } else if (tn->left.get()) {
-          p.vec_to_tree_elm[dir] = dist;
-          nearest_neighbor_assist(p, tn->left.get(), unsigned((dir+1)%p.N));
-        }
+  /* fills best with the k nearest neighbors sorted by increasing distance */
+  static void k_nearest_neighbors_(const kdtree_flat &t, dim_type N,
+                                   const base_node &pos, size_type k,
+                                   std::vector<knn_candidate> &best,
+                                   std::vector<scalar_type> &off) {
+    best.resize(0);
+    off.assign(N, scalar_type(0));
+    k_nearest_data_ p;
+    p.t = &t; p.pos = pos.const_begin(); p.N = N; p.k = k;
+    p.off = off.data(); p.best = &best;
+    k_nearest_(p, 0, 0, 0, t.n, scalar_type(0));
+    std::sort_heap(best.begin(), best.end());
+  }
+
+  const kdtree_flat &kdtree::build_tree() const {
+    const kdtree_flat *p = tree.load(std::memory_order_acquire);
+    if (!p) {
+      GLOBAL_OMP_GUARD
+      p = tree.load(std::memory_order_acquire);
+      if (!p) {
+        kdtree_flat *t = new kdtree_flat;
+        build_flat_tree_(*t, pts, N);
+        p = t;
+        tree.store(p, std::memory_order_release);
       }
-    } else {
-      // find the nearest neighbor inside the leaf which contains pos
-      nearest_neighbor_assist(p, t, dir);
     }
+    return *p;
   }
 
-  void kdtree::clear_tree() { tree = std::unique_ptr<kdtree_elt_base>(); }
+  void kdtree::clear_tree() {
+    const kdtree_flat *p = tree.exchange(0);
+    if (p) delete p;
+  }
+
+  void kdtree::points_in_box(std::vector<size_type> &ipts,
+                             const base_node &min,
+                             const base_node &max) const {
+    ipts.resize(0);
+    if (pts.size() == 0) return;
+    for (size_type i=0; i < N; ++i) if (min[i] > max[i]) return;
+    points_in_box_data_ p;
+    p.t = &(build_tree());
+    p.bmin = min.const_begin(); p.bmax = max.const_begin();
+    p.ipts = &ipts; p.N = N;
+    points_in_box_(p, 0, 0, 0, pts.size());
+  }
 
   void kdtree::points_in_box(kdtree_tab_type &ipts,
-			     const base_node &min, 
-			     const base_node &max) {
+                             const base_node &min,
+                             const base_node &max) const {
+    THREAD_SAFE_STATIC std::vector<size_type> idx;
+    points_in_box(idx, min, max);
     ipts.resize(0);
-    if (tree == 0) { tree = build_tree_(pts.begin(), pts.end(), 0); if (!tree) return; }
-    base_node bmin(min), bmax(max);
-    for (size_type i=0; i < bmin.size(); ++i) if (bmin[i] > bmax[i]) return;
-    points_in_box_data_ p; 
-    p.bmin = bmin.const_begin(); p.bmax = bmax.const_begin();
-    p.ipts = &ipts; p.N = N; 
-    points_in_box_(p, tree.get(), 0);
+    for (size_type j : idx) ipts.push_back(pts[j]);
   }
 
   scalar_type kdtree::nearest_neighbor(index_node_pair &ipt,
-                                       const base_node &pos) {
-    
+                                       const base_node &pos) const {
     ipt.i = size_type(-1);
-    if (tree == 0) {
-      tree = build_tree_(pts.begin(), pts.end(), 0);
-      if (!tree) return scalar_type(-1);
+    if (pts.size() == 0) return scalar_type(-1);
+    const kdtree_flat &t = build_tree();
+    THREAD_SAFE_STATIC std::vector<knn_candidate> best;
+    THREAD_SAFE_STATIC std::vector<scalar_type> off;
+    k_nearest_neighbors_(t, N, pos, 1, best, off);
+    ipt = pts[t.perm[best[0].second]];
+    return best[0].first;
+  }
+
+  void kdtree::nearest_neighbors(const std::vector<base_node> &pos,
+                                 std::vector<size_type> &ids,
+                                 std::vector<scalar_type> &dist2) const {
+    ids.assign(pos.size(), size_type(-1));
+    dist2.assign(pos.size(), scalar_type(-1));
+    if (pts.size() == 0) return;
+    const kdtree_flat &t = build_tree();
+    /* close positions are processed by the same thread */
+    std::vector<size_type> order;
+    space_filling_curve_order(pos, order);
+    getfem::parallel_chunks(pos.size(), [&](size_type i0, size_type i1) {
+      std::vector<knn_candidate> best;
+      std::vector<scalar_type> off;
+      for (size_type ii = i0; ii < i1; ++ii) {
+        size_type i = order[ii];
+        k_nearest_neighbors_(t, N, pos[i], 1, best, off);
+        ids[i] = pts[t.perm[best[0].second]].i;
+        dist2[i] = best[0].first;
+      }
+    });
+  }
+
+  size_type kdtree::k_nearest_neighbors(const base_node &pos, size_type k,
+                                        std::vector<size_type> &ids,
+                                        std::vector<scalar_type> &dist2)
+    const {
+    ids.resize(0); dist2.resize(0);
+    if (pts.size() == 0 || k == 0) return 0;
+    const kdtree_flat &t = build_tree();
+    THREAD_SAFE_STATIC std::vector<knn_candidate> best;
+    THREAD_SAFE_STATIC std::vector<scalar_type> off;
+    k_nearest_neighbors_(t, N, pos, k, best, off);
+    for (const knn_candidate &c : best) {
+      ids.push_back(pts[t.perm[c.second]].i);
+      dist2.push_back(c.first);
     }
-    nearest_neighbor_data_ p;
-    p.pos = pos.const_begin();
-    p.ipt = &ipt;
-    p.N = N;
-    p.dist2 = scalar_type(-1);
-    base_node tmp(N);
-    p.vec_to_tree_elm = tmp.begin();
-    nearest_neighbor_main(p, tree.get(), 0);
-    return p.dist2;
+    return best.size();
+  }
+
+  size_type kdtree::k_nearest_neighbors(const std::vector<base_node> &pos,
+                                        size_type k,
+                                        std::vector<size_type> &ids,
+                                        std::vector<scalar_type> &dist2)
+    const {
+    size_type m = std::min(k, pts.size());
+    ids.resize(m*pos.size()); dist2.resize(m*pos.size());
+    if (m == 0) return 0;
+    const kdtree_flat &t = build_tree();
+    std::vector<size_type> order;
+    space_filling_curve_order(pos, order);
+    getfem::parallel_chunks(pos.size(), [&](size_type i0, size_type i1) {
+      std::vector<knn_candidate> best;
+      std::vector<scalar_type> off;
+      for (size_type ii = i0; ii < i1; ++ii) {
+        size_type i = order[ii];
+        k_nearest_neighbors_(t, N, pos[i], m, best, off);
+        for (size_type l = 0; l < m; ++l) {
+          ids[i*m+l] = pts[t.perm[best[l].second]].i;
+          dist2[i*m+l] = best[l].first;
+        }
+      }
+    });
+    return m;
   }
 }
@@ -26,6 +26,87 @@
 namespace bgeot {
 
 
+  /* ******************************************************************** */
+  /*  Compact copy of the connectivity.                                   */
+  /* ******************************************************************** */
+
+  template <typename IND>
+  void mesh_structure_csr::build(const mesh_structure &ms, csr_tab<IND> &tab) {
+    size_type nbcv = ms.nb_allocated_convex(), nbpt = ms.nb_max_points();
+    const dal::bit_vector &cvs = ms.convex_index();
+    tab.cv_offset.assign(nbcv+1, IND(0));
+    for (dal::bv_visitor cv(cvs); !cv.finished(); ++cv)
+      tab.cv_offset[cv+1] = IND(ms.ind_points_of_convex(cv).size());
+    for (size_type cv = 0; cv < nbcv; ++cv)
+      tab.cv_offset[cv+1] = IND(tab.cv_offset[cv+1] + tab.cv_offset[cv]);
+    tab.cv_points.resize(tab.cv_offset[nbcv]);
+    for (dal::bv_visitor cv(cvs); !cv.finished(); ++cv) {
+      const mesh_structure::ind_set &ct = ms.ind_points_of_convex(cv);
+      std::copy(ct.begin(), ct.end(), tab.cv_points.begin()+tab.cv_offset[cv]);
+    }
+
+    tab.pt_offset.assign(nbpt+1, IND(0));
+    for (size_type ip = 0; ip < nbpt; ++ip)
+      tab.pt_offset[ip+1] = IND(tab.pt_offset[ip]
+                                + ms.convex_to_point(ip).size());
+    tab.pt_convexes.resize(tab.pt_offset[nbpt]);
+    for (size_type ip = 0; ip < nbpt; ++ip) {
+      const mesh_structure::ind_cv_ct &ct = ms.convex_to_point(ip);
+      std::copy(ct.begin(), ct.end(),
+                tab.pt_convexes.begin()+tab.pt_offset[ip]);
+    }
+  }
+
+  mesh_structure_csr::mesh_structure_csr(const mesh_structure &ms) {
+    size_type nb = 0;
+    for (dal::bv_visitor cv(ms.convex_index()); !cv.finished(); ++cv)
+      nb += ms.ind_points_of_convex(cv).size();
+    size_type limit = size_type(std::numeric_limits<uint32_t>::max());
+    short_ind = (nb < limit && ms.nb_allocated_convex() < limit
+                 && ms.nb_max_points() < limit);
+    if (short_ind) build(ms, tab32); else build(ms, tab64);
+  }
+
+  size_type mesh_structure_csr::memsize() const {
+    return sizeof(mesh_structure_csr)
+      + (tab32.cv_offset.size() + tab32.cv_points.size()
+         + tab32.pt_offset.size() + tab32.pt_convexes.size())*sizeof(uint32_t)
+      + (tab64.cv_offset.size() + tab64.cv_points.size()
+         + tab64.pt_offset.size() + tab64.pt_convexes.size())*sizeof(size_type);
+  }
+
+  std::shared_ptr<const mesh_structure_csr>
+  mesh_structure::frozen_structure() const {
+    // frozen_tab is only written before frozen_tab_valid is set, and
+    // cleared by the modifications of the structure.
+    if (!frozen_tab_valid.load(std::memory_order_acquire)) {
+      GLOBAL_OMP_GUARD
+      if (!frozen_tab_valid.load(std::memory_order_acquire)) {
+        frozen_tab = std::make_shared<mesh_structure_csr>(*this);
+        frozen_tab_valid.store(true, std::memory_order_release);
+      }
+    }
+    return frozen_tab;
+  }
+
+  void mesh_structure::touch_structure() {
+    frozen_tab_valid = false;
+    frozen_tab.reset();
+  }
+
+  mesh_structure::mesh_structure(const mesh_structure &ms)
+    : convex_tab(ms.convex_tab), points_tab(ms.points_tab),
+      frozen(ms.frozen), frozen_tab_valid(false) {}
+
+  mesh_structure &mesh_structure::operator =(const mesh_structure &ms) {
+    if (this != &ms) {
+      touch_structure();
+      convex_tab = ms.convex_tab; points_tab = ms.points_tab;
+      frozen = ms.frozen;
+    }
+    return *this;
+  }
+
   dal::bit_vector mesh_structure::convex_index(dim_type n) const {
     dal::bit_vector res = convex_tab.index();
     for (dal::bv_visitor cv(convex_tab.index()); !cv.finished(); ++cv)
@@ -46,6 +127,7 @@ namespace bgeot {
 
   void mesh_structure::swap_points(size_type i, size_type j) {
     if (i == j) return;
+    touch_structure();
     std::vector<size_type> doubles;
 
     for (size_type k = 0; k < points_tab[i].size(); ++k) {
@@ -68,6 +150,7 @@ namespace bgeot {
 
   void mesh_structure::swap_convex(size_type i, size_type j) {
     if (i == j) return;
+    touch_structure();
     std::vector<size_type> doubles;
 
     if (is_convex_valid(i))
@@ -90,6 +173,39 @@ namespace bgeot {
     convex_tab.swap(i,j);
   }
 
+  void mesh_structure::permute_convexes
+  (const std::vector<size_type> &new_num) {
+    size_type nbc = convex_tab.card();
+    GMM_ASSERT1(nb_allocated_convex() == nbc && new_num.size() >= nbc,
+                "The convex numbering should be compact");
+    touch_structure();
+    std::vector<mesh_convex_structure> old(nbc);
+    for (size_type i = 0; i < nbc; ++i) {
+      old[i].cstruct = convex_tab[i].cstruct;
+      old[i].pts.swap(convex_tab[i].pts);
+    }
+    for (size_type i = 0; i < nbc; ++i) {
+      mesh_convex_structure &c = convex_tab[new_num[i]];
+      c.cstruct = old[i].cstruct;
+      c.pts.swap(old[i].pts);
+    }
+    for (size_type ip = 0; ip < points_tab.size(); ++ip)
+      for (size_type &cv : points_tab[ip]) cv = new_num[cv];
+  }
+
+  void mesh_structure::permute_points(const std::vector<size_type> &new_num) {
+    touch_structure();
+    point_ct npt;
+    for (size_type ip = 0; ip < points_tab.size(); ++ip)
+      if (!points_tab[ip].empty()) {
+        GMM_ASSERT1(ip < new_num.size(), "Wrong size of the permutation");
+        npt[new_num[ip]].swap(points_tab[ip]);
+      }
+    points_tab.swap(npt);
+    for (dal::bv_visitor cv(convex_tab.index()); !cv.finished(); ++cv)
+      for (size_type &ip : convex_tab[cv].pts) ip = new_num[ip];
+  }
+
   size_type mesh_structure::add_segment(size_type a, size_type b) {
     static pconvex_structure cs = NULL;
     if (!cs) cs = simplex_structure(1);
@@ -99,6 +215,7 @@ namespace bgeot {
 
   void mesh_structure::sup_convex(size_type ic) {
     if (!(is_convex_valid(ic))) return;
+    touch_structure();
     for (size_type l = 0; l < convex_tab[ic].pts.size(); ++l) {
       size_type &ind = convex_tab[ic].pts[l];
       std::vector<size_type>::iterator it1= points_tab[ind].begin(), it2 = it1;
@@ -185,6 +302,7 @@ namespace bgeot {
       mems += convex_tab[i].pts.size() * sizeof(size_type);
     for (size_type i = 0; i < points_tab.size(); ++i)
       mems += points_tab[i].size() * sizeof(size_type);
+    if (frozen_tab) mems += frozen_tab->memsize();
     return mems;
   }
 
@@ -205,7 +323,7 @@ namespace bgeot {
   void mesh_structure::clear(void) {
     points_tab = dal::dynamic_tas<ind_cv_ct, 8>();
     convex_tab = dal::dynamic_tas<mesh_convex_structure, 8>();
-
+    touch_structure();
   }
 
   void mesh_structure::stat(void) {
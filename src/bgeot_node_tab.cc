@@ -21,6 +21,8 @@
 
 
 #include "getfem/bgeot_node_tab.h"
+#include <unordered_map>
+#include <algorithm>
 
 namespace bgeot {
 
@@ -86,7 +88,49 @@ namespace bgeot {
     GMM_ASSERT1(false, "Problem in node structure !!");
   }
 
+  // The contiguous coordinates are only written by the first call to
+  // coordinates() and by the modifications of the node_tab.
+  const scalar_type *node_tab::coordinates() const {
+    if (!coords_built.load(std::memory_order_acquire)) {
+      GLOBAL_OMP_GUARD
+      if (!coords_built.load(std::memory_order_acquire)) {
+        const_cast<node_tab *>(this)->update_coordinates();
+        coords_built.store(true, std::memory_order_release);
+      }
+    }
+    return coords.data();
+  }
+
+  void node_tab::update_coordinates(void) {
+    coords.assign((index().last_true()+1)*dim_, scalar_type(0));
+    for (dal::bv_visitor i(index()); !i.finished(); ++i)
+      std::copy((*this)[i].begin(), (*this)[i].end(), coords.begin()+i*dim_);
+  }
+
+  void node_tab::update_coordinates(size_type i) {
+    if (!coords_built) return;
+    if (coords.size() < (i+1)*dim_) coords.resize((i+1)*dim_);
+    if (index().is_in(i))
+      std::copy((*this)[i].begin(), (*this)[i].end(), coords.begin()+i*dim_);
+    else
+      std::fill(coords.begin()+i*dim_, coords.begin()+(i+1)*dim_,
+                scalar_type(0));
+  }
+
+  void node_tab::set_node(size_type i, const base_node &pt) {
+    GMM_ASSERT1(index().is_in(i), "Node " << i << " does not exist");
+    GMM_ASSERT1(dim_ == pt.size(), "Nodes should have the same dimension");
+    max_radius = std::max(max_radius, gmm::vect_norm2(pt));
+    eps = max_radius * prec_factor;
+    for (size_type is = 0; is < sorters.size(); ++is) sorters[is].erase(i);
+    dal::dynamic_tas<base_node>::operator[](i) = pt;
+    for (size_type is = 0; is < sorters.size(); ++is) sorters[is].insert(i);
+    update_coordinates(i);
+  }
+
   void node_tab::clear() {
+    std::vector<scalar_type>().swap(coords);
+    coords_built = false;
     dal::dynamic_tas<base_node>::clear();
     sorters = std::vector<sorter>();
     max_radius = scalar_type(1e-60);
@@ -100,9 +144,10 @@ namespace bgeot {
     max_radius = std::max(max_radius, npt);
     eps = max_radius * prec_factor;
 
-    if (this->card() == 0)
+    if (this->card() == 0) {
+      if (dim_ != pt.size()) coords.clear();
       dim_ = pt.size();
-    else
+    } else
       GMM_ASSERT1(dim_ == pt.size(), "Nodes should have the same dimension");
     size_type id(-1);
     if (remove_duplicated_nodes && radius >= 0.)
@@ -113,10 +158,89 @@ namespace bgeot {
         sorters[i].insert(id);
         GMM_ASSERT3(sorters[i].size() == card(), "internal error");
       }
+      update_coordinates(id);
     }
     return id;
   }
 
+  // Hash of the cell of integer coordinates c + offset, where the k-th
+  // component of offset is dir[k] if the k-th bit of ic is set, 0 otherwise.
+  static size_type node_grid_key(const std::vector<long long> &c,
+                                 const std::vector<long long> &dir,
+                                 size_type ic) {
+    size_type key = 0;
+    for (size_type k = 0; k < c.size(); ++k, ic >>= 1)
+      key = (key * size_type(73856093))
+        ^ size_type(c[k] + ((ic & 1) ? dir[k] : 0));
+    return key;
+  }
+
+  void node_tab::add_nodes(const std::vector<base_node> &pts,
+                           std::vector<size_type> &ids,
+                           const scalar_type radius, bool merge_new) {
+    ids.resize(pts.size());
+    if (pts.size() == 0) return;
+    if (this->card() == 0) {
+      if (dim_ != pts[0].size()) coords.clear();
+      dim_ = unsigned(pts[0].size());
+    }
+    for (const base_node &pt : pts) {
+      GMM_ASSERT1(dim_ == pt.size(), "Nodes should have the same dimension");
+      max_radius = std::max(max_radius, gmm::vect_norm2(pt));
+    }
+    eps = max_radius * prec_factor;
+    resort();
+
+    if (radius < 0.) {
+      for (size_type i = 0; i < pts.size(); ++i)
+        ids[i] = dal::dynamic_tas<base_node>::add(pts[i]);
+      if (coords_built) update_coordinates();
+      return;
+    }
+
+    // Uniform grid of step twice the merging distance: the nodes close to
+    // a point are in its cell or in the neighbour cells on the side of the
+    // nearest cell faces, i.e. in 2^N cells. The nodes of a cell are
+    // chained with the array next.
+    scalar_type radius_eps = std::max(eps, radius), h = 2. * radius_eps;
+    size_type nbc = size_type(1) << dim_;
+    std::unordered_map<size_type, size_type> first;
+    std::vector<size_type> next(index().last_true()+1+pts.size(),
+                                size_type(-1));
+    std::vector<long long> cell(dim_), dir(dim_);
+    auto cell_of = [&](const base_node &pt) {
+      for (size_type k = 0; k < dim_; ++k) {
+        scalar_type a = pt[k] / h, fa = std::floor(a);
+        cell[k] = (long long)(fa); dir[k] = (a - fa < 0.5) ? -1 : 1;
+      }
+    };
+    auto insert = [&](size_type id) {
+      auto r = first.emplace(node_grid_key(cell, dir, 0), id);
+      if (!r.second) { next[id] = r.first->second; r.first->second = id; }
+    };
+    first.reserve(card() + pts.size());
+    for (dal::bv_visitor i(index()); !i.finished(); ++i)
+      { cell_of((*this)[i]); insert(i); }
+
+    for (size_type i = 0; i < pts.size(); ++i) {
+      const base_node &pt = pts[i];
+      size_type id(-1);
+      cell_of(pt);
+      for (size_type ic = 0; ic < nbc && id == size_type(-1); ++ic) {
+        auto it = first.find(node_grid_key(cell, dir, ic));
+        if (it != first.end())
+          for (size_type j = it->second; j != size_type(-1); j = next[j])
+            if (gmm::vect_dist2(pt, (*this)[j]) < radius_eps) { id = j; break; }
+      }
+      if (id == size_type(-1)) {
+        id = dal::dynamic_tas<base_node>::add(pt);
+        if (merge_new) insert(id);
+        update_coordinates(id);
+      }
+      ids[i] = id;
+    }
+  }
+
   void node_tab::swap_points(size_type i, size_type j) {
     if (i != j) {
       bool existi = index().is_in(i), existj = index().is_in(j);
@@ -130,9 +254,22 @@ namespace bgeot {
         if (existj) sorters[is].insert(i);
         GMM_ASSERT3(sorters[is].size() == card(), "internal error");
       }
+      update_coordinates(i); update_coordinates(j);
     }
   }
 
+  void node_tab::permute_points(const std::vector<size_type> &new_num) {
+    size_type nb = card();
+    GMM_ASSERT1(size() == nb && new_num.size() >= nb,
+                "The node numbering should be compact");
+    resort();
+    std::vector<base_node> old(nb);
+    dynamic_tas<base_node> &nodes = *this;
+    for (size_type i = 0; i < nb; ++i) std::swap(old[i], nodes[i]);
+    for (size_type i = 0; i < nb; ++i) std::swap(nodes[new_num[i]], old[i]);
+    if (coords_built) update_coordinates();
+  }
+
   void node_tab::sup_node(size_type i) {
     if (index().is_in(i)) {
       for (size_type is = 0; is < sorters.size(); ++is) {
@@ -141,13 +278,15 @@ namespace bgeot {
         // if (sorters[is].size()+1 != card()) { resort(); }
       }
       dal::dynamic_tas<base_node>::sup(i);
-
+      update_coordinates(i);
     }
   }
 
   void node_tab::translation(const base_small_vector &V) {
-    for (dal::bv_visitor i(index()); !i.finished(); ++i) (*this)[i] += V;
+    dynamic_tas<base_node> &nodes = *this;
+    for (dal::bv_visitor i(index()); !i.finished(); ++i) nodes[i] += V;
     resort();
+    if (coords_built) update_coordinates();
   }
 
   void node_tab::transformation(const base_matrix &M) {
@@ -155,26 +294,87 @@ namespace bgeot {
     GMM_ASSERT1(gmm::mat_nrows(M) != 0 && gmm::mat_ncols(M) == dim(),
                 "invalid dimensions for the transformation matrix");
     dim_ = unsigned(gmm::mat_nrows(M));
+    dynamic_tas<base_node> &nodes = *this;
     for (dal::bv_visitor i(index()); !i.finished(); ++i) {
-      w = (*this)[i];
-      gmm::resize((*this)[i], dim_);
-      gmm::mult(M,w,(*this)[i]);
+      w = nodes[i];
+      gmm::resize(nodes[i], dim_);
+      gmm::mult(M,w,nodes[i]);
     }
     resort();
+    if (coords_built) update_coordinates();
   }
 
-  node_tab::node_tab(scalar_type prec_loose) {
+  node_tab::node_tab(scalar_type prec_loose) : coords(), coords_built(false) {
     max_radius = scalar_type(1e-60);
     sorters.reserve(5);
     prec_factor = gmm::default_tol(scalar_type()) * prec_loose;
     eps = max_radius * prec_factor;
   }
 
+  /* Position of the point of integer coordinates X (bits bits each) along
+     the Hilbert curve, in "transposed" form (J. Skilling, Programming the
+     Hilbert curve, AIP Conf. Proc. 707, 2004). */
+  static void hilbert_transpose(std::vector<uint64_t> &X, unsigned bits) {
+    size_type n = X.size();
+    uint64_t M = uint64_t(1) << (bits-1);
+    for (uint64_t Q = M; Q > 1; Q >>= 1) {
+      uint64_t P = Q - 1;
+      for (size_type i = 0; i < n; ++i)
+        if (X[i] & Q) X[0] ^= P;
+        else { uint64_t t = (X[0] ^ X[i]) & P; X[0] ^= t; X[i] ^= t; }
+    }
+    for (size_type i = 1; i < n; ++i) X[i] ^= X[i-1];
+    uint64_t t = 0;
+    for (uint64_t Q = M; Q > 1; Q >>= 1) if (X[n-1] & Q) t ^= Q-1;
+    for (size_type i = 0; i < n; ++i) X[i] ^= t;
+  }
+
+  void space_filling_curve_order(const std::vector<base_node> &pts,
+                                 std::vector<size_type> &order,
+                                 bool hilbert) {
+    size_type nb = pts.size();
+    order.resize(nb);
+    for (size_type i = 0; i < nb; ++i) order[i] = i;
+    if (nb < 2) return;
+    size_type N = pts[0].size();
+    if (N == 0) return;
+    unsigned bits = unsigned(std::min(size_type(21), size_type(63) / N));
+    if (bits == 0) bits = 1;
+
+    base_node Pmin = pts[0], Pmax = pts[0];
+    for (const base_node &pt : pts)
+      for (size_type k = 0; k < N; ++k) {
+        Pmin[k] = std::min(Pmin[k], pt[k]);
+        Pmax[k] = std::max(Pmax[k], pt[k]);
+      }
+    scalar_type h = scalar_type(0);
+    for (size_type k = 0; k < N; ++k) h = std::max(h, Pmax[k] - Pmin[k]);
+    scalar_type maxc = scalar_type((uint64_t(1) << bits) - 1);
+    scalar_type scale = (h > scalar_type(0)) ? maxc / h : scalar_type(0);
+
+    std::vector<std::pair<uint64_t, size_type> > keys(nb);
+    std::vector<uint64_t> X(N);
+    for (size_type i = 0; i < nb; ++i) {
+      for (size_type k = 0; k < N; ++k)
+        X[k] = uint64_t(std::min(maxc, (pts[i][k] - Pmin[k]) * scale));
+      if (hilbert) hilbert_transpose(X, bits);
+      uint64_t key = 0;
+      for (unsigned b = bits; b-- > 0; )
+        for (size_type k = 0; k < N; ++k) key = (key << 1) | ((X[k] >> b) & 1);
+      keys[i] = std::make_pair(key, i);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_type i = 0; i < nb; ++i) order[i] = keys[i].second;
+  }
+
   node_tab::node_tab(const node_tab &t)
     : dal::dynamic_tas<base_node>(t), sorters(), eps(t.eps),
-      prec_factor(t.prec_factor), max_radius(t.max_radius), dim_(t.dim_)  {}
+      prec_factor(t.prec_factor), max_radius(t.max_radius), dim_(t.dim_),
+      coords(), coords_built(false) {}
 
   node_tab &node_tab::operator =(const node_tab &t) {
+    std::vector<scalar_type>().swap(coords);
+    coords_built = false;
     dal::dynamic_tas<base_node>::operator =(t);
     sorters = std::vector<sorter>();
     eps = t.eps; prec_factor = t.prec_factor;
@@ -134,7 +134,7 @@ namespace bgeot {
     size_type cv_stored(-1);
 
     auto &box_tree = mp->box_tree;
-    rtree::pbox_set box_list;
+    THREAD_SAFE_STATIC rtree::pbox_cont box_list;
     box_tree.find_boxes_at_point(p, box_list);
     
     while (box_list.size()) {
@@ -178,7 +178,7 @@ namespace bgeot {
       }
         
       if (box_list.size() == 1) break;
-      box_list.erase(pmax_box);
+      box_list.erase(std::find(box_list.begin(), box_list.end(), pmax_box));
     }
     if (cv_stored != size_type(-1)) {
       scalar_type res =
@@ -120,8 +120,8 @@ namespace bgeot {
   /* match boxes intersecting the line passing through org and of
      direction vector dirv.*/
   struct intersect_line {
-    const base_node org;
-    const base_small_vector dirv;
+    const base_node &org;
+    const base_small_vector &dirv;
     intersect_line(const base_node& org_, const base_small_vector &dirv_)
       : org(org_), dirv(dirv_) {}
     bool operator()(const base_node& min2, const base_node& max2) const {
@@ -148,9 +148,9 @@ namespace bgeot {
   /* match boxes intersecting the line passing through org and of
      direction vector dirv.*/
   struct intersect_line_and_box {
-    const base_node org;
-    const base_small_vector dirv;
-    const base_node min,max;
+    const base_node &org;
+    const base_small_vector &dirv;
+    const base_node &min, &max;
     const scalar_type EPS;
     intersect_line_and_box(const base_node& org_,
                            const base_small_vector &dirv_,
@@ -204,14 +204,36 @@ namespace bgeot {
     tree_built = false;
   }
 
-  template <typename Predicate>
-  static void find_matching_boxes_(rtree_elt_base *n, rtree::pbox_set& boxlst,
+  static void add_box_(rtree::pbox_set& boxlst, const box_index *pb)
+  { boxlst.insert(pb); }
+  static void add_box_(rtree::pbox_cont& boxlst, const box_index *pb)
+  { boxlst.push_back(pb); }
+
+  /* a box may be stored in several leaves */
+  static void sort_and_unique_(rtree::pbox_cont& boxlst) {
+    std::sort(boxlst.begin(), boxlst.end(), box_index_id_compare());
+    boxlst.erase(std::unique(boxlst.begin(), boxlst.end()), boxlst.end());
+  }
+
+  static rtree::pbox_cont &scratch_boxes_() {
+    THREAD_SAFE_STATIC rtree::pbox_cont bs;
+    return bs;
+  }
+
+  static void pbox_cont_to_idvec_(const rtree::pbox_cont &bs,
+                                  std::vector<size_type>& idvec) {
+    idvec.resize(bs.size());
+    for (size_type i = 0; i < bs.size(); ++i) idvec[i] = bs[i]->id;
+  }
+
+  template <typename Predicate, typename CONT>
+  static void find_matching_boxes_(rtree_elt_base *n, CONT& boxlst,
                                    const Predicate &p) {
     if (n->isleaf()) {
       const rtree_leaf *rl = static_cast<rtree_leaf*>(n);
       for (rtree::pbox_cont::const_iterator it = rl->lst.begin();
            it != rl->lst.end(); ++it) {
-        if (p(*(*it)->min, *(*it)->max)) { boxlst.insert(*it); }
+        if (p(*(*it)->min, *(*it)->max)) { add_box_(boxlst, *it); }
       }
     } else {
       const rtree_node *rn = static_cast<rtree_node*>(n);
@@ -278,6 +300,184 @@ namespace bgeot {
                            intersect_line_and_box(org, dirv, bmin, bmax, EPS));
   }
 
+  void rtree::find_intersecting_boxes(const base_node& bmin,
+                                      const base_node& bmax,
+                                      pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(),boxlst,intersection_p(bmin,bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_containing_boxes(const base_node& bmin,
+                                    const base_node& bmax,
+                                    pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(), boxlst, contains_p(bmin,bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_contained_boxes(const base_node& bmin,
+                                   const base_node& bmax,
+                                   pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(), boxlst, contained_p(bmin,bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_boxes_at_point(const base_node& P, pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(), boxlst, has_point_p(P, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_line_intersecting_boxes(const base_node& org,
+                                           const base_small_vector& dirv,
+                                           pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(),boxlst,intersect_line(org, dirv));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_line_intersecting_boxes(const base_node& org,
+                                           const base_small_vector& dirv,
+                                           const base_node& bmin,
+                                           const base_node& bmax,
+                                           pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root)
+      find_matching_boxes_(root.get(), boxlst,
+                           intersect_line_and_box(org, dirv, bmin, bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void rtree::find_intersecting_boxes(const base_node& bmin,
+                                      const base_node& bmax,
+                                      std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_intersecting_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void rtree::find_containing_boxes(const base_node& bmin,
+                                    const base_node& bmax,
+                                    std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_containing_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void rtree::find_contained_boxes(const base_node& bmin,
+                                   const base_node& bmax,
+                                   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_contained_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void rtree::find_boxes_at_point(const base_node& P,
+                                  std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_boxes_at_point(P, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void rtree::find_line_intersecting_boxes(const base_node& org,
+                                           const base_small_vector& dirv,
+                                           std::vector<size_type>& idvec)
+    const {
+    pbox_cont &bs = scratch_boxes_();
+    find_line_intersecting_boxes(org, dirv, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void rtree::find_line_intersecting_boxes(const base_node& org,
+                                           const base_small_vector& dirv,
+                                           const base_node& bmin,
+                                           const base_node& bmax,
+                                           std::vector<size_type>& idvec)
+    const {
+    pbox_cont &bs = scratch_boxes_();
+    find_line_intersecting_boxes(org, dirv, bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  /* Batched point queries. idx[b..e) are the indices of the points whose
+     search region contains the node. The sub-lists of the children are
+     pushed at the end of idx, which is used as a stack. */
+  using point_hit = std::pair<size_type, const box_index *>;
+
+  static void find_boxes_at_points_(const rtree_elt_base *n,
+                                    const std::vector<base_node> &pts,
+                                    std::vector<size_type> &idx,
+                                    size_type b, size_type e,
+                                    scalar_type EPS,
+                                    std::vector<point_hit> &hits) {
+    if (n->isleaf()) {
+      const rtree_leaf *rl = static_cast<const rtree_leaf*>(n);
+      for (size_type i = b; i < e; ++i) {
+        has_point_p p(pts[idx[i]], EPS);
+        for (const box_index *pb : rl->lst)
+          if (p(*(pb->min), *(pb->max))) hits.push_back(point_hit(idx[i], pb));
+      }
+    } else {
+      const rtree_node *rn = static_cast<const rtree_node*>(n);
+      for (const rtree_elt_base *c : {rn->left.get(), rn->right.get()}) {
+        size_type b2 = idx.size();
+        for (size_type i = b; i < e; ++i) {
+          size_type k = idx[i];
+          if (has_point_p(pts[k], EPS)(c->rmin, c->rmax)) idx.push_back(k);
+        }
+        if (idx.size() > b2)
+          find_boxes_at_points_(c, pts, idx, b2, idx.size(), EPS, hits);
+        idx.resize(b2);
+      }
+    }
+  }
+
+  /* sort the hits by point then by box id and store them in ptr/boxlst */
+  static void point_hits_to_boxes_(std::vector<point_hit> &hits,
+                                   size_type nb_points,
+                                   std::vector<size_type> &ptr,
+                                   rtree::pbox_cont &boxlst) {
+    std::sort(hits.begin(), hits.end(),
+              [](const point_hit &h1, const point_hit &h2) {
+                return (h1.first < h2.first)
+                  || (h1.first == h2.first && h1.second->id < h2.second->id);
+              });
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    ptr.assign(nb_points+1, 0);
+    boxlst.resize(hits.size());
+    for (size_type i = 0; i < hits.size(); ++i) {
+      ++ptr[hits[i].first+1];
+      boxlst[i] = hits[i].second;
+    }
+    for (size_type i = 0; i < nb_points; ++i) ptr[i+1] += ptr[i];
+  }
+
+  void rtree::find_boxes_at_points(const std::vector<base_node> &pts,
+                                   std::vector<size_type> &ptr,
+                                   pbox_cont &boxlst) const {
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    std::vector<size_type> idx;
+    std::vector<point_hit> hits;
+    if (root && pts.size()) {
+      space_filling_curve_order(pts, idx);
+      find_boxes_at_points_(root.get(), pts, idx, 0, pts.size(), EPS, hits);
+    }
+    point_hits_to_boxes_(hits, pts.size(), ptr, boxlst);
+  }
+
   /*
      try to split at the approximate center of the box. Could be much more
      sophisticated
@@ -404,4 +604,576 @@ namespace bgeot {
     cout << " --- end of tree dump, nb of rectangles: " << boxes.size()
          << ", rectangle ref in tree: " << count << "\n";
   }
+
+  /* ******************************************************************** */
+  /*  dynamic_rtree                                                       */
+  /* ******************************************************************** */
+
+  /* Cost of a box for the surface area heuristic : half of its surface
+     (its length in 1D). ext(j) gives the extent in direction j. */
+  template <typename EXT>
+  static scalar_type sah_cost(size_type N, const EXT &ext) {
+    if (N == 1) return ext(0);
+    scalar_type c(0);
+    for (size_type i = 0; i < N; ++i) {
+      scalar_type p(1);
+      for (size_type j = 0; j < N; ++j) if (j != i) p *= ext(j);
+      c += p;
+    }
+    return c;
+  }
+
+  static scalar_type box_cost(const base_node& bmin, const base_node& bmax) {
+    return sah_cost(bmin.size(), [&](size_type j)
+                    { return bmax[j] - bmin[j]; });
+  }
+
+  static scalar_type union_cost(const base_node& amin, const base_node& amax,
+                                const base_node& bmin, const base_node& bmax) {
+    return sah_cost(amin.size(), [&](size_type j)
+                    { return std::max(amax[j], bmax[j])
+                        - std::min(amin[j], bmin[j]); });
+  }
+
+  dynamic_rtree::dynamic_rtree(scalar_type EPS_, scalar_type margin_)
+    : EPS(EPS_), margin(margin_), next_id(0), root(size_type(-1)),
+      tree_built(false) {}
+
+  size_type dynamic_rtree::new_node() {
+    size_type i;
+    if (free_nodes.size()) { i = free_nodes.back(); free_nodes.pop_back(); }
+    else { i = tnodes.size(); tnodes.push_back(dyn_node()); }
+    dyn_node &n = tnodes[i];
+    n.parent = n.left = n.right = size_type(-1);
+    n.box = 0;
+    return i;
+  }
+
+  void dynamic_rtree::delete_node(size_type i) {
+    tnodes[i].parent = tnodes[i].left = tnodes[i].right = size_type(-1);
+    tnodes[i].box = 0;
+    free_nodes.push_back(i);
+  }
+
+  void dynamic_rtree::fat_bounds(const dyn_box &b, base_node &rmin,
+                                 base_node &rmax) const {
+    size_type N = b.min.size();
+    scalar_type h(0);
+    for (size_type k = 0; k < N; ++k) h = std::max(h, b.max[k] - b.min[k]);
+    rmin.resize(N); rmax.resize(N);
+    for (size_type k = 0; k < N; ++k) {
+      rmin[k] = b.min[k] - margin * h;
+      rmax[k] = b.max[k] + margin * h;
+    }
+  }
+
+  size_type dynamic_rtree::new_leaf(dyn_box &b) {
+    size_type i = new_node();
+    tnodes[i].box = &(b.bi);
+    fat_bounds(b, tnodes[i].rmin, tnodes[i].rmax);
+    b.leaf = i;
+    return i;
+  }
+
+  /* recompute the bounds of the ancestors of a modified node, stopping as
+     soon as they are unchanged. */
+  void dynamic_rtree::refit_upwards(size_type i) {
+    for (; i != size_type(-1); i = tnodes[i].parent) {
+      dyn_node &n = tnodes[i];
+      const dyn_node &l = tnodes[n.left], &r = tnodes[n.right];
+      bool changed = false;
+      for (size_type k = 0; k < n.rmin.size(); ++k) {
+        scalar_type a = std::min(l.rmin[k], r.rmin[k]);
+        scalar_type b = std::max(l.rmax[k], r.rmax[k]);
+        if (a != n.rmin[k] || b != n.rmax[k])
+          { n.rmin[k] = a; n.rmax[k] = b; changed = true; }
+      }
+      if (!changed) break;
+    }
+  }
+
+  /* Insertion of a leaf : the sibling is chosen by a descent minimizing
+     the increase of the SAH cost of the tree. */
+  void dynamic_rtree::insert_leaf(size_type leaf) {
+    if (root == size_type(-1))
+      { root = leaf; tnodes[leaf].parent = size_type(-1); return; }
+
+    size_type p = new_node(), i = root;
+    const dyn_node &l = tnodes[leaf];
+    while (!tnodes[i].isleaf()) {
+      const dyn_node &n = tnodes[i];
+      scalar_type combined = union_cost(n.rmin, n.rmax, l.rmin, l.rmax);
+      scalar_type cost = scalar_type(2) * combined;
+      scalar_type inherit
+        = scalar_type(2) * (combined - box_cost(n.rmin, n.rmax));
+      scalar_type c[2];
+      size_type ch[2] = { n.left, n.right };
+      for (size_type j = 0; j < 2; ++j) {
+        const dyn_node &m = tnodes[ch[j]];
+        c[j] = union_cost(m.rmin, m.rmax, l.rmin, l.rmax) + inherit;
+        if (!m.isleaf()) c[j] -= box_cost(m.rmin, m.rmax);
+      }
+      if (cost < c[0] && cost < c[1]) break;
+      i = (c[0] <= c[1]) ? ch[0] : ch[1];
+    }
+
+    size_type old_parent = tnodes[i].parent;
+    dyn_node &np = tnodes[p];
+    np.parent = old_parent; np.left = i; np.right = leaf;
+    np.rmin = tnodes[i].rmin; np.rmax = tnodes[i].rmax;
+    bgeot::update_box(np.rmin, np.rmax, l.rmin, l.rmax);
+    tnodes[i].parent = tnodes[leaf].parent = p;
+    if (old_parent == size_type(-1)) root = p;
+    else {
+      if (tnodes[old_parent].left == i) tnodes[old_parent].left = p;
+      else tnodes[old_parent].right = p;
+      refit_upwards(old_parent);
+    }
+  }
+
+  void dynamic_rtree::remove_leaf(size_type leaf) {
+    if (leaf == root) { root = size_type(-1); return; }
+    size_type p = tnodes[leaf].parent, g = tnodes[p].parent;
+    size_type s = (tnodes[p].left == leaf) ? tnodes[p].right : tnodes[p].left;
+    tnodes[s].parent = g;
+    delete_node(p);
+    if (g == size_type(-1)) root = s;
+    else {
+      if (tnodes[g].left == p) tnodes[g].left = s; else tnodes[g].right = s;
+      refit_upwards(g);
+    }
+  }
+
+  size_type dynamic_rtree::add_box(const base_node &min, const base_node &max,
+                                   size_type id) {
+    if (id == size_type(-1)) id = next_id;
+    GMM_ASSERT1(boxes.count(id) == 0, "Box " << id << " already exists");
+    next_id = std::max(next_id, id+1);
+    dyn_box &b = boxes[id];
+    b.min = min; b.max = max;
+    b.bi.id = id; b.bi.min = &(b.min); b.bi.max = &(b.max);
+    b.leaf = size_type(-1);
+    if (tree_built) insert_leaf(new_leaf(b));
+    return id;
+  }
+
+  bool dynamic_rtree::update_box(size_type id, const base_node &min,
+                                 const base_node &max) {
+    auto it = boxes.find(id);
+    GMM_ASSERT1(it != boxes.end(), "Box " << id << " does not exist");
+    dyn_box &b = it->second;
+    GMM_ASSERT1(min.size() == b.min.size() && max.size() == b.max.size(),
+                "Dimensions mismatch");
+    b.min = min; b.max = max;
+    if (!tree_built) return false;
+
+    const dyn_node &l = tnodes[b.leaf];
+    bool inside = true;
+    for (size_type k = 0; k < min.size() && inside; ++k)
+      if (min[k] < l.rmin[k] || max[k] > l.rmax[k]) inside = false;
+    if (inside) return false;
+
+    remove_leaf(b.leaf);
+    fat_bounds(b, tnodes[b.leaf].rmin, tnodes[b.leaf].rmax);
+    insert_leaf(b.leaf);
+    return true;
+  }
+
+  void dynamic_rtree::remove_box(size_type id) {
+    auto it = boxes.find(id);
+    GMM_ASSERT1(it != boxes.end(), "Box " << id << " does not exist");
+    if (tree_built) {
+      remove_leaf(it->second.leaf);
+      delete_node(it->second.leaf);
+    }
+    boxes.erase(it);
+  }
+
+  void dynamic_rtree::clear_tree() {
+    tnodes.clear(); free_nodes.clear();
+    root = size_type(-1);
+    tree_built = false;
+  }
+
+  void dynamic_rtree::clear() {
+    clear_tree();
+    boxes.clear();
+    next_id = 0;
+  }
+
+  /* Top-down build with a binned surface area heuristic along the
+     direction of largest extent of the centroids. Falls back to a median
+     split when no binned split separates the leaves. */
+  size_type dynamic_rtree::build_tree_(std::vector<size_type> &leaves,
+                                       size_type b, size_type e) {
+    if (e - b == 1) return leaves[b];
+    const size_type NBINS = 16;
+    size_type N = tnodes[leaves[b]].rmin.size();
+    auto center = [&](size_type l, size_type k)
+      { return (tnodes[l].rmin[k] + tnodes[l].rmax[k]) / scalar_type(2); };
+
+    base_node cmin(N), cmax(N);
+    for (size_type k = 0; k < N; ++k) cmin[k] = cmax[k] = center(leaves[b], k);
+    for (size_type i = b+1; i < e; ++i)
+      for (size_type k = 0; k < N; ++k) {
+        cmin[k] = std::min(cmin[k], center(leaves[i], k));
+        cmax[k] = std::max(cmax[k], center(leaves[i], k));
+      }
+    size_type dir = 0;
+    for (size_type k = 1; k < N; ++k)
+      if (cmax[k] - cmin[k] > cmax[dir] - cmin[dir]) dir = k;
+    scalar_type ext = cmax[dir] - cmin[dir];
+
+    size_type mid = b;
+    if (ext > scalar_type(0)) {
+      auto bin_of = [&](size_type l) {
+        size_type j = size_type((center(l, dir) - cmin[dir]) / ext
+                                * scalar_type(NBINS));
+        return std::min(j, NBINS-1);
+      };
+      std::vector<size_type> cnt(NBINS, 0);
+      std::vector<scalar_type> bmin(NBINS*N), bmax(NBINS*N);
+      for (size_type i = b; i < e; ++i) {
+        size_type l = leaves[i], j = bin_of(l);
+        for (size_type k = 0; k < N; ++k) {
+          scalar_type a = tnodes[l].rmin[k], c = tnodes[l].rmax[k];
+          bmin[j*N+k] = cnt[j] ? std::min(bmin[j*N+k], a) : a;
+          bmax[j*N+k] = cnt[j] ? std::max(bmax[j*N+k], c) : c;
+        }
+        ++cnt[j];
+      }
+      std::vector<scalar_type> amin(N), amax(N), rcost(NBINS);
+      size_type n = 0;
+      for (size_type j = NBINS-1; j > 0; --j) {
+        for (size_type k = 0; cnt[j] && k < N; ++k) {
+          amin[k] = n ? std::min(amin[k], bmin[j*N+k]) : bmin[j*N+k];
+          amax[k] = n ? std::max(amax[k], bmax[j*N+k]) : bmax[j*N+k];
+        }
+        n += cnt[j];
+        rcost[j] = n ? scalar_type(n) * sah_cost(N, [&](size_type k)
+                                                 { return amax[k]-amin[k]; })
+                     : scalar_type(0);
+      }
+      size_type split = NBINS;
+      scalar_type best(0);
+      n = 0;
+      for (size_type j = 0; j+1 < NBINS; ++j) {
+        for (size_type k = 0; cnt[j] && k < N; ++k) {
+          amin[k] = n ? std::min(amin[k], bmin[j*N+k]) : bmin[j*N+k];
+          amax[k] = n ? std::max(amax[k], bmax[j*N+k]) : bmax[j*N+k];
+        }
+        n += cnt[j];
+        if (n == 0 || n == e - b) continue;
+        scalar_type c = scalar_type(n) * sah_cost(N, [&](size_type k)
+                                                  { return amax[k]-amin[k]; })
+          + rcost[j+1];
+        if (split == NBINS || c < best) { best = c; split = j; }
+      }
+      if (split < NBINS)
+        mid = size_type(std::partition(leaves.begin()+b, leaves.begin()+e,
+                                       [&](size_type l)
+                                       { return bin_of(l) <= split; })
+                        - leaves.begin());
+    }
+    if (mid == b || mid == e) {
+      mid = b + (e - b) / 2;
+      std::nth_element(leaves.begin()+b, leaves.begin()+mid,
+                       leaves.begin()+e, [&](size_type l1, size_type l2)
+                       { return center(l1, dir) < center(l2, dir); });
+    }
+
+    size_type left = build_tree_(leaves, b, mid);
+    size_type right = build_tree_(leaves, mid, e);
+    size_type p = new_node();
+    dyn_node &n = tnodes[p];
+    n.left = left; n.right = right;
+    n.rmin = tnodes[left].rmin; n.rmax = tnodes[left].rmax;
+    bgeot::update_box(n.rmin, n.rmax, tnodes[right].rmin, tnodes[right].rmax);
+    tnodes[left].parent = tnodes[right].parent = p;
+    return p;
+  }
+
+  void dynamic_rtree::build_tree() {
+    if (tree_built) return;
+    clear_tree();
+    tnodes.reserve(2*boxes.size());
+    std::vector<size_type> leaves;
+    leaves.reserve(boxes.size());
+    for (auto &b : boxes) leaves.push_back(new_leaf(b.second));
+    if (leaves.size()) {
+      root = build_tree_(leaves, 0, leaves.size());
+      tnodes[root].parent = size_type(-1);
+    }
+    tree_built = true;
+  }
+
+  void dynamic_rtree::refit_(size_type i) {
+    dyn_node &n = tnodes[i];
+    if (n.isleaf())
+      fat_bounds(boxes.find(n.box->id)->second, n.rmin, n.rmax);
+    else {
+      refit_(n.left); refit_(n.right);
+      n.rmin = tnodes[n.left].rmin; n.rmax = tnodes[n.left].rmax;
+      bgeot::update_box(n.rmin, n.rmax,
+                        tnodes[n.right].rmin, tnodes[n.right].rmax);
+    }
+  }
+
+  void dynamic_rtree::refit() {
+    if (!tree_built) { build_tree(); return; }
+    if (root != size_type(-1)) refit_(root);
+  }
+
+  static size_type dyn_depth_(const std::vector<dynamic_rtree::dyn_node> &t,
+                              size_type i) {
+    if (t[i].isleaf()) return 1;
+    return 1 + std::max(dyn_depth_(t, t[i].left), dyn_depth_(t, t[i].right));
+  }
+
+  size_type dynamic_rtree::depth() const {
+    return (root == size_type(-1)) ? 0 : dyn_depth_(tnodes, root);
+  }
+
+  template <typename Predicate, typename CONT>
+  static void dyn_find_matching_boxes_
+  (const std::vector<dynamic_rtree::dyn_node> &t, size_type i,
+   CONT& boxlst, const Predicate &p) {
+    const dynamic_rtree::dyn_node &n = t[i];
+    if (!p.accept(n.rmin, n.rmax)) return;
+    if (n.isleaf()) {
+      if (p(*(n.box->min), *(n.box->max))) add_box_(boxlst, n.box);
+    } else {
+      dyn_find_matching_boxes_(t, n.left, boxlst, p);
+      dyn_find_matching_boxes_(t, n.right, boxlst, p);
+    }
+  }
+
+  void dynamic_rtree::find_intersecting_boxes(const base_node& bmin,
+                                              const base_node& bmax,
+                                              pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersection_p(bmin, bmax, EPS));
+  }
+
+  void dynamic_rtree::find_containing_boxes(const base_node& bmin,
+                                            const base_node& bmax,
+                                            pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               contains_p(bmin, bmax, EPS));
+  }
+
+  void dynamic_rtree::find_contained_boxes(const base_node& bmin,
+                                           const base_node& bmax,
+                                           pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               contained_p(bmin, bmax, EPS));
+  }
+
+  void dynamic_rtree::find_boxes_at_point(const base_node& P,
+                                          pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst, has_point_p(P, EPS));
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersect_line(org, dirv));
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   const base_node& bmin, const base_node& bmax, pbox_set& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersect_line_and_box(org, dirv, bmin, bmax,
+                                                      EPS));
+  }
+
+  void dynamic_rtree::find_intersecting_boxes(const base_node& bmin,
+                                              const base_node& bmax,
+                                              pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersection_p(bmin, bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_containing_boxes(const base_node& bmin,
+                                            const base_node& bmax,
+                                            pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               contains_p(bmin, bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_contained_boxes(const base_node& bmin,
+                                           const base_node& bmax,
+                                           pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               contained_p(bmin, bmax, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_boxes_at_point(const base_node& P,
+                                          pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst, has_point_p(P, EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersect_line(org, dirv));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   const base_node& bmin, const base_node& bmax, pbox_cont& boxlst) const {
+    boxlst.clear();
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    if (root != size_type(-1))
+      dyn_find_matching_boxes_(tnodes, root, boxlst,
+                               intersect_line_and_box(org, dirv, bmin, bmax,
+                                                      EPS));
+    sort_and_unique_(boxlst);
+  }
+
+  void dynamic_rtree::find_intersecting_boxes
+  (const base_node& bmin, const base_node& bmax,
+   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_intersecting_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void dynamic_rtree::find_containing_boxes
+  (const base_node& bmin, const base_node& bmax,
+   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_containing_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void dynamic_rtree::find_contained_boxes
+  (const base_node& bmin, const base_node& bmax,
+   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_contained_boxes(bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void dynamic_rtree::find_boxes_at_point
+  (const base_node& P, std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_boxes_at_point(P, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_line_intersecting_boxes(org, dirv, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  void dynamic_rtree::find_line_intersecting_boxes
+  (const base_node& org, const base_small_vector& dirv,
+   const base_node& bmin, const base_node& bmax,
+   std::vector<size_type>& idvec) const {
+    pbox_cont &bs = scratch_boxes_();
+    find_line_intersecting_boxes(org, dirv, bmin, bmax, bs);
+    pbox_cont_to_idvec_(bs, idvec);
+  }
+
+  static void dyn_find_boxes_at_points_
+  (const std::vector<dynamic_rtree::dyn_node> &t, size_type n,
+   const std::vector<base_node> &pts, std::vector<size_type> &idx,
+   size_type b, size_type e, scalar_type EPS, std::vector<point_hit> &hits) {
+    const dynamic_rtree::dyn_node &nd = t[n];
+    if (nd.isleaf()) {
+      for (size_type i = b; i < e; ++i)
+        if (has_point_p(pts[idx[i]], EPS)(*(nd.box->min), *(nd.box->max)))
+          hits.push_back(point_hit(idx[i], nd.box));
+    } else {
+      for (size_type c : {nd.left, nd.right}) {
+        size_type b2 = idx.size();
+        for (size_type i = b; i < e; ++i) {
+          size_type k = idx[i];
+          if (has_point_p(pts[k], EPS)(t[c].rmin, t[c].rmax)) idx.push_back(k);
+        }
+        if (idx.size() > b2)
+          dyn_find_boxes_at_points_(t, c, pts, idx, b2, idx.size(), EPS, hits);
+        idx.resize(b2);
+      }
+    }
+  }
+
+  void dynamic_rtree::find_boxes_at_points(const std::vector<base_node> &pts,
+                                           std::vector<size_type> &ptr,
+                                           pbox_cont &boxlst) const {
+    GMM_ASSERT2(tree_built, "Boxtree not initialised.");
+    std::vector<size_type> idx;
+    std::vector<point_hit> hits;
+    if (root != size_type(-1) && pts.size()) {
+      space_filling_curve_order(pts, idx);
+      dyn_find_boxes_at_points_(tnodes, root, pts, idx, 0, pts.size(), EPS,
+                                hits);
+    }
+    point_hits_to_boxes_(hits, pts.size(), ptr, boxlst);
+  }
+
+  static void dyn_dump_tree_(const std::vector<dynamic_rtree::dyn_node> &t,
+                             size_type i, int level) {
+    for (int l=0; l < level; ++l) cout << "  ";
+    cout << "span=" << t[i].rmin << ".." << t[i].rmax << " ";
+    if (t[i].isleaf())
+      cout << "Leaf " << t[i].box->id << "\n";
+    else {
+      cout << "Node\n";
+      dyn_dump_tree_(t, t[i].left, level+1);
+      dyn_dump_tree_(t, t[i].right, level+1);
+    }
+  }
+
+  void dynamic_rtree::dump() const {
+    cout << "tree dump follows\n";
+    if (root != size_type(-1)) dyn_dump_tree_(tnodes, root, 0);
+    cout << " --- end of tree dump, nb of rectangles: " << boxes.size()
+         << ", depth: " << depth() << "\n";
+  }
 }
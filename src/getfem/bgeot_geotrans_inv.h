@@ -245,19 +245,23 @@ namespace bgeot {
                                            bool bruteforce) {
     base_node min, max; /* bound of the box enclosing the convex */
     size_type nbpt = 0; /* nb of points in the convex */
-    kdtree_tab_type boxpts;
+    std::vector<size_type> boxpts; /* positions in tree.points() */
+    const kdtree_tab_type &pts = tree.points();
     bounding_box(min, max, cv.points(), pgt);
     for (size_type k=0; k < min.size(); ++k) { min[k] -= EPS; max[k] += EPS; }
     gic.init(cv.points(),pgt);
     /* get the points in a box enclosing the convex */
-    if (!bruteforce) points_in_box(boxpts, min, max);
-    else boxpts = tree.points();
+    if (!bruteforce) tree.points_in_box(boxpts, min, max);
+    else {
+      boxpts.resize(pts.size());
+      for (size_type l = 0; l < pts.size(); ++l) boxpts[l] = l;
+    }
     /* and invert the geotrans, and check if the obtained point is 
        inside the reference convex */
     for (size_type l = 0; l < boxpts.size(); ++l) {
       // base_node pt_ref;
-      if (gic.invert(boxpts[l].n, pftab[nbpt], EPS)) {
-        itab[nbpt++] = boxpts[l].i;
+      if (gic.invert(pts[boxpts[l]].n, pftab[nbpt], EPS)) {
+        itab[nbpt++] = pts[boxpts[l]].i;
       }
     }
     return nbpt;
@@ -37,21 +37,16 @@
     @date January 2004.
     @brief Simple implementation of a KD-tree.
 
-    Basically, a KD-tree is a balanced N-dimensional tree.
+    Basically, a KD-tree is a balanced N-dimensional tree. The tree is
+    stored in flat arrays (implicit node numbering and coordinates stored
+    component by component) and it is built level by level, the nodes of a
+    same level being split in parallel.
 */
+#include <atomic>
 #include "bgeot_small_vector.h"
 
 namespace bgeot {
 
-  /* generic node for the kdtree */
-  struct kdtree_elt_base {
-    enum { PTS_PER_LEAF=8 };
-    unsigned n; /* 0 => is a tree node, != 0 => tree leaf storing n points */
-    bool isleaf() const { return (n != 0); }
-    kdtree_elt_base(unsigned n_) : n(n_) {}
-    virtual ~kdtree_elt_base() {}
-  };
-
   /// store a point and the associated index for the kdtree.
   /* std::pair<size_type,base_node> is not ok since it does not
      have a suitable overloaded swap function ...
@@ -68,12 +63,29 @@ namespace bgeot {
   /// store a set of points with associated indexes.
   typedef std::vector<index_node_pair> kdtree_tab_type;
 
+  /* Flat representation of the tree. The nodes are numbered as in a heap
+     (the children of node i are 2i+1 and 2i+2), all the leaves are at the
+     same depth and the node of range [b, e) is split at b + (e-b)/2. */
+  struct kdtree_flat {
+    enum { PTS_PER_LEAF=16 };
+    size_type n;          /* number of points                           */
+    unsigned depth;       /* depth of the leaves                        */
+    std::vector<scalar_type> split_v;
+    std::vector<dim_type> split_dir;
+    std::vector<size_type> perm;     /* index in pts of the points in the
+                                        tree order                      */
+    std::vector<scalar_type> coords; /* component k of the j-th point in
+                                        the tree order is coords[k*n+j] */
+  };
+
   /** Balanced tree over a set of points.
 
   Once the tree have been built, it is possible to query very
-  quickly for the list of points lying in a given box. Note that
-  this is not a dynamic structure: once you start to call
-  kdtree::points_in_box, you should not use anymore kdtree::add_point.
+  quickly for the list of points lying in a given box or for the nearest
+  neighbors of a given position. The tree is built at the first query and
+  is invalidated by kdtree::add_point, so the points should be all inserted
+  before the first query. The queries do not modify the tree once it is
+  built and can be done concurrently by several threads.
 
   Here is an example of use (which tries to find the mapping between
   the dof of the mesh_fem and the node numbers of its mesh):
@@ -102,10 +114,11 @@ namespace bgeot {
   */
   class kdtree {
     dim_type N; /* dimension of points */
-    std::unique_ptr<kdtree_elt_base> tree;
+    mutable std::atomic<const kdtree_flat *> tree;
     kdtree_tab_type pts;
   public:
-    kdtree() : N(0) {}
+    kdtree() : N(0), tree(0) {}
+    ~kdtree() { clear_tree(); }
 
     kdtree(const kdtree&) = delete;
     kdtree &operator = (const kdtree&) = delete;
@@ -123,7 +136,7 @@ namespace bgeot {
         N = n.size();
       else
         GMM_ASSERT2(N == n.size(), "invalid dimension");
-      if (tree) clear_tree();
+      clear_tree();
       pts.push_back(index_node_pair(i, n));
     }
     size_type nb_points() const { return pts.size(); }
@@ -132,13 +145,39 @@ namespace bgeot {
        [min,max] */
     void points_in_box(kdtree_tab_type &ipts,
                        const base_node &min,
-                       const base_node &max);
+                       const base_node &max) const;
+    /* fills ipts with the positions in points() of the points in the box
+       [min,max] (avoids the copy of the points). */
+    void points_in_box(std::vector<size_type> &ipts,
+                       const base_node &min,
+                       const base_node &max) const;
     /* assigns at ipt the index of the nearest neighbor at location
        pos and returns the square of the distance to this point*/
     scalar_type nearest_neighbor(index_node_pair &ipt,
-                                 const base_node &pos);
+                                 const base_node &pos) const;
+    /* for each position pos[i], assigns at ids[i] the index of its nearest
+       neighbor and at dist2[i] the square of the distance to this point.
+       The positions are processed in parallel. */
+    void nearest_neighbors(const std::vector<base_node> &pos,
+                           std::vector<size_type> &ids,
+                           std::vector<scalar_type> &dist2) const;
+    /* fills ids and dist2 with the indexes of the min(k, nb_points())
+       nearest neighbors at location pos and the square of the distances
+       to these points, sorted by increasing distance. Returns the number
+       of neighbors found. */
+    size_type k_nearest_neighbors(const base_node &pos, size_type k,
+                                  std::vector<size_type> &ids,
+                                  std::vector<scalar_type> &dist2) const;
+    /* batched version of the previous function: with m = min(k,
+       nb_points()) the returned value, the neighbors of pos[i] are stored
+       in ids and dist2 from index i*m to (i+1)*m. The positions are
+       processed in parallel. */
+    size_type k_nearest_neighbors(const std::vector<base_node> &pos,
+                                  size_type k,
+                                  std::vector<size_type> &ids,
+                                  std::vector<scalar_type> &dist2) const;
   private:
-    typedef std::vector<size_type>::const_iterator ITER;
+    const kdtree_flat &build_tree() const;
     void clear_tree();
   };
 }
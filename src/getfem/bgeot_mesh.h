@@ -93,6 +93,18 @@ namespace bgeot {
     }
 
     inline void points_of_convex(size_type ic, base_matrix &G) const {
+      if (is_frozen()) {
+        const mesh_structure_csr *fs = frozen_structure_ptr();
+        size_type Np = fs->nb_points_of_convex(ic);
+        if (fs->short_indices()) {
+          const uint32_t *ind = fs->short_ind_points_of_convex(ic);
+          pts.gather_nodes(ind, ind+Np, G);
+        } else {
+          const size_type *ind = fs->long_ind_points_of_convex(ic);
+          pts.gather_nodes(ind, ind+Np, G);
+        }
+        return;
+      }
       const ind_set &rct = ind_points_of_convex(ic);
       size_type N = dim(), Np = rct.size();
       G.base_resize(N, Np);
@@ -121,6 +133,16 @@ namespace bgeot {
       return pts.add_node(pt, remove_duplicated_nodes ? tol : -1.);
     }
 
+    /** Add a set of points to the mesh in one call (see
+        node_tab::add_nodes). ind[i] receives the index of the point
+        corresponding to pt[i]. If tol is negative the check for nearby
+        points is deactivated.
+    */
+    void add_points(const std::vector<base_node> &pt,
+                    std::vector<size_type> &ind,
+                    const scalar_type tol=scalar_type(0))
+    { pts.add_nodes(pt, ind, tol); }
+
     template<class ITER>
     size_type add_convex(bgeot::pgeometric_trans pgt, ITER ipts) {
       bool present;
@@ -39,6 +39,8 @@
 #define BGEOT_MESH_STRUCTURE_H__
 
 #include <set>
+#include <atomic>
+#include <memory>
 #include "bgeot_convex_structure.h"
 #include "dal_tree_sorted.h"
 
@@ -64,6 +66,65 @@ namespace bgeot {
     static convex_face invalid_face() {return {size_type(-1), short_type(-1)};}
   };
 
+  class mesh_structure;
+
+  /** Compact and immutable copy of the connectivity of a mesh_structure.
+      The convex to point and point to convex relations are stored in flat
+      offset/index arrays, with 32-bit indices when the sizes allow it,
+      instead of one std::vector per convex and per point. The convex and
+      point numbering is the one of the mesh_structure (holes included).
+  */
+  class APIDECL mesh_structure_csr {
+
+    template <typename IND> struct csr_tab {
+      std::vector<IND> cv_offset, cv_points, pt_offset, pt_convexes;
+    };
+    csr_tab<uint32_t> tab32;
+    csr_tab<size_type> tab64;
+    bool short_ind;
+
+    template <typename IND> void build(const mesh_structure &ms,
+                                       csr_tab<IND> &tab);
+
+  public :
+
+    /// Number of points of convex ic (0 for a non existing convex).
+    size_type nb_points_of_convex(size_type ic) const {
+      return short_ind ? size_type(tab32.cv_offset[ic+1]-tab32.cv_offset[ic])
+        : tab64.cv_offset[ic+1] - tab64.cv_offset[ic];
+    }
+    /// Global index of the i-th point of convex ic.
+    size_type ind_point_of_convex(size_type ic, size_type i) const {
+      return short_ind ? size_type(tab32.cv_points[tab32.cv_offset[ic]+i])
+        : tab64.cv_points[tab64.cv_offset[ic]+i];
+    }
+    /// Indices of the points of convex ic, if short_indices().
+    const uint32_t *short_ind_points_of_convex(size_type ic) const
+    { return tab32.cv_points.data() + tab32.cv_offset[ic]; }
+    /// Indices of the points of convex ic, if !short_indices().
+    const size_type *long_ind_points_of_convex(size_type ic) const
+    { return tab64.cv_points.data() + tab64.cv_offset[ic]; }
+    /// Number of convexes attached to point ip.
+    size_type nb_convex_of_point(size_type ip) const {
+      return short_ind ? size_type(tab32.pt_offset[ip+1]-tab32.pt_offset[ip])
+        : tab64.pt_offset[ip+1] - tab64.pt_offset[ip];
+    }
+    /// Index of the i-th convex attached to point ip.
+    size_type ind_convex_of_point(size_type ip, size_type i) const {
+      return short_ind ? size_type(tab32.pt_convexes[tab32.pt_offset[ip]+i])
+        : tab64.pt_convexes[tab64.pt_offset[ip]+i];
+    }
+    size_type nb_allocated_convex() const
+    { return (short_ind ? tab32.cv_offset.size() : tab64.cv_offset.size())-1; }
+    size_type nb_max_points() const
+    { return (short_ind ? tab32.pt_offset.size() : tab64.pt_offset.size())-1; }
+    /// True if the indices are stored on 32 bits.
+    bool short_indices() const { return short_ind; }
+    size_type memsize() const;
+
+    explicit mesh_structure_csr(const mesh_structure &ms);
+  };
+
   /**@addtogroup mesh */
   ///@{
   /** Mesh structure definition.
@@ -84,6 +145,11 @@ namespace bgeot {
 
     dal::dynamic_tas<mesh_convex_structure, 8> convex_tab;
     point_ct points_tab;
+    bool frozen;
+    mutable std::shared_ptr<const mesh_structure_csr> frozen_tab;
+    mutable std::atomic_bool frozen_tab_valid;
+
+    void touch_structure();
 
   public :
 
@@ -97,6 +163,25 @@ namespace bgeot {
     /// The number of convex indexes from 0 to the index of the last convex
     size_type nb_allocated_convex() const
       { return convex_tab.index().last_true()+1; }
+    /** Set the frozen mode. In this mode, a compact copy of the
+        connectivity (see mesh_structure_csr) is used by the element
+        loops which support it. The copy is rebuilt lazily after any
+        modification of the structure. */
+    void freeze(bool f = true) { frozen = f; if (!f) touch_structure(); }
+    bool is_frozen() const { return frozen; }
+    /** Return the compact copy of the connectivity, building it if
+        necessary. A modification of the structure drops it from the
+        mesh_structure, the copy held by the caller remaining valid but
+        out of date. */
+    std::shared_ptr<const mesh_structure_csr> frozen_structure() const;
+    /** Same as frozen_structure() without sharing the ownership of the
+        copy, for the element loops: the pointer is valid until the next
+        modification of the structure. */
+    const mesh_structure_csr *frozen_structure_ptr() const {
+      if (frozen_tab_valid.load(std::memory_order_acquire))
+        return frozen_tab.get();
+      return frozen_structure().get();
+    }
     /// Return true if i is in convex_index()
     bool is_convex_valid(size_type i) { return (convex_tab.index())[i]; }
     size_type nb_max_points() const { return points_tab.size(); }
@@ -121,6 +206,13 @@ namespace bgeot {
     void swap_points(size_type i, size_type j);
     /// Exchange two convex IDs
     void swap_convex(size_type cv1, size_type cv2);
+    /** Renumber all the convexes in one pass: convex i becomes convex
+        new_num[i]. The convex numbering has to be without holes. */
+    void permute_convexes(const std::vector<size_type> &new_num);
+    /** Renumber all the points in one pass: point i becomes point
+        new_num[i] (new_num has an entry for each point used by a
+        convex). */
+    void permute_points(const std::vector<size_type> &new_num);
 
     template<class ITER>
     size_type add_convex_noverif(pconvex_structure cs, ITER ipts,
@@ -245,6 +337,10 @@ namespace bgeot {
      *  the point is not found.
      */
     size_type ind_in_convex_of_point(size_type ic, size_type ip) const;
+
+    mesh_structure() : frozen(false), frozen_tab_valid(false) {}
+    mesh_structure(const mesh_structure &ms);
+    mesh_structure &operator =(const mesh_structure &ms);
   };
   ///@}
 
@@ -280,6 +376,7 @@ namespace bgeot {
     mesh_convex_structure s; s.cstruct = cs;
     size_type nb = cs->nb_points();
 
+    touch_structure();
     if (is != size_type(-1)) { sup_convex(is); convex_tab.add_to_index(is,s); }
     else is = convex_tab.add(s);
 
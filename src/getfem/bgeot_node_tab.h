@@ -42,6 +42,7 @@
 #include "bgeot_small_vector.h"
 #include "dal_tree_sorted.h"
 #include "set"
+#include <atomic>
 
 namespace bgeot {
 
@@ -68,8 +69,17 @@ namespace bgeot {
     mutable base_node c;
     scalar_type eps, prec_factor, max_radius;
     unsigned dim_;
+    mutable std::vector<scalar_type> coords;
+    mutable std::atomic_bool coords_built;
 
     void add_sorter(void) const;
+    void update_coordinates(size_type i);
+    void update_coordinates(void);
+
+  private :
+    // Modifications which would not keep the contiguous coordinates.
+    using dal::dynamic_tas<base_node>::compact;
+    using dal::dynamic_tas<base_node>::add_to_index;
 
   public :
 
@@ -90,21 +100,80 @@ namespace bgeot {
     size_type add_node(const base_node &pt, const scalar_type radius=0,
                        bool remove_duplicated_nodes = true);
     size_type add(const base_node &pt) { return add_node(pt); }
+    /** Add a set of points to the array in one call. On return, ids[i]
+        is the index of the node corresponding to pts[i]. Points located
+        within a distance smaller than radius from an existing node (or
+        from a previous point of the set if merge_new is true) are merged
+        with it, as add_node does. The search uses a hashed uniform grid
+        whose step is twice the merging distance, so the cost is linear in
+        the number of points. If radius is negative, no merging is done.
+    */
+    void add_nodes(const std::vector<base_node> &pts,
+                   std::vector<size_type> &ids,
+                   const scalar_type radius=0, bool merge_new = true);
     void sup_node(size_type i);
     void sup(size_type i) { sup_node(i); }
     void resort(void) { sorters = std::vector<sorter>(); }
     dim_type dim(void) const { return dim_type(dim_); }
+    /** Move the node i to pt. */
+    void set_node(size_type i, const base_node &pt);
+    /** Return the coordinates of the nodes stored in a contiguous array:
+        the coordinates of node i are at positions i*dim() to
+        i*dim()+dim()-1 (the holes of the numbering are filled with zeros).
+        The array is built on first use, then updated in place by the
+        modifications of the node_tab, in the same way as the nodes. It is
+        only reallocated when a node is added past its end, so that the
+        returned pointer stays valid as long as no node is added.
+    */
+    const scalar_type *coordinates() const;
+    /** Copy the coordinates of the nodes of indices [it, ite) in the
+        columns of G, resized to dim() x (ite - it), from the contiguous
+        array of coordinates.
+    */
+    template <class ITER>
+    void gather_nodes(ITER it, ITER ite, base_matrix &G) const {
+      const scalar_type *X = coordinates();
+      size_type N = dim_;
+      G.base_resize(N, size_type(ite - it));
+      auto itG = G.begin();
+      for (; it != ite; ++it, itG += N) std::copy(X+(*it)*N, X+(*it+1)*N, itG);
+    }
+
+    /* The nodes are only modified through the node_tab interface, which
+       keeps the contiguous coordinates up to date: the accesses to the
+       nodes are read-only. */
+    const base_node &operator[](size_type i) const
+    { return dynamic_tas::operator[](i); }
+    const_iterator begin() const { return dynamic_tas::begin(); }
+    const_iterator end() const { return dynamic_tas::end(); }
+    const_tas_iterator tas_begin() const { return dynamic_tas::tas_begin(); }
+    const_tas_iterator tas_end() const { return dynamic_tas::tas_end(); }
+
     void translation(const base_small_vector &V);
     void transformation(const base_matrix &M);
 
     void swap_points(size_type i, size_type j);
     void swap(size_type i, size_type j) { swap_points(i,j); }
+    /** Renumber all the nodes in one pass: node i becomes node
+        new_num[i]. The numbering of the nodes has to be without holes. */
+    void permute_points(const std::vector<size_type> &new_num);
 
     node_tab(scalar_type prec_loose = scalar_type(10000));
     node_tab(const node_tab &t);
     node_tab &operator =(const node_tab &t);
   };
 
+  /** Order a set of points along a space filling curve covering their
+      bounding box: on return, order[k] is the index in pts of the k-th
+      point along the curve. The Hilbert curve is used if hilbert is true
+      and the Morton (Z-order) curve otherwise. Consecutive points along
+      the curve are close to each other, which is used to renumber the
+      convexes and points of a mesh for a better memory locality.
+  */
+  void APIDECL space_filling_curve_order(const std::vector<base_node> &pts,
+                                         std::vector<size_type> &order,
+                                         bool hilbert = true);
+
 
 
 }
@@ -39,6 +39,7 @@
 */
 
 #include <set>
+#include <map>
 #include "bgeot_small_vector.h"
 #include "bgeot_node_tab.h"
 
@@ -90,7 +91,8 @@ namespace bgeot {
   /** Balanced tree of n-dimensional rectangles.
    *
    * This is not a dynamic structure. Once a query has been made on the
-   * tree, new boxes should not be added.
+   * tree, new boxes should not be added (see dynamic_rtree). Once the
+   * tree is built, queries may be run concurrently from several threads.
    *
    * CAUTION : For EPS > 0, nearly identically boxes are eliminated
    *           For EPS = 0 all boxes are stored.
@@ -126,54 +128,55 @@ namespace bgeot {
                                       const base_node& bmax,
                                       pbox_set& boxlst) const;
 
+    /** The same queries storing the boxes in a caller provided buffer.
+        boxlst is cleared first and each box appears once, sorted by id as
+        in a pbox_set. No memory is allocated once the capacity of boxlst
+        is sufficient. */
     void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
-                                 std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_intersecting_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                                 pbox_cont& boxlst) const;
     void find_containing_boxes(const base_node& bmin, const base_node& bmax,
-                               std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_containing_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
-    void find_contained_boxes(const base_node& bmin,
-                              const base_node& bmax,
-                              std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_contained_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                               pbox_cont& boxlst) const;
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              pbox_cont& boxlst) const;
+    void find_boxes_at_point(const base_node& P, pbox_cont& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      pbox_cont& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      const base_node& bmin,
+                                      const base_node& bmax,
+                                      pbox_cont& boxlst) const;
+
+    /** The same queries returning the ids of the boxes. */
+    void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
+                                 std::vector<size_type>& idvec) const;
+    void find_containing_boxes(const base_node& bmin, const base_node& bmax,
+                               std::vector<size_type>& idvec) const;
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              std::vector<size_type>& idvec) const;
     void find_boxes_at_point(const base_node& P,
-                             std::vector<size_type>& idvec) const
-    { pbox_set bs; find_boxes_at_point(P, bs);  pbox_set_to_idvec(bs, idvec); }
+                             std::vector<size_type>& idvec) const;
     void find_line_intersecting_boxes(const base_node& org,
                                       const base_small_vector& dirv,
-                                      std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_line_intersecting_boxes(org, dirv, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                                      std::vector<size_type>& idvec) const;
     void find_line_intersecting_boxes(const base_node& org,
                                       const base_small_vector& dirv,
                                       const base_node& bmin,
                                       const base_node& bmax,
-                                      std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_line_intersecting_boxes(org, dirv, bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                                      std::vector<size_type>& idvec) const;
+
+    /** Batched point query. The boxes containing pts[i] are
+        boxlst[ptr[i]] ... boxlst[ptr[i+1]-1], sorted by id. The points
+        are ordered along a Hilbert curve and the tree is traversed once
+        for the whole set of points. */
+    void find_boxes_at_points(const std::vector<base_node> &pts,
+                              std::vector<size_type> &ptr,
+                              pbox_cont &boxlst) const;
 
     void dump();
     void build_tree();
   private:
-    void pbox_set_to_idvec(pbox_set bs, std::vector<size_type>& idvec) const {
-      idvec.reserve(bs.size()); idvec.resize(0);
-      for (pbox_set::const_iterator it=bs.begin(); it != bs.end(); ++it)
-        idvec.push_back((*it)->id);
-    }
-
     const scalar_type EPS;
     node_tab nodes;
     box_cont boxes;
@@ -182,6 +185,155 @@ namespace bgeot {
     getfem::lock_factory locks_;
   };
 
+  /** Dynamic tree of n-dimensional rectangles.
+   *
+   * Contrary to rtree, boxes may be added, moved and removed after the
+   * tree has been built. Each leaf holds a single box and its bounds are
+   * enlarged by a margin relative to the size of the box, so that a box
+   * which moves inside its enlarged bounds does not modify the tree. A box
+   * leaving them is removed and reinserted, the bounds of its ancestors
+   * being refitted. The cost of an update of the boxes is thus
+   * proportional to the motion rather than to the number of boxes.
+   *
+   * build_tree() makes a bulk build of the tree with a binned surface area
+   * heuristic (SAH). rebuild_tree() can be used to restore the quality of
+   * the tree after many insertions and removals, and refit() to shrink
+   * the enlarged bounds of all the leaves in a single bottom-up sweep.
+   *
+   * Boxes are identified by their id only. Contrary to rtree, nearly
+   * identical boxes are never merged; EPS is the tolerance of the queries.
+   */
+  class dynamic_rtree {
+  public:
+    using pbox_cont = rtree::pbox_cont;
+    using pbox_set = rtree::pbox_set;
+
+    dynamic_rtree(scalar_type EPS = 0, scalar_type margin = 0.1);
+    dynamic_rtree(const dynamic_rtree&) = delete;
+    dynamic_rtree& operator = (const dynamic_rtree&) = delete;
+
+    /** Add a box. If the tree is built, the box is inserted in it. */
+    size_type add_box(const base_node &min, const base_node &max,
+                      size_type id=size_type(-1));
+    /** Move box id to [min..max]. Return true if the structure of the
+        tree has been modified, false if the box remained inside the
+        enlarged bounds of its leaf. */
+    bool update_box(size_type id, const base_node &min, const base_node &max);
+    void remove_box(size_type id);
+    bool has_box(size_type id) const { return boxes.count(id) != 0; }
+    size_type nb_boxes() const { return boxes.size(); }
+    /** Relative enlargement of the leaves, as a fraction of the largest
+        side of the box. Taken into account by the next (re)insertions. */
+    void set_margin(scalar_type m) { margin = m; }
+    scalar_type get_margin() const { return margin; }
+    void clear();
+
+    void build_tree();
+    void rebuild_tree() { clear_tree(); build_tree(); }
+    /** Recompute the bounds of all the nodes from the current boxes. */
+    void refit();
+    bool tree_is_built() const { return tree_built; }
+    size_type depth() const;
+
+    void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
+                                 pbox_set& boxlst) const;
+    void find_containing_boxes(const base_node& bmin, const base_node& bmax,
+                               pbox_set& boxlst) const;
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              pbox_set& boxlst) const;
+    void find_boxes_at_point(const base_node& P, pbox_set& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      pbox_set& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      const base_node& bmin,
+                                      const base_node& bmax,
+                                      pbox_set& boxlst) const;
+
+    /** The same queries storing the boxes in a caller provided buffer.
+        boxlst is cleared first and each box appears once, sorted by id as
+        in a pbox_set. No memory is allocated once the capacity of boxlst
+        is sufficient. */
+    void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
+                                 pbox_cont& boxlst) const;
+    void find_containing_boxes(const base_node& bmin, const base_node& bmax,
+                               pbox_cont& boxlst) const;
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              pbox_cont& boxlst) const;
+    void find_boxes_at_point(const base_node& P, pbox_cont& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      pbox_cont& boxlst) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      const base_node& bmin,
+                                      const base_node& bmax,
+                                      pbox_cont& boxlst) const;
+
+    /** The same queries returning the ids of the boxes. */
+    void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
+                                 std::vector<size_type>& idvec) const;
+    void find_containing_boxes(const base_node& bmin, const base_node& bmax,
+                               std::vector<size_type>& idvec) const;
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              std::vector<size_type>& idvec) const;
+    void find_boxes_at_point(const base_node& P,
+                             std::vector<size_type>& idvec) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      std::vector<size_type>& idvec) const;
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      const base_node& bmin,
+                                      const base_node& bmax,
+                                      std::vector<size_type>& idvec) const;
+
+    /** Batched point query. The boxes containing pts[i] are
+        boxlst[ptr[i]] ... boxlst[ptr[i+1]-1], sorted by id. The points
+        are ordered along a Hilbert curve and the tree is traversed once
+        for the whole set of points. */
+    void find_boxes_at_points(const std::vector<base_node> &pts,
+                              std::vector<size_type> &ptr,
+                              pbox_cont &boxlst) const;
+
+    void dump() const;
+
+    struct dyn_box {
+      box_index bi;
+      base_node min, max;
+      size_type leaf;
+    };
+    struct dyn_node {
+      base_node rmin, rmax;
+      size_type parent, left, right;
+      const box_index *box;
+      bool isleaf() const { return left == size_type(-1); }
+    };
+
+  private:
+    size_type new_node();
+    void delete_node(size_type i);
+    size_type new_leaf(dyn_box &b);
+    void fat_bounds(const dyn_box &b, base_node &rmin, base_node &rmax) const;
+    void insert_leaf(size_type leaf);
+    void remove_leaf(size_type leaf);
+    void refit_upwards(size_type i);
+    size_type build_tree_(std::vector<size_type> &leaves,
+                          size_type b, size_type e);
+    void refit_(size_type i);
+    void clear_tree();
+
+    const scalar_type EPS;
+    scalar_type margin;
+    std::map<size_type, dyn_box> boxes;
+    size_type next_id;
+    std::vector<dyn_node> tnodes;
+    std::vector<size_type> free_nodes;
+    size_type root;
+    bool tree_built;
+  };
+
 }
 
 #endif
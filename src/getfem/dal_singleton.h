@@ -128,6 +128,7 @@ namespace dal {
 
     ~singleton_instance() {
       if (!pointer()) return;
+      pointer()->on_thread_update(); // partitions added since last access
       for(size_t i = 0; i != pointer()->num_threads(); ++i) {
         auto &p_singleton = (*pointer())(i);
         if(p_singleton){
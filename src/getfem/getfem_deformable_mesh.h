@@ -114,10 +114,13 @@ namespace getfem {
         for (size_type pt = 0; pt < num_points; ++pt)
         {
           /** iterate through each components of point [pt]and deform the component*/
-          if (deform_pt_flag[pt_index[pt]])
-          for (size_type comp = 0; comp < ddim; ++comp)
-            //move pts by dU;
-            ppts[pt_index[pt]][comp] += dU[dof[pt*ddim + comp]];
+          if (deform_pt_flag[pt_index[pt]]) {
+            base_node P = ppts[pt_index[pt]];
+            for (size_type comp = 0; comp < ddim; ++comp)
+              //move pts by dU;
+              P[comp] += dU[dof[pt*ddim + comp]];
+            ppts.set_node(pt_index[pt], P);
+          }
 
           //flag current [pt] to deformed
           deform_pt_flag[pt_index[pt]] = false;
@@ -132,7 +135,8 @@ namespace getfem {
     {
       auto &pts = const_cast<getfem::mesh &>(mf_.linked_mesh()).points();
       GMM_ASSERT1(pts.size() == initial_nodes_.size(), "Internal error, incorrect number of points.");
-      for (size_type i = 0; i < pts.size(); ++i) gmm::copy(initial_nodes_[i], pts[i]);
+      for (dal::bv_visitor i(pts.index()); !i.finished(); ++i)
+        pts.set_node(i, initial_nodes_[i]);
     }
 
     VECTOR dU_;
@@ -742,6 +742,65 @@ namespace getfem {
   };
 
 
+  /**
+     Sum factorization of a fem on the volume integration points of an
+     approximate integration method. It applies when the base functions
+     of the fem are products of one dimensional Lagrange polynomials in
+     each reference coordinate and when the integration points form a
+     tensor grid (for instance FEM_QK(N,K) with
+     IM_GAUSS_PARALLELEPIPED(N,K')). The values and reference gradients
+     of a field at all the integration points of an element, and the
+     transposed operation, are then computed direction by direction with
+     O(N p^(N+1)) operations instead of O(p^(2N)), p being the number of
+     one dimensional base functions or points.
+
+     The coefficient vectors have the layout of the generic assembly:
+     coeff(Q, nb_dof) for Q components. Values are stored as val(Q, nbpt)
+     and reference gradients as grad(Q, N, nbpt), the point index being
+     the one of the integration method.
+  */
+  class fem_sum_factorization_ : virtual public dal::static_stored_object {
+    size_type N, ndof, nbpt;
+    std::vector<size_type> nd, nq;    // 1D base functions/points per dir.
+    std::vector<base_matrix> B1, D1;  // 1D values/derivatives (nq x nd)
+    std::vector<size_type> tensor_dofs, tensor_points;
+    bool valid;
+
+    void contract(const base_vector &v, base_vector &w, const base_matrix &M,
+                  std::vector<size_type> &sizes, size_type d,
+                  bool transp) const;
+  public:
+    /// true if the fem and the integration points have the structure.
+    bool is_valid() const { return valid; }
+    size_type dim() const { return N; }
+    size_type nb_dof() const { return ndof; }
+    size_type nb_points() const { return nbpt; }
+    /** Values (and reference gradients if grad is not null) of a field
+        of Q components at the integration points of the element. */
+    void interpolate(const base_vector &coeff, size_type Q,
+                     base_vector &val, base_vector *grad) const;
+    /** Transposed operation: adds to elem(Q, nb_dof) the sum over the
+        integration points of val(q, i) phi_j(x_i) (if val is not null)
+        and of grad(q, k, i) d_k phi_j(x_i) (if grad is not null). */
+    void integrate(const base_vector *val, const base_vector *grad,
+                   size_type Q, base_vector &elem) const;
+    fem_sum_factorization_(pfem pf, bgeot::pstored_point_tab pspt,
+                           size_type nbpt_);
+    ~fem_sum_factorization_()
+    { DAL_STORED_OBJECT_DEBUG_DESTROYED(this, "Fem_sum_factorization"); }
+  };
+
+  typedef std::shared_ptr<const fem_sum_factorization_>
+    pfem_sum_factorization;
+
+  /** Return the sum factorization of pf on the volume integration points
+      of pai, or a null pointer if the pair has not the required tensor
+      product structure. The objects are stored like the fem_precomp
+      ones. */
+  pfem_sum_factorization fem_sum_factorization(pfem pf,
+                                               papprox_integration pai);
+
+
   /** structure passed as the argument of fem interpolation
       functions. This structure can be partially filled (for example
       the xreal will be computed if needed as long as pgp+ii is known).
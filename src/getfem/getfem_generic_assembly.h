@@ -57,6 +57,7 @@ namespace getfem {
   struct ga_tree;
   class model;
   class ga_workspace;
+  struct ga_instruction_set;
 
   typedef gmm::rsvector<scalar_type> model_real_sparse_vector;
   typedef gmm::rsvector<complex_type> model_complex_sparse_vector;
@@ -369,11 +370,49 @@ namespace getfem {
                              row_unreduced_K,
                              row_col_unreduced_K;
     base_vector unreduced_V;
+    // The compiled instructions reach the matrix and the vector they
+    // assemble into through exec_K and exec_V, set at each assembly, so
+    // that a compiled program does not depend on its targets. The targets
+    // themselves are never moved: several workspaces may share them.
+    model_real_sparse_matrix *exec_K = nullptr;
+    base_vector *exec_V = nullptr;
     base_tensor assemb_t;
     bool include_empty_int_pts = false;
+    bool atomic_vector_assembly = false;
+    bool use_sum_factorization = false;
+    bool optimize_instructions = true;
+    bool dump_instructions = false;
+    size_type nb_optimized_instr = 0;
+    bool use_native_code = false;
+    size_type nb_native_kern = 0;
+    size_type element_batch_size = 0;
+    bool matrix_free = false;
+    base_vector matrix_free_x, matrix_free_y;
+    std::map<std::string, base_vector> matrix_free_x_parts;
 
     std::map<std::string, gmm::sub_interval> tmp_var_intervals;
 
+    // Compiled assembly programs kept from one call of assembly() to the
+    // next, one per order. The cache is not copied with the workspace since
+    // the instructions refer to the data of the workspace they were
+    // compiled for.
+    struct compiled_program_cache {
+      typedef std::pair<std::string, std::shared_ptr<ga_instruction_set> >
+        program;
+      std::map<size_type, program> programs;
+      size_type nb_hits, nb_misses;
+      bool enabled;
+      compiled_program_cache() : nb_hits(0), nb_misses(0), enabled(true) {}
+      compiled_program_cache(const compiled_program_cache &cpc)
+        : nb_hits(0), nb_misses(0), enabled(cpc.enabled) {}
+      compiled_program_cache &operator =(const compiled_program_cache &cpc)
+      { programs.clear(); enabled = cpc.enabled; return *this; }
+    };
+    compiled_program_cache compiled_programs;
+    size_type expressions_version; // Incremented at each change of the trees
+
+    std::string compiled_program_signature(size_type order) const;
+
   public:
     // setter functions
     void set_assembled_matrix(model_real_sparse_matrix &K_) {
@@ -406,6 +445,8 @@ namespace getfem {
     model_real_sparse_matrix &row_col_unreduced_matrix()
     { return row_col_unreduced_K; }
     base_vector &unreduced_vector() { return unreduced_V; }
+    model_real_sparse_matrix *const &exec_matrix() const { return exec_K; }
+    base_vector *const &exec_vector() const { return exec_V; }
 
     /** Add an expression, perform the semantic analysis, split into
      *  terms in separated test functions, derive if necessary to obtain
@@ -527,7 +568,7 @@ namespace getfem {
 
     void add_elementary_transformation(const std::string &name,
                                        pelementary_transformation ptrans)
-    { elem_transformations[name] = ptrans; }
+    { elem_transformations[name] = ptrans; ++expressions_version; }
 
     bool elementary_transformation_exists(const std::string &name) const;
 
@@ -550,9 +591,107 @@ namespace getfem {
 
     void assembly(size_type order);
 
+    /** Enable or disable the reuse of the compiled assembly programs from
+        one call of assembly() to the next (enabled by default). A compiled
+        program is reused as long as the expressions, the versions of the
+        mesh_im, mesh_fem and im_data objects, the layout of the variables
+        and the values of the fixed size variables and data are unchanged.
+        The values of the fixed size variables being folded in the program,
+        an expression depending on a fixed size unknown (a global
+        multiplier for instance) is recompiled at each change of it.
+    */
+    void set_compiled_program_caching(bool enable);
+    bool compiled_program_caching() const { return compiled_programs.enabled; }
+    /** Delete the compiled programs kept by the workspace. */
+    void clear_compiled_programs() { compiled_programs.programs.clear(); }
+    /** Number of calls of assembly() having reused a compiled program. */
+    size_type nb_compiled_program_hits() const
+    { return compiled_programs.nb_hits; }
+    /** Number of calls of assembly() having (re)compiled a program. */
+    size_type nb_compiled_program_misses() const
+    { return compiled_programs.nb_misses; }
+
     void set_include_empty_int_points(bool include);
     bool include_empty_int_points() const;
 
+    /** Use atomic additions for the assembly of the vector of fem and fixed
+        size variables. Allows several workspaces, run by different threads,
+        to assemble into the same vector. Not valid for reduced fems, whose
+        contribution is added at the end of the assembly. */
+    void set_atomic_vector_assembly(bool atomic);
+    bool is_atomic_vector_assembly() const { return atomic_vector_assembly; }
+
+    /** Compute y = K x where K is the matrix of the order 2 terms of the
+        workspace, without assembling K: the elementary matrices are
+        multiplied by the local components of x on the fly. x and y are
+        vectors of size nb_primary_dof(). Reduced fems and groups of
+        variables are not supported. */
+    void matrix_free_product(const base_vector &x, base_vector &y);
+    bool is_matrix_free() const { return matrix_free; }
+    const base_vector &matrix_free_input() const { return matrix_free_x; }
+    base_vector &matrix_free_output() { return matrix_free_y; }
+    /** Name of the fem constant holding the part of x corresponding to a
+        variable during matrix_free_product(), empty if there is none. */
+    std::string matrix_free_input_name(const std::string &varname) const;
+
+    /** Enable or disable the sum factorization of the values and gradients
+        of fem variables and of the order 1 terms on the elements where the
+        fem and the integration method have a tensor product structure
+        (see fem_sum_factorization). Disabled by default. */
+    void set_sum_factorization(bool enable);
+    bool sum_factorization() const { return use_sum_factorization; }
+
+    /** Enable or disable the fusion of the chains of element-wise
+        instructions (additions, scalar multiplications, copies and
+        transpositions) of the compiled assembly programs. Enabled by
+        default: the fused instructions save up to 15% of the assembly
+        time of the tangent matrices combining several terms in the test
+        functions (see test_instruction_fusion in contrib/opt_assembly). */
+    void set_instruction_optimization(bool enable);
+    bool instruction_optimization() const { return optimize_instructions; }
+    /** Print the compiled instructions (before and after their
+        optimization) on the standard output at each compilation. */
+    void set_instruction_dump(bool enable) { dump_instructions = enable; }
+    bool instruction_dump() const { return dump_instructions; }
+    /** Number of instructions removed by the optimization of the program
+        used by the last assembly. */
+    size_type nb_optimized_instructions() const { return nb_optimized_instr; }
+
+    /** Translate the integration point instructions of the compiled
+        assembly programs into C++ functions compiled by the system
+        compiler (given by the environment variables GETFEM_NATIVE_CXX and
+        GETFEM_NATIVE_CXXFLAGS, "c++ -O3" by default) and loaded as shared
+        objects. The shared objects are kept in the directory
+        GETFEM_NATIVE_DIR (TMPDIR/getfem_native_<uid> by default), which
+        has to belong to the user with no access for the others, and
+        reused for the same instructions and tensor sizes. The interpreter
+        is used when no compiler is available or when the sizes of the
+        tensors change. Disabled by default. */
+    void set_native_code(bool enable);
+    bool native_code() const { return use_native_code; }
+    /** Number of lists of instructions executed in native code by the
+        last assembly. */
+    size_type nb_native_kernels() const { return nb_native_kern; }
+
+    /** Execute the arithmetic instructions (additions, scalar
+        multiplications, contractions, tensor products and index
+        permutations) preceding the assembly of each term on chunks of nb
+        elements at a time, the tensors being stored with the integration
+        points of the chunk as innermost index so that the loops vectorize
+        across the points. The contributions of the points of an element
+        are then summed before being assembled. The other instructions
+        are executed point by point, and the terms which do not end with
+        such arithmetic instructions or whose assembly depends on the
+        integration point (im_data variables, interpolate
+        transformations) are executed as usual. 0 (the default) disables
+        the batched execution. It is for now slower than the execution
+        point by point on the P2 elasticity and mass terms of
+        test_element_batching in contrib/opt_assembly (by 20% to 3 times),
+        the copy of the base function values of each point costing about
+        as much as the arithmetic operations saved. */
+    void set_element_batching(size_type nb);
+    size_type element_batching() const { return element_batch_size; }
+
     size_type nb_primary_dof() const { return nb_prim_dof; }
     size_type nb_temporary_dof() const { return nb_tmp_dof; }
 
@@ -577,6 +716,25 @@ namespace getfem {
 
   };
 
+  /** Linear operator y = K x where K is the matrix of the order 2 terms of
+      a workspace, never assembled (see ga_workspace::matrix_free_product).
+      It can replace a matrix in the gmm iterative solvers, for instance
+      gmm::cg(ga_matrix_free_operator(workspace), X, B, P, iter), with a
+      preconditioner P not requiring the matrix (identity, diagonal built
+      separately, ...). For gmm, it is an abstract matrix whose only
+      available operations are gmm::mat_nrows, gmm::mat_ncols and
+      gmm::mult.
+  */
+  class ga_matrix_free_operator {
+    ga_workspace &workspace;
+  public:
+    size_type nrows() const { return workspace.nb_primary_dof(); }
+    size_type ncols() const { return workspace.nb_primary_dof(); }
+    void mult(const base_vector &x, base_vector &y) const
+    { workspace.matrix_free_product(x, y); }
+    explicit ga_matrix_free_operator(ga_workspace &w) : workspace(w) {}
+  };
+
   // Small tool to make basic substitutions into an assembly string
   std::string ga_substitute(const std::string &expr,
                             const std::map<std::string, std::string> &dict);
@@ -620,8 +778,6 @@ namespace getfem {
   // Intermediate structure for user function manipulation
   //=========================================================================
 
-  struct ga_instruction_set;
-
   class ga_function {
     mutable ga_workspace local_workspace;
     std::string expr;
@@ -814,5 +970,64 @@ namespace getfem {
 
 }  /* end of namespace getfem.                                             */
 
+namespace gmm {
+
+  template <> struct linalg_traits<getfem::ga_matrix_free_operator> {
+    typedef getfem::ga_matrix_free_operator this_type;
+    typedef this_type origin_type;
+    typedef linalg_false is_reference;
+    typedef abstract_matrix linalg_type;
+    typedef getfem::scalar_type value_type;
+    typedef getfem::scalar_type reference;
+    typedef abstract_null_type storage_type;
+    typedef abstract_null_type sub_row_type;
+    typedef abstract_null_type const_sub_row_type;
+    typedef abstract_null_type row_iterator;
+    typedef abstract_null_type const_row_iterator;
+    typedef abstract_null_type sub_col_type;
+    typedef abstract_null_type const_sub_col_type;
+    typedef abstract_null_type col_iterator;
+    typedef abstract_null_type const_col_iterator;
+    typedef abstract_null_type sub_orientation;
+    typedef abstract_null_type index_sorted;
+    static size_type nrows(const this_type &m) { return m.nrows(); }
+    static size_type ncols(const this_type &m) { return m.ncols(); }
+    static void do_clear(this_type &)
+    { GMM_ASSERT1(false, "A matrix-free operator cannot be cleared"); }
+  };
+
+  template <typename VECT1, typename VECT2> inline
+  void mult(const getfem::ga_matrix_free_operator &A, const VECT1 &x,
+            VECT2 &y) {
+    getfem::base_vector xx(gmm::vect_size(x)), yy;
+    gmm::copy(x, xx);
+    A.mult(xx, yy);
+    gmm::copy(yy, y);
+  }
+
+  template <typename VECT1, typename VECT2> inline
+  void mult(const getfem::ga_matrix_free_operator &A, const VECT1 &x,
+            const VECT2 &y_) {
+    mult(A, x, const_cast<VECT2 &>(y_));
+  }
+
+  template <typename VECT1, typename VECT2, typename VECT3> inline
+  void mult(const getfem::ga_matrix_free_operator &A, const VECT1 &x,
+            const VECT2 &b, VECT3 &y) {
+    getfem::base_vector xx(gmm::vect_size(x)), yy;
+    gmm::copy(x, xx);
+    A.mult(xx, yy);
+    gmm::add(b, yy);
+    gmm::copy(yy, y);
+  }
+
+  template <typename VECT1, typename VECT2, typename VECT3> inline
+  void mult(const getfem::ga_matrix_free_operator &A, const VECT1 &x,
+            const VECT2 &b, const VECT3 &y_) {
+    mult(A, x, b, const_cast<VECT3 &>(y_));
+  }
+
+}
+
 
 #endif /* GETFEM_GENERIC_ASSEMBLY_H__  */
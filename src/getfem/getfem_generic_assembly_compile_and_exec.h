@@ -63,8 +63,15 @@ namespace getfem {
   };
 
 
+  struct ga_batch_op;
+  struct ga_element_batch;
+
   struct ga_instruction {
     virtual int exec() = 0;
+    // Operation of the instruction for the element-batched execution (see
+    // ga_workspace::set_element_batching). The instructions returning false
+    // are executed on one integration point at a time.
+    virtual bool batch_op(ga_batch_op &) const { return false; }
     virtual ~ga_instruction() {};
   };
 
@@ -155,6 +162,7 @@ namespace getfem {
 
       const mesh *m;
       const mesh_im *im;
+      bool sum_factorization; // Sum factorization allowed on the elements
       ga_if_hierarchy current_hierarchy;
       std::map<std::string, base_vector> local_dofs;
       std::map<const mesh_fem *, pfem_precomp> pfps;
@@ -188,8 +196,10 @@ namespace getfem {
         instructions;        // Instructions executed on each
                              // integration/interpolation point
       std::map<scalar_type, std::list<pga_tree_node> > node_list;
+      // Plan of the element-batched execution, built on first use
+      std::shared_ptr<ga_element_batch> element_batch;
 
-      region_mim_instructions(): m(0), im(0) {}
+      region_mim_instructions(): m(0), im(0), sum_factorization(false) {}
     };
 
     std::list<ga_tree> trees; // The trees are stored mainly because they
@@ -197,8 +207,14 @@ namespace getfem {
     std::list<ga_tree> interpolation_trees;
 
     std::map<region_mim, region_mim_instructions> all_instructions;
-
-    ga_instruction_set() : need_elt_size(false), nbpt(0), ipt(0) {}
+    size_type nb_optimized_instructions; // Removed by instruction fusion
+    size_type nb_native_kernels; // Lists of instructions in native code
+    size_type nb_exec; // Number of runs of ga_exec, for the data that the
+                       // instructions keep during one run
+
+    ga_instruction_set() : need_elt_size(false), nbpt(0), ipt(0),
+                           nb_optimized_instructions(0),
+                           nb_native_kernels(0), nb_exec(0) {}
   };
 
   
@@ -213,6 +229,10 @@ namespace getfem {
   void ga_interpolation_exec(ga_instruction_set &gis,
                              ga_workspace &workspace,
                              ga_interpolation_context &gic);
+  size_type ga_optimize_instructions(ga_instruction_set &gis);
+  size_type ga_native_code(ga_instruction_set &gis);
+  void ga_print_instructions(const ga_instruction_set &gis,
+                             std::ostream &str);
   
 } /* end of namespace */
 
@@ -184,7 +184,7 @@ namespace getfem {
 
     mutable bgeot::rtree boxtree;
     mutable size_type cv_stored;
-    mutable bgeot::rtree::pbox_set boxlst;
+    mutable bgeot::rtree::pbox_cont boxlst;
     mutable bgeot::geotrans_inv_convex gic;
 
 
@@ -112,7 +112,7 @@ namespace getfem {
                                                array should keep it full of
                                                size_type(-1) */
     mutable size_type cv_stored;
-    mutable bgeot::rtree::pbox_set boxlst;
+    mutable bgeot::rtree::pbox_cont boxlst;
     mutable bgeot::geotrans_inv_convex gic;
     mutable base_tensor taux;
     mutable fem_interpolation_context fictx;
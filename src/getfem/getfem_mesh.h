@@ -190,6 +190,7 @@ namespace getfem {
     { return ref_convex(structure_of_convex(ic), points_of_convex(ic)); }
 
     using basic_mesh::add_point;
+    using basic_mesh::add_points;
     /// Give the number of geometrical nodes in the mesh.
     size_type nb_points() const { return pts.card(); }
     /// Return the points index
@@ -451,9 +452,27 @@ namespace getfem {
     /** Remove all references to a convex from all regions stored in the mesh.
      @param cv the convex number.*/
     void sup_convex_from_regions(size_type cv);
+    /** Renumbering of the convexes done by optimize_structure. With
+        HILBERT_RENUMBERING and MORTON_RENUMBERING, the convexes (by their
+        centers) and the points are ordered along a space filling curve. */
+    enum renumbering_method { NO_RENUMBERING, CUTHILL_MCKEE_RENUMBERING,
+                              HILBERT_RENUMBERING, MORTON_RENUMBERING };
     /** Pack the mesh : renumber convexes and nodes such that there
-        is no holes in their numbering. Do NOT do the Cuthill-McKee. */
-    void optimize_structure(bool with_renumbering = true);
+        is no holes in their numbering. If with_renumbering is true, the
+        convexes are then renumbered with the Cuthill-McKee ordering. */
+    void optimize_structure(bool with_renumbering = true) {
+      optimize_structure(with_renumbering ? CUTHILL_MCKEE_RENUMBERING
+                                          : NO_RENUMBERING);
+    }
+    /** Pack the mesh and renumber it with the given method. */
+    void optimize_structure(renumbering_method method);
+    /** Renumber all the convexes of a packed mesh in one pass (convex i
+        becomes convex new_num[i]), regions included. The finite element
+        methods on the mesh are updated as for swap_convex. */
+    void permute_convexes(const std::vector<size_type> &new_num);
+    /** Renumber all the points of a packed mesh in one pass (point i
+        becomes point new_num[i]). */
+    void permute_points(const std::vector<size_type> &new_num);
     /// Return the list of convex IDs for a Cuthill-McKee ordering
     const std::vector<size_type> &cuthill_mckee_ordering() const;
     /// Erase the mesh.
@@ -146,6 +146,15 @@ namespace getfem {
    *  @see mesh_im
    */
   class mesh_fem : public context_dependencies, virtual public dal::static_stored_object {
+  public :
+    /** Renumbering of the basic dofs applied after their enumeration
+        (see mesh_fem::set_dof_ordering). */
+    enum dof_ordering_method {
+      DOF_ORDERING_NONE,  /* dofs numbered in the order of the convexes   */
+      DOF_ORDERING_RCM,   /* reverse Cuthill-McKee on the graph of the dofs */
+      DOF_ORDERING_NESTED_DISSECTION /* nested dissection (needs METIS)   */
+    };
+
   protected :
     typedef gmm::csc_matrix<scalar_type> REDUCTION_MATRIX;
     typedef gmm::csr_matrix<scalar_type> EXTENSION_MATRIX;
@@ -175,6 +184,12 @@ namespace getfem {
     std::vector<size_type> dof_partition;
     mutable gmm::uint64_type v_num_update, v_num;
     bool use_reduction;    /* A reduction matrix is applied or not.       */
+    dof_ordering_method dof_ordering;
+    mutable std::vector<size_type> dof_perm;
+    bool parallel_enumeration; /* enumerate_dof uses enumerate_dof_parallel */
+
+    /* Renumber the basic dofs of dof_structure with dof_ordering. */
+    void apply_dof_ordering() const;
 
   public :
     typedef base_node point_type;
@@ -457,6 +472,16 @@ namespace getfem {
     virtual const std::vector<size_type> &
     ind_scalar_basic_dof_of_element(size_type cv) const
     { return dof_structure.ind_points_of_convex(cv); }
+    /** Give the compact copy of the scalar dof numbers of the elements
+        (see bgeot::mesh_structure::frozen_structure()) when the linked
+        mesh is in frozen mode, and a null pointer otherwise. The pointer
+        is valid until the next modification of the dofs or of the mesh.
+    */
+    virtual const bgeot::mesh_structure_csr *frozen_dof_structure() const {
+      if (linked_mesh_ && linked_mesh_->is_frozen())
+        return dof_structure.frozen_structure_ptr();
+      return nullptr;
+    }
     /** Give an array of the dof numbers lying of a convex face (all
               degrees of freedom whose associated base function is non-zero
         on the convex face).
@@ -546,6 +571,17 @@ namespace getfem {
     /** Renumber the degrees of freedom. You should not have
      * to call this function, as it is done automatically */
     virtual void enumerate_dof() const;
+    /** Serial version of the enumeration of the dofs. */
+    void enumerate_dof_serial() const;
+    /** Shared memory parallel version of the enumeration of the dofs,
+     * giving the same numbering as enumerate_dof_serial(). It falls back
+     * to enumerate_dof_serial() when a fem is defined on the real element.
+     * It is used by enumerate_dof() when it has been selected with
+     * set_parallel_dof_enumeration() and several threads are available. */
+    void enumerate_dof_parallel() const;
+    /** Select the parallel enumeration of the dofs (off by default). */
+    void set_parallel_dof_enumeration(bool b) { parallel_enumeration = b; }
+    bool parallel_dof_enumeration() const { return parallel_enumeration; }
 
 #if GETFEM_PARA_LEVEL > 1
     void enumerate_dof_para()const;
@@ -594,6 +630,33 @@ namespace getfem {
     }
     void clear_dof_partition() { dof_partition.clear(); }
 
+    /** Select the renumbering of the basic dofs done after their
+        enumeration, to reduce the fill-in of direct solvers
+        (DOF_ORDERING_NESTED_DISSECTION) or the bandwidth of the matrices
+        (DOF_ORDERING_RCM). The dofs are renumbered node by node: the
+        components of a vector field at a node keep consecutive numbers.
+        The ordering is applied by mesh_fem::enumerate_dof(), which the
+        derived mesh_fem (mesh_fem_sum, mesh_fem_product,
+        mesh_fem_level_set, ...) use: an override of enumerate_dof() has
+        to call it, as torus_mesh_fem does.
+    */
+    void set_dof_ordering(dof_ordering_method o) {
+      if (o != dof_ordering) {
+        dof_ordering = o;
+        dof_enumeration_made = false;
+        touch(); v_num = act_counter();
+      }
+    }
+    dof_ordering_method get_dof_ordering() const { return dof_ordering; }
+    /** Return the permutation applied by the dof ordering: the basic dof
+        i of the enumeration in the order of the convexes is the basic dof
+        dof_permutation()[i]. Empty when no renumbering is done. */
+    const std::vector<size_type> &dof_permutation() const {
+      context_check();
+      if (!dof_enumeration_made) enumerate_dof();
+      return dof_perm;
+    }
+
     size_type memsize() const {
       return dof_structure.memsize() +
         sizeof(mesh_fem) - sizeof(bgeot::mesh_structure) +
@@ -671,6 +734,17 @@ namespace getfem {
       if (qmult2 > 1) qmult2 /= mf.fem_of_element(cv)->target_dim();
     }
     size_type qmultot = qmult1*qmult2;
+    const bgeot::mesh_structure_csr *fs = mf.frozen_dof_structure();
+    if (fs) {
+      size_type nbd = fs->nb_points_of_convex(cv);
+      gmm::resize(coeff, nbd*qmultot);
+      auto itc = coeff.begin();
+      for (size_type i = 0; i < nbd; ++i) {
+        auto itv = vec.begin()+fs->ind_point_of_convex(cv, i)*qmult1;
+        for (size_type m = 0; m < qmultot; ++m) *itc++ = *itv++;
+      }
+      return;
+    }
     auto &ct = mf.ind_scalar_basic_dof_of_element(cv);
     gmm::resize(coeff, ct.size()*qmultot);
 
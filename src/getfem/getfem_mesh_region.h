@@ -41,6 +41,7 @@
 #include <bitset>
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include "dal_bit_vector.h"
 #include "bgeot_convex_structure.h"
@@ -55,7 +56,9 @@ namespace getfem {
   class APIDECL mesh_region {
   public:
     using face_bitset = std::bitset<MAX_FACES_PER_CV+1>;
-    using map_t = std::map<size_type, face_bitset>;
+    /* (convex, face mask) pairs, sorted by convex number. An empty mask
+       marks a removed entry, dropped on next iteration. */
+    using map_t = std::vector<std::pair<size_type, face_bitset>>;
 
   private:
 
@@ -63,8 +66,30 @@ namespace getfem {
 
     struct impl {
       mutable map_t m;
+      /* new convexes added out of order, merged into m on next
+         iteration. */
+      mutable std::map<size_type, face_bitset> pending;
+      /* false when there are pending or removed entries. They are merged
+         by the iterations, and for all the regions before the parallel
+         sections (see compact_unsorted_regions()), so that the point
+         queries in the parallel sections are done on sorted entries. */
+      mutable std::atomic_bool sorted;
+      /* incremented each time the entries of m are moved (for visitors). */
+      mutable size_type generation;
+      /* changed at each modification of the content (see act_counter). */
+      gmm::uint64_type v_num;
       mutable omp_distribute<dal::bit_vector> index_;
       mutable dal::bit_vector serial_index_;
+      impl() : sorted{true}, generation(0), v_num(0) {}
+      impl(const impl &o)
+        : m(o.m), pending(o.pending), sorted{o.sorted.load()}, generation(0),
+          v_num(o.v_num), index_(o.index_), serial_index_(o.serial_index_) {}
+      impl &operator=(const impl &o) {
+        m = o.m; pending = o.pending; sorted = o.sorted.load(); ++generation;
+        v_num = o.v_num; index_ = o.index_; serial_index_ = o.serial_index_;
+        return *this;
+      }
+      void sort() const;
     };
     std::shared_ptr<impl> p;  /* the real region data */
 
@@ -98,10 +123,28 @@ namespace getfem {
 
     void update_partition_iterators() const;
 
+    /** merge the pending entries and drop the removed ones, under
+        GLOBAL_OMP_GUARD. To be called before any iteration on m. */
+    void sort_entries() const;
+    /** mark the entries as not sorted and register the region for the
+        next compact_unsorted_regions(). */
+    void mark_unsorted();
+    static std::vector<std::weak_ptr<impl>> &unsorted_regions();
+    /** add the faces in mask to convex cv, in O(log n). */
+    void append(size_type cv, const face_bitset &mask);
+    /** face mask of convex cv in m (possibly removed) or null, in
+        O(log n). The pending entries are not searched. */
+    face_bitset *find(size_type cv) const;
+    /** face mask of convex cv, pending entries included (empty if cv is
+        not in the region), in O(log n) and without merging, except in a
+        parallel section for a region modified in it. */
+    face_bitset mask_of(size_type cv) const;
+
     impl &wp() { return *p.get(); }
     const impl &rp() const { return *p.get(); }
     void clean();
-    /** tells the owner mesh that the region is valid */
+    /** tells the owner mesh that the region is valid, and changes the
+        version number of the region. Called by every modification. */
     void touch_parent_mesh();
 
     /**when running while multithreaded, gives the iterator
@@ -159,6 +202,9 @@ namespace getfem {
                            const getfem::mesh& m2) const;
 
     size_type id() const { return id_; }
+    /** Number changed by each modification of the content of the region
+        (see act_counter()), 0 for a region never modified. */
+    gmm::uint64_type version_number() const { return p ? rp().v_num : 0; }
 
     size_type get_type() const { return type_; }
 
@@ -179,6 +225,11 @@ namespace getfem {
 
     bool is_partitioning_allowed() const;
 
+    /** Merge the pending and removed entries of all the regions modified
+    since the last call. Called before each parallel section, so that the
+    regions are only read there, without lock. */
+    static void compact_unsorted_regions();
+
     /** Extract the next region number
     that does not yet exists in the mesh*/
     static size_type free_region_id(const getfem::mesh& m);
@@ -204,6 +255,8 @@ namespace getfem {
     void sup_all(size_type cv);
     void clear();
     void swap_convex(size_type cv1, size_type cv2);
+    /** Renumber the convexes of the region: cv becomes new_num[cv]. */
+    void permute_convexes(const std::vector<size_type> &new_num);
     bool is_in(size_type cv, short_type f = short_type(-1)) const;
     bool is_in(size_type cv, short_type f, const mesh &m) const;
 
@@ -233,13 +286,14 @@ namespace getfem {
     for (mr_visitor i(region); !i.finished(); ++i) {
     ...
     }
+    The region can be modified during the iteration.
     */
     class visitor {
 
-      typedef mesh_region::map_t::const_iterator const_iterator;
       bool whole_mesh;
       dal::bit_const_iterator itb, iteb;
-      const_iterator it, ite;
+      const impl *pi;
+      size_type i_, end_cv, gen_;
       face_bitset c;
       size_type cv_;
       short_type f_;
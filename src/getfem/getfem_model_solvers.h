@@ -79,8 +79,33 @@ namespace getfem {
 
   template <typename MAT, typename VECT>
   struct abstract_linear_solver {
+    /* Modified Newton: maximal number of consecutive Newton iterations
+       solved with the factorization of a previous tangent matrix, and
+       maximal ratio between two consecutive residuals under which the
+       tangent matrix is considered as not having changed much. */
+    size_type max_factorization_reuse;
+    double factorization_reuse_ratio;
+    /* Direct solvers keeping their factorization: number of numerical
+       factorizations and of orderings/symbolic analyses performed. */
+    mutable size_type nb_factorizations, nb_analyses;
+
     virtual void operator ()(const MAT &, VECT &, const VECT &,
                              gmm::iteration &) const  = 0;
+    /** For the direct solvers keeping their factorization: solve with the
+        factorization of the last matrix passed to operator(). Returns
+        false if no factorization is available. */
+    virtual bool solve_with_last_factorization(VECT &, const VECT &,
+                                               gmm::iteration &) const
+    { return false; }
+    /** Allow the Newton algorithms to reuse the factorization of the
+        tangent matrix for at most n consecutive iterations, as long as
+        the residual is divided at each iteration by at least 1/ratio.
+        Only effective for the direct solvers. */
+    void set_factorization_reuse(size_type n, double ratio = 0.5)
+    { max_factorization_reuse = n; factorization_reuse_ratio = ratio; }
+    abstract_linear_solver()
+      : max_factorization_reuse(0), factorization_reuse_ratio(0.5),
+        nb_factorizations(0), nb_analyses(0) {}
     virtual ~abstract_linear_solver() {}
   };
 
@@ -139,49 +164,189 @@ namespace getfem {
     }
   };
 
+  /** Near nullspace of the operators of linear elasticity on the dofs of
+      mf: the rigid body modes if the qdim of mf is the dimension of the
+      mesh (3 modes in 2D, 6 in 3D), the constant of each component
+      otherwise. B is resized to mf.nb_dof() x (number of modes). */
+  void rigid_body_modes(const mesh_fem &mf, base_matrix &B);
+
+  /** Near nullspace of the tangent matrix of md for the algebraic
+      multigrid preconditioner: the rigid_body_modes of each fem variable
+      and zero on the other dofs, including the ones of the multipliers
+      and of the other filtered variables. block_size is the qdim of the
+      fem variable if it is the only variable of the model, 1 otherwise.
+      The dofs of the model have to be the ones of the next solve. */
+  void model_near_nullspace(const model &md, base_matrix &B,
+                            size_type &block_size);
+
+  /* Iterative solvers preconditioned by gmm::amg_precond, with the near
+     nullspace of the model at the time the solver is selected. */
+  template <typename MAT, typename VECT>
+  struct linear_solver_amg_base : public abstract_linear_solver<MAT, VECT> {
+    typedef typename gmm::linalg_traits<MAT>::value_type T;
+    base_matrix B;
+    size_type block_size;
+    gmm::amg_smoother_type smoother;
+
+    void build_precond(const MAT &M, gmm::amg_precond<MAT> &P) const {
+      P.smoother = smoother;
+      if (gmm::mat_nrows(B) == gmm::mat_nrows(M))
+        P.set_near_nullspace(B, block_size);
+      else if (gmm::mat_nrows(B) != 0)
+        GMM_WARNING2("The number of dofs of the model has changed, the "
+                     "constant vector is used as near nullspace");
+      P.build_with(M);
+    }
+    linear_solver_amg_base(const model &md, gmm::amg_smoother_type s)
+      : smoother(s) { model_near_nullspace(md, B, block_size); }
+  };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_cg_preconditioned_amg
+    : public linear_solver_amg_base<MAT, VECT> {
+    void operator ()(const MAT &M, VECT &x, const VECT &b,
+                     gmm::iteration &iter)  const {
+      gmm::amg_precond<MAT> P;
+      this->build_precond(M, P);
+      gmm::cg(M, x, b, P, iter);
+      if (!iter.converged()) GMM_WARNING2("cg did not converge!");
+    }
+    linear_solver_cg_preconditioned_amg(const model &md,
+                                        gmm::amg_smoother_type s)
+      : linear_solver_amg_base<MAT, VECT>(md, s) {}
+  };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_gmres_preconditioned_amg
+    : public linear_solver_amg_base<MAT, VECT> {
+    void operator ()(const MAT &M, VECT &x, const VECT &b,
+                     gmm::iteration &iter)  const {
+      gmm::amg_precond<MAT> P;
+      this->build_precond(M, P);
+      gmm::gmres(M, x, b, P, 500, iter);
+      if (!iter.converged()) GMM_WARNING2("gmres did not converge!");
+    }
+    linear_solver_gmres_preconditioned_amg(const model &md,
+                                           gmm::amg_smoother_type s)
+      : linear_solver_amg_base<MAT, VECT>(md, s) {}
+  };
+
+  /* The direct solvers below keep the factorization of the last matrix.
+     The factorization is skipped if the matrix has not changed and, for
+     sparse matrices, the ordering and symbolic analysis are reused if the
+     sparsity pattern has not changed. */
+
   template <typename MAT, typename VECT>
   struct linear_solver_superlu
     : public abstract_linear_solver<MAT, VECT> {
+    typedef typename gmm::linalg_traits<MAT>::value_type T;
+    /* Last factorized matrix, kept before its equilibration by SuperLU
+       to detect a change of the matrix. */
+    mutable gmm::csc_matrix<T> csc_M;
+    mutable gmm::SuperLU_factor<T> factor;
+    mutable bool factorized;
+
     void operator ()(const MAT &M, VECT &x, const VECT &b,
                      gmm::iteration &iter)  const {
-      double rcond;
-      /*gmm::HarwellBoeing_IO::write("test.hb", M);
-      std::fstream f("bbb", std::ios::out);
-      for (unsigned i=0; i < gmm::vect_size(b); ++i) f << b[i] << "\n";*/
-      int info = SuperLU_solve(M, x, b, rcond);
-      iter.enforce_converged(info == 0);
-      if (iter.get_noisy()) cout << "condition number: " << 1.0/rcond<< endl;
+      gmm::csc_matrix<T> csc_A;
+      csc_A.init_with(M);
+      bool same_pattern = (csc_M.nr == csc_A.nr && csc_M.ir == csc_A.ir
+                           && csc_M.jc == csc_A.jc);
+      if (!factorized || !same_pattern || csc_M.pr != csc_A.pr) {
+        GMM_ASSERT1(gmm::nnz(csc_A) != 0,
+                    "Cannot factor a matrix full of zeros!");
+        csc_M = csc_A; // csc_A is equilibrated in place by the factorization
+        double rcond;
+        bool numeric_only = factorized && same_pattern;
+        int info = factor.factorize(csc_A, numeric_only, iter.get_noisy(),
+                                    rcond);
+        if (info > 0) GMM_WARNING1("SuperLU solve failed: info =" << info);
+        if (iter.get_noisy())
+          cout << (numeric_only ? "numeric factorization only, " : "")
+               << "condition number: " << 1.0/rcond << endl;
+        ++(this->nb_factorizations);
+        if (!numeric_only) ++(this->nb_analyses);
+        factorized = (info == 0);
+        if (!factorized) {
+          gmm::clear(x);
+          iter.enforce_converged(false);
+          return;
+        }
+      }
+      factor.solve(x, b);
+      iter.enforce_converged(true);
+    }
+    bool solve_with_last_factorization(VECT &x, const VECT &b,
+                                       gmm::iteration &iter) const {
+      if (!factorized) return false;
+      factor.solve(x, b);
+      iter.enforce_converged(true);
+      return true;
     }
+    linear_solver_superlu() : factorized(false) {}
   };
 
   template <typename MAT, typename VECT>
   struct linear_solver_dense_lu : public abstract_linear_solver<MAT, VECT> {
+    typedef typename gmm::linalg_traits<MAT>::value_type T;
+    mutable gmm::dense_matrix<T> MM, LU;
+    mutable gmm::lapack_ipvt ipvt;
+    mutable bool factorized;
+
     void operator ()(const MAT &M, VECT &x, const VECT &b,
                      gmm::iteration &iter) const {
-      typedef typename gmm::linalg_traits<MAT>::value_type T;
-      gmm::dense_matrix<T> MM(gmm::mat_nrows(M),gmm::mat_ncols(M));
-      gmm::copy(M, MM);
-      gmm::lu_solve(MM, x, b);
+      gmm::dense_matrix<T> M2(gmm::mat_nrows(M), gmm::mat_ncols(M));
+      gmm::copy(M, M2);
+      if (!factorized || gmm::mat_nrows(MM) != gmm::mat_nrows(M2)
+          || gmm::mat_ncols(MM) != gmm::mat_ncols(M2)
+          || MM.as_vector() != M2.as_vector()) {
+        factorized = false;
+        MM.swap(M2);
+        gmm::resize(LU, gmm::mat_nrows(MM), gmm::mat_ncols(MM));
+        gmm::copy(MM, LU);
+        ipvt = gmm::lapack_ipvt(gmm::mat_nrows(MM));
+        size_type info = gmm::lu_factor(LU, ipvt);
+        ++(this->nb_factorizations); ++(this->nb_analyses);
+        GMM_ASSERT1(!info, "Singular system, pivot = " << info);
+        factorized = true;
+      }
+      gmm::lu_solve(LU, ipvt, x, b);
+      iter.enforce_converged(true);
+    }
+    bool solve_with_last_factorization(VECT &x, const VECT &b,
+                                       gmm::iteration &iter) const {
+      if (!factorized) return false;
+      gmm::lu_solve(LU, ipvt, x, b);
       iter.enforce_converged(true);
+      return true;
     }
+    linear_solver_dense_lu() : ipvt(0), factorized(false) {}
   };
 
 #ifdef GMM_USES_MUMPS
   template <typename MAT, typename VECT>
   struct linear_solver_mumps : public abstract_linear_solver<MAT, VECT> {
+    typedef typename gmm::linalg_traits<MAT>::value_type T;
+    mutable gmm::MUMPS_factor<T> factor;
+
     void operator ()(const MAT &M, VECT &x, const VECT &b,
                      gmm::iteration &iter) const {
-      bool ok = gmm::MUMPS_solve(M, x, b, false);
-      iter.enforce_converged(ok);
+      bool ok = factor.factorize(M);
+      this->nb_factorizations = factor.nb_factorizations();
+      this->nb_analyses = factor.nb_analyses();
+      iter.enforce_converged(ok && factor.solve(x, b));
     }
+    bool solve_with_last_factorization(VECT &x, const VECT &b,
+                                       gmm::iteration &iter) const {
+      if (!factor.is_factorized()) return false;
+      iter.enforce_converged(factor.solve(x, b));
+      return true;
+    }
+    linear_solver_mumps(bool sym = false) : factor(sym) {}
   };
   template <typename MAT, typename VECT>
-  struct linear_solver_mumps_sym : public abstract_linear_solver<MAT, VECT> {
-    void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter) const {
-      bool ok = gmm::MUMPS_solve(M, x, b, true);
-      iter.enforce_converged(ok);
-    }
+  struct linear_solver_mumps_sym : public linear_solver_mumps<MAT, VECT> {
+    linear_solver_mumps_sym() : linear_solver_mumps<MAT, VECT>(true) {}
   };
 #endif
 
@@ -441,16 +606,41 @@ namespace getfem {
 
     scalar_type crit = pb.residual_norm() / approx_eln;
     if (iter.finished(crit)) return;
+    R res_prev(0), reuse_ratio(linear_solver.factorization_reuse_ratio);
+    size_type nb_reuse = 0;
     for(;;) {
 
       crit = gmm::vect_dist1(pb.residual(), gmm::scaled(b0, R(1)-alpha))
         / approx_eln;
       if (!iter.converged(crit)) {
         gmm::iteration iter_linsolv = iter_linsolv0;
-        if (iter.get_noisy() > 1)
+
+        // Modified Newton: the factorization of the last tangent matrix is
+        // kept while the residual decreases fast enough.
+        bool reuse = (nb_reuse < linear_solver.max_factorization_reuse
+                      && iter.get_iteration() > 0
+                      && res0 < res_prev * reuse_ratio);
+        res_prev = res0;
+        if (reuse) {
+          gmm::clear(dr);
+          gmm::copy(pb.residual(), b);
+          gmm::add(gmm::scaled(b0,alpha-R(1)), b);
+          iter_linsolv.init();
+          reuse = linear_solver.solve_with_last_factorization(dr, b,
+                                                              iter_linsolv)
+            && iter_linsolv.converged();
+        }
+        if (reuse) {
+          ++nb_reuse;
+          if (iter.get_noisy() > 1)
+            cout << "factorization of the previous tangent matrix reused"
+                 << endl;
+        } else nb_reuse = 0;
+
+        if (!reuse && iter.get_noisy() > 1)
           cout << "starting tangent matrix computation" << endl;
 
-        int is_singular = 1;
+        int is_singular = reuse ? 0 : 1;
         while (is_singular) { // Linear system solve
           pb.compute_tangent_matrix();
           gmm::clear(dr);
@@ -566,12 +756,37 @@ namespace getfem {
     typename PB::VECTOR b(gmm::vect_size(pb.residual()));
 
     scalar_type crit = pb.residual_norm() / approx_eln;
+    R res_prev(0), reuse_ratio(linear_solver.factorization_reuse_ratio);
+    size_type nb_reuse = 0;
     while (!iter.finished(crit)) {
       gmm::iteration iter_linsolv = iter_linsolv0;
-      if (iter.get_noisy() > 1)
+
+      // Modified Newton: the factorization of the last tangent matrix is
+      // kept while the residual decreases fast enough.
+      R res = pb.residual_norm();
+      bool reuse = (nb_reuse < linear_solver.max_factorization_reuse
+                    && iter.get_iteration() > 0
+                    && res < res_prev * reuse_ratio);
+      res_prev = res;
+      if (reuse) {
+        gmm::clear(dr);
+        gmm::copy(pb.residual(), b);
+        iter_linsolv.init();
+        reuse = linear_solver.solve_with_last_factorization(dr, b,
+                                                            iter_linsolv)
+          && iter_linsolv.converged();
+      }
+      if (reuse) {
+        ++nb_reuse;
+        if (iter.get_noisy() > 1)
+          cout << "factorization of the previous tangent matrix reused"
+               << endl;
+      } else nb_reuse = 0;
+
+      if (!reuse && iter.get_noisy() > 1)
         cout << "starting computing tangent matrix" << endl;
 
-      int is_singular = 1;
+      int is_singular = reuse ? 0 : 1;
       while (is_singular) {
         pb.compute_tangent_matrix();
         gmm::clear(dr);
@@ -816,6 +1031,24 @@ namespace getfem {
     else if (bgeot::casecmp(name, "gmres/ilutp") == 0)
       return std::make_shared
         <linear_solver_gmres_preconditioned_ilutp<MATRIX, VECTOR>>();
+    else if (bgeot::casecmp(name.substr(0, 6), "cg/amg") == 0
+             || bgeot::casecmp(name.substr(0, 9), "gmres/amg") == 0) {
+      // cg/amg or gmres/amg, optionally followed by /jacobi,
+      // /gauss_seidel (the default) or /chebyshev.
+      bool cg = (bgeot::casecmp(name.substr(0, 6), "cg/amg") == 0);
+      std::string sm = name.substr(cg ? 6 : 9);
+      gmm::amg_smoother_type s = gmm::AMG_GAUSS_SEIDEL;
+      if (bgeot::casecmp(sm, "/jacobi") == 0) s = gmm::AMG_JACOBI;
+      else if (bgeot::casecmp(sm, "/chebyshev") == 0) s = gmm::AMG_CHEBYSHEV;
+      else GMM_ASSERT1(sm.size() == 0 || bgeot::casecmp(sm, "/gauss_seidel")
+                       == 0, "Unknown linear solver " << name);
+      if (cg)
+        return std::make_shared
+          <linear_solver_cg_preconditioned_amg<MATRIX, VECTOR>>(md, s);
+      else
+        return std::make_shared
+          <linear_solver_gmres_preconditioned_amg<MATRIX, VECTOR>>(md, s);
+    }
     else if (bgeot::casecmp(name, "auto") == 0)
       return default_linear_solver<MATRIX, VECTOR>(md);
     else
@@ -370,6 +370,38 @@ namespace getfem {
 
     mutable std::list<gen_expr> generic_expressions;
 
+    // Thread local workspaces containing the analysed and derived generic
+    // expressions. They are kept from one assembly to the next (Newton
+    // iterations, time steps) as long as the signature of the expressions
+    // and of the variables of the model does not change.
+    mutable omp_distribute<std::shared_ptr<ga_workspace>> ge_workspaces;
+    mutable std::string ge_workspaces_signature;
+    std::string generic_expressions_signature() const;
+    void reset_generic_workspaces() const { ge_workspaces_signature.clear(); }
+
+    // Parallel assembly of the generic expressions color by color, directly
+    // into the tangent matrix and the residual. ge_colored_regions[c][i] is
+    // the part of the region of the i-th generic expression of color c. It
+    // is empty when the strategy is not selected or not applicable.
+    bool colored_parallel_assembly_;
+    mutable std::vector<std::vector<mesh_region> > ge_colored_regions;
+    mutable omp_distribute<std::vector<std::shared_ptr<ga_workspace> > >
+      ge_colored_workspaces;
+    bool color_generic_expressions_elements() const;
+
+    // Parallel assembly of the residual of the generic expressions with
+    // atomic additions into a single vector.
+    bool atomic_residual_assembly_;
+    bool sum_factorization_;
+    mutable bool ge_atomic_residual;
+
+    // Reuse of the sparsity pattern of the tangent matrix. The pattern of
+    // the generic expressions is inserted (symbolic assembly) each time
+    // ge_pattern_signature differs from the signature of the expressions.
+    bool reuse_tangent_matrix_pattern_;
+    mutable std::string ge_pattern_signature;
+    void add_generic_expressions_pattern() const;
+
     // Groups of variables for interpolation on different meshes
     // generic assembly
     std::map<std::string, std::vector<std::string> > variable_groups;
@@ -556,6 +588,61 @@ namespace getfem {
     /** Return true if all the model terms are linear. */
     bool is_linear() const { return is_linear_; }
 
+    /** Select the strategy for the parallel assembly of the generic
+        expressions. By default, each thread assembles into its own copy of
+        the tangent matrix and of the residual, the copies being summed at
+        the end. With the colored strategy, the elements are colored such
+        that two elements of the same color do not share any dof and the
+        threads assemble directly into the tangent matrix and the residual
+        of the model, one color after the other. The default strategy is
+        kept when the coloring does not apply (assignments, secondary
+        domains, interpolated test functions, test functions on fixed size
+        variables or on reduced fems, expressions on several meshes). */
+    void set_colored_parallel_assembly(bool b)
+    { colored_parallel_assembly_ = b; reset_generic_workspaces(); }
+    bool colored_parallel_assembly() const
+    { return colored_parallel_assembly_; }
+    /** Number of colors used by the last assembly of the generic
+        expressions, 0 if the colored strategy has not been applied. */
+    size_type nb_assembly_colors() const { return ge_colored_regions.size(); }
+
+    /** Number of compilations of the generic expressions made by the
+        workspaces kept by the model, all threads together. It does not
+        increase from one assembly to the next as long as the expressions
+        and the structure of the model are unchanged. */
+    size_type nb_generic_expressions_compilations() const;
+
+    /** In the parallel assembly of the generic expressions, let all the
+        threads add their contributions to the residual with atomic
+        additions instead of assembling private copies of the residual which
+        are summed at the end. Avoids the copies and the reduction for
+        repeated residual assemblies (explicit dynamics). Not applied when a
+        variable is defined on a reduced fem. */
+    void set_atomic_residual_assembly(bool b)
+    { atomic_residual_assembly_ = b; reset_generic_workspaces(); }
+    bool atomic_residual_assembly() const { return atomic_residual_assembly_; }
+
+    /** Use the sum factorization (see ga_workspace::set_sum_factorization)
+        in the assembly of the generic expressions. It applies to the
+        elements where the fem and the integration method have a tensor
+        product structure, the other elements are assembled as usual. */
+    void set_sum_factorization(bool b)
+    { sum_factorization_ = b; reset_generic_workspaces(); }
+    bool sum_factorization() const { return sum_factorization_; }
+
+    /** Keep the sparsity pattern of the real tangent matrix from one
+        assembly to the next (Newton iterations, time steps). The entries
+        coupling the dofs of the elements of the generic expressions are
+        inserted once, computed from the dof connectivity of the finite
+        element methods (symbolic assembly). The following assemblies only
+        reset the values and add the elementary contributions to existing
+        entries (numeric assembly), without insertion nor reallocation in
+        the sparse columns. The matrix may then store zero entries. */
+    void set_reuse_tangent_matrix_pattern(bool b)
+    { reuse_tangent_matrix_pattern_ = b; ge_pattern_signature.clear(); }
+    bool reuse_tangent_matrix_pattern() const
+    { return reuse_tangent_matrix_pattern_; }
+
     /** Total number of degrees of freedom in the model. */
     size_type nb_dof() const;
 
@@ -39,6 +39,7 @@ This is the kernel of getfem.
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <set>
 #include <vector>
@@ -462,6 +463,9 @@ namespace getfem
    - thread-safe locale
    */
   #ifdef GETFEM_HAS_OPENMP
+    void parallel_execution(std::function<void(void)> lambda,
+                            bool iterate_over_partitions);
+
     #define GETFEM_OMP_PARALLEL(body) getfem::parallel_execution([&](){body;}, true);
 
     /**execute in parallel, but do not iterate over partitions*/
@@ -486,4 +490,16 @@ namespace getfem
 
   #endif
 
+  /** Call f(i0, i1) in parallel on one contiguous chunk of [0, n) per
+      thread. The whole range is processed by the calling thread if it
+      already runs in a parallel section. */
+  template <typename F> void parallel_chunks(size_type n, const F &f) {
+    if (me_is_multithreaded_now()) { f(size_type(0), n); return; }
+    GETFEM_OMP_PARALLEL_NO_PARTITION(
+      size_type nt = true_thread_policy::num_threads();
+      size_type t = true_thread_policy::this_thread();
+      f((n*t)/nt, (n*(t+1))/nt)
+    )
+  }
+
 }  /* end of namespace getfem.                                             */
\ No newline at end of file
@@ -105,6 +105,9 @@ namespace getfem {
     ind_scalar_basic_dof_of_element(size_type cv) const
     { return mf.ind_scalar_basic_dof_of_element(cv); }
 
+    const bgeot::mesh_structure_csr *frozen_dof_structure() const
+    { return mf.frozen_dof_structure(); }
+
     ind_dof_face_ct
     ind_basic_dof_of_face_of_element(size_type cv, short_type f) const
     { return  mf.ind_basic_dof_of_face_of_element(cv, f); }
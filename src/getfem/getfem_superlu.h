@@ -94,6 +94,16 @@ namespace gmm {
       build_with(csc_A, permc_spec);
     }
     void build_with(const gmm::csc_matrix<T> &A, int permc_spec = 3);
+    /** Do the factorization of A and return the SuperLU info (0 on
+        success, i > 0 if U(i,i) is exactly zero, n+1 if A is singular to
+        working precision) instead of raising an error. If same_pattern
+        is true, A is assumed to have the sparsity pattern of the
+        previously factorized matrix and its column ordering is reused.
+        If cond is true, rcond_ contains on output an estimate of the
+        reciprocal condition number of A (not computed otherwise). As for
+        build_with, A may be equilibrated in place. */
+    int factorize(const gmm::csc_matrix<T> &A, bool same_pattern, bool cond,
+                  double &rcond_, int permc_spec = 3);
     template <typename VECTX, typename VECTB> 
     /** After factorization, do the triangular solves.
        transp = LU_NOTRANSP   -> solves Ax = B
@@ -659,17 +659,19 @@ namespace getfem {
     potential_pairs = std::vector<std::vector<face_info> >();
     potential_pairs.resize(boundary_points.size());
 
+    // boxes containing boundary_points[ip] : bset[box_ptr[ip]..box_ptr[ip+1])
+    std::vector<size_type> box_ptr;
+    bgeot::rtree::pbox_cont bset;
+    element_boxes.find_boxes_at_points(boundary_points, box_ptr, bset);
+
     for (size_type ip = 0; ip < boundary_points.size(); ++ip) {
 
-      bgeot::rtree::pbox_set bset;
-      element_boxes.find_boxes_at_point(boundary_points[ip], bset);
       boundary_point *pt_info = &(boundary_points_info[ip]);
       const mesh_fem &mf1 = mfdisp_of_boundary(pt_info->ind_boundary);
       size_type ib1 = pt_info->ind_boundary;
 
-      bgeot::rtree::pbox_set::iterator it = bset.begin();
-      for (; it != bset.end(); ++it) {
-        influence_box &ibx = element_boxes_info[(*it)->id];
+      for (size_type ibox = box_ptr[ip]; ibox < box_ptr[ip+1]; ++ibox) {
+        influence_box &ibx = element_boxes_info[bset[ibox]->id];
         size_type ib2 = ibx.ind_boundary;
         const mesh_fem &mf2 = mfdisp_of_boundary(ib2);
 
@@ -1700,7 +1702,7 @@ namespace getfem {
       //
       // Determine the potential contact pairs with deformable bodies
       //
-      bgeot::rtree::pbox_set bset;
+      THREAD_SAFE_STATIC bgeot::rtree::pbox_cont bset;
       base_node bmin(pt_x), bmax(pt_x);
       for (size_type i = 0; i < N; ++i)
         { bmin[i] -= release_distance; bmax[i] += release_distance; }
@@ -2130,7 +2132,7 @@ namespace getfem {
       //
       // Determine the potential contact pairs with deformable bodies
       //
-      bgeot::rtree::pbox_set bset;
+      THREAD_SAFE_STATIC bgeot::rtree::pbox_cont bset;
       base_node bmin(pt_x), bmax(pt_x);
       for (size_type i = 0; i < N; ++i)
         { bmin[i] -= release_distance; bmax[i] += release_distance; }
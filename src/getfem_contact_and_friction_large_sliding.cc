@@ -1357,14 +1357,18 @@ namespace getfem {
     contact_frame &cf;   // contact frame description.
 
     // list des enrichissements pour ses points : y0, d0, element ...
-    bgeot::rtree element_boxes;  // influence regions of boundary elements
+    // influence regions of boundary elements, kept from an assembly to the
+    // next one so that only the boxes which moved enough are reinserted.
+    bgeot::dynamic_rtree &element_boxes;
     // list des enrichissements of boundary elements
     std::vector<size_type> boundary_of_elements;
     std::vector<size_type> ind_of_elements;
     std::vector<size_type> face_of_elements;
     std::vector<base_node> unit_normal_of_elements;
+    bgeot::rtree::pbox_cont bset; // buffer for the box queries
 
-    contact_elements(contact_frame &ccf) : cf(ccf) {}
+    contact_elements(contact_frame &ccf, bgeot::dynamic_rtree &eb)
+      : cf(ccf), element_boxes(eb) {}
     void init(void);
     bool add_point_contribution(size_type boundary_num,
                                 getfem::fem_interpolation_context &ctxu,
@@ -1378,7 +1382,7 @@ namespace getfem {
     fem_precomp_pool fppool;
     // compute the influence regions of boundary elements. To be run
     // before the assembly of contact terms.
-    element_boxes.clear();
+    size_type nb_old_boxes = element_boxes.nb_boxes();
     unit_normal_of_elements.resize(0);
     boundary_of_elements.resize(0);
     ind_of_elements.resize(0);
@@ -1471,7 +1475,11 @@ namespace getfem {
           { bmin[k] -= h; bmax[k] += h; }
 
         // Store the influence box and additional information.
-        element_boxes.add_box(bmin, bmax, unit_normal_of_elements.size());
+        size_type id = unit_normal_of_elements.size();
+        if (element_boxes.has_box(id))
+          element_boxes.update_box(id, bmin, bmax);
+        else
+          element_boxes.add_box(bmin, bmax, id);
         n_mean /= gmm::vect_norm2(n_mean);
         unit_normal_of_elements.push_back(n_mean);
         boundary_of_elements.push_back(i);
@@ -1479,6 +1487,8 @@ namespace getfem {
         face_of_elements.push_back(v.f());
       }
     }
+    for (size_type id = unit_normal_of_elements.size(); id < nb_old_boxes; ++id)
+      element_boxes.remove_box(id);
     element_boxes.build_tree();
   }
 
@@ -1536,7 +1546,6 @@ namespace getfem {
     // Selection of influence boxes
     // ----------------------------------------------------------
 
-    bgeot::rtree::pbox_set bset;
     element_boxes.find_boxes_at_point(x, bset);
 
     if (noisy) cout << "Number of boxes found : " << bset.size() << endl;
@@ -1546,12 +1555,12 @@ namespace getfem {
     // criterion : should at least eliminate the original element.
     // ----------------------------------------------------------
 
-    bgeot::rtree::pbox_set::iterator it = bset.begin(), itnext;
-    for (; it != bset.end(); it = itnext) {
-      itnext = it; ++itnext;
-      if (gmm::vect_sp(unit_normal_of_elements[(*it)->id], n)
-          >= -scalar_type(1)/scalar_type(20)) bset.erase(it);
-    }
+    bset.erase(std::remove_if(bset.begin(), bset.end(),
+                              [&](const bgeot::box_index *pb) {
+                                return gmm::vect_sp
+                                  (unit_normal_of_elements[pb->id], n)
+                                  >= -scalar_type(1)/scalar_type(20);
+                              }), bset.end());
 
     if (noisy)
       cout << "Number of boxes satisfying the unit normal criterion : "
@@ -1564,7 +1573,7 @@ namespace getfem {
     // situations with a test on |x0-y0|
     // ----------------------------------------------------------
 
-    it = bset.begin();
+    bgeot::rtree::pbox_cont::iterator it = bset.begin();
     std::vector<base_node> y0s;
     std::vector<base_small_vector> n0_y0s;
     std::vector<scalar_type> d0s;
@@ -2069,6 +2078,7 @@ namespace getfem {
 
     std::vector<contact_boundary> boundaries;
     std::vector<std::string> obstacles;
+    mutable bgeot::dynamic_rtree element_boxes;
 
     void add_boundary(const std::string &varn, const std::string &multn,
                       const mesh_im &mim, size_type region) {
@@ -2162,7 +2172,7 @@ namespace getfem {
     GMM_ASSERT1(gmm::vect_size(f_coeff) == 1,
                 "Friction coefficient should be a scalar");
 
-    contact_elements ce(cf);
+    contact_elements ce(cf, element_boxes);
     ce.init();
 
     for (size_type bnum = 0; bnum < boundaries.size(); ++bnum) {
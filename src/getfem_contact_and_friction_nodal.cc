@@ -138,32 +138,35 @@ namespace getfem {
         contact_node *cn2 = &cnl2[i2];
         tree2.add_point_with_id(cn2->mf->point_of_basic_dof(cn2->dof), i2);
       }
+      std::vector<base_node> nodes;
+      std::vector<size_type> ids;
+      std::vector<scalar_type> dist2;
       if (slave1) {
+        nodes.resize(cnl1.size());
+        for (size_type i1 = 0; i1 < cnl1.size(); ++i1)
+          nodes[i1] = cnl1[i1].mf->point_of_basic_dof(cnl1[i1].dof);
+        tree2.nearest_neighbors(nodes, ids, dist2);
         size_type ii1=size0;
         for (size_type i1 = 0; i1 < cnl1.size(); ++i1, ++ii1) {
-          contact_node *cn1 = &cnl1[i1];
-          base_node node1 = cn1->mf->point_of_basic_dof(cn1->dof);
-          bgeot::index_node_pair ipt;
-          scalar_type dist2 = tree2.nearest_neighbor(ipt, node1);
-          if (ipt.i != size_type(-1) && dist2 < (*this)[ii1].dist2) {
-            (*this)[ii1].cn_s = *cn1;
-            (*this)[ii1].cn_m = cnl2[ipt.i];
-            (*this)[ii1].dist2 = dist2;
+          if (ids[i1] != size_type(-1) && dist2[i1] < (*this)[ii1].dist2) {
+            (*this)[ii1].cn_s = cnl1[i1];
+            (*this)[ii1].cn_m = cnl2[ids[i1]];
+            (*this)[ii1].dist2 = dist2[i1];
             (*this)[ii1].is_active = true;
           }
         }
       }
       if (slave2) {
+        nodes.resize(cnl2.size());
+        for (size_type i2 = 0; i2 < cnl2.size(); ++i2)
+          nodes[i2] = cnl2[i2].mf->point_of_basic_dof(cnl2[i2].dof);
+        tree1.nearest_neighbors(nodes, ids, dist2);
         size_type ii2=size0+size1;
         for (size_type i2 = 0; i2 < cnl2.size(); ++i2, ++ii2) {
-          contact_node *cn2 = &cnl2[i2];
-          base_node node2 = cn2->mf->point_of_basic_dof(cn2->dof);
-          bgeot::index_node_pair ipt;
-          scalar_type dist2 = tree1.nearest_neighbor(ipt, node2);
-          if (ipt.i != size_type(-1) && dist2 < (*this)[ii2].dist2) {
-            (*this)[ii2].cn_s = *cn2;
-            (*this)[ii2].cn_m = cnl1[ipt.i];
-            (*this)[ii2].dist2 = dist2;
+          if (ids[i2] != size_type(-1) && dist2[i2] < (*this)[ii2].dist2) {
+            (*this)[ii2].cn_s = cnl2[i2];
+            (*this)[ii2].cn_m = cnl1[ids[i2]];
+            (*this)[ii2].dist2 = dist2[i2];
             (*this)[ii2].is_active = true;
           }
         }
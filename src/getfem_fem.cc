@@ -4348,5 +4348,221 @@ namespace getfem {
     precomps.clear();
   }
 
+  /* ******************************************************************** */
+  /*        Sum factorization.                                            */
+  /* ******************************************************************** */
+
+  DAL_TRIPLE_KEY(sum_factorization_key_, pfem, bgeot::pstored_point_tab,
+                 size_type);
+
+  // Coordinates of a tensor grid of points in each direction and index of
+  // the points in the grid (the first direction varying first). Returns
+  // false if the points do not form a complete tensor grid.
+  static bool sf_tensor_grid(const std::vector<base_node> &pts, size_type N,
+                             std::vector<std::vector<scalar_type>> &coords,
+                             std::vector<size_type> &ind) {
+    const scalar_type eps = 1E-10;
+    coords.assign(N, std::vector<scalar_type>());
+    std::vector<size_type> ind_pt(pts.size()*N);
+    for (size_type d = 0; d < N; ++d) {
+      for (const base_node &pt : pts) {
+        bool found = false;
+        for (const scalar_type &x : coords[d])
+          if (gmm::abs(x - pt[d]) < eps) { found = true; break; }
+        if (!found) coords[d].push_back(pt[d]);
+      }
+      std::sort(coords[d].begin(), coords[d].end());
+    }
+    size_type nb = 1;
+    for (size_type d = 0; d < N; ++d) nb *= coords[d].size();
+    if (nb != pts.size()) return false;
+    ind.assign(nb, size_type(-1));
+    for (size_type i = 0; i < pts.size(); ++i) {
+      size_type t = 0, stride = 1;
+      for (size_type d = 0; d < N; ++d) {
+        size_type k = 0;
+        while (gmm::abs(coords[d][k] - pts[i][d]) >= eps) ++k;
+        t += k * stride; stride *= coords[d].size();
+      }
+      if (ind[t] != size_type(-1)) return false;
+      ind[t] = i;
+    }
+    return true;
+  }
+
+  // Values and derivatives of the 1D Lagrange polynomials of the nodes x
+  // at the points p.
+  static void sf_lagrange_1D(const std::vector<scalar_type> &x,
+                             const std::vector<scalar_type> &p,
+                             base_matrix &B, base_matrix &D) {
+    size_type n = x.size(), q = p.size();
+    B = base_matrix(q, n); D = base_matrix(q, n);
+    for (size_type j = 0; j < q; ++j)
+      for (size_type i = 0; i < n; ++i) {
+        scalar_type val(1), der(0);
+        for (size_type m = 0; m < n; ++m)
+          if (m != i) {
+            scalar_type f = (p[j] - x[m]) / (x[i] - x[m]);
+            der = der * f + val / (x[i] - x[m]);
+            val *= f;
+          }
+        B(j, i) = val; D(j, i) = der;
+      }
+  }
+
+  fem_sum_factorization_::fem_sum_factorization_
+  (pfem pf, bgeot::pstored_point_tab pspt, size_type nbpt_)
+    : N(pf->dim()), ndof(pf->nb_dof(0)), nbpt(nbpt_), valid(false) {
+    DAL_STORED_OBJECT_DEBUG_CREATED(this, "Fem_sum_factorization");
+    if (!(pf->is_standard()) || !(pf->is_lagrange()) ||
+        !(pf->is_polynomial()) || pf->target_dim() != 1 || N == 0 ||
+        nbpt == 0 || pspt->size() < nbpt)
+      return;
+
+    std::vector<base_node> nodes(ndof), pts(nbpt);
+    for (size_type i = 0; i < ndof; ++i) nodes[i] = pf->node_of_dof(0, i);
+    for (size_type i = 0; i < nbpt; ++i) pts[i] = (*pspt)[i];
+    std::vector<std::vector<scalar_type>> xn, xp;
+    if (!sf_tensor_grid(nodes, N, xn, tensor_dofs) ||
+        !sf_tensor_grid(pts, N, xp, tensor_points))
+      return;
+    nd.resize(N); nq.resize(N); B1.resize(N); D1.resize(N);
+    for (size_type d = 0; d < N; ++d) {
+      nd[d] = xn[d].size(); nq[d] = xp[d].size();
+      sf_lagrange_1D(xn[d], xp[d], B1[d], D1[d]);
+    }
+
+    // Check on all the points that the base functions are the products of
+    // the 1D Lagrange polynomials. Done once, the result being stored.
+    std::vector<size_type> point_index(nbpt), ip_t(N), id_t(N);
+    for (size_type t = 0; t < nbpt; ++t) point_index[tensor_points[t]] = t;
+    base_tensor val, grad;
+    for (size_type ip = 0; ip < nbpt; ++ip) {
+      pf->base_value(pts[ip], val);
+      pf->grad_base_value(pts[ip], grad);
+      for (size_type d = 0, t = point_index[ip]; d < N; ++d)
+        { ip_t[d] = t % nq[d]; t /= nq[d]; }
+      for (size_type td = 0; td < ndof; ++td) {
+        for (size_type d = 0, t = td; d < N; ++d)
+          { id_t[d] = t % nd[d]; t /= nd[d]; }
+        size_type i = tensor_dofs[td];
+        for (size_type k = 0; k <= N; ++k) { // k == N : value
+          scalar_type a(1);
+          for (size_type d = 0; d < N; ++d)
+            a *= (d == k) ? D1[d](ip_t[d], id_t[d]) : B1[d](ip_t[d], id_t[d]);
+          scalar_type b = (k == N) ? val[i] : grad[i + ndof*k];
+          if (gmm::abs(a - b) > 1E-8 * (scalar_type(1) + gmm::abs(b))) return;
+        }
+      }
+    }
+    valid = true;
+  }
+
+  // Contraction of the index d of the tensor v with the columns (or rows
+  // if transp is true) of M. sizes are updated with the new dimension.
+  void fem_sum_factorization_::contract(const base_vector &v, base_vector &w,
+                                        const base_matrix &M,
+                                        std::vector<size_type> &sizes,
+                                        size_type d, bool transp) const {
+    size_type nin = sizes[d], nout = transp ? M.ncols() : M.nrows();
+    size_type pre = 1, post = 1;
+    for (size_type e = 0; e < d; ++e) pre *= sizes[e];
+    for (size_type e = d+1; e < N; ++e) post *= sizes[e];
+    w.resize(pre * nout * post);
+    std::fill(w.begin(), w.end(), scalar_type(0));
+    for (size_type b = 0; b < post; ++b)
+      for (size_type j = 0; j < nout; ++j) {
+        scalar_type *itw = &(w[pre*(j + nout*b)]);
+        for (size_type i = 0; i < nin; ++i) {
+          scalar_type m = transp ? M(i, j) : M(j, i);
+          if (m == scalar_type(0)) continue;
+          const scalar_type *itv = &(v[pre*(i + nin*b)]);
+          for (size_type a = 0; a < pre; ++a) itw[a] += m * itv[a];
+        }
+      }
+    sizes[d] = nout;
+  }
+
+  void fem_sum_factorization_::interpolate(const base_vector &coeff,
+                                           size_type Q, base_vector &val,
+                                           base_vector *grad) const {
+    GMM_ASSERT1(valid && gmm::vect_size(coeff) == ndof*Q,
+                "Invalid sum factorization");
+    THREAD_SAFE_STATIC base_vector c, u, w;
+    THREAD_SAFE_STATIC std::vector<size_type> sizes;
+    val.resize(nbpt*Q);
+    if (grad) grad->resize(nbpt*Q*N);
+    c.resize(ndof);
+    for (size_type q = 0; q < Q; ++q) {
+      for (size_type td = 0; td < ndof; ++td)
+        c[td] = coeff[tensor_dofs[td]*Q + q];
+      for (size_type k = 0; k <= (grad ? N : 0); ++k) { // k == 0 : value
+        u = c; sizes = nd;
+        for (size_type d = 0; d < N; ++d) {
+          contract(u, w, (d+1 == k) ? D1[d] : B1[d], sizes, d, false);
+          std::swap(u, w);
+        }
+        if (k == 0)
+          for (size_type tp = 0; tp < nbpt; ++tp)
+            val[tensor_points[tp]*Q + q] = u[tp];
+        else
+          for (size_type tp = 0; tp < nbpt; ++tp)
+            (*grad)[(tensor_points[tp]*N + k-1)*Q + q] = u[tp];
+      }
+    }
+  }
+
+  void fem_sum_factorization_::integrate(const base_vector *val,
+                                         const base_vector *grad,
+                                         size_type Q,
+                                         base_vector &elem) const {
+    GMM_ASSERT1(valid && (!val || gmm::vect_size(*val) == nbpt*Q) &&
+                (!grad || gmm::vect_size(*grad) == nbpt*Q*N) &&
+                gmm::vect_size(elem) == ndof*Q, "Invalid sum factorization");
+    THREAD_SAFE_STATIC base_vector acc, u, w;
+    THREAD_SAFE_STATIC std::vector<size_type> sizes;
+    acc.resize(ndof);
+    for (size_type q = 0; q < Q; ++q) {
+      std::fill(acc.begin(), acc.end(), scalar_type(0));
+      for (size_type k = (val ? 0 : 1); k <= (grad ? N : 0); ++k) {
+        u.resize(nbpt);
+        if (k == 0) // value
+          for (size_type tp = 0; tp < nbpt; ++tp)
+            u[tp] = (*val)[tensor_points[tp]*Q + q];
+        else
+          for (size_type tp = 0; tp < nbpt; ++tp)
+            u[tp] = (*grad)[(tensor_points[tp]*N + k-1)*Q + q];
+        sizes = nq;
+        for (size_type d = 0; d < N; ++d) {
+          contract(u, w, (d+1 == k) ? D1[d] : B1[d], sizes, d, true);
+          std::swap(u, w);
+        }
+        gmm::add(u, acc);
+      }
+      for (size_type td = 0; td < ndof; ++td)
+        elem[tensor_dofs[td]*Q + q] += acc[td];
+    }
+  }
+
+  pfem_sum_factorization fem_sum_factorization(pfem pf,
+                                               papprox_integration pai) {
+    if (!pf || !pai || pai->is_built_on_the_fly())
+      return pfem_sum_factorization();
+    bgeot::pstored_point_tab pspt = pai->pintegration_points();
+    size_type nbpt = pai->nb_points_on_convex();
+    dal::pstatic_stored_object_key
+      pk = std::make_shared<sum_factorization_key_>(pf, pspt, nbpt);
+    dal::pstatic_stored_object o = dal::search_stored_object(pk);
+    pfem_sum_factorization p;
+    if (o)
+      p = std::dynamic_pointer_cast<const fem_sum_factorization_>(o);
+    else {
+      p = std::make_shared<fem_sum_factorization_>(pf, pspt, nbpt);
+      dal::add_stored_object(pk, p, pspt, dal::AUTODELETE_STATIC_OBJECT);
+      if (dal::exists_stored_object(pf)) dal::add_dependency(p, pf);
+    }
+    return p->is_valid() ? p : pfem_sum_factorization();
+  }
+
 
 }  /* end of namespace getfem.                                            */
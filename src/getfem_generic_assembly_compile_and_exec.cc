@@ -24,6 +24,18 @@
 #include "getfem/getfem_generic_assembly_semantic.h"
 #include "getfem/getfem_generic_assembly_compile_and_exec.h"
 #include "getfem/getfem_generic_assembly_functions_and_operators.h"
+#include "getfem/dal_backtrace.h"
+#include <typeinfo>
+#ifdef GETFEM_HAVE_DLOPEN
+# include <fstream>
+# include <iterator>
+# include <dlfcn.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+#endif
 
 // #define GA_USES_BLAS // not so interesting, at least for debian blas
 
@@ -745,6 +757,95 @@ namespace getfem {
 
   };
 
+  // Values (or gradients) of a variable at all the integration points of
+  // the element computed at once by sum factorization. Executed once per
+  // element, before the per point extraction.
+  struct ga_instruction_sum_factorization_interpolate : public ga_instruction {
+    const fem_interpolation_context &ctx;
+    const mesh_fem &mf;
+    const base_vector &coeff;
+    size_type qdim;
+    bool grad;
+    const papprox_integration &pai;
+    pfem pf_old;
+    papprox_integration pai_old;
+    pfem_sum_factorization psf;
+    base_vector val, rgrad;
+    bool use_sf;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: sum factorization of "
+                    << (grad ? "gradient" : "variable value"));
+      pfem pf = mf.fem_of_element(ctx.convex_num());
+      if (pf != pf_old || pai != pai_old) {
+        psf = fem_sum_factorization(pf, pai);
+        pf_old = pf; pai_old = pai;
+      }
+      use_sf = psf && ctx.have_pgp() && !(ctx.is_on_face());
+      if (use_sf) psf->interpolate(coeff, qdim, val, grad ? &rgrad : 0);
+      return 0;
+    }
+
+    ga_instruction_sum_factorization_interpolate
+    (const fem_interpolation_context &ct, const mesh_fem &mf_,
+     const base_vector &co, size_type q, bool grad_,
+     const papprox_integration &pai_)
+      : ctx(ct), mf(mf_), coeff(co), qdim(q), grad(grad_), pai(pai_),
+        pai_old(0), use_sf(false) {}
+  };
+
+  struct ga_instruction_sum_factorization_val : public ga_instruction {
+    base_tensor &t;
+    const fem_interpolation_context &ctx;
+    const ga_instruction_sum_factorization_interpolate &sfi;
+    const size_type &ipt;
+    base_tensor Z;
+    pga_instruction base_instr, eval_instr; // used out of the tensor case
+    // Extraction of the values (or gradients) computed by sum factorization
+    // at the current integration point --> t(Qmult) or t(Qmult,N)
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: " << (sfi.grad ? "gradient" : "value")
+                    << " computed by sum factorization");
+      if (!sfi.use_sf) { base_instr->exec(); return eval_instr->exec(); }
+
+      size_type qdim = sfi.qdim;
+      if (sfi.grad) {
+        const base_matrix &B = ctx.B();
+        size_type P = gmm::mat_nrows(B), N = gmm::mat_ncols(B);
+        GA_DEBUG_ASSERT(t.size() == qdim*P, "dimensions mismatch");
+        auto itg = sfi.rgrad.begin() + ipt*N*qdim;
+        auto it = t.begin();
+        for (size_type l = 0; l < P; ++l)
+          for (size_type q = 0; q < qdim; ++q, ++it) {
+            *it = scalar_type(0);
+            for (size_type k = 0; k < N; ++k) *it += itg[k*qdim+q] * B(l, k);
+          }
+      } else {
+        GA_DEBUG_ASSERT(t.size() == qdim, "dimensions mismatch");
+        std::copy(sfi.val.begin() + ipt*qdim, sfi.val.begin() + (ipt+1)*qdim,
+                  t.begin());
+      }
+      return 0;
+    }
+
+    ga_instruction_sum_factorization_val
+    (base_tensor &tt, fem_interpolation_context &ct, pfem_precomp &pfp,
+     const ga_instruction_sum_factorization_interpolate &sfi_,
+     const size_type &ipt_)
+      : t(tt), ctx(ct), sfi(sfi_), ipt(ipt_) {
+      if (sfi.grad) {
+        base_instr = std::make_shared<ga_instruction_grad_base>
+          (Z, ct, sfi.mf, pfp);
+        eval_instr = std::make_shared<ga_instruction_grad>
+          (t, Z, sfi.coeff, sfi.qdim);
+      } else {
+        base_instr = std::make_shared<ga_instruction_val_base>
+          (Z, ct, sfi.mf, pfp);
+        eval_instr = std::make_shared<ga_instruction_val>
+          (t, Z, sfi.coeff, sfi.qdim);
+      }
+    }
+  };
+
   struct ga_instruction_hess : public ga_instruction_val {
     // Z(ndof,target_dim,N*N), coeff(Qmult,ndof) --> t(target_dim*Qmult,N,N)
     virtual int exec() {
@@ -1650,6 +1751,102 @@ namespace getfem {
   };
 
 
+  // Index permutation computed by a transposition, an index move or an
+  // index swap (see ga_instruction_transpose, ga_instruction_index_move_last
+  // and ga_instruction_swap_indices): tensor t is given by t[i] = tc1[ind[i]].
+  struct ga_index_permutation {
+    enum kind_type { TRANSPOSE, MOVE_LAST, SWAP } kind;
+    size_type n1, n2, n3, n4;
+
+    void build(size_type s, std::vector<size_type> &ind) const {
+      ind.resize(s);
+      auto it = ind.begin();
+      switch (kind) {
+      case TRANSPOSE: // n1, n2, nn = n3
+        {
+          size_type n0 = s / (n1*n2*n3);
+          for (size_type i = 0; i < n3; ++i)
+            for (size_type j = 0; j < n1; ++j)
+              for (size_type k = 0; k < n2; ++k) {
+                size_type s3 = i*n1*n2*n0 + j*n0 + k*n1*n0;
+                for (size_type l = 0; l < n0; ++l, ++it) *it = s3+l;
+              }
+        }
+        break;
+      case MOVE_LAST: // nn = n1, ii2 = n2
+        {
+          size_type ii1 = s / (n1*n2);
+          for (size_type i = 0; i < n1; ++i)
+            for (size_type j = 0; j < n2; ++j)
+              for (size_type k = 0; k < ii1; ++k, ++it)
+                *it = k + i*ii1 + j*ii1*n1;
+        }
+        break;
+      case SWAP: // nn1 = n1, nn2 = n2, ii2 = n3, ii3 = n4
+        {
+          size_type ii1 = s / (n1*n2*n3*n4);
+          for (size_type i = 0; i < n4; ++i)
+            for (size_type j = 0; j < n1; ++j)
+              for (size_type k = 0; k < n3; ++k)
+                for (size_type l = 0; l < n2; ++l) {
+                  size_type c = j*ii1 + k*ii1*n1 + l*ii1*n1*n3
+                    + i*ii1*n1*n3*n2;
+                  for (size_type m = 0; m < ii1; ++m, ++it) *it = c+m;
+                }
+        }
+        break;
+      }
+    }
+  };
+
+  // Operation of an instruction for the element-batched execution (see
+  // ga_element_batch). LINEAR_COMBINATION computes t (+)= sum of the terms
+  // alpha*(prod factors)/(prod divisors)*tc, where tc is possibly permuted,
+  // and covers the element-wise instructions. ASSEMBLY is for the
+  // instructions which assemble coeff*tc1 (added to t for an order 0
+  // term), the other kinds compute t from tc1 and tc2 as the instruction
+  // of the same name.
+  struct ga_batch_op {
+    enum kind_type { LINEAR_COMBINATION, CONTRACTION, MATRIX_MULT,
+                     MATRIX_MULT_SPEC, TMULT, ASSEMBLY } kind;
+    struct term {
+      const base_tensor *tc;
+      scalar_type alpha;
+      std::vector<const scalar_type *> factors, divisors;
+      bool permuted;
+      ga_index_permutation perm;
+    };
+    const base_tensor *t, *tc1, *tc2;
+    std::vector<term> terms; // LINEAR_COMBINATION
+    bool accumulate;         // LINEAR_COMBINATION
+    size_type n, m, p;       // Contracted dimension (and m, p of the spec)
+    bool permuted, spec2;    // Permuted tc1 (CONTRACTION), spec2 variant
+    ga_index_permutation perm;
+
+    bool set(kind_type k, const base_tensor *t_, const base_tensor *tc1_ = 0,
+             const base_tensor *tc2_ = 0, size_type n_ = 0) {
+      kind = k; t = t_; tc1 = tc1_; tc2 = tc2_; n = n_; m = p = 0;
+      terms.resize(0); accumulate = permuted = spec2 = false;
+      return true;
+    }
+    term &add_term(const base_tensor *tc, scalar_type alpha = 1.,
+                   const scalar_type *f = 0, const scalar_type *d = 0) {
+      terms.emplace_back();
+      term &tm = terms.back();
+      tm.tc = tc; tm.alpha = alpha; tm.permuted = false;
+      if (f) tm.factors.push_back(f);
+      if (d) tm.divisors.push_back(d);
+      return tm;
+    }
+    bool set_permutation(const base_tensor *t_, const base_tensor *tc1_,
+                         const ga_index_permutation &perm_) {
+      set(LINEAR_COMBINATION, t_);
+      term &tm = add_term(tc1_);
+      tm.permuted = true; tm.perm = perm_;
+      return true;
+    }
+  };
+
   struct ga_instruction_add : public ga_instruction {
     base_tensor &t;
     const base_tensor &tc1, &tc2;
@@ -1662,6 +1859,11 @@ namespace getfem {
       gmm::add(tc1.as_vector(), tc2.as_vector(), t.as_vector());
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.add_term(&tc1); op.add_term(&tc2);
+      return true;
+    }
     ga_instruction_add(base_tensor &t_,
                        const base_tensor &tc1_, const base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -1692,6 +1894,8 @@ namespace getfem {
       gmm::add(gmm::scaled(tc1.as_vector(), coeff), t.as_vector());
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, &t, &tc1); }
     ga_instruction_add_to_coeff(base_tensor &t_, const base_tensor &tc1_,
                                 scalar_type &coeff_)
       : t(t_), tc1(tc1_), coeff(coeff_) {}
@@ -1708,6 +1912,11 @@ namespace getfem {
                t.as_vector());
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.add_term(&tc1); op.add_term(&tc2, -1.);
+      return true;
+    }
     ga_instruction_sub(base_tensor &t_,
                        const base_tensor &tc1_, const base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -1750,6 +1959,11 @@ namespace getfem {
       // gmm::copy(tc1.as_vector(), t.as_vector());
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.add_term(&tc1);
+      return true;
+    }
     ga_instruction_copy_tensor(base_tensor &t_, const base_tensor &tc1_)
       : t(t_), tc1(tc1_) {}
   };
@@ -1884,6 +2098,10 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      return op.set_permutation
+        (&t, &tc1, {ga_index_permutation::TRANSPOSE, n1, n2, nn, 1});
+    }
     ga_instruction_transpose(base_tensor &t_, const base_tensor &tc1_,
                              size_type n1_, size_type n2_, size_type nn_)
       : t(t_), tc1(tc1_), n1(n1_), n2(n2_), nn(nn_) {}
@@ -1910,6 +2128,10 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      return op.set_permutation
+        (&t, &tc1, {ga_index_permutation::SWAP, nn1, nn2, ii2, ii3});
+    }
     ga_instruction_swap_indices(base_tensor &t_, const base_tensor &tc1_,
                                 size_type n1_, size_type n2_,
                                 size_type i2_, size_type i3_)
@@ -1935,6 +2157,10 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      return op.set_permutation
+        (&t, &tc1, {ga_index_permutation::MOVE_LAST, nn, ii2, 1, 1});
+    }
     ga_instruction_index_move_last(base_tensor &t_, const base_tensor &tc1_,
                                    size_type n_, size_type i2_)
       : t(t_), tc1(tc1_), nn(n_), ii2(i2_) {}
@@ -1960,6 +2186,10 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      return op.set_permutation
+        (&t, &tc1, {ga_index_permutation::TRANSPOSE, n1, n2, nn, 1});
+    }
     ga_instruction_transpose_no_test(base_tensor &t_, const base_tensor &tc1_,
                                      size_type n1_, size_type n2_,
                                      size_type nn_)
@@ -1983,6 +2213,12 @@ namespace getfem {
             *it = tc1[j+s2*i+k*s3];
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      size_type s1 = t.sizes()[0], s2 = t.sizes()[1];
+      return op.set_permutation
+        (&t, &tc1, {ga_index_permutation::TRANSPOSE, s2, s1,
+                    t.size()/(s1*s2), 1});
+    }
     ga_instruction_transpose_test(base_tensor &t_, const base_tensor &tc1_)
       : t(t_), tc1(tc1_) {}
   };
@@ -2091,6 +2327,11 @@ namespace getfem {
       gmm::copy(gmm::scaled(tc1.as_vector(), c), t.as_vector());
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.add_term(&tc1, 1., &c);
+      return true;
+    }
     ga_instruction_scalar_mult(base_tensor &t_, base_tensor &tc1_,
                                const scalar_type &c_)
       : t(t_), tc1(tc1_), c(c_) {}
@@ -2107,11 +2348,104 @@ namespace getfem {
       for (; it != t.end(); ++it, ++it1) *it = *it1/c;
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.add_term(&tc1, 1., 0, &c);
+      return true;
+    }
     ga_instruction_scalar_div(base_tensor &t_, base_tensor &tc1_,
                                const scalar_type &c_)
       : t(t_), tc1(tc1_), c(c_) {}
   };
 
+  // Linear combination t (+)= sum_i alpha_i*(prod factors)/(prod divisors)*
+  // T_i(tc_i) of tensors of the same size, where T_i is either the identity
+  // or a transposition (as in ga_instruction_transpose). Built by
+  // ga_optimize_instructions to replace chains of additions, subtractions,
+  // scalar multiplications, copies and transpositions.
+  struct ga_instruction_linear_combination : public ga_instruction {
+    struct term {
+      const base_tensor *tc;
+      scalar_type alpha;
+      std::vector<const scalar_type *> factors, divisors;
+      size_type n1, n2, nn; // Transposition if n1 != 0
+      term() : tc(0), alpha(1), n1(0), n2(0), nn(0) {}
+      scalar_type coeff() const {
+        scalar_type c = alpha;
+        for (const scalar_type *f : factors) c *= *f;
+        for (const scalar_type *d : divisors) c /= *d;
+        return c;
+      }
+    };
+    base_tensor &t;
+    std::vector<term> terms;
+    bool accumulate; // t += ... instead of t = ...
+    std::vector<scalar_type> a;
+    std::vector<base_tensor::const_iterator> x;
+
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: linear combination of "
+                    << terms.size() << " tensors");
+      size_type s = t.size(), nx = 0;
+      bool first = !accumulate;
+      a.resize(terms.size()); x.resize(terms.size());
+      for (const term &tm : terms) {
+        GA_DEBUG_ASSERT(tm.tc->size() == s, "Wrong sizes");
+        if (!tm.n1) { a[nx] = tm.coeff(); x[nx++] = tm.tc->begin(); }
+      }
+
+      // Terms without transposition, two by two in a single pass over t.
+      base_tensor::iterator it = t.begin();
+      size_type k = 0;
+      if (first && nx == 1)
+        for (size_type i = 0; i < s; ++i) it[i] = a[0]*x[0][i];
+      else if (first && nx > 1)
+        for (size_type i = 0; i < s; ++i) it[i] = a[0]*x[0][i]+a[1]*x[1][i];
+      if (first && nx) { k = std::min(nx, size_type(2)); first = false; }
+      for (; k+1 < nx; k += 2)
+        for (size_type i = 0; i < s; ++i)
+          it[i] += a[k]*x[k][i] + a[k+1]*x[k+1][i];
+      if (k < nx)
+        for (size_type i = 0; i < s; ++i) it[i] += a[k]*x[k][i];
+
+      // Transposed terms
+      for (const term &tm : terms) {
+        if (!tm.n1) continue;
+        scalar_type c = tm.coeff();
+        size_type n0 = s / (tm.n1*tm.n2*tm.nn);
+        base_tensor::const_iterator it1 = tm.tc->begin();
+        it = t.begin();
+        for (size_type i = 0; i < tm.nn; ++i)
+          for (size_type j = 0; j < tm.n1; ++j)
+            for (size_type l = 0; l < tm.n2; ++l) {
+              base_tensor::const_iterator it2
+                = it1 + (i*tm.n1*tm.n2*n0 + j*n0 + l*tm.n1*n0);
+              if (first)
+                for (size_type m = 0; m < n0; ++m, ++it) *it = c*it2[m];
+              else
+                for (size_type m = 0; m < n0; ++m, ++it) *it += c*it2[m];
+            }
+        first = false;
+      }
+      return 0;
+    }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::LINEAR_COMBINATION, &t);
+      op.accumulate = accumulate;
+      for (const term &tm : terms) {
+        ga_batch_op::term &btm = op.add_term(tm.tc, tm.alpha);
+        btm.factors = tm.factors; btm.divisors = tm.divisors;
+        if (tm.n1) {
+          btm.permuted = true;
+          btm.perm = {ga_index_permutation::TRANSPOSE, tm.n1, tm.n2, tm.nn, 1};
+        }
+      }
+      return true;
+    }
+    ga_instruction_linear_combination(base_tensor &t_, bool acc)
+      : t(t_), accumulate(acc) {}
+  };
+
   struct ga_instruction_dotmult : public ga_instruction {
     base_tensor &t, &tc1, &tc2;
     virtual int exec() {
@@ -2384,6 +2718,8 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::MATRIX_MULT, &t, &tc1, &tc2, n); }
     ga_instruction_matrix_mult(base_tensor &t_, base_tensor &tc1_,
                                base_tensor &tc2_, size_type n_)
       : t(t_), tc1(tc1_), tc2(tc2_), n(n_) {}
@@ -2412,6 +2748,11 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::MATRIX_MULT_SPEC, &t, &tc1, &tc2, n);
+      op.m = m; op.p = p;
+      return true;
+    }
     ga_instruction_matrix_mult_spec(base_tensor &t_, base_tensor &tc1_,
                                     base_tensor &tc2_, size_type n_,
                                     size_type m_, size_type p_)
@@ -2441,16 +2782,31 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Wrong sizes");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::MATRIX_MULT_SPEC, &t, &tc1, &tc2, n);
+      op.m = m; op.p = p; op.spec2 = true;
+      return true;
+    }
     ga_instruction_matrix_mult_spec2(base_tensor &t_, base_tensor &tc1_,
                                      base_tensor &tc2_, size_type n_,
                                      size_type m_, size_type p_)
       : t(t_), tc1(tc1_), tc2(tc2_), n(n_), m(m_), p(p_) {}
   };
 
-  // Performs Ani Bmi -> Cmn
-  struct ga_instruction_contraction : public ga_instruction {
+  // Common part of the dense contractions Ani Bmi -> Cmn, whose operands
+  // can be replaced by ga_optimize_instructions.
+  struct ga_instruction_contraction_base : public ga_instruction {
     base_tensor &t, &tc1, &tc2;
     size_type nn;
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, nn); }
+    ga_instruction_contraction_base(base_tensor &t_, base_tensor &tc1_,
+                                    base_tensor &tc2_, size_type n_)
+      : t(t_), tc1(tc1_), tc2(tc2_), nn(n_) {}
+  };
+
+  // Performs Ani Bmi -> Cmn
+  struct ga_instruction_contraction : public ga_instruction_contraction_base {
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: contraction operation of size " << nn);
 #if GA_USES_BLAS
@@ -2485,7 +2841,50 @@ namespace getfem {
     }
     ga_instruction_contraction(base_tensor &t_, base_tensor &tc1_,
                              base_tensor &tc2_, size_type n_)
-      : t(t_), tc1(tc1_), tc2(tc2_), nn(n_) {}
+      : ga_instruction_contraction_base(t_, tc1_, tc2_, n_) {}
+  };
+
+  // Performs Ani Bmi -> Cmn where A is the permutation of tensor tc0
+  // described by perm, without computing A. Built by
+  // ga_optimize_instructions to fold a transposition or an index move
+  // into the contraction using it.
+  struct ga_instruction_contraction_permuted : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc0;
+    base_tensor &tc2;
+    size_type nn;
+    ga_index_permutation perm;
+    std::vector<size_type> ind; // Position in tc0 of the components of A
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: contraction operation of size " << nn
+                    << " with a permuted tensor");
+      if (ind.size() != tc0.size()) perm.build(tc0.size(), ind);
+      size_type s1 = tc0.size()/nn, s2 = tc2.size()/nn;
+      GA_DEBUG_ASSERT(t.size() == s1*s2, "Internal error");
+
+      auto it = t.begin(), it2 = tc2.begin();
+      auto itind = ind.begin();
+      for (size_type i = 0; i < s1; ++i, it += s2) {
+        scalar_type a = tc0[itind[i]];
+        for (size_type j = 0; j < s2; ++j) it[j] = a * it2[j];
+        for (size_type k = 1; k < nn; ++k) {
+          a = tc0[itind[i+k*s1]];
+          auto it2k = it2 + k*s2;
+          for (size_type j = 0; j < s2; ++j) it[j] += a * it2k[j];
+        }
+      }
+      return 0;
+    }
+    virtual bool batch_op(ga_batch_op &op) const {
+      op.set(ga_batch_op::CONTRACTION, &t, &tc0, &tc2, nn);
+      op.permuted = true; op.perm = perm;
+      return true;
+    }
+    ga_instruction_contraction_permuted(base_tensor &t_,
+                                        const base_tensor &tc0_,
+                                        base_tensor &tc2_, size_type n_,
+                                        const ga_index_permutation &perm_)
+      : t(t_), tc0(tc0_), tc2(tc2_), nn(n_), perm(perm_) {}
   };
 
   // Performs Ani Bmi -> Cmn
@@ -2521,6 +2920,8 @@ namespace getfem {
       // GMM_ASSERT1(gmm::vect_dist2(t.as_vector(), u.as_vector()) < 1E-9, "Erroneous");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, n*q); }
     ga_instruction_contraction_opt0_2(base_tensor &t_, base_tensor &tc1_,
                                     base_tensor &tc2_, size_type n_,
                                     size_type q_)
@@ -2557,6 +2958,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, N*q); }
     ga_instruction_contraction_opt0_2_unrolled(base_tensor &t_, base_tensor &tc1_,
                                              base_tensor &tc2_, size_type q_)
       : t(t_), tc1(tc1_), tc2(tc2_), q(q_) {}
@@ -2591,6 +2994,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, N*Q); }
     ga_instruction_contraction_opt0_2_dunrolled
     (base_tensor &t_, base_tensor &tc1_, base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -2623,6 +3028,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, n*q); }
     ga_instruction_contraction_opt2_0(base_tensor &t_, base_tensor &tc1_,
                                     base_tensor &tc2_, size_type n_,
                                     size_type q_)
@@ -2656,6 +3063,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, N*q); }
     ga_instruction_contraction_opt2_0_unrolled(base_tensor &t_, base_tensor &tc1_,
                                              base_tensor &tc2_, size_type q_)
       : t(t_), tc1(tc1_), tc2(tc2_), q(q_) {}
@@ -2687,6 +3096,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, N*Q); }
     ga_instruction_contraction_opt2_0_dunrolled
     (base_tensor &t_, base_tensor &tc1_, base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -2714,6 +3125,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, nn); }
     ga_instruction_contraction_opt0_1(base_tensor &t_, base_tensor &tc1_,
                                     base_tensor &tc2_, size_type n_)
       : t(t_), tc1(tc1_), tc2(tc2_), nn(n_) {}
@@ -2746,6 +3159,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, N); }
     ga_instruction_contraction_opt0_1_unrolled(base_tensor &t_, base_tensor &tc1_,
                                              base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -2777,6 +3192,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::CONTRACTION, &t, &tc1, &tc2, nn); }
     ga_instruction_contraction_opt1_1(base_tensor &t_, base_tensor &tc1_,
                                     base_tensor &tc2_, size_type n_)
       : t(t_), tc1(tc1_), tc2(tc2_), nn(n_) {}
@@ -2797,8 +3214,7 @@ namespace getfem {
 
   // Performs Ani Bmi -> Cmn. Unrolled operation.
   template<int N> struct ga_instruction_contraction_unrolled
-    : public ga_instruction {
-    base_tensor &t, &tc1, &tc2;
+    : public ga_instruction_contraction_base {
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: unrolled contraction operation of size " << N);
       size_type s1 = tc1.size()/N, s2 = tc2.size()/N;
@@ -2813,7 +3229,7 @@ namespace getfem {
     }
     ga_instruction_contraction_unrolled(base_tensor &t_, base_tensor &tc1_,
                                       base_tensor &tc2_)
-      : t(t_), tc1(tc1_), tc2(tc2_) {}
+      : ga_instruction_contraction_base(t_, tc1_, tc2_, N) {}
   };
 
   template<int N, int S2> inline void reduc_elem_d_unrolled__
@@ -2877,8 +3293,7 @@ namespace getfem {
   // Performs Ani Bmi -> Cmn. Automatically doubly unrolled operation
   // (for uniform meshes).
   template<int N, int S2> struct ga_ins_red_d_unrolled
-    : public ga_instruction {
-    base_tensor &t, &tc1, &tc2;
+    : public ga_instruction_contraction_base {
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: doubly unrolled contraction operation of size "
                     << S2 << "x" << N);
@@ -2895,7 +3310,7 @@ namespace getfem {
       return 0;
     }
     ga_ins_red_d_unrolled(base_tensor &t_, base_tensor &tc1_, base_tensor &tc2_)
-      : t(t_), tc1(tc1_), tc2(tc2_) {}
+      : ga_instruction_contraction_base(t_, tc1_, tc2_, N) {}
   };
 
 
@@ -3427,6 +3842,8 @@ namespace getfem {
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::TMULT, &t, &tc1, &tc2); }
     ga_instruction_simple_tmult(base_tensor &t_, base_tensor &tc1_,
                                 base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -3462,6 +3879,8 @@ namespace getfem {
       GA_DEBUG_ASSERT(it == t.end(), "Internal error");
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::TMULT, &t, &tc1, &tc2); }
     ga_instruction_simple_tmult_unrolled(base_tensor &t_, base_tensor &tc1_,
                                          base_tensor &tc2_)
       : t(t_), tc1(tc1_), tc2(tc2_) {}
@@ -4061,6 +4480,8 @@ namespace getfem {
       E += t[0] * coeff;
       return 0;
      }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_scalar_assembly(base_tensor &t_, scalar_type &E_,
                                    scalar_type &coeff_)
       : t(t_), E(E_), coeff(coeff_) {}
@@ -4068,14 +4489,59 @@ namespace getfem {
 
   struct ga_instruction_fem_vector_assembly : public ga_instruction {
     const base_tensor &t;
-    base_vector &Vr, &Vn;
+    base_vector &Vr;
+    base_vector *const &Vn; // set at each assembly (see ga_workspace)
     const fem_interpolation_context &ctx;
     const gmm::sub_interval &Iu, &Ir;
     const mesh_fem *mfn, **mfg;
     scalar_type &coeff;
-    const size_type &nbpt, &ipt;
+    const size_type &nbpt, &ipt, &nb_exec;
     base_vector elem;
-    bool interpolate;
+    bool interpolate, atomic;
+    // Frozen dof structure of fs_mf, fetched once per run of ga_exec
+    const bgeot::mesh_structure_csr *fs;
+    const mesh_fem *fs_mf;
+    size_type fs_exec;
+
+    void add_elem() { // Adds elem to the assembled vector
+      GMM_ASSERT1(mfg ? *mfg : mfn, "Internal error");
+      const mesh_fem &mf = *(mfg ? *mfg : mfn);
+      const gmm::sub_interval &I = mf.is_reduced() ? Iu : Ir;
+      base_vector &V = mf.is_reduced() ? Vr : *Vn;
+      if (!(ctx.is_convex_num_valid())) return;
+      size_type cv_1 = ctx.convex_num();
+      // size_type cv_1 = ctx.is_convex_num_valid()
+      //   ? ctx.convex_num() : mf.convex_index().first_true();
+      GA_DEBUG_ASSERT(V.size() >= I.first() + mf.nb_basic_dof(),
+                      "Bad assembly vector size");
+      size_type qmult = mf.get_qdim();
+      if (qmult > 1) qmult /= mf.fem_of_element(cv_1)->target_dim();
+      size_type ifirst = I.first();
+      auto ite = elem.begin();
+      if (fs_exec != nb_exec || fs_mf != &mf) {
+        fs = mf.frozen_dof_structure(); fs_mf = &mf; fs_exec = nb_exec;
+      }
+      if (fs && !atomic) {
+        for (size_type i = 0, nbd = fs->nb_points_of_convex(cv_1); i < nbd;
+             ++i) {
+          auto itv = V.begin() + (ifirst + fs->ind_point_of_convex(cv_1, i));
+          for (size_type q = 0; q < qmult; ++q) *itv++ += *ite++;
+        }
+      } else if (atomic) {
+        for (const auto &dof : mf.ind_scalar_basic_dof_of_element(cv_1))
+          for (size_type q = 0; q < qmult; ++q) {
+            scalar_type &v = V[ifirst+dof+q];
+            #pragma omp atomic
+            v += *ite++;
+          }
+      } else {
+        for (const auto &dof : mf.ind_scalar_basic_dof_of_element(cv_1))
+          for (size_type q = 0; q < qmult; ++q)
+            V[ifirst+dof+q] += *ite++;
+      }
+      GMM_ASSERT1(ite == elem.end(), "Internal error");
+    }
+
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: vector term assembly for fem variable");
       bool empty_weight = (coeff == scalar_type(0));
@@ -4088,43 +4554,160 @@ namespace getfem {
         // gmm::add(gmm::scaled(t.as_vector(), coeff), elem);
         add_scaled_4(t, coeff, elem);
 
-      if (ipt == nbpt-1 || interpolate) { // finalize
-        GMM_ASSERT1(mfg ? *mfg : mfn, "Internal error");
-        const mesh_fem &mf = *(mfg ? *mfg : mfn);
-        const gmm::sub_interval &I = mf.is_reduced() ? Iu : Ir;
-        base_vector &V = mf.is_reduced() ? Vr : Vn;
-        if (!(ctx.is_convex_num_valid())) return 0;
-        size_type cv_1 = ctx.convex_num();
-        // size_type cv_1 = ctx.is_convex_num_valid()
-        //   ? ctx.convex_num() : mf.convex_index().first_true();
-        GA_DEBUG_ASSERT(V.size() >= I.first() + mf.nb_basic_dof(),
-                        "Bad assembly vector size");
-        size_type qmult = mf.get_qdim();
-        if (qmult > 1) qmult /= mf.fem_of_element(cv_1)->target_dim();
-        size_type ifirst = I.first();
-        auto ite = elem.begin();
-        for (const auto &dof : mf.ind_scalar_basic_dof_of_element(cv_1))
-          for (size_type q = 0; q < qmult; ++q)
-            V[ifirst+dof+q] += *ite++;
-        GMM_ASSERT1(ite == elem.end(), "Internal error");
-      }
+      if (ipt == nbpt-1 || interpolate) add_elem(); // finalize
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return !interpolate && op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_fem_vector_assembly
-    (const base_tensor &t_, base_vector &Vr_, base_vector &Vn_,
+    (const base_tensor &t_, base_vector &Vr_, base_vector *const &Vn_,
      const fem_interpolation_context &ctx_,
      const gmm::sub_interval &Iu_, const gmm::sub_interval &Ir_,
      const mesh_fem *mfn_, const mesh_fem **mfg_,
-     scalar_type &coeff_,
-     const size_type &nbpt_, const size_type &ipt_, bool interpolate_)
+     scalar_type &coeff_, const size_type &nbpt_, const size_type &ipt_,
+     const size_type &nb_exec_, bool interpolate_, bool atomic_ = false)
     : t(t_), Vr(Vr_), Vn(Vn_), ctx(ctx_), Iu(Iu_), Ir(Ir_), mfn(mfn_),
-      mfg(mfg_), coeff(coeff_), nbpt(nbpt_), ipt(ipt_),
-      interpolate(interpolate_) {}
+      mfg(mfg_), coeff(coeff_), nbpt(nbpt_), ipt(ipt_), nb_exec(nb_exec_),
+      interpolate(interpolate_), atomic(atomic_), fs(0), fs_mf(0),
+      fs_exec(size_type(-1)) {}
+  };
+
+  // Assembly of an order 1 term of the form sum_i s_i F_i . T_i, T_i being
+  // the value, the gradient or the divergence of the test functions and
+  // s_i F_i a test function free flux (see ga_sum_factorization_decompose).
+  // On the elements having a tensor product structure, the fluxes are
+  // stored for all the integration points and the element vector is
+  // computed at the last point by sum factorization.
+  struct ga_instruction_sum_factorization_vector_assembly
+    : public ga_instruction_fem_vector_assembly {
+    struct flux_term {
+      const base_tensor *F;  // 0 for a unit flux
+      std::vector<const base_tensor *> factors, divisors; // scalars
+      scalar_type scale;
+      int kind;              // 0 : value, 1 : gradient, 2 : divergence
+    };
+    std::vector<flux_term> terms;
+    const mesh_fem &mf;
+    const papprox_integration &pai;
+    size_type Q, P;
+    bool has_val, has_grad;
+    base_tensor Z, G;
+    pga_instruction val_base, grad_base; // used out of the tensor case
+    pfem pf_old;
+    papprox_integration pai_old;
+    pfem_sum_factorization psf;
+    base_vector flux_v, flux_g, fv, fg;
+    size_type ndof;
+    bool use_sf;
+
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: vector term assembly for fem variable "
+                    "by sum factorization");
+      if (ipt == 0) {
+        size_type cv = ctx.convex_num();
+        pfem pf = mf.fem_of_element(cv);
+        if (pf != pf_old || pai != pai_old) {
+          psf = fem_sum_factorization(pf, pai);
+          pf_old = pf; pai_old = pai;
+        }
+        use_sf = psf && ctx.have_pgp() && !(ctx.is_on_face());
+        ndof = pf->nb_dof(cv);
+        elem.assign(ndof*Q, scalar_type(0));
+        if (use_sf) {
+          size_type nbp = psf->nb_points(), N = psf->dim();
+          if (has_val) fv.assign(nbp*Q, scalar_type(0));
+          if (has_grad) fg.assign(nbp*N*Q, scalar_type(0));
+        }
+      }
+
+      if (coeff != scalar_type(0)) {
+        std::fill(flux_v.begin(), flux_v.end(), scalar_type(0));
+        std::fill(flux_g.begin(), flux_g.end(), scalar_type(0));
+        for (const flux_term &ft : terms) {
+          scalar_type s = ft.scale * coeff;
+          for (const base_tensor *f : ft.factors) s *= (*f)[0];
+          for (const base_tensor *d : ft.divisors) s /= (*d)[0];
+          base_vector &flux = (ft.kind == 0) ? flux_v : flux_g;
+          if (ft.kind == 2) {
+            if (ft.F) s *= (*(ft.F))[0];
+            for (size_type q = 0; q < Q; ++q) flux_g[q*(Q+1)] += s;
+          } else if (ft.F) {
+            auto itF = ft.F->begin();
+            for (auto it = flux.begin(); it != flux.end(); ++it, ++itF)
+              *it += s * (*itF);
+          } else
+            flux[0] += s;
+        }
+
+        if (use_sf) {
+          if (has_val)
+            std::copy(flux_v.begin(), flux_v.end(), fv.begin() + ipt*Q);
+          if (has_grad) {
+            const base_matrix &B = ctx.B();
+            size_type N = gmm::mat_ncols(B);
+            auto itg = fg.begin() + ipt*N*Q;
+            for (size_type k = 0; k < N; ++k)
+              for (size_type q = 0; q < Q; ++q, ++itg)
+                for (size_type l = 0; l < P; ++l)
+                  *itg += flux_g[q+Q*l] * B(l, k);
+          }
+        } else {
+          if (has_val) {
+            val_base->exec();
+            GA_DEBUG_ASSERT(Z.sizes()[0] == ndof, "Internal error");
+            auto ite = elem.begin();
+            for (size_type j = 0; j < ndof; ++j)
+              for (size_type q = 0; q < Q; ++q)
+                *ite++ += flux_v[q] * Z[j];
+          }
+          if (has_grad) {
+            grad_base->exec();
+            GA_DEBUG_ASSERT(G.sizes()[0] == ndof, "Internal error");
+            for (size_type l = 0; l < P; ++l)
+              for (size_type q = 0; q < Q; ++q) {
+                scalar_type a = flux_g[q+Q*l];
+                auto itG = G.begin() + ndof*l;
+                for (size_type j = 0; j < ndof; ++j)
+                  elem[j*Q+q] += a * itG[j];
+              }
+          }
+        }
+      }
+
+      if (ipt == nbpt-1) { // finalize
+        if (use_sf)
+          psf->integrate(has_val ? &fv : 0, has_grad ? &fg : 0, Q, elem);
+        add_elem();
+      }
+      return 0;
+    }
+
+    virtual bool batch_op(ga_batch_op &) const { return false; }
+    ga_instruction_sum_factorization_vector_assembly
+    (const std::vector<flux_term> &terms_, base_vector &Vr_,
+     base_vector *const &Vn_, fem_interpolation_context &ctx_,
+     const gmm::sub_interval &Iu_, const gmm::sub_interval &Ir_,
+     const mesh_fem &mf_, pfem_precomp &pfp, scalar_type &coeff_,
+     const size_type &nbpt_, const size_type &ipt_,
+     const size_type &nb_exec_, const papprox_integration &pai_,
+     bool atomic_)
+      : ga_instruction_fem_vector_assembly(Z, Vr_, Vn_, ctx_, Iu_, Ir_, &mf_,
+                                           0, coeff_, nbpt_, ipt_, nb_exec_,
+                                           false, atomic_),
+        terms(terms_), mf(mf_), pai(pai_), Q(mf_.get_qdim()),
+        P(mf_.linked_mesh().dim()), has_val(false), has_grad(false),
+        pai_old(0), ndof(0), use_sf(false) {
+      for (const flux_term &ft : terms)
+        if (ft.kind == 0) has_val = true; else has_grad = true;
+      flux_v.resize(Q); flux_g.resize(Q*P);
+      val_base = std::make_shared<ga_instruction_val_base>(Z, ctx_, mf, pfp);
+      grad_base = std::make_shared<ga_instruction_grad_base>(G, ctx_, mf, pfp);
+    }
   };
 
   struct ga_instruction_imd_vector_assembly : public ga_instruction {
     const base_tensor &t;
-    base_vector &V;
+    base_vector *const &V;
     const fem_interpolation_context &ctx;
     const gmm::sub_interval &I;
     const im_data *imd;
@@ -4137,11 +4720,11 @@ namespace getfem {
                     * imd->filtered_index_of_point(ctx.convex_num(), ipt);
       GMM_ASSERT1(i+t.size() <= I.size(), "Internal error "<<i<<"+"<<t.size()<<" <= "<<I.size());
       for (const auto &val : t.as_vector())
-        V[ifirst+(i++)] += coeff*val;
+        (*V)[ifirst+(i++)] += coeff*val;
       return 0;
     }
     ga_instruction_imd_vector_assembly
-    (const base_tensor &t_, base_vector &V_,
+    (const base_tensor &t_, base_vector *const &V_,
      const fem_interpolation_context &ctx_, const gmm::sub_interval &I_,
      const im_data *imd_, scalar_type &coeff_, const size_type &ipt_)
     : t(t_), V(V_), ctx(ctx_), I(I_), imd(imd_), coeff(coeff_), ipt(ipt_)
@@ -4150,19 +4733,31 @@ namespace getfem {
 
   struct ga_instruction_vector_assembly : public ga_instruction {
     const base_tensor &t;
-    base_vector &V;
+    base_vector *const &V;
     const gmm::sub_interval &I;
     scalar_type &coeff;
+    bool atomic;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: vector term assembly for "
                     "fixed size variable");
-      gmm::add(gmm::scaled(t.as_vector(), coeff), gmm::sub_vector(V, I));
+      if (atomic) {
+        base_vector::iterator it = V->begin() + I.first();
+        for (const auto &val : t.as_vector()) {
+          scalar_type &v = *it++;
+          #pragma omp atomic
+          v += coeff*val;
+        }
+      } else
+        gmm::add(gmm::scaled(t.as_vector(), coeff), gmm::sub_vector(*V, I));
       return 0;
     }
-    ga_instruction_vector_assembly(const base_tensor &t_, base_vector &V_,
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
+    ga_instruction_vector_assembly(const base_tensor &t_,
+                                   base_vector *const &V_,
                                    const gmm::sub_interval &I_,
-                                   scalar_type &coeff_)
-      : t(t_), V(V_), I(I_), coeff(coeff_) {}
+                                   scalar_type &coeff_, bool atomic_ = false)
+      : t(t_), V(V_), I(I_), coeff(coeff_), atomic(atomic_) {}
   };
 
   struct ga_instruction_assignment : public ga_instruction {
@@ -4324,7 +4919,8 @@ namespace getfem {
 
   struct ga_instruction_matrix_assembly : public ga_instruction {
     const base_tensor &t;
-    model_real_sparse_matrix &Krr, &Kru, &Kur, &Kuu;
+    model_real_sparse_matrix *const &Krr; // set at each assembly
+    model_real_sparse_matrix &Kru, &Kur, &Kuu;
     const fem_interpolation_context &ctx1, &ctx2;
     const gmm::sub_interval &Iu1, &Iu2, &Ir1, &Ir2;
     const mesh_fem *mfn1, *mfn2, **mfg1, **mfg2;
@@ -4334,6 +4930,11 @@ namespace getfem {
     base_vector elem;
     bool interpolate;
     std::vector<size_type> dofs1, dofs2, dofs1_sort;
+    virtual void add_elem(model_real_sparse_matrix &K,
+                          const std::vector<size_type> &d1,
+                          const std::vector<size_type> &d2,
+                          scalar_type threshold, size_type N)
+    { add_elem_matrix(K, d1, d2, dofs1_sort, elem, threshold, N); }
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: matrix term assembly");
       bool empty_weight = (coeff == scalar_type(0));
@@ -4353,7 +4954,7 @@ namespace getfem {
         bool reduced1 = (pmf1 && pmf1->is_reduced());
         bool reduced2 = (pmf2 && pmf2->is_reduced());
         model_real_sparse_matrix &K = reduced1 ? (reduced2 ? Kuu : Kur)
-                                               : (reduced2 ? Kru : Krr);
+                                               : (reduced2 ? Kru : *Krr);
         const gmm::sub_interval &I1 = reduced1 ? Iu1 : Ir1;
         const gmm::sub_interval &I2 = reduced2 ? Iu2 : Ir2;
         GA_DEBUG_ASSERT(I1.size() && I2.size(), "Internal error");
@@ -4381,10 +4982,10 @@ namespace getfem {
 
         if (pmf1 == pmf2 && (pmf1 ? (cv1 == cv2) : (s1 == s2))) {
           if (ifirst1 == ifirst2) {
-            add_elem_matrix(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
+            add_elem(K, dofs1, dofs1, ninf*1E-14, N);
           } else {
             populate_dofs_vector(dofs2, dofs1.size(), ifirst2 - ifirst1, dofs1);
-            add_elem_matrix(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+            add_elem(K, dofs1, dofs2, ninf*1E-14, N);
           }
         } else {
           if (pmf2) {
@@ -4396,14 +4997,18 @@ namespace getfem {
                                  pmf2->ind_scalar_basic_dof_of_element(cv2));
           } else
             populate_contiguous_dofs_vector(dofs2, s2, ifirst2); // --> dofs2
-          add_elem_matrix(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+          add_elem(K, dofs1, dofs2, ninf*1E-14, N);
         }
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const {
+      return !interpolate && !imd1 && !imd2
+        && op.set(ga_batch_op::ASSEMBLY, 0, &t);
+    }
     ga_instruction_matrix_assembly
     (const base_tensor &t_,
-     model_real_sparse_matrix &Krr_, model_real_sparse_matrix &Kru_,
+     model_real_sparse_matrix *const &Krr_, model_real_sparse_matrix &Kru_,
      model_real_sparse_matrix &Kur_, model_real_sparse_matrix &Kuu_,
      const fem_interpolation_context &ctx1_,
      const fem_interpolation_context &ctx2_,
@@ -4421,9 +5026,44 @@ namespace getfem {
         dofs1(0), dofs2(0) {}
   };
 
+  // Matrix-free version: the elementary matrix is multiplied by the
+  // corresponding components of x and added to y instead of being assembled.
+  struct ga_instruction_matrix_free_product
+    : public ga_instruction_matrix_assembly {
+    const base_vector &x;
+    base_vector &y;
+    virtual void add_elem(model_real_sparse_matrix &,
+                          const std::vector<size_type> &d1,
+                          const std::vector<size_type> &d2,
+                          scalar_type, size_type) {
+      base_vector::const_iterator it = elem.cbegin();
+      for (const size_type &dof2 : d2) {
+        scalar_type a = x[dof2];
+        for (const size_type &dof1 : d1) y[dof1] += (*it++) * a;
+      }
+    }
+    ga_instruction_matrix_free_product
+    (const base_tensor &t_, model_real_sparse_matrix *const &K_,
+     model_real_sparse_matrix &Ku_,
+     const fem_interpolation_context &ctx1_,
+     const fem_interpolation_context &ctx2_,
+     const gmm::sub_interval &I1_, const gmm::sub_interval &I2_,
+     const mesh_fem *mfn1_, const mesh_fem **mfg1_, const im_data *imd1_,
+     const mesh_fem *mfn2_, const mesh_fem **mfg2_, const im_data *imd2_,
+     const scalar_type &coeff_, const scalar_type &a1, const scalar_type &a2,
+     const size_type &nbpt_, const size_type &ipt_, bool interpolate_,
+     const base_vector &x_, base_vector &y_)
+      : ga_instruction_matrix_assembly(t_, K_, Ku_, Ku_, Ku_, ctx1_, ctx2_,
+                                       I1_, I1_, I2_, I2_,
+                                       mfn1_, mfg1_, imd1_,
+                                       mfn2_, mfg2_, imd2_, coeff_, a1, a2,
+                                       nbpt_, ipt_, interpolate_),
+        x(x_), y(y_) {}
+  };
+
   struct ga_instruction_matrix_assembly_standard_scalar: public ga_instruction {
     const base_tensor &t;
-    model_real_sparse_matrix &K;
+    model_real_sparse_matrix *const &K; // set at each assembly
     const fem_interpolation_context &ctx1, &ctx2;
     const gmm::sub_interval &I1, &I2;
     const mesh_fem *pmf1, *pmf2;
@@ -4457,24 +5097,26 @@ namespace getfem {
 
         if (pmf2 == pmf1 && cv1 == cv2) {
           if (I1.first() == I2.first()) {
-            add_elem_matrix(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
+            add_elem_matrix(*K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
           } else {
             populate_dofs_vector(dofs2, dofs1.size(), I2.first() - I1.first(),
                                  dofs1);
-            add_elem_matrix(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+            add_elem_matrix(*K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
           }
         } else {
           if (cv2 == size_type(-1)) return 0;
           auto &ct2 = pmf2->ind_scalar_basic_dof_of_element(cv2);
           GA_DEBUG_ASSERT(ct2.size() == t.sizes()[1], "Internal error");
           populate_dofs_vector(dofs2, ct2.size(), I2.first(), ct2);
-          add_elem_matrix(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+          add_elem_matrix(*K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
         }
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_matrix_assembly_standard_scalar
-    (const base_tensor &t_, model_real_sparse_matrix &Kn_,
+    (const base_tensor &t_, model_real_sparse_matrix *const &Kn_,
      const fem_interpolation_context &ctx1_,
      const fem_interpolation_context &ctx2_,
      const gmm::sub_interval &Ir1_, const gmm::sub_interval &Ir2_,
@@ -4488,7 +5130,7 @@ namespace getfem {
 
   struct ga_instruction_matrix_assembly_standard_vector: public ga_instruction {
     const base_tensor &t;
-    model_real_sparse_matrix &K;
+    model_real_sparse_matrix *const &K; // set at each assembly
     const fem_interpolation_context &ctx1, &ctx2;
     const gmm::sub_interval &I1, &I2;
     const mesh_fem *pmf1, *pmf2;
@@ -4523,7 +5165,7 @@ namespace getfem {
                              pmf1->ind_scalar_basic_dof_of_element(cv1));
 
         if (pmf2 == pmf1 && cv1 == cv2 && I1.first() == I2.first()) {
-          add_elem_matrix(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
+          add_elem_matrix(*K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
         } else {
           if (pmf2 == pmf1 && cv1 == cv2) {
             populate_dofs_vector(dofs2, dofs1.size(), I2.first() - I1.first(),
@@ -4535,13 +5177,15 @@ namespace getfem {
             populate_dofs_vector(dofs2, s2, I2.first(), qmult2,      // --> dofs2
                                  pmf2->ind_scalar_basic_dof_of_element(cv2));
           }
-          add_elem_matrix(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+          add_elem_matrix(*K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
         }
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_matrix_assembly_standard_vector
-    (const base_tensor &t_, model_real_sparse_matrix &Kn_,
+    (const base_tensor &t_, model_real_sparse_matrix *const &Kn_,
      const fem_interpolation_context &ctx1_,
      const fem_interpolation_context &ctx2_,
      const gmm::sub_interval &Ir1_, const gmm::sub_interval &Ir2_,
@@ -4557,7 +5201,7 @@ namespace getfem {
   struct ga_instruction_matrix_assembly_standard_vector_opt10_2
     : public ga_instruction {
     const base_tensor &t;
-    model_real_sparse_matrix &K;
+    model_real_sparse_matrix *const &K; // set at each assembly
     const fem_interpolation_context &ctx1, &ctx2;
     const gmm::sub_interval &I1, &I2;
     const mesh_fem *pmf1, *pmf2;
@@ -4606,16 +5250,18 @@ namespace getfem {
                                pmf2->ind_scalar_basic_dof_of_element(cv2));
         }
         std::vector<size_type> &dofs2_ = same_dofs ? dofs1 : dofs2;
-        add_elem_matrix(K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
+        add_elem_matrix(*K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
         for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
         if (!same_dofs) for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-        add_elem_matrix(K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
+        add_elem_matrix(*K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
       }
       return 0;
     }
 
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_matrix_assembly_standard_vector_opt10_2
-    (const base_tensor &t_, model_real_sparse_matrix &Kn_,
+    (const base_tensor &t_, model_real_sparse_matrix *const &Kn_,
      const fem_interpolation_context &ctx1_,
      const fem_interpolation_context &ctx2_,
      const gmm::sub_interval &Ir1_, const gmm::sub_interval &Ir2_,
@@ -4631,7 +5277,7 @@ namespace getfem {
   struct ga_instruction_matrix_assembly_standard_vector_opt10_3
     : public ga_instruction {
     const base_tensor &t;
-    model_real_sparse_matrix &K;
+    model_real_sparse_matrix *const &K; // set at each assembly
     const fem_interpolation_context &ctx1, &ctx2;
     const gmm::sub_interval &I1, &I2;
     const mesh_fem *pmf1, *pmf2;
@@ -4680,18 +5326,20 @@ namespace getfem {
                                pmf2->ind_scalar_basic_dof_of_element(cv2));
         }
         std::vector<size_type> &dofs2_ = same_dofs ? dofs1 : dofs2;
-        add_elem_matrix(K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
+        add_elem_matrix(*K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
         for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
         if (!same_dofs) for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-        add_elem_matrix(K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
+        add_elem_matrix(*K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
         for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
         if (!same_dofs) for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-        add_elem_matrix(K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
+        add_elem_matrix(*K, dofs1, dofs2_, dofs1_sort, elem, ninf, N);
       }
       return 0;
     }
+    virtual bool batch_op(ga_batch_op &op) const
+    { return op.set(ga_batch_op::ASSEMBLY, 0, &t); }
     ga_instruction_matrix_assembly_standard_vector_opt10_3
-    (const base_tensor &t_, model_real_sparse_matrix &Kn_,
+    (const base_tensor &t_, model_real_sparse_matrix *const &Kn_,
      const fem_interpolation_context &ctx1_,
      const fem_interpolation_context &ctx2_,
      const gmm::sub_interval &Ir1_, const gmm::sub_interval &Ir2_,
@@ -4747,6 +5395,21 @@ namespace getfem {
 
   // workspace argument  is not const because of declaration of temporary
   // unreduced variables
+  // Test if the values of the fem of mf on the first element of mim can be
+  // computed by sum factorization (see fem_sum_factorization).
+  static bool ga_sum_factorization_available(const mesh_fem &mf,
+                                             const mesh_im &mim) {
+    if (!(mf.is_uniform()) ||
+        (mf.get_qdim() > 1 && !(mf.is_uniformly_vectorized())))
+      return false;
+    size_type cv = mim.convex_index().first_true();
+    if (cv == size_type(-1) || !(mf.convex_index().is_in(cv))) return false;
+    pintegration_method pim = mim.int_method_of_element(cv);
+    if (!pim || pim->type() != IM_APPROX) return false;
+    return bool(fem_sum_factorization(mf.fem_of_element(cv),
+                                      pim->approx_method()));
+  }
+
   static void ga_compile_node(const pga_tree_node pnode,
                               ga_workspace &workspace,
                               ga_instruction_set &gis,
@@ -5148,6 +5811,24 @@ namespace getfem {
               rmi.instructions.push_back(std::move(pgai));
             }
             
+            // Values or gradients at all the integration points of an
+            // element computed at once by sum factorization when possible
+            if (rmi.sum_factorization && mf->is_uniform() &&
+                (pnode->node_type == GA_NODE_VAL ||
+                 pnode->node_type == GA_NODE_GRAD) &&
+                ga_sum_factorization_available(*mf, *(rmi.im))) {
+              auto psfi = std::make_shared
+                <ga_instruction_sum_factorization_interpolate>
+                (gis.ctx, *mf, rmi.local_dofs[pnode->name],
+                 workspace.qdim(pnode->name),
+                 pnode->node_type == GA_NODE_GRAD, gis.pai);
+              pgai = std::make_shared<ga_instruction_sum_factorization_val>
+                (pnode->tensor(), gis.ctx, rmi.pfps[mf], *psfi, gis.ipt);
+              rmi.elt_instructions.push_back(std::move(psfi));
+              rmi.instructions.push_back(std::move(pgai));
+              break;
+            }
+
             // An instruction for the base value
             pgai = pga_instruction();
             switch (pnode->node_type) {
@@ -6718,6 +7399,201 @@ namespace getfem {
     }
   }
 
+  //=========================================================================
+  // Sum factorization of order 1 terms and matrix-free action form
+  //=========================================================================
+
+  // Contraction of a test function free flux with the value, gradient or
+  // divergence of the test function (see
+  // ga_instruction_sum_factorization_vector_assembly).
+  struct ga_sum_factorization_term {
+    pga_tree_node F;                              // 0 for a unit flux
+    std::vector<pga_tree_node> factors, divisors; // scalar factors
+    scalar_type scale;
+    int kind;                                     // 0 : value, 1 : gradient,
+                                                  // 2 : divergence
+  };
+
+  static int ga_sum_factorization_test_kind(const pga_tree_node pnode,
+                                            const pga_tree_node root) {
+    if (pnode->test_function_type != 1 ||
+        pnode->name_test1.compare(root->name_test1) ||
+        pnode->interpolate_name_test1.size()) return -1;
+    switch (pnode->node_type) {
+    case GA_NODE_VAL_TEST: return 0;
+    case GA_NODE_GRAD_TEST: return 1;
+    case GA_NODE_DIVERG_TEST: return 2;
+    default: return -1;
+    }
+  }
+
+  // Decompose a scalar order 1 term into a sum of ga_sum_factorization_term.
+  // Return false if the term has not this form.
+  static bool ga_sum_factorization_decompose
+  (const pga_tree_node pnode, const pga_tree_node root, scalar_type scale,
+   std::vector<pga_tree_node> &factors, std::vector<pga_tree_node> &divisors,
+   std::vector<ga_sum_factorization_term> &terms) {
+    if (pnode->node_type == GA_NODE_ZERO) return true;
+    if (pnode->tensor_proper_size() != 1) return false;
+    int kind = ga_sum_factorization_test_kind(pnode, root);
+    if (kind >= 0) {
+      terms.push_back({pga_tree_node(0), factors, divisors, scale, kind});
+      return true;
+    }
+    if (pnode->node_type != GA_NODE_OP) return false;
+
+    size_type nbch = pnode->children.size();
+    pga_tree_node child0 = (nbch > 0) ? pnode->children[0] : 0;
+    pga_tree_node child1 = (nbch > 1) ? pnode->children[1] : 0;
+    auto scalar_factor = [](const pga_tree_node p)
+      { return p->test_function_type == 0 && p->tensor_proper_size() == 1; };
+    bool ok = false;
+    switch (pnode->op_type) {
+    case GA_PLUS: case GA_MINUS:
+      return ga_sum_factorization_decompose(child0, root, scale, factors,
+                                            divisors, terms) &&
+        ga_sum_factorization_decompose(child1, root, (pnode->op_type==GA_PLUS)
+                                       ? scale : -scale, factors, divisors,
+                                       terms);
+    case GA_UNARY_MINUS:
+      return ga_sum_factorization_decompose(child0, root, -scale, factors,
+                                            divisors, terms);
+    case GA_MULT:
+      if (scalar_factor(child1)) std::swap(child0, child1);
+      if (!scalar_factor(child0)) return false;
+      factors.push_back(child0);
+      ok = ga_sum_factorization_decompose(child1, root, scale, factors,
+                                          divisors, terms);
+      factors.pop_back();
+      return ok;
+    case GA_DIV:
+      if (!scalar_factor(child1)) return false;
+      divisors.push_back(child1);
+      ok = ga_sum_factorization_decompose(child0, root, scale, factors,
+                                          divisors, terms);
+      divisors.pop_back();
+      return ok;
+    case GA_DOT: case GA_COLON:
+      {
+        if (child0->test_function_type == 0) std::swap(child0, child1);
+        kind = ga_sum_factorization_test_kind(child0, root);
+        size_type order = child1->tensor_order();
+        if (kind < 0 || child1->test_function_type != 0 || order == 0 ||
+            order != child0->tensor_order() ||
+            (pnode->op_type == GA_DOT && order != 1)) return false;
+        for (size_type i = 0; i < order; ++i)
+          if (child0->tensor_proper_size(i) != child1->tensor_proper_size(i))
+            return false;
+        terms.push_back({child1, factors, divisors, scale, kind});
+      }
+      return true;
+    default: return false;
+    }
+  }
+
+  // Decompose an order 1 tree if its assembly can be performed by sum
+  // factorization.
+  static bool ga_sum_factorization_terms
+  (const pga_tree_node root, const ga_workspace &workspace,
+   const ga_instruction_set::region_mim_instructions &rmi,
+   std::vector<ga_sum_factorization_term> &terms) {
+    terms.resize(0);
+    if (!(rmi.sum_factorization) || root->test_function_type != 1 ||
+        root->interpolate_name_test1.size() ||
+        workspace.variable_group_exists(root->name_test1)) return false;
+    const mesh_fem *mf = workspace.associated_mf(root->name_test1);
+    if (!mf || workspace.qdim(root->name_test1) != mf->get_qdim() ||
+        !ga_sum_factorization_available(*mf, *(rmi.im))) return false;
+    std::vector<pga_tree_node> factors, divisors;
+    if (!ga_sum_factorization_decompose(root, root, scalar_type(1), factors,
+                                        divisors, terms)) return false;
+    size_type Q = mf->get_qdim(), P = mf->linked_mesh().dim();
+    for (const ga_sum_factorization_term &term : terms)
+      if (term.kind == 2 && Q != P) return false;
+    return terms.size() > 0;
+  }
+
+  // Replace the second test function by the field named xname.
+  static bool ga_replace_test2(pga_tree_node pnode, const std::string &xname) {
+    for (pga_tree_node child : pnode->children)
+      if (!ga_replace_test2(child, xname)) return false;
+    if (!(pnode->children.empty()) || !(pnode->test_function_type & 2))
+      return true;
+    std::string prefix;
+    switch (pnode->node_type) {
+    case GA_NODE_VAL_TEST: break;
+    case GA_NODE_GRAD_TEST: prefix = "Grad_"; break;
+    case GA_NODE_HESS_TEST: prefix = "Hess_"; break;
+    case GA_NODE_DIVERG_TEST: prefix = "Div_"; break;
+    default: return false;
+    }
+    if (pnode->interpolate_name_test2.size()) return false;
+    pnode->node_type = GA_NODE_NAME;
+    pnode->name = prefix + xname;
+    pnode->test_function_type = 0;
+    pnode->name_test2 = pnode->interpolate_name_test2 = "";
+    pnode->qdim2 = 0;
+    return true;
+  }
+
+  // Action form of an order 2 tree for a matrix-free product: an order 1
+  // tree where the second test function is replaced by the field defined
+  // by the input vector (see ga_workspace::matrix_free_product).
+  static bool ga_matrix_free_action_form(ga_tree &tree,
+                                         ga_workspace &workspace,
+                                         const mesh &m) {
+    pga_tree_node root = tree.root;
+    if (!root || root->test_function_type != 3 ||
+        tree.secondary_domain.size() ||
+        root->interpolate_name_test1.size() ||
+        root->interpolate_name_test2.size() ||
+        workspace.variable_group_exists(root->name_test1)) return false;
+    std::string name_test1 = root->name_test1;
+    std::string xname = workspace.matrix_free_input_name(root->name_test2);
+    const mesh_fem *mf1 = workspace.associated_mf(name_test1);
+    if (xname.empty() || !mf1 || mf1->is_reduced() ||
+        workspace.factor_of_variable(name_test1) != scalar_type(1))
+      return false;
+
+    ga_tree action_tree(tree);
+    if (!ga_replace_test2(action_tree.root, xname)) return false;
+    ga_semantic_analysis(action_tree, workspace, m, ref_elt_dim_of_mesh(m),
+                         true, false);
+    root = action_tree.root;
+    if (!root || root->test_function_type != 1 ||
+        root->name_test1.compare(name_test1) ||
+        root->interpolate_name_test1.size()) return false;
+    tree.swap(action_tree);
+    return true;
+  }
+
+  static pga_instruction ga_sum_factorization_vector_assembly
+  (const std::vector<ga_sum_factorization_term> &sf_terms,
+   const ga_workspace &workspace, ga_instruction_set &gis,
+   ga_instruction_set::region_mim_instructions &rmi,
+   const std::string &name_test1, base_vector &Vu, base_vector *const &Vr,
+   const gmm::sub_interval &Iu, const gmm::sub_interval &Ir) {
+    typedef ga_instruction_sum_factorization_vector_assembly::flux_term
+      flux_term;
+    std::vector<flux_term> terms;
+    for (const ga_sum_factorization_term &term : sf_terms) {
+      flux_term ft;
+      ft.F = term.F ? &(term.F->tensor()) : 0;
+      for (const pga_tree_node f : term.factors)
+        ft.factors.push_back(&(f->tensor()));
+      for (const pga_tree_node d : term.divisors)
+        ft.divisors.push_back(&(d->tensor()));
+      ft.scale = term.scale;
+      ft.kind = term.kind;
+      terms.push_back(ft);
+    }
+    const mesh_fem *mf = workspace.associated_mf(name_test1);
+    return std::make_shared<ga_instruction_sum_factorization_vector_assembly>
+      (terms, Vu, Vr, gis.ctx, Iu, Ir, *mf, rmi.pfps[mf], gis.coeff,
+       gis.nbpt, gis.ipt, gis.nb_exec, gis.pai,
+       workspace.is_atomic_vector_assembly());
+  }
+
   void ga_compile_interpolation(ga_workspace &workspace,
                                 ga_instruction_set &gis) {
     gis.transformations.clear();
@@ -6754,6 +7630,707 @@ namespace getfem {
     }
   }
 
+  //=========================================================================
+  // Optimization of a compiled set of assembly terms
+  //=========================================================================
+
+  typedef ga_instruction_linear_combination::term ga_lc_term;
+
+  // Description as a linear combination of the instructions that can be
+  // fused, null for the other ones.
+  static std::shared_ptr<ga_instruction_linear_combination>
+  ga_linear_combination_of(ga_instruction *p) {
+    std::shared_ptr<ga_instruction_linear_combination> lc;
+    ga_lc_term t1, t2;
+    if (auto q = dynamic_cast<ga_instruction_add *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t2.tc = &(q->tc2);
+      lc->terms = {t1, t2};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_sub *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t2.tc = &(q->tc2); t2.alpha = scalar_type(-1);
+      lc->terms = {t1, t2};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_scalar_mult *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t1.factors.push_back(&(q->c));
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_scalar_div *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t1.divisors.push_back(&(q->c));
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_copy_tensor *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1);
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_transpose *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t1.n1 = q->n1; t1.n2 = q->n2; t1.nn = q->nn;
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_transpose_no_test *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, false);
+      t1.tc = &(q->tc1); t1.n1 = q->n1; t1.n2 = q->n2; t1.nn = q->nn;
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_add_to *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, true);
+      t1.tc = &(q->tc1);
+      lc->terms = {t1};
+      return lc;
+    }
+    if (auto q = dynamic_cast<ga_instruction_add_to_coeff *>(p)) {
+      lc = std::make_shared<ga_instruction_linear_combination>(q->t, true);
+      t1.tc = &(q->tc1); t1.factors.push_back(&(q->coeff));
+      lc->terms = {t1};
+    }
+    return lc;
+  }
+
+  // Replaces the term outer, whose tensor is computed by the linear
+  // combination inner, by the terms of inner. Fails if the composition of
+  // two transpositions is not the identity.
+  static bool ga_compose_terms(const std::vector<ga_lc_term> &inner,
+                               const ga_lc_term &outer,
+                               std::vector<ga_lc_term> &terms) {
+    for (const ga_lc_term &tm : inner)
+      if (tm.n1 && outer.n1 &&
+          (tm.n1 != outer.n2 || tm.n2 != outer.n1 || tm.nn != outer.nn))
+        return false;
+    for (ga_lc_term tm : inner) {
+      tm.alpha *= outer.alpha;
+      tm.factors.insert(tm.factors.end(), outer.factors.begin(),
+                        outer.factors.end());
+      tm.divisors.insert(tm.divisors.end(), outer.divisors.begin(),
+                         outer.divisors.end());
+      if (outer.n1) {
+        if (tm.n1) tm.n1 = tm.n2 = tm.nn = 0;
+        else { tm.n1 = outer.n1; tm.n2 = outer.n2; tm.nn = outer.nn; }
+      }
+      terms.push_back(tm);
+    }
+    return true;
+  }
+
+  // Description of the permutations of tensors that can be folded into a
+  // contraction. Returns the computed tensor, or null.
+  static const base_tensor *
+  ga_permutation_of(ga_instruction *p, ga_index_permutation &perm,
+                    const base_tensor *&tc) {
+    if (auto q = dynamic_cast<ga_instruction_transpose *>(p)) {
+      perm = {ga_index_permutation::TRANSPOSE, q->n1, q->n2, q->nn, 1};
+      tc = &(q->tc1); return &(q->t);
+    }
+    if (auto q = dynamic_cast<ga_instruction_transpose_no_test *>(p)) {
+      perm = {ga_index_permutation::TRANSPOSE, q->n1, q->n2, q->nn, 1};
+      tc = &(q->tc1); return &(q->t);
+    }
+    if (auto q = dynamic_cast<ga_instruction_index_move_last *>(p)) {
+      perm = {ga_index_permutation::MOVE_LAST, q->nn, q->ii2, 1, 1};
+      tc = &(q->tc1); return &(q->t);
+    }
+    if (auto q = dynamic_cast<ga_instruction_swap_indices *>(p)) {
+      perm = {ga_index_permutation::SWAP, q->nn1, q->nn2, q->ii2, q->ii3};
+      tc = &(q->tc1); return &(q->t);
+    }
+    return 0;
+  }
+
+  static void ga_count_tensor_uses
+  (const pga_tree_node pnode, std::map<const base_tensor *, size_type> &uses) {
+    ++(uses[&(pnode->tensor())]);
+    for (const pga_tree_node child : pnode->children)
+      ga_count_tensor_uses(child, uses);
+  }
+
+  // Fuses the chains of element-wise instructions (additions, subtractions,
+  // scalar multiplications and divisions, copies and transpositions) executed
+  // on each integration point: an instruction computing an intermediary
+  // tensor used only once is merged into the instruction using it, so that
+  // the intermediary tensor is no longer computed. In the same way, the
+  // transpositions and index moves or swaps giving the first operand of a
+  // dense contraction are folded into the addressing of the contraction.
+  // The lists of instructions containing an interpolate filter are left
+  // unchanged since it jumps over a fixed number of instructions.
+  size_type ga_optimize_instructions(ga_instruction_set &gis) {
+    // Number of nodes of the trees sharing each tensor. A tensor shared by
+    // a single node is read only by the instruction of its parent node (or
+    // by the assembly instruction for a root).
+    std::map<const base_tensor *, size_type> uses;
+    for (const std::list<ga_tree> *trees : {&gis.trees,
+                                            &gis.interpolation_trees})
+      for (const ga_tree &tree : *trees)
+        if (tree.root) ga_count_tensor_uses(tree.root, uses);
+
+    size_type nb_removed = 0;
+    for (auto &&instr : gis.all_instructions) {
+      std::vector<pga_instruction> &gil = instr.second.instructions;
+      size_type nb = gil.size();
+      std::vector<std::shared_ptr<ga_instruction_linear_combination>> lc(nb);
+      std::vector<ga_index_permutation> perm(nb);
+      std::vector<const base_tensor *> perm_tc(nb, 0);
+      std::map<const base_tensor *, size_type> producer;
+      std::set<const base_tensor *> pinned; // Read outside of the trees
+      bool filter = false;
+      for (size_type i = 0; i < nb; ++i) {
+        ga_instruction *p = gil[i].get();
+        if (dynamic_cast<ga_instruction_interpolate_filter *>(p))
+          filter = true;
+        else if (auto q = dynamic_cast<ga_instruction_transpose_test *>(p))
+          pinned.insert(&(q->tc1));
+        lc[i] = ga_linear_combination_of(p);
+        const base_tensor *pt = ga_permutation_of(p, perm[i], perm_tc[i]);
+        if (lc[i] && !(lc[i]->accumulate)) pt = &(lc[i]->t);
+        if (pt) producer[pt] = producer.count(pt) ? size_type(-1) : i;
+      }
+      if (filter) continue;
+
+      std::vector<bool> removed(nb, false), fused(nb, false);
+      for (size_type i = 0; i < nb; ++i) {
+        if (!lc[i]) continue;
+        std::vector<ga_lc_term> terms;
+        for (const ga_lc_term &tm : lc[i]->terms) {
+          auto itp = producer.find(tm.tc);
+          size_type j = (itp == producer.end()) ? size_type(-1) : itp->second;
+          if (j < i && lc[j] && !removed[j] && uses[tm.tc] == 1
+              && pinned.count(tm.tc) == 0
+              && ga_compose_terms(lc[j]->terms, tm, terms)) {
+            removed[j] = fused[i] = true; ++nb_removed;
+          } else
+            terms.push_back(tm);
+        }
+        if (fused[i]) lc[i]->terms.swap(terms);
+      }
+
+      std::vector<pga_instruction> folded(nb);
+      for (size_type i = 0; i < nb; ++i) {
+        auto q = dynamic_cast<ga_instruction_contraction_base *>(gil[i].get());
+        if (!q) continue;
+        auto itp = producer.find(&(q->tc1));
+        size_type j = (itp == producer.end()) ? size_type(-1) : itp->second;
+        if (j < i && perm_tc[j] && !removed[j] && !fused[j]
+            && uses[&(q->tc1)] == 1 && pinned.count(&(q->tc1)) == 0) {
+          folded[i] = std::make_shared<ga_instruction_contraction_permuted>
+            (q->t, *(perm_tc[j]), q->tc2, q->nn, perm[j]);
+          removed[j] = true; ++nb_removed;
+        }
+      }
+
+      std::vector<pga_instruction> optimized_gil;
+      for (size_type i = 0; i < nb; ++i)
+        if (!removed[i])
+          optimized_gil.push_back(folded[i] ? folded[i]
+                                  : (fused[i] ? lc[i] : gil[i]));
+      gil.swap(optimized_gil);
+    }
+    return nb_removed;
+  }
+
+  static std::string ga_instruction_name(const ga_instruction &instr) {
+    std::string name = dal::demangle(typeid(instr).name());
+    if (name.empty()) name = typeid(instr).name();
+    if (name.compare(0, 8, "getfem::") == 0) name = name.substr(8);
+    return name;
+  }
+
+  void ga_print_instructions(const ga_instruction_set &gis,
+                             std::ostream &str) {
+    for (const auto &instr : gis.all_instructions) {
+      const ga_instruction_set::region_mim_instructions &rmi = instr.second;
+      str << "Instructions on mesh_im " << instr.first.mim()
+          << ", region " << instr.first.region() << endl;
+      const std::vector<pga_instruction> *lists[3]
+        = {&rmi.begin_instructions, &rmi.elt_instructions, &rmi.instructions};
+      const char *names[3] = {"begin", "element", "integration point"};
+      for (size_type k = 0; k < 3; ++k) {
+        str << "  " << names[k] << " (" << lists[k]->size() << "):" << endl;
+        for (const pga_instruction &pgai : *(lists[k])) {
+          str << "    " << ga_instruction_name(*pgai);
+          auto plc
+            = dynamic_cast<const ga_instruction_linear_combination *>(&*pgai);
+          if (plc) str << " of " << plc->terms.size() << " tensors";
+          str << endl;
+        }
+      }
+    }
+  }
+
+  //=========================================================================
+  // Native code for the integration point instructions
+  //=========================================================================
+
+  // The instructions of a list are translated into a C++ function in which
+  // the element-wise operations and the contractions are written with the
+  // sizes of the tensors at compile time, the other instructions being
+  // called back. The function is compiled by the system compiler into a
+  // shared object, cached on disk and loaded with dlopen. The sizes of the
+  // tensors are checked before the call and after each call back. The
+  // remaining instructions are executed by the interpreter if a size has
+  // changed.
+
+  typedef int (*ga_native_callback)(void *, int, int);
+  typedef int (*ga_native_function)(scalar_type *const *,
+                                    scalar_type *const *, void *,
+                                    ga_native_callback);
+
+  struct ga_instruction_native_code : public ga_instruction {
+    ga_native_function f;
+    std::vector<pga_instruction> gil; // Interpreted instructions
+    std::vector<base_tensor *> tensors;
+    std::vector<size_type> sizes;
+    std::vector<scalar_type *> T, S;
+    // Tensors used by each run of consecutive native instructions, checked
+    // before the run.
+    std::vector<std::vector<size_type>> runs;
+    int first_run; // Run at the beginning of the list, -1 if none
+
+    bool update_tensors(int r) {
+      if (r < 0) return true;
+      for (size_type i : runs[r]) {
+        if (tensors[i]->size() != sizes[i]) return false;
+        if (sizes[i]) T[i] = &((*(tensors[i]))[0]);
+      }
+      return true;
+    }
+    static int callback(void *data, int k, int r) {
+      ga_instruction_native_code *p
+        = static_cast<ga_instruction_native_code *>(data);
+      p->gil[k]->exec();
+      return p->update_tensors(r) ? 0 : 1;
+    }
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: native code");
+      size_type k = 0;
+      if (update_tensors(first_run))
+        k = size_type((*f)(&(T[0]), &(S[0]), this, callback));
+      for (; k < gil.size(); ++k) k += gil[k]->exec();
+      return 0;
+    }
+    ga_instruction_native_code() : f(0), first_run(-1) {}
+  };
+
+  struct ga_native_code_generator {
+    std::map<const base_tensor *, size_type> tensor_index;
+    std::vector<base_tensor *> tensors;
+    std::map<const scalar_type *, size_type> scalar_index;
+    std::vector<scalar_type *> scalars;
+    std::stringstream code;
+    std::set<size_type> used; // Tensors used by the current instruction
+    std::vector<std::vector<size_type>> runs;
+    int first_run;
+    size_type nb_native;
+
+    std::string T(const base_tensor &t) {
+      auto it = tensor_index.find(&t);
+      if (it == tensor_index.end()) {
+        it = tensor_index.emplace(&t, tensors.size()).first;
+        tensors.push_back(const_cast<base_tensor *>(&t));
+      }
+      used.insert(it->second);
+      return "T[" + std::to_string(it->second) + "]";
+    }
+
+    std::string S(const scalar_type &s) {
+      auto it = scalar_index.find(&s);
+      if (it == scalar_index.end()) {
+        it = scalar_index.emplace(&s, scalars.size()).first;
+        scalars.push_back(const_cast<scalar_type *>(&s));
+      }
+      return "(*S[" + std::to_string(it->second) + "])";
+    }
+
+    bool linear_combination(const ga_instruction_linear_combination &lc) {
+      size_type s = lc.t.size();
+      for (const ga_lc_term &tm : lc.terms)
+        if (tm.tc->size() != s || (tm.n1 && s % (tm.n1*tm.n2*tm.nn) != 0))
+          return false;
+      code << "  { scalar_type *t = " << T(lc.t) << ";\n";
+      bool first = !(lc.accumulate);
+      for (const ga_lc_term &tm : lc.terms) {
+        const char *op = first ? "=" : "+=";
+        code << "    { const scalar_type *c = " << T(*(tm.tc))
+             << "; scalar_type a = " << tm.alpha;
+        for (const scalar_type *f : tm.factors) code << "*" << S(*f);
+        for (const scalar_type *d : tm.divisors) code << "/" << S(*d);
+        code << ";\n";
+        if (tm.n1) {
+          size_type n0 = s / (tm.n1*tm.n2*tm.nn);
+          code << "      scalar_type *it = t;\n"
+               << "      for (int i = 0; i < " << tm.nn << "; ++i)\n"
+               << "        for (int j = 0; j < " << tm.n1 << "; ++j)\n"
+               << "          for (int k = 0; k < " << tm.n2 << "; ++k)\n"
+               << "            for (int l = 0; l < " << n0 << "; ++l)\n"
+               << "              *it++ " << op << " a*c[i*"
+               << tm.n1*tm.n2*n0 << "+j*" << n0 << "+k*" << tm.n1*n0
+               << "+l];\n";
+        } else
+          code << "      for (int i = 0; i < " << s << "; ++i) t[i] " << op
+               << " a*c[i];\n";
+        code << "    }\n";
+        first = false;
+      }
+      code << "  }\n";
+      return true;
+    }
+
+    template <int N, int Q> bool contraction_opt0_2_dunrolled
+    (ga_instruction *p) {
+      auto q = dynamic_cast<ga_instruction_contraction_opt0_2_dunrolled<N,Q> *>
+        (p);
+      if (!q) return false;
+      size_type s1 = q->tc1.size()/(N*Q), s2 = q->tc2.size()/(N*Q);
+      if (s1*N*Q != q->tc1.size() || s2*N*Q != q->tc2.size()
+          || s2 % Q != 0 || q->t.size() != s1*s2) return false;
+      code << "  { scalar_type *t = " << T(q->t) << ";\n"
+           << "    const scalar_type *c1 = " << T(q->tc1) << ", *c2 = "
+           << T(q->tc2) << ";\n"
+           << "    for (int i = 0; i < " << s1 << "; ++i)\n"
+           << "      for (int j = 0; j < " << s2/Q << "; ++j)\n"
+           << "        for (int l = 0; l < " << Q << "; ++l) {\n"
+           << "          scalar_type a = 0;\n"
+           << "          for (int m = 0; m < " << N << "; ++m)\n"
+           << "            a += c1[i+l*" << s1 << "+m*" << s1*Q << "]*c2[j*"
+           << Q << "+m*" << s2*Q << "];\n"
+           << "          t[i*" << s2 << "+j*" << Q << "+l] = a;\n"
+           << "        }\n  }\n";
+      return true;
+    }
+
+    // Native code for the instruction if it is supported.
+    bool instruction(ga_instruction *p) {
+      if (contraction_opt0_2_dunrolled<1,2>(p)
+          || contraction_opt0_2_dunrolled<1,3>(p)
+          || contraction_opt0_2_dunrolled<1,4>(p)
+          || contraction_opt0_2_dunrolled<2,2>(p)
+          || contraction_opt0_2_dunrolled<2,3>(p)
+          || contraction_opt0_2_dunrolled<2,4>(p)
+          || contraction_opt0_2_dunrolled<3,2>(p)
+          || contraction_opt0_2_dunrolled<3,3>(p)
+          || contraction_opt0_2_dunrolled<3,4>(p))
+        return true;
+      if (auto q = dynamic_cast<ga_instruction_linear_combination *>(p))
+        return linear_combination(*q);
+      if (auto lc = ga_linear_combination_of(p))
+        return linear_combination(*lc);
+      if (auto q = dynamic_cast<ga_instruction_scalar_add *>(p)) {
+        code << "  " << S(q->t) << " = " << S(q->c) << " + " << S(q->d)
+             << ";\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_scalar_sub *>(p)) {
+        code << "  " << S(q->t) << " = " << S(q->c) << " - " << S(q->d)
+             << ";\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_scalar_scalar_mult *>(p)) {
+        code << "  " << S(q->t) << " = " << S(q->c) << " * " << S(q->d)
+             << ";\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_scalar_scalar_div *>(p)) {
+        code << "  " << S(q->t) << " = " << S(q->c) << " / " << S(q->d)
+             << ";\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_copy_scalar *>(p)) {
+        code << "  " << S(q->t) << " = " << S(q->t1) << ";\n";
+        return true;
+      }
+      auto qm = dynamic_cast<ga_instruction_dotmult *>(p);
+      auto qd = dynamic_cast<ga_instruction_dotdiv *>(p);
+      if (qm || qd) {
+        base_tensor &t = qm ? qm->t : qd->t;
+        base_tensor &tc1 = qm ? qm->tc1 : qd->tc1;
+        base_tensor &tc2 = qm ? qm->tc2 : qd->tc2;
+        size_type s2 = tc2.size();
+        if (s2 == 0 || tc1.size() % s2 != 0 || t.size() != tc1.size())
+          return false;
+        size_type s1_1 = tc1.size() / s2;
+        code << "  { scalar_type *t = " << T(t) << ";\n"
+             << "    const scalar_type *c1 = " << T(tc1) << ", *c2 = "
+             << T(tc2) << ";\n"
+             << "    for (int i = 0; i < " << s2 << "; ++i)\n"
+             << "      for (int m = 0; m < " << s1_1 << "; ++m)\n"
+             << "        *t++ = c1[m+" << s1_1 << "*i] " << (qm ? "*" : "/")
+             << " c2[i];\n  }\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_contraction *>(p)) {
+        size_type nn = q->nn;
+        if (nn == 0 || q->tc1.size() % nn != 0 || q->tc2.size() % nn != 0)
+          return false;
+        size_type s1 = q->tc1.size()/nn, s2 = q->tc2.size()/nn;
+        if (q->t.size() != s1*s2) return false;
+        code << "  { scalar_type *t = " << T(q->t) << ";\n"
+             << "    const scalar_type *c1 = " << T(q->tc1) << ", *c2 = "
+             << T(q->tc2) << ";\n"
+             << "    for (int i = 0; i < " << s1 << "; ++i, t += " << s2
+             << ") {\n"
+             << "      for (int j = 0; j < " << s2 << "; ++j) t[j] = 0;\n"
+             << "      for (int k = 0; k < " << nn << "; ++k) {\n"
+             << "        scalar_type a = c1[i+k*" << s1 << "];\n"
+             << "        for (int j = 0; j < " << s2 << "; ++j)\n"
+             << "          t[j] += a*c2[j+k*" << s2 << "];\n"
+             << "      }\n    }\n  }\n";
+        return true;
+      }
+      if (auto q = dynamic_cast<ga_instruction_matrix_mult *>(p)) {
+        size_type n = q->n;
+        if (n == 0 || q->tc1.size() % n != 0 || q->tc2.size() % n != 0)
+          return false;
+        size_type s1 = q->tc1.size() / n, s2 = q->tc2.size() / n;
+        if (q->t.size() != s1*s2) return false;
+        code << "  { scalar_type *t = " << T(q->t) << ";\n"
+             << "    const scalar_type *c1 = " << T(q->tc1) << ", *c2 = "
+             << T(q->tc2) << ";\n"
+             << "    for (int k = 0; k < " << s2 << "; ++k, t += " << s1
+             << ", c2 += " << n << ") {\n"
+             << "      for (int i = 0; i < " << s1 << "; ++i) t[i] = 0;\n"
+             << "      for (int j = 0; j < " << n << "; ++j)\n"
+             << "        for (int i = 0; i < " << s1 << "; ++i)\n"
+             << "          t[i] += c1[i+j*" << s1 << "]*c2[j];\n"
+             << "    }\n  }\n";
+        return true;
+      }
+      return false;
+    }
+
+    std::string source(const std::vector<pga_instruction> &gil) {
+      size_type nb = gil.size();
+      std::vector<std::string> blocks(nb);
+      std::vector<std::set<size_type>> used_tensors(nb);
+      std::vector<bool> native(nb);
+      code.precision(17);
+      for (size_type k = 0; k < nb; ++k) {
+        code.str(""); used.clear();
+        native[k] = instruction(gil[k].get());
+        blocks[k] = code.str(); used_tensors[k] = used;
+      }
+
+      nb_native = 0;
+      first_run = (nb && native[0]) ? 0 : -1;
+      std::stringstream body;
+      for (size_type k = 0; k < nb; ++k) {
+        if (native[k]) {
+          if (k == 0 || !native[k-1]) runs.push_back(std::vector<size_type>());
+          for (size_type i : used_tensors[k])
+            if (std::find(runs.back().begin(), runs.back().end(), i)
+                == runs.back().end())
+              runs.back().push_back(i);
+          body << blocks[k];
+          ++nb_native;
+        } else {
+          int r = (k+1 < nb && native[k+1]) ? int(runs.size()) : -1;
+          body << "  if (call(data, " << k << ", " << r << ")) return "
+               << k+1 << ";\n";
+        }
+      }
+
+      std::stringstream src;
+      src << "// Generated by GetFEM++ from compiled assembly instructions\n"
+          << "typedef double scalar_type;\n"
+          << "typedef int (*ga_native_callback)(void *, int, int);\n"
+          << "extern \"C\" int ga_native_function\n"
+          << "(scalar_type *const *T, scalar_type *const *S, void *data,\n"
+          << " ga_native_callback call) {\n"
+          << body.str() << "  return " << nb << ";\n}\n";
+      return src.str();
+    }
+
+    ga_native_code_generator() : first_run(-1), nb_native(0) {}
+  };
+
+#ifdef GETFEM_HAVE_DLOPEN
+  static std::string ga_native_env(const char *name, const char *def) {
+    const char *value = getenv(name);
+    return (value && *value) ? std::string(value) : std::string(def);
+  }
+
+  // Cache directory of the shared objects: GETFEM_NATIVE_DIR, or a
+  // directory getfem_native_<uid> of TMPDIR (or /tmp). It is created with
+  // mode 0700 and only used if it belongs to the user and is not accessible
+  // to the others, since the shared objects found in it are loaded.
+  static bool ga_native_dir(std::string &dir) {
+    const char *d = getenv("GETFEM_NATIVE_DIR");
+    if (d && *d) dir = d;
+    else dir = ga_native_env("TMPDIR", "/tmp") + "/getfem_native_"
+           + std::to_string(getuid());
+    if (mkdir(dir.c_str(), S_IRWXU) != 0 && errno != EEXIST) return false;
+    struct stat st;
+    return lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode)
+      && st.st_uid == getuid() && (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+  }
+
+  // Runs the compiler on cc_file without shell: the compiler and each word
+  // of the flags are given as separate arguments to execvp.
+  static bool ga_native_compile(const std::string &cxx,
+                                const std::string &cxxflags,
+                                const std::string &cc_file,
+                                const std::string &so_file) {
+    std::vector<std::string> args;
+    args.push_back(cxx);
+    std::stringstream flags(cxxflags);
+    for (std::string w; flags >> w; ) args.push_back(w);
+    for (const char *w : {"-shared", "-fPIC", "-x", "c++", "-o"})
+      args.push_back(w);
+    args.push_back(so_file); args.push_back(cc_file);
+    std::vector<char *> argv;
+    for (std::string &w : args) argv.push_back(&w[0]);
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) { // Only async-signal-safe calls in the child
+      int fd = open("/dev/null", O_WRONLY);
+      if (fd >= 0) { dup2(fd, 1); dup2(fd, 2); }
+      execvp(argv[0], argv.data());
+      _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+      if (errno != EINTR) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  // Writes str in a new file dir/prefixXXXXXX created by mkstemp.
+  static bool ga_native_temp_file(const std::string &dir, const char *prefix,
+                                  const std::string &str, std::string &file) {
+    file = dir + "/" + prefix + "XXXXXX";
+    int fd = mkstemp(&file[0]);
+    if (fd < 0) return false;
+    const char *p = str.data();
+    for (size_type n = str.size(); n > 0; ) {
+      ssize_t r = write(fd, p, n);
+      if (r < 0 && errno == EINTR) continue;
+      if (r <= 0) { close(fd); remove(file.c_str()); return false; }
+      p += r; n -= size_type(r);
+    }
+    close(fd);
+    return true;
+  }
+
+  // Tells if file exists and contains exactly str.
+  static bool ga_native_file_is(const std::string &file,
+                                const std::string &str) {
+    std::ifstream f(file, std::ios::binary);
+    if (!f) return false;
+    std::string content((std::istreambuf_iterator<char>(f)),
+                        std::istreambuf_iterator<char>());
+    return content == str;
+  }
+
+  // Compiles (or finds in the cache directory) and loads the shared object
+  // corresponding to a generated source. Returns 0 if it fails.
+  static ga_native_function ga_load_native_function(const std::string &src) {
+    GLOBAL_OMP_GUARD;
+    static std::map<std::string, ga_native_function> loaded;
+    auto it = loaded.find(src);
+    if (it != loaded.end()) return it->second;
+    ga_native_function &f = loaded[src];
+    f = 0;
+
+    std::string dir;
+    if (!ga_native_dir(dir)) {
+      GMM_WARNING2("Unusable directory " << dir << " for the native code "
+                   "of assembly instructions, the interpreter is used");
+      return f;
+    }
+    // The source kept next to each shared object starts with the compiler
+    // command. A shared object is only loaded if its source is the
+    // expected one, so that a collision of the names or a change of the
+    // compiler or of the flags never loads a wrong function.
+    std::string cxx = ga_native_env("GETFEM_NATIVE_CXX", "c++");
+    std::string cxxflags = ga_native_env("GETFEM_NATIVE_CXXFLAGS", "-O3");
+    std::string command = "// " + cxx + " " + cxxflags;
+    std::replace(command.begin(), command.end(), '\n', ' ');
+    std::string full_src = command + "\n" + src;
+    std::stringstream name;
+    name << dir << "/getfem_native_" << std::hex
+         << std::hash<std::string>()(full_src) << "_" << full_src.size();
+    std::string so_file = name.str() + ".so", cc_file = name.str() + ".cc";
+    void *handle = 0;
+    if (ga_native_file_is(cc_file, full_src))
+      handle = dlopen(so_file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+      // The files are built under unique names and renamed into place, the
+      // source after the shared object, so that concurrent processes never
+      // see a partially written file. The new shared object is loaded under
+      // its unique name, never confused with a previously loaded one.
+      std::string cc_tmp, so_tmp;
+      bool ok = ga_native_temp_file(dir, "src_", full_src, cc_tmp);
+      if (ok && !ga_native_temp_file(dir, "obj_", "", so_tmp))
+        { remove(cc_tmp.c_str()); ok = false; }
+      if (ok) {
+        ok = ga_native_compile(cxx, cxxflags, cc_tmp, so_tmp)
+          && (handle = dlopen(so_tmp.c_str(), RTLD_NOW | RTLD_LOCAL)) != 0;
+        bool kept = ok && rename(so_tmp.c_str(), so_file.c_str()) == 0;
+        if (!kept) remove(so_tmp.c_str());
+        if (!kept || rename(cc_tmp.c_str(), cc_file.c_str()) != 0)
+          remove(cc_tmp.c_str());
+      }
+      if (!ok) {
+        GMM_WARNING2("Native compilation of assembly instructions failed, "
+                     "the interpreter is used");
+        return f;
+      }
+    }
+    f = reinterpret_cast<ga_native_function>
+      (dlsym(handle, "ga_native_function"));
+    return f;
+  }
+#else
+  static ga_native_function ga_load_native_function(const std::string &)
+  { return 0; }
+#endif
+
+  // Replaces the integration point instructions of each region and
+  // integration method by a native function. Returns the number of native
+  // functions.
+  size_type ga_native_code(ga_instruction_set &gis) {
+    size_type nb_kernels = 0;
+    for (auto &&instr : gis.all_instructions) {
+      std::vector<pga_instruction> &gil = instr.second.instructions;
+      bool filter = false;
+      for (const pga_instruction &pgai : gil)
+        if (dynamic_cast<ga_instruction_interpolate_filter *>(pgai.get()))
+          filter = true;
+      if (filter || gil.size() == 0) continue;
+
+      ga_native_code_generator gen;
+      std::string src = gen.source(gil);
+      if (gen.nb_native == 0) continue;
+      ga_native_function f = ga_load_native_function(src);
+      if (!f) continue;
+
+      auto pgai = std::make_shared<ga_instruction_native_code>();
+      pgai->f = f;
+      pgai->gil = gil;
+      pgai->tensors = gen.tensors;
+      for (const base_tensor *t : gen.tensors)
+        pgai->sizes.push_back(t->size());
+      pgai->runs = gen.runs;
+      pgai->first_run = gen.first_run;
+      pgai->T.resize(gen.tensors.size(), 0);
+      pgai->S = gen.scalars;
+      if (pgai->T.empty()) pgai->T.push_back(0);
+      if (pgai->S.empty()) pgai->S.push_back(0);
+      gil.assign(1, pgai);
+      ++nb_kernels;
+    }
+    return nb_kernels;
+  }
+
   void ga_compile(ga_workspace &workspace,
                   ga_instruction_set &gis, size_type order) {
     gis.transformations.clear();
@@ -6778,6 +8355,12 @@ namespace getfem {
           ga_semantic_analysis(trees.back(), workspace, td.mim->linked_mesh(),
                                ref_elt_dim_of_mesh(td.mim->linked_mesh()),
                                true, false);
+          // Order 2 terms of a matrix-free product are compiled in their
+          // action form when possible
+          bool action_form = (phase == ga_workspace::ASSEMBLY &&
+                              order == 2 && workspace.is_matrix_free() &&
+                              ga_matrix_free_action_form
+                              (trees.back(), workspace, td.mim->linked_mesh()));
           pga_tree_node root = trees.back().root;
           if (root) {
             // Compile tree
@@ -6790,10 +8373,37 @@ namespace getfem {
             auto &rmi = gis.all_instructions[rm];
             rmi.m = td.m;
             rmi.im = td.mim;
+            rmi.sum_factorization = workspace.sum_factorization() && !psd;
             // rmi.interpolate_infos.clear();
             ga_compile_interpolate_trans(root, workspace, gis, rmi, *(td.m));
-            ga_compile_node(root, workspace, gis, rmi, *(td.m), false,
-                            rmi.current_hierarchy);
+
+            // For the assembly by sum factorization of an order 1 term, only
+            // the fluxes and the scalar factors are compiled.
+            std::vector<ga_sum_factorization_term> sf_terms;
+            if (phase == ga_workspace::ASSEMBLY &&
+                (order == 1 || action_form) &&
+                ga_sum_factorization_terms(root, workspace, rmi, sf_terms)) {
+              const mesh_fem *mf = workspace.associated_mf(root->name_test1);
+              if (rmi.pfps.count(mf) == 0) {
+                rmi.pfps[mf] = 0;
+                pga_instruction pgai = std::make_shared<ga_instruction_update_pfp>
+                  (*mf, rmi.pfps[mf], gis.ctx, gis.fp_pool);
+                rmi.begin_instructions.push_back(std::move(pgai));
+              }
+              for (const ga_sum_factorization_term &term : sf_terms) {
+                if (term.F)
+                  ga_compile_node(term.F, workspace, gis, rmi, *(td.m), false,
+                                  rmi.current_hierarchy);
+                for (pga_tree_node f : term.factors)
+                  ga_compile_node(f, workspace, gis, rmi, *(td.m), false,
+                                  rmi.current_hierarchy);
+                for (pga_tree_node d : term.divisors)
+                  ga_compile_node(d, workspace, gis, rmi, *(td.m), false,
+                                  rmi.current_hierarchy);
+              }
+            } else
+              ga_compile_node(root, workspace, gis, rmi, *(td.m), false,
+                              rmi.current_hierarchy);
             // cout << "compilation finished "; ga_print_node(root, cout);
             // cout << endl;
 
@@ -6828,8 +8438,8 @@ namespace getfem {
                   workspace.add_temporary_interval_for_unreduced_variable
                     (root->name_test1);
 
-                  base_vector &Vu = workspace.unreduced_vector(),
-                              &Vr = workspace.assembled_vector();
+                  base_vector &Vu = workspace.unreduced_vector();
+                  base_vector *const &Vr = workspace.exec_vector();
                   if (mf) {
                     const mesh_fem **mfg = 0;
                     const gmm::sub_interval *Iu = 0, *Ir = 0;
@@ -6856,9 +8466,16 @@ namespace getfem {
                                         : rmi.interpolate_infos[intn1].ctx);
                     bool interpolate =
                       !(intn1.empty() || intn1 == "neighbour_elt" || secondary);
-                    pgai = std::make_shared<ga_instruction_fem_vector_assembly>
-                      (root->tensor(), Vu, Vr, ctx, *Iu, *Ir, mf, mfg,
-                       gis.coeff, gis.nbpt, gis.ipt, interpolate);
+                    if (sf_terms.size())
+                      pgai = ga_sum_factorization_vector_assembly
+                        (sf_terms, workspace, gis, rmi, root->name_test1, Vu,
+                         Vr, *Iu, *Ir);
+                    else
+                      pgai = std::make_shared
+                        <ga_instruction_fem_vector_assembly>
+                        (root->tensor(), Vu, Vr, ctx, *Iu, *Ir, mf, mfg,
+                         gis.coeff, gis.nbpt, gis.ipt, gis.nb_exec,
+                         interpolate, workspace.is_atomic_vector_assembly());
                   } else if (imd) {
                     GMM_ASSERT1(root->interpolate_name_test1.size() == 0,
                                 "Interpolate transformation on integration "
@@ -6871,12 +8488,33 @@ namespace getfem {
                     pgai = std::make_shared<ga_instruction_vector_assembly>
                       (root->tensor(), Vr,
                        workspace.interval_of_variable(root->name_test1),
-                       gis.coeff);
+                       gis.coeff, workspace.is_atomic_vector_assembly());
                   }
                 }
                 break;
               case 2:
-                {
+                if (action_form) { // Order 1 term added to the product
+                  GMM_ASSERT1(root->tensor_proper_size() == 1,
+                              "Invalid vector or tensor quantity. An order 2 "
+                              "weak form has to be a scalar quantity");
+                  const mesh_fem *mf
+                    = workspace.associated_mf(root->name_test1);
+                  const gmm::sub_interval &I
+                    = workspace.interval_of_variable(root->name_test1);
+                  // exec_vector() is the matrix-free output (see
+                  // ga_workspace::assembly)
+                  base_vector &V = workspace.matrix_free_output();
+                  base_vector *const &pV = workspace.exec_vector();
+                  if (sf_terms.size())
+                    pgai = ga_sum_factorization_vector_assembly
+                      (sf_terms, workspace, gis, rmi, root->name_test1, V, pV,
+                       I, I);
+                  else
+                    pgai = std::make_shared<ga_instruction_fem_vector_assembly>
+                      (root->tensor(), V, pV, gis.ctx, I, I, mf, nullptr,
+                       gis.coeff, gis.nbpt, gis.ipt, gis.nb_exec, false,
+                       workspace.is_atomic_vector_assembly());
+                } else {
                   GMM_ASSERT1(root->tensor_proper_size() == 1,
                               "Invalid vector or tensor quantity. An order 2 "
                               "weak form has to be a scalar quantity");
@@ -6917,7 +8555,8 @@ namespace getfem {
                                                    (root->name_test2));
 
                   // ga instructions write into one of the following matrices
-                  auto &Krr = workspace.assembled_matrix();
+                  model_real_sparse_matrix *const &Krr
+                    = workspace.exec_matrix();
                   auto &Kru = workspace.col_unreduced_matrix();
                   auto &Kur = workspace.row_unreduced_matrix();
                   auto &Kuu = workspace.row_col_unreduced_matrix();
@@ -6960,7 +8599,20 @@ namespace getfem {
                   bool simple = !interpolate &&
                                 mfg1 == 0 && mfg2 == 0 && mf1 && mf2 &&
                                 !(mf1->is_reduced()) && !(mf2->is_reduced());
-                  if (simple && mf1->get_qdim() == 1 && mf2->get_qdim() == 1) {
+                  if (workspace.is_matrix_free()) {
+                    GMM_ASSERT1(!(mf1 && mf1->is_reduced()) &&
+                                !(mf2 && mf2->is_reduced()) &&
+                                mfg1 == 0 && mfg2 == 0, "Matrix-free product "
+                                "not available for reduced fems and groups "
+                                "of variables");
+                    pgai = std::make_shared<ga_instruction_matrix_free_product>
+                      (root->tensor(), Krr, Kuu, ctx1, ctx2, *Ir1, *Ir2,
+                       mf1, mfg1, imd1, mf2, mfg2, imd2,
+                       gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt,
+                       interpolate, workspace.matrix_free_input(),
+                       workspace.matrix_free_output());
+                  } else if (simple && mf1->get_qdim() == 1
+                             && mf2->get_qdim() == 1) {
                     pgai = std::make_shared
                       <ga_instruction_matrix_assembly_standard_scalar>
                       (root->tensor(), Krr, ctx1, ctx2, *Ir1, *Ir2, mf1, mf2,
@@ -7000,6 +8652,23 @@ namespace getfem {
         }
       }
     }
+    if (workspace.instruction_optimization()) {
+      if (workspace.instruction_dump()) {
+        cout << "Compiled instructions of order " << order << ":" << endl;
+        ga_print_instructions(gis, cout);
+      }
+      gis.nb_optimized_instructions = ga_optimize_instructions(gis);
+      if (workspace.instruction_dump()) {
+        cout << "Optimized instructions of order " << order << " ("
+             << gis.nb_optimized_instructions << " removed):" << endl;
+        ga_print_instructions(gis, cout);
+      }
+    } else if (workspace.instruction_dump()) {
+      cout << "Compiled instructions of order " << order << ":" << endl;
+      ga_print_instructions(gis, cout);
+    }
+    if (workspace.native_code())
+      gis.nb_native_kernels = ga_native_code(gis);
   } // ga_compile(...)
 
 
@@ -7107,10 +8776,495 @@ namespace getfem {
     gic.finalize();
   }
 
+  // Plan and buffers of the element-batched execution of the instructions
+  // of a region (see ga_workspace::set_element_batching). The instruction
+  // list is split into a prefix, executed at each integration point as in
+  // ga_exec, a run of instructions having a batch operation, executed on
+  // the values captured at all the integration points of a chunk of
+  // elements, and the trailing assembly instructions, executed once per
+  // element on the sum of the weighted assembled tensors over its points.
+  // The tensors of the run (the slots) are stored in buf with the
+  // integration point as innermost index.
+  struct ga_element_batch {
+    struct operand { // Scalar operand: row of buf or of sbuf
+      bool in_buf;
+      size_type row;
+    };
+    struct step_term {
+      size_type tc;
+      std::vector<operand> factors, divisors;
+      std::vector<size_type> ind; // Index permutation of a permuted term
+    };
+    struct step {
+      const ga_instruction *pgi;
+      ga_batch_op op;
+      size_type t, tc1, tc2;
+      bool reduced; // t is only assembled: summed over the points at once
+      std::vector<step_term> terms;
+      std::vector<size_type> ind; // Index permutation of a permuted tc1
+    };
+    struct element {
+      size_type cv, first;
+      short_type f;
+      base_matrix G;
+      bgeot::pgeotrans_precomp pgp;
+      bgeot::pgeometric_trans pgt;
+      base_node xref;
+    };
+
+    bool valid;
+    size_type nb_prefix;
+    std::vector<step> steps;
+    std::vector<pga_instruction> assembly;
+    std::vector<const base_tensor *> slots;
+    std::vector<size_type> first_write; // First step writing each slot
+    std::vector<size_type> captured;    // Slots read before being written
+    std::vector<size_type> assembled;   // Slots read by the assembly
+    std::vector<const scalar_type *> scalars; // Captured scalar operands
+
+    size_type Kc, K; // Capacity and number of stored points
+    size_type ld;    // Length of the rows of buf and sbuf
+    std::vector<bgeot::multi_index> shapes;
+    std::vector<size_type> sizes, offsets;
+    base_vector buf, sbuf, cbuf, coeffs, saved, tmp;
+    std::vector<bool> reduced; // Slots only summed over the points
+    std::vector<size_type> eoffsets;
+    size_type esize;
+    base_vector ebuf; // Sums of the reduced slots on each element
+    std::vector<bool> zrow; // Rows of buf vanishing at all the points
+    std::vector<element> elements;
+    size_type nb_elements;
+
+    size_type slot(const base_tensor *t, size_type i, bool write) {
+      size_type s = 0;
+      while (s < slots.size() && slots[s] != t) ++s;
+      if (s == slots.size()) {
+        slots.push_back(t);
+        first_write.push_back(size_type(-1));
+        if (!write) captured.push_back(s);
+      }
+      if (write && first_write[s] == size_type(-1)) first_write[s] = i;
+      return s;
+    }
+
+    const scalar_type *row(size_type s, size_type i) const
+    { return &buf[(offsets[s]+i)*ld]; }
+    scalar_type *row(size_type s, size_type i)
+    { return &buf[(offsets[s]+i)*ld]; }
+
+    // Scalar operand c of step i: a component of a slot written by a
+    // previous step or a value captured at each point.
+    operand scalar_operand(const scalar_type *c, size_type i) {
+      operand o;
+      for (size_type j = 0; j < slots.size(); ++j) {
+        const base_tensor &t = *(slots[j]);
+        if (first_write[j] < i && t.size() && c >= &(t[0])
+            && c < &(t[0]) + t.size()) {
+          o.in_buf = true; o.row = offsets[j] + size_type(c - &(t[0]));
+          return o;
+        }
+      }
+      o.in_buf = false; o.row = 0;
+      while (o.row < scalars.size() && scalars[o.row] != c) ++(o.row);
+      if (o.row == scalars.size()) scalars.push_back(c);
+      return o;
+    }
+
+    const scalar_type *operand_row(const operand &o) const
+    { return o.in_buf ? &buf[o.row*ld] : &sbuf[o.row*ld]; }
+
+    // The vanishing rows, mainly those of the vectorized base functions,
+    // are skipped by the kernels.
+    bool zero(size_type s, size_type i) const { return zrow[offsets[s]+i]; }
+
+    // Row i of the result of a step. The rows of a reduced slot are
+    // computed in tmp and summed over the points of each element by done.
+    scalar_type *out(const step &st, size_type i)
+    { return st.reduced ? &tmp[0] : row(st.t, i); }
+
+    void done(const step &st, size_type i, bool z) {
+      if (!st.reduced) {
+        if (z) std::fill(row(st.t, i), row(st.t, i)+K, scalar_type(0));
+        zrow[offsets[st.t]+i] = z;
+        return;
+      }
+      scalar_type *it = &ebuf[eoffsets[st.t] + i];
+      for (size_type e = 0; e < nb_elements; ++e, it += esize) {
+        scalar_type a(0);
+        if (!z) {
+          size_type ke = (e+1 < nb_elements) ? elements[e+1].first : K;
+          for (size_type k = elements[e].first; k < ke; ++k)
+            a += coeffs[k] * tmp[k];
+        }
+        *it = a;
+      }
+    }
+
+    // Layout of the buffers for the current shapes of the slots and a
+    // capacity of nb elements of nbpt points
+    void layout(size_type nb, size_type nbpt) {
+      Kc = nb * std::max(nbpt, size_type(1));
+      // Rows of an odd number of cache lines, to avoid the aliasing of the
+      // rows accessed together in the cache
+      ld = ((Kc + 7) / 8) | 1; ld *= 8;
+      shapes.resize(slots.size());
+      sizes.resize(slots.size()); offsets.resize(slots.size());
+      size_type s = 0;
+      eoffsets.resize(slots.size()); esize = 0;
+      for (size_type i = 0; i < slots.size(); ++i) {
+        shapes[i] = slots[i]->sizes();
+        sizes[i] = slots[i]->size();
+        offsets[i] = s; eoffsets[i] = esize;
+        if (reduced[i]) esize += sizes[i]; else s += sizes[i];
+      }
+      buf.resize(s*ld); zrow.assign(s, true);
+      tmp.resize(Kc);
+      coeffs.resize(Kc);
+      scalars.resize(0);
+      size_type nbt = 0;
+      for (size_type i = 0; i < steps.size(); ++i) {
+        step &st = steps[i];
+        st.pgi->batch_op(st.op); // The permutations may depend on shapes
+        for (size_type j = 0; j < st.terms.size(); ++j) {
+          const ga_batch_op::term &tm = st.op.terms[j];
+          step_term &stm = st.terms[j];
+          stm.factors.resize(0); stm.divisors.resize(0);
+          for (const scalar_type *c : tm.factors)
+            stm.factors.push_back(scalar_operand(c, i));
+          for (const scalar_type *c : tm.divisors)
+            stm.divisors.push_back(scalar_operand(c, i));
+          if (tm.permuted) tm.perm.build(sizes[st.t], stm.ind);
+        }
+        if (st.op.permuted) st.op.perm.build(sizes[st.tc1], st.ind);
+        nbt = std::max(nbt, st.terms.size());
+      }
+      sbuf.resize(scalars.size()*ld);
+      cbuf.resize(nbt*Kc);
+    }
+
+    bool same_shapes() const {
+      if (shapes.size() != slots.size()) return false;
+      for (size_type i = 0; i < slots.size(); ++i)
+        if (slots[i]->sizes() != shapes[i]) return false;
+      return true;
+    }
+
+    void exec_linear_combination(const step &st) {
+      const ga_batch_op &op = st.op;
+      std::vector<bool> constant(st.terms.size());
+      for (size_type j = 0; j < st.terms.size(); ++j) {
+        const step_term &stm = st.terms[j];
+        constant[j] = stm.factors.empty() && stm.divisors.empty();
+        if (constant[j]) continue;
+        scalar_type *c = &cbuf[j*Kc];
+        std::fill(c, c+K, op.terms[j].alpha);
+        for (const operand &o : stm.factors) {
+          const scalar_type *f = operand_row(o);
+          for (size_type k = 0; k < K; ++k) c[k] *= f[k];
+        }
+        for (const operand &o : stm.divisors) {
+          const scalar_type *d = operand_row(o);
+          for (size_type k = 0; k < K; ++k) c[k] /= d[k];
+        }
+      }
+      for (size_type i = 0; i < sizes[st.t]; ++i) {
+        scalar_type *it = out(st, i);
+        bool first = !op.accumulate, z = first || zero(st.t, i);
+        for (size_type j = 0; j < st.terms.size(); ++j) {
+          const step_term &stm = st.terms[j];
+          size_type ii = stm.ind.size() ? stm.ind[i] : i;
+          if (zero(stm.tc, ii)) continue;
+          const scalar_type *x = row(stm.tc, ii);
+          if (constant[j]) {
+            scalar_type a = op.terms[j].alpha;
+            if (first) for (size_type k = 0; k < K; ++k) it[k] = a * x[k];
+            else for (size_type k = 0; k < K; ++k) it[k] += a * x[k];
+          } else {
+            const scalar_type *c = &cbuf[j*Kc];
+            if (first) for (size_type k = 0; k < K; ++k) it[k] = c[k] * x[k];
+            else for (size_type k = 0; k < K; ++k) it[k] += c[k] * x[k];
+          }
+          first = z = false;
+        }
+        done(st, i, z);
+      }
+    }
+
+    void exec_step(const step &st) {
+      const ga_batch_op &op = st.op;
+      size_type n = op.n;
+      switch (op.kind) {
+      case ga_batch_op::LINEAR_COMBINATION:
+        exec_linear_combination(st);
+        break;
+      case ga_batch_op::CONTRACTION: // Ani Bmi -> Cmn
+        {
+          size_type s1 = sizes[st.tc1]/n, s2 = sizes[st.tc2]/n;
+          GA_DEBUG_ASSERT(sizes[st.t] == s1*s2, "Internal error");
+          for (size_type i = 0; i < s1; ++i)
+            for (size_type j = 0; j < s2; ++j) {
+              scalar_type *it = out(st, i*s2+j);
+              bool z = true;
+              for (size_type l = 0; l < n; ++l) {
+                size_type i1 = i+l*s1, i2 = j+l*s2;
+                if (op.permuted) i1 = st.ind[i1];
+                if (zero(st.tc1, i1) || zero(st.tc2, i2)) continue;
+                const scalar_type *it1 = row(st.tc1, i1);
+                const scalar_type *it2 = row(st.tc2, i2);
+                if (z)
+                  for (size_type k = 0; k < K; ++k) it[k] = it1[k] * it2[k];
+                else
+                  for (size_type k = 0; k < K; ++k) it[k] += it1[k] * it2[k];
+                z = false;
+              }
+              done(st, i*s2+j, z);
+            }
+        }
+        break;
+      case ga_batch_op::MATRIX_MULT: // Amj Bjk -> Cmk
+        {
+          size_type s1 = sizes[st.tc1]/n, s2 = sizes[st.tc2]/n;
+          GA_DEBUG_ASSERT(sizes[st.t] == s1*s2, "Internal error");
+          for (size_type l = 0; l < s2; ++l)
+            for (size_type i = 0; i < s1; ++i) {
+              scalar_type *it = out(st, i+l*s1);
+              bool z = true;
+              for (size_type j = 0; j < n; ++j) {
+                if (zero(st.tc1, i+j*s1) || zero(st.tc2, j+l*n)) continue;
+                const scalar_type *it1 = row(st.tc1, i+j*s1);
+                const scalar_type *it2 = row(st.tc2, j+l*n);
+                if (z)
+                  for (size_type k = 0; k < K; ++k) it[k] = it1[k] * it2[k];
+                else
+                  for (size_type k = 0; k < K; ++k) it[k] += it1[k] * it2[k];
+                z = false;
+              }
+              done(st, i+l*s1, z);
+            }
+        }
+        break;
+      case ga_batch_op::MATRIX_MULT_SPEC: // Amij Bnjk -> Cmnik (or Cnmik)
+        {
+          size_type q = sizes[st.tc1]/(op.m*n), l = sizes[st.tc2]/(op.p*n);
+          GA_DEBUG_ASSERT(sizes[st.t] == q*l*op.m*op.p, "Internal error");
+          for (size_type r = 0; r < op.p; ++r)
+            for (size_type k2 = 0; k2 < op.m; ++k2)
+              for (size_type j = 0; j < l; ++j)
+                for (size_type i = 0; i < q; ++i) {
+                  size_type ii = op.spec2 ? j + l*(i + q*(k2 + op.m*r))
+                                          : i + q*(j + l*(k2 + op.m*r));
+                  scalar_type *it = out(st, ii);
+                  bool z = true;
+                  for (size_type s = 0; s < n; ++s) {
+                    size_type i1 = i+k2*q+s*q*op.m, i2 = j+s*l+r*l*n;
+                    if (zero(st.tc1, i1) || zero(st.tc2, i2)) continue;
+                    const scalar_type *it1 = row(st.tc1, i1);
+                    const scalar_type *it2 = row(st.tc2, i2);
+                    if (z)
+                      for (size_type k = 0; k < K; ++k) it[k] = it1[k]*it2[k];
+                    else
+                      for (size_type k = 0; k < K; ++k) it[k] += it1[k]*it2[k];
+                    z = false;
+                  }
+                  done(st, ii, z);
+                }
+        }
+        break;
+      case ga_batch_op::TMULT: // Aij Bkl -> Cijkl
+        {
+          size_type s1 = sizes[st.tc1], s2 = sizes[st.tc2];
+          GA_DEBUG_ASSERT(sizes[st.t] == s1*s2, "Internal error");
+          for (size_type j = 0; j < s2; ++j)
+            for (size_type i = 0; i < s1; ++i) {
+              scalar_type *it = out(st, i+j*s1);
+              bool z = zero(st.tc1, i) || zero(st.tc2, j);
+              if (!z) {
+                const scalar_type *it1 = row(st.tc1, i), *it2 = row(st.tc2, j);
+                for (size_type k = 0; k < K; ++k) it[k] = it1[k] * it2[k];
+              }
+              done(st, i+j*s1, z);
+            }
+        }
+        break;
+      case ga_batch_op::ASSEMBLY:
+        GMM_ASSERT1(false, "Internal error");
+      }
+    }
+
+    // Executes the run on the stored points and the assembly instructions
+    // on each stored element. The context and the point data of gis are
+    // restored afterwards.
+    void flush(ga_instruction_set &gis) {
+      if (!K) return;
+      ebuf.resize(esize*nb_elements);
+      for (size_type s : captured)
+        for (size_type i = 0; i < sizes[s]; ++i)
+          if (!zero(s, i)) {
+            const scalar_type *it = row(s, i);
+            size_type k = 0;
+            while (k < K && it[k] == scalar_type(0)) ++k;
+            zrow[offsets[s]+i] = (k == K);
+          }
+      for (const step &st : steps) exec_step(st);
+
+      fem_interpolation_context &ctx = gis.ctx;
+      bool have_pgp = ctx.have_pgp();
+      bgeot::pgeotrans_precomp pgp = ctx.pgp();
+      bgeot::pgeometric_trans pgt = ctx.pgt();
+      size_type ii = ctx.ii(), cv = ctx.convex_num();
+      short_type f = ctx.is_on_face() ? ctx.face_num() : short_type(-1);
+      base_node xref; if (!have_pgp) xref = ctx.xref();
+      const base_matrix &G = ctx.G();
+      scalar_type coeff = gis.coeff;
+      size_type ipt = gis.ipt, nbpt = gis.nbpt;
+
+      // The captured assembled tensors are restored at the end
+      saved.resize(0);
+      for (size_type s : assembled)
+        if (first_write[s] == size_type(-1))
+          saved.insert(saved.end(), slots[s]->begin(), slots[s]->end());
+
+      gis.coeff = scalar_type(1); gis.ipt = 0; gis.nbpt = 1;
+      for (size_type e = 0; e < nb_elements; ++e) {
+        const element &el = elements[e];
+        size_type kb = el.first;
+        size_type ke = (e+1 < nb_elements) ? elements[e+1].first : K;
+        if (el.pgp) ctx.change(el.pgp, 0, 0, el.G, el.cv, el.f);
+        else ctx.change(el.pgt, 0, el.xref, el.G, el.cv, el.f);
+        for (size_type s : assembled) {
+          base_tensor &t = const_cast<base_tensor &>(*(slots[s]));
+          if (reduced[s]) {
+            const scalar_type *it = &ebuf[e*esize + eoffsets[s]];
+            std::copy(it, it + sizes[s], t.begin());
+            continue;
+          }
+          for (size_type i = 0; i < sizes[s]; ++i) {
+            if (zero(s, i)) { t[i] = scalar_type(0); continue; }
+            const scalar_type *it = row(s, i);
+            scalar_type a(0);
+            for (size_type k = kb; k < ke; ++k) a += coeffs[k] * it[k];
+            t[i] = a;
+          }
+        }
+        for (size_type j = 0; j < assembly.size(); ++j)
+          j += assembly[j]->exec();
+      }
+
+      auto it = saved.begin();
+      for (size_type s : assembled)
+        if (first_write[s] == size_type(-1)) {
+          base_tensor &t = const_cast<base_tensor &>(*(slots[s]));
+          std::copy(it, it + t.size(), t.begin()); it += t.size();
+        }
+      if (have_pgp) ctx.change(pgp, 0, ii, G, cv, f);
+      else ctx.change(pgt, 0, xref, G, cv, f);
+      gis.coeff = coeff; gis.ipt = ipt; gis.nbpt = nbpt;
+      K = 0; nb_elements = 0;
+    }
+
+    // Executes the prefix at the current integration point and stores the
+    // values of the captured slots.
+    void exec_point(ga_instruction_set &gis,
+                    const std::vector<pga_instruction> &gil, size_type nb) {
+      for (size_type j = 0; j < nb_prefix; ++j) j += gil[j]->exec();
+      if (K == Kc || !same_shapes()) {
+        flush(gis);
+        if (!same_shapes() || Kc != nb * std::max(gis.nbpt, size_type(1)))
+          layout(nb, gis.nbpt);
+      }
+      const fem_interpolation_context &ctx = gis.ctx;
+      if (gis.ipt == 0 || nb_elements == 0) {
+        if (elements.size() == nb_elements) elements.emplace_back();
+        element &el = elements[nb_elements++];
+        el.cv = ctx.convex_num(); el.first = K;
+        el.f = ctx.is_on_face() ? ctx.face_num() : short_type(-1);
+        el.G = ctx.G();
+        el.pgp = ctx.pgp();
+        el.pgt = ctx.pgt();
+        if (!el.pgp) el.xref = ctx.xref();
+      }
+      // A captured row vanishing so far in the chunk is not stored
+      for (size_type s : captured) {
+        scalar_type *it = &buf[offsets[s]*ld + K];
+        const base_tensor &t = *(slots[s]);
+        for (size_type i = 0, r = offsets[s]; i < sizes[s]; ++i, ++r, it += ld)
+          if (!zrow[r]) *it = t[i];
+          else if (t[i] != scalar_type(0)) {
+            std::fill(it - K, it, scalar_type(0));
+            *it = t[i]; zrow[r] = false;
+          }
+      }
+      for (size_type i = 0; i < scalars.size(); ++i)
+        sbuf[i*ld + K] = *(scalars[i]);
+      coeffs[K++] = gis.coeff;
+    }
+
+    ga_element_batch(const std::vector<pga_instruction> &gil)
+      : valid(false), nb_prefix(0), Kc(0), K(0), ld(0), esize(0),
+        nb_elements(0) {
+      ga_batch_op op;
+      size_type ns = gil.size();
+      while (ns > 0 && gil[ns-1]->batch_op(op)
+             && op.kind == ga_batch_op::ASSEMBLY) --ns;
+      size_type nr = ns;
+      while (nr > 0 && gil[nr-1]->batch_op(op)
+             && op.kind != ga_batch_op::ASSEMBLY) --nr;
+      if (ns == gil.size() || nr == ns) return;
+      nb_prefix = nr;
+      for (size_type j = nr; j < ns; ++j) {
+        steps.emplace_back();
+        step &st = steps.back();
+        size_type i = steps.size() - 1;
+        st.pgi = gil[j].get();
+        st.pgi->batch_op(st.op);
+        st.tc1 = st.op.tc1 ? slot(st.op.tc1, i, false) : 0;
+        st.tc2 = st.op.tc2 ? slot(st.op.tc2, i, false) : 0;
+        st.terms.resize(st.op.terms.size());
+        for (size_type k = 0; k < st.terms.size(); ++k)
+          st.terms[k].tc = slot(st.op.terms[k].tc, i, false);
+        if (st.op.accumulate) slot(st.op.t, i, false);
+        st.t = slot(st.op.t, i, true);
+      }
+      for (size_type j = ns; j < gil.size(); ++j) {
+        gil[j]->batch_op(op);
+        assembled.push_back(slot(op.tc1, steps.size(), false));
+        assembly.push_back(gil[j]);
+      }
+
+      // An assembled slot written once and read by no step (neither as a
+      // tensor nor as a scalar operand) is summed over the points of each
+      // element as soon as each of its rows is computed.
+      reduced.assign(slots.size(), false);
+      std::vector<size_type> nb_writes(slots.size());
+      for (const step &st : steps) ++(nb_writes[st.t]);
+      for (size_type s : assembled)
+        reduced[s] = (nb_writes[s] == 1);
+      for (step &st : steps) {
+        if (st.op.tc1) reduced[st.tc1] = false;
+        if (st.op.tc2) reduced[st.tc2] = false;
+        for (size_type k = 0; k < st.terms.size(); ++k) {
+          reduced[st.terms[k].tc] = false;
+          const ga_batch_op::term &tm = st.op.terms[k];
+          for (size_type s = 0; s < slots.size(); ++s) {
+            const base_tensor &t = *(slots[s]);
+            for (const auto *pc : {&tm.factors, &tm.divisors})
+              for (const scalar_type *c : *pc)
+                if (t.size() && c >= &(t[0]) && c < &(t[0]) + t.size())
+                  reduced[s] = false;
+          }
+        }
+      }
+      for (size_type s : captured) reduced[s] = false;
+      for (step &st : steps) st.reduced = reduced[st.t];
+      valid = true;
+    }
+  };
+
   void ga_exec(ga_instruction_set &gis, ga_workspace &workspace) {
     base_matrix G1, G2;
     base_small_vector un;
     scalar_type J1(0), J2(0);
+    ++(gis.nb_exec);
 
     for (const std::string &t : gis.transformations)
       workspace.interpolate_transformation(t)->init(workspace);
@@ -7138,6 +9292,16 @@ namespace getfem {
 
         const mesh_region &region = *(instr.first.region());
 
+        ga_element_batch *peb = 0;
+        size_type nb_batch = workspace.element_batching();
+        if (nb_batch && gis.transformations.empty()) {
+          if (!instr.second.element_batch)
+            instr.second.element_batch
+              = std::make_shared<ga_element_batch>(gil);
+          if (instr.second.element_batch->valid)
+            peb = instr.second.element_batch.get();
+        }
+
         // iteration on elements (or faces of elements)
         size_type old_cv = size_type(-1);
         bgeot::pgeometric_trans pgt = 0, pgt_old = 0;
@@ -7220,13 +9384,16 @@ namespace getfem {
                   for (size_type j=0; j < gile.size(); ++j) j+=gile[j]->exec();
                 }
                 if (enable_ipt || gis.ipt == 0 || gis.ipt == gis.nbpt-1) {
-                  for (size_type j=0; j < gil.size(); ++j) j+=gil[j]->exec();
+                  if (peb) peb->exec_point(gis, gil, nb_batch);
+                  else
+                    for (size_type j=0; j < gil.size(); ++j) j+=gil[j]->exec();
                 }
                 GA_DEBUG_INFO("");
               }
             }
           }
         }
+        if (peb) peb->flush(gis);
         GA_DEBUG_INFO("-----------------------------");
 
       } else { // Integration on the product of two domains (secondary domain)
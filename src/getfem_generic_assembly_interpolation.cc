@@ -677,15 +677,15 @@ namespace getfem {
 
       *m_t = &target_mesh;
 
-      bgeot::rtree::pbox_cont boxes;
+      THREAD_SAFE_STATIC bgeot::rtree::pbox_cont boxes;
       {
-        bgeot::rtree::pbox_set bset;
-        element_boxes.find_boxes_at_point(P, bset);
+        element_boxes.find_boxes_at_point(P, boxes);
 
-        // using a std::set as a sorter
-        std::set<std::pair<scalar_type, const bgeot::box_index*>, rated_box_index_compare>
+        THREAD_SAFE_STATIC
+          std::vector<std::pair<scalar_type, const bgeot::box_index*>>
           rated_boxes;
-        for (const auto &box : bset) {
+        rated_boxes.resize(0);
+        for (const auto &box : boxes) {
           scalar_type rating = scalar_type(1);
           for (size_type i = 0; i < m.dim(); ++i) {
             scalar_type h = box->max->at(i) - box->min->at(i);
@@ -695,12 +695,14 @@ namespace getfem {
               rating = std::min(r, rating);
             }
           }
-          rated_boxes.insert(std::make_pair(rating, box));
+          rated_boxes.push_back(std::make_pair(rating, box));
         }
+        std::sort(rated_boxes.begin(), rated_boxes.end(),
+                  rated_box_index_compare());
 
         // boxes should now be ordered in increasing rating order
-        for (const auto &p : rated_boxes)
-          boxes.push_back(p.second);
+        for (size_type i = 0; i < rated_boxes.size(); ++i)
+          boxes[i] = rated_boxes[i].second;
       }
 
 
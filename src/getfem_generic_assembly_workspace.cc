@@ -312,6 +312,7 @@ namespace getfem {
       GMM_ASSERT1(name != "neighbour_elt", "neighbour_elt is a "
                   "reserved interpolate transformation name");
     transformations[name] = ptrans;
+    ++expressions_version;
   }
 
   bool ga_workspace::interpolate_transformation_exists
@@ -360,6 +361,7 @@ namespace getfem {
       GMM_ASSERT1(false, "An interpolate transformation with the same "
                   "name already exists");
     secondary_domains[name] = psecdom;
+    ++expressions_version;
   }
 
   bool ga_workspace::secondary_domain_exists
@@ -402,6 +404,7 @@ namespace getfem {
                               bool function_expr, operation_type op_type,
                               const std::string varname_interpolation) {
     if (tree.root) {
+      ++expressions_version;
       // Eliminate the term if it corresponds to disabled variables
       if ((tree.root->test_function_type >= 1 &&
            is_disabled_variable(tree.root->name_test1)) ||
@@ -745,17 +748,123 @@ namespace getfem {
   }
 
 
+  void ga_workspace::set_compiled_program_caching(bool enable) {
+    compiled_programs.enabled = enable;
+    if (!enable) clear_compiled_programs();
+  }
+
+  // Everything on which a compiled program depends apart from the values
+  // of the fem and im_data variables, which are referenced by the
+  // instructions. The values of the fixed size variables and data are part
+  // of the signature since they are evaluated at compile time (semantic
+  // analysis with eval_fixed_size). The cost is a full recompilation at
+  // each change of such a value: the programs of a model with a fixed size
+  // unknown are not reused along the Newton iterations. Keying the
+  // signature on the sizes only would require these variables to be
+  // copied at each integration point instead of being folded.
+  std::string
+  ga_workspace::compiled_program_signature(size_type order) const {
+    std::stringstream sig;
+    sig << order << ";" << expressions_version << ";" << nb_prim_dof << ";"
+        << atomic_vector_assembly << ";"
+        << matrix_free << ";" << use_sum_factorization << ";"
+        << optimize_instructions << ";" << use_native_code << ";";
+    // The time step is folded in the compiled program: its exact value,
+    // possibly coming from a parent workspace, is part of the signature.
+    const ga_workspace *wdt = this;
+    while (wdt && !wdt->md) wdt = wdt->parent_workspace;
+    if (wdt) {
+      scalar_type dt = get_time_step();
+      sig.write(reinterpret_cast<const char *>(&dt), sizeof(scalar_type));
+      sig << ";";
+    }
+
+    std::set<var_trans_pair> vars;
+    for (const tree_description &td : trees) {
+      sig << td.mim << ":" << (td.mim ? td.mim->version_number() : 0) << ";";
+      if (td.ptree->root)
+        ga_extract_variables(td.ptree->root, *this, *(td.m), vars, false);
+      for (const std::string *name : {&(td.name_test1), &(td.name_test2),
+                                      &(td.varname_interpolation)})
+        if (name->size()) vars.insert(var_trans_pair(*name, ""));
+    }
+
+    std::set<std::string> varnames, transnames;
+    for (const var_trans_pair &var : vars) {
+      if (variable_group_exists(var.varname)) {
+        for (const std::string &vname : variable_group(var.varname))
+          varnames.insert(vname);
+      } else
+        varnames.insert(var.varname);
+      if (var.transname.size()) transnames.insert(var.transname);
+    }
+
+    for (const std::string &trans : transnames)
+      if (interpolate_transformation_exists(trans))
+        sig << trans << ":" << interpolate_transformation(trans).get() << ";";
+
+    for (const std::string &vname : varnames) {
+      const model_real_plain_vector &U = value(vname);
+      const mesh_fem *mf = associated_mf(vname);
+      const im_data *imd = associated_im_data(vname);
+      sig << vname << ":" << &U << ":" << gmm::vect_size(U) << ":";
+      if (!is_constant(vname)) {
+        const gmm::sub_interval &I = interval_of_variable(vname);
+        sig << I.first() << ":" << I.size() << ":";
+      }
+      if (mf)
+        sig << mf << ":" << mf->version_number();
+      else if (imd)
+        sig << imd << ":" << imd->version_number();
+      else if (gmm::vect_size(U))
+        sig.write(reinterpret_cast<const char *>(&(U[0])),
+                  std::streamsize(gmm::vect_size(U)*sizeof(scalar_type)));
+      sig << ";";
+    }
+    return sig.str();
+  }
+
+  // Values of the variables on reduced fems are extended at compile time.
+  static void ga_update_extended_variables(const ga_workspace &workspace,
+                                           ga_instruction_set &gis) {
+    for (auto &&ev : gis.really_extended_vars)
+      workspace.associated_mf(ev.first)->extend_vector
+        (workspace.value(ev.first), ev.second);
+  }
+
   void ga_workspace::assembly(size_type order) {
     const ga_workspace *w = this;
     while (w->parent_workspace) w = w->parent_workspace;
     if (w->md) w->md->nb_dof(); // To eventually call actualize_sizes()
 
     GA_TIC;
-    ga_instruction_set gis;
-    ga_compile(*this, gis, order);
+    std::shared_ptr<ga_instruction_set> pgis;
+    std::string signature;
+    if (compiled_programs.enabled) {
+      signature = compiled_program_signature(order);
+      auto it = compiled_programs.programs.find(order);
+      if (it != compiled_programs.programs.end()
+          && it->second.first == signature) {
+        pgis = it->second.second;
+        ga_update_extended_variables(*this, *pgis);
+        ++(compiled_programs.nb_hits);
+      }
+    }
+    if (!pgis) {
+      pgis = std::make_shared<ga_instruction_set>();
+      ga_compile(*this, *pgis, order);
+      if (compiled_programs.enabled) {
+        compiled_programs.programs[order]
+          = compiled_program_cache::program(signature, pgis);
+        ++(compiled_programs.nb_misses);
+      }
+    }
+    ga_instruction_set &gis = *pgis;
+    nb_optimized_instr = gis.nb_optimized_instructions;
+    nb_native_kern = gis.nb_native_kernels;
     GA_TOCTIC("Compile time");
 
-    if (order == 2) {
+    if (order == 2 && !matrix_free) {
       if (K.use_count()) {
         gmm::clear(*K);
         gmm::resize(*K, nb_prim_dof, nb_prim_dof);
@@ -778,6 +887,10 @@ namespace getfem {
     gmm::clear(assembled_tensor().as_vector());
     GA_TOCTIC("Init time");
 
+    // Binds the current targets to the compiled program. In a matrix-free
+    // product, the order 1 terms of the action form go to the output.
+    exec_K = K.get();
+    exec_V = (order == 2 && matrix_free) ? &matrix_free_y : V.get();
     ga_exec(gis, *this);
     GA_TOCTIC("Exec time");
 
@@ -789,7 +902,7 @@ namespace getfem {
     }
 
     // Deal with reduced fems.
-    if (order > 0) {
+    if (order > 0 && !matrix_free) {
       std::set<std::string> vars_vec_done;
       std::set<std::pair<std::string, std::string> > vars_mat_done;
       for (ga_tree &tree : gis.trees) {
@@ -866,6 +979,79 @@ namespace getfem {
     return include_empty_int_pts;
   }
 
+  void ga_workspace::matrix_free_product(const base_vector &x,
+                                         base_vector &y) {
+    const ga_workspace *w = this;
+    while (w->parent_workspace) w = w->parent_workspace;
+    if (w->md) w->md->nb_dof(); // To eventually call actualize_sizes()
+    GMM_ASSERT1(gmm::vect_size(x) == nb_prim_dof, "Wrong size of vector x, "
+                << gmm::vect_size(x) << " instead of " << nb_prim_dof);
+    gmm::resize(matrix_free_x, nb_prim_dof);
+    gmm::copy(x, matrix_free_x);
+    gmm::resize(matrix_free_y, nb_prim_dof);
+    gmm::clear(matrix_free_y);
+    // Parts of x used by the order 1 form of the terms (see ga_compile),
+    // declared as constants for the time of the assembly only.
+    std::vector<std::string> xnames;
+    for (const tree_description &td : trees)
+      if (td.order == 2 && td.operation == ASSEMBLY &&
+          td.interpolate_name_test2.empty() &&
+          !variable_group_exists(td.name_test2)) {
+        const mesh_fem *mf = associated_mf(td.name_test2);
+        if (mf && !(mf->is_reduced()) &&
+            factor_of_variable(td.name_test2) == scalar_type(1)) {
+          const gmm::sub_interval &I = interval_of_variable(td.name_test2);
+          base_vector &xp = matrix_free_x_parts[td.name_test2];
+          gmm::resize(xp, I.size());
+          gmm::copy(gmm::sub_vector(x, I), xp);
+          std::string xname = matrix_free_input_name(td.name_test2);
+          if (!variable_exists(xname)) {
+            add_fem_constant(xname, *mf, xp);
+            xnames.push_back(xname);
+          }
+        }
+      }
+    matrix_free = true;
+    try {
+      assembly(2);
+    } catch (...) {
+      matrix_free = false;
+      for (const std::string &xname : xnames) variables.erase(xname);
+      throw;
+    }
+    matrix_free = false;
+    for (const std::string &xname : xnames) variables.erase(xname);
+    MPI_SUM_VECTOR(matrix_free_y);
+    gmm::resize(y, nb_prim_dof);
+    gmm::copy(matrix_free_y, y);
+  }
+
+  std::string
+  ga_workspace::matrix_free_input_name(const std::string &varname) const {
+    if (matrix_free_x_parts.count(varname) == 0) return std::string();
+    return "Matrix_free_x_" + varname;
+  }
+
+  void ga_workspace::set_sum_factorization(bool enable) {
+    use_sum_factorization = enable;
+  }
+
+  void ga_workspace::set_instruction_optimization(bool enable) {
+    optimize_instructions = enable;
+  }
+
+  void ga_workspace::set_native_code(bool enable) {
+    use_native_code = enable;
+  }
+
+  void ga_workspace::set_element_batching(size_type nb) {
+    element_batch_size = nb;
+  }
+
+  void ga_workspace::set_atomic_vector_assembly(bool atomic) {
+    atomic_vector_assembly = atomic;
+  }
+
   void ga_workspace::add_temporary_interval_for_unreduced_variable
     (const std::string &name)
   {
@@ -882,7 +1068,8 @@ namespace getfem {
     }
   }
 
-  void ga_workspace::clear_expressions() { trees.clear(); }
+  void ga_workspace::clear_expressions()
+  { trees.clear(); ++expressions_version; }
 
   void ga_workspace::print(std::ostream &str) {
     for (size_type i = 0; i < trees.size(); ++i)
@@ -920,7 +1107,7 @@ namespace getfem {
     : md(&md_), parent_workspace(0),
       enable_all_md_variables(enable_all_variables),
       nb_prim_dof(0), nb_tmp_dof(0),
-      macro_dict(md_.macro_dictionary())
+      macro_dict(md_.macro_dictionary()), expressions_version(0)
   {
     init();
     nb_prim_dof = md->nb_dof();
@@ -928,11 +1115,11 @@ namespace getfem {
   ga_workspace::ga_workspace(bool, const ga_workspace &gaw)
     : md(0), parent_workspace(&gaw), enable_all_md_variables(false),
       nb_prim_dof(gaw.nb_primary_dof()), nb_tmp_dof(0),
-      macro_dict(gaw.macro_dictionary())
+      macro_dict(gaw.macro_dictionary()), expressions_version(0)
   { init(); }
   ga_workspace::ga_workspace()
     : md(0), parent_workspace(0), enable_all_md_variables(false),
-      nb_prim_dof(0), nb_tmp_dof(0)
+      nb_prim_dof(0), nb_tmp_dof(0), expressions_version(0)
   { init(); }
   ga_workspace::~ga_workspace() { clear_expressions(); }
 
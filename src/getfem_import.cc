@@ -276,6 +276,8 @@ namespace getfem {
 
     //cerr << "reading nodes..[nb=" << nb_node << "]\n";
     std::map<size_type, size_type> msh_node_2_getfem_node;
+    std::vector<size_type> node_ids, getfem_nodes;
+    std::vector<base_node> nodes;
     for (size_type block=0; block < nb_block; ++block) {
       if (version >= 4)
         f >> dummy >> dummy >> dummy >> nb_node;
@@ -283,10 +285,12 @@ namespace getfem {
         size_type node_id;
         base_node n{0,0,0};
         f >> node_id >> n[0] >> n[1] >> n[2];
-        msh_node_2_getfem_node[node_id]
-          = m.add_point(n, remove_duplicated_nodes ? 0. : -1.);
+        node_ids.push_back(node_id); nodes.push_back(n);
       }
     }
+    m.add_points(nodes, getfem_nodes, remove_duplicated_nodes ? 0. : -1.);
+    for (size_type i = 0; i < node_ids.size(); ++i)
+      msh_node_2_getfem_node[node_ids[i]] = getfem_nodes[i];
 
     if (version >= 2)
       bgeot::read_until(f, "$Endnodes"); /* Format versions 2 and 4 */
@@ -664,11 +668,17 @@ namespace getfem {
         }
         size_type dim2=0;
         for (size_type j=0; j < dim; ++j) if (!direction_useless[j]) dim2++;
+        std::vector<base_node> nodes;
+        std::vector<size_type> getfem_nodes;
         for (dal::bv_visitor ip(gid_nodes_used); !ip.finished(); ++ip) {
           base_node n(dim2);
           for (size_type j=0, cnt=0; j < dim; ++j) if (!direction_useless[j]) n[cnt++]=gid_nodes[ip][j];
-          msh_node_2_getfem_node[ip] = m.add_point(n);
+          nodes.push_back(n);
         }
+        m.add_points(nodes, getfem_nodes);
+        size_type cnt = 0;
+        for (dal::bv_visitor ip(gid_nodes_used); !ip.finished(); ++ip)
+          msh_node_2_getfem_node[ip] = getfem_nodes[cnt++];
       }
 
       bgeot::read_until(f, "ELEMENTS");
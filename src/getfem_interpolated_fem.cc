@@ -42,7 +42,7 @@ namespace getfem {
     if (cv_stored != size_type(-1) && gic.invert(pt, ptr, gt_invertible))
       { cv = cv_stored; if (gt_invertible) return true; }
     boxtree.find_boxes_at_point(pt, boxlst);
-    bgeot::rtree::pbox_set::const_iterator it = boxlst.begin(),
+    bgeot::rtree::pbox_cont::const_iterator it = boxlst.begin(),
       ite = boxlst.end();
     for (; it != ite; ++it) {
       for (auto candidate : box_to_convexes_map.at((*it)->id)) {
@@ -47,7 +47,7 @@ base_small_vector element_U(const contact_boundary &cb, size_type cv)
 }
 
 //Returns an iterator of a box which centre is closest to the given point
-auto most_central_box(const bgeot::rtree::pbox_set &bset,
+auto most_central_box(const bgeot::rtree::pbox_cont &bset,
                       const bgeot::base_node       &pt) -> decltype(begin(bset))
 {
   using namespace std;
@@ -84,9 +84,11 @@ class  interpolate_transformation_on_deformed_domains
   contact_boundary master;//also marked with a target or Y prefix/suffix
   contact_boundary slave; //also marked with a source or X prefix/suffix
 
-  mutable bgeot::rtree element_boxes;
-  mutable std::map<size_type, std::vector<size_type>> box_to_convex; //index to obtain a convex
-                                                                     //number from a box number
+  //boxes of the deformed elements of the master, the box id being the convex
+  //number. The tree is kept between assemblies and only updated with the
+  //new deformed boxes, most of them staying in their leaf.
+  mutable bgeot::dynamic_rtree element_boxes;
+  mutable dal::bit_vector boxed_convexes;
   mutable bgeot::geotrans_inv_convex gic;
   mutable fem_precomp_pool fppool;
 
@@ -94,7 +96,6 @@ class  interpolate_transformation_on_deformed_domains
   void compute_element_boxes() const { // called by init
     base_matrix G;
     model_real_plain_vector Uelm; //element displacement
-    element_boxes.clear();
 
     auto bnum = master.region;
     auto &mfu = *(master.mfu);
@@ -114,7 +115,7 @@ class  interpolate_transformation_on_deformed_domains
 
     dal::bit_vector points_already_interpolated;
     std::vector<base_node> transformed_points(m.nb_max_points());
-    box_to_convex.clear();
+    dal::bit_vector visited_convexes;
 
     for (getfem::mr_visitor v(region, m); !v.finished(); ++v) {
       auto cv   = v.cv();
@@ -152,9 +153,16 @@ class  interpolate_transformation_on_deformed_domains
         }
       }
 
-      // Store the bounding box and additional information.
-      box_to_convex[element_boxes.add_box(bmin, bmax)].push_back(cv);
+      // Store or update the bounding box.
+      if (element_boxes.has_box(cv))
+        element_boxes.update_box(cv, bmin, bmax);
+      else
+        element_boxes.add_box(bmin, bmax, cv);
+      visited_convexes.add(cv);
     }
+    for (dal::bv_visitor cv(boxed_convexes); !cv.finished(); ++cv)
+      if (!visited_convexes.is_in(cv)) element_boxes.remove_box(cv);
+    boxed_convexes = visited_convexes;
     element_boxes.build_tree();
   }
 
@@ -240,8 +248,6 @@ public:
   };
 
   void finalize() const override {
-    element_boxes.clear();
-    box_to_convex.clear();
     master.U_unred.clear();
     slave.U_unred.clear();
     fppool.clear();
@@ -283,28 +289,25 @@ public:
 
     //Find the best box from the master (target) that
     //corresponds to this point (The box which centre is the closest to the point).
-    //Obtain the corresponding element number using the box id and box_to_convex
-    //indices. Compute deformed nodes of the target element. Invert the geometric
+    //The box id is the corresponding element number. Compute deformed nodes
+    //of the target element. Invert the geometric
     //transformation of the target element with deformed nodes, obtaining this way
     //reference coordinates of the target element
-    auto bset = rtree::pbox_set{};
+    THREAD_SAFE_STATIC rtree::pbox_cont bset;
     element_boxes.find_boxes_at_point(pt_x, bset);
     while (!bset.empty())
     {
       auto itmax = most_central_box(bset, pt_x);
 
-      for (auto i : box_to_convex.at((*itmax)->id))
-      {
-        auto deformed_nodes_y = deformed_master_nodes(i);
-        gic.init(deformed_nodes_y, target_mesh.trans_of_convex(i));
-        auto converged = true;
-        auto is_in = gic.invert(pt_x, P_ref, converged);
-        if (is_in && converged) {
-          cv = i;
-          face_num = static_cast<short_type>(-1);
-          transformation_success = true;
-          break;
-        }
+      auto i = (*itmax)->id;
+      auto deformed_nodes_y = deformed_master_nodes(i);
+      gic.init(deformed_nodes_y, target_mesh.trans_of_convex(i));
+      auto converged = true;
+      auto is_in = gic.invert(pt_x, P_ref, converged);
+      if (is_in && converged) {
+        cv = i;
+        face_num = static_cast<short_type>(-1);
+        transformation_success = true;
       }
       if (transformation_success || (bset.size() == 1)) break;
       bset.erase(itmax);
@@ -220,7 +220,7 @@ namespace getfem {
   }
 #endif
 
-  void mesh::optimize_structure(bool with_renumbering) {
+  void mesh::optimize_structure(renumbering_method method) {
     pts.resort();
     size_type i, j = nb_convex(), nbc = j;
     for (i = 0; i < j; i++)
@@ -233,20 +233,72 @@ namespace getfem {
         while (i < j && j != ST_NIL && !(pts.index()[j])) --j;
         if (i < j && j != ST_NIL ) swap_points(i, j);
       }
-    if (with_renumbering) { // Could be optimized no using only swap_convex
-      std::vector<size_type> cmk, iord(nbc), iordinv(nbc);
-      for (i = 0; i < nbc; ++i) iord[i] = iordinv[i] = i;
-
-      bgeot::cuthill_mckee_on_convexes(*this, cmk);
+    if (method == NO_RENUMBERING || nbc == 0) return;
+
+    std::vector<size_type> order, new_num(nbc);
+    if (method == CUTHILL_MCKEE_RENUMBERING)
+      bgeot::cuthill_mckee_on_convexes(*this, order);
+    else {
+      bool hilbert = (method == HILBERT_RENUMBERING);
+      std::vector<base_node> centers(nbc);
       for (i = 0; i < nbc; ++i) {
-        j = iordinv[cmk[i]];
-        if (i != j) {
-          swap_convex(i, j);
-          std::swap(iord[i], iord[j]);
-          std::swap(iordinv[iord[i]], iordinv[iord[j]]);
-        }
+        const ind_set &ipts = ind_points_of_convex(i);
+        centers[i] = pts[ipts[0]];
+        for (j = 1; j < ipts.size(); ++j) centers[i] += pts[ipts[j]];
+        centers[i] /= scalar_type(ipts.size());
       }
+      bgeot::space_filling_curve_order(centers, order, hilbert);
+
+      size_type nbpt = pts.size();
+      std::vector<base_node> nodes(nbpt);
+      for (i = 0; i < nbpt; ++i) nodes[i] = pts[i];
+      std::vector<size_type> pt_order, pt_num(nbpt);
+      bgeot::space_filling_curve_order(nodes, pt_order, hilbert);
+      for (i = 0; i < nbpt; ++i) pt_num[pt_order[i]] = i;
+      permute_points(pt_num);
+    }
+    for (i = 0; i < nbc; ++i) new_num[order[i]] = i;
+    permute_convexes(new_num);
+  }
+
+  void mesh::permute_convexes(const std::vector<size_type> &new_num) {
+    size_type nbc = nb_convex();
+    bgeot::mesh_structure::permute_convexes(new_num);
+    std::vector<bgeot::pgeometric_trans> old_gt(nbc);
+    for (size_type i = 0; i < nbc; ++i) old_gt[i] = gtab[i];
+    for (size_type i = 0; i < nbc; ++i) {
+      gtab[new_num[i]] = old_gt[i];
+      cvs_v_num[i] = act_counter();
     }
+    for (dal::bv_visitor i(valid_cvf_sets); !i.finished(); ++i)
+      cvf_sets[i].permute_convexes(new_num);
+    if (Bank_info.get()) {
+      dal::bit_vector is_green;
+      for (dal::bv_visitor i(Bank_info->is_green_simplex); !i.finished(); ++i)
+        is_green.add(new_num[i]);
+      Bank_info->is_green_simplex = is_green;
+      std::map<size_type, size_type> num_green;
+      for (const auto &p : Bank_info->num_green_simplex)
+        num_green[new_num[p.first]] = p.second;
+      Bank_info->num_green_simplex.swap(num_green);
+      for (dal::bv_visitor i(Bank_info->green_simplices.index());
+           !i.finished(); ++i)
+        for (size_type &cv : Bank_info->green_simplices[i].sub_simplices)
+          cv = new_num[cv];
+    }
+    touch();
+  }
+
+  void mesh::permute_points(const std::vector<size_type> &new_num) {
+    pts.permute_points(new_num);
+    bgeot::mesh_structure::permute_points(new_num);
+    if (Bank_info.get()) {
+      edge_set edges;
+      for (const edge &e : Bank_info->edges)
+        edges.insert(edge(e.i0, new_num[e.i1], new_num[e.i2]));
+      Bank_info->edges.swap(edges);
+    }
+    touch();
   }
 
   void mesh::translation(const base_small_vector &V)
@@ -328,6 +380,22 @@ namespace getfem {
                                     ? msource.convex_index()
                                     : msource.region(rg).index();
     std::vector<size_type> old2new(msource.points_index().last()+1, size_type(-1));
+    // All the points of the source convexes are added in one call, in
+    // the order of their first use. They can be merged with the points
+    // of the mesh but not between them.
+    std::vector<size_type> old_pids, new_pids;
+    std::vector<base_node> new_pts;
+    for (dal::bv_visitor cv(convexes); !cv.finished(); ++cv)
+      for (size_type old_pid : msource.ind_points_of_convex(cv))
+        if (old2new[old_pid] == size_type(-1)) {
+          old2new[old_pid] = old_pids.size();
+          old_pids.push_back(old_pid);
+          new_pts.push_back(msource.points()[old_pid]);
+        }
+    pts.add_nodes(new_pts, new_pids, tol, false);
+    for (size_type i = 0; i < old_pids.size(); ++i)
+      old2new[old_pids[i]] = new_pids[i];
+
     for (dal::bv_visitor cv(convexes); !cv.finished(); ++cv) {
 
       bgeot::pgeometric_trans pgt = msource.trans_of_convex(cv);
@@ -335,22 +403,7 @@ namespace getfem {
       const ind_cv_ct &rct = msource.ind_points_of_convex(cv);
       GMM_ASSERT1(nb == rct.size(), "Internal error");
       std::vector<size_type> ind(nb);
-      for (short_type i = 0; i < nb; ++i) {
-        size_type old_pid = rct[i];
-        size_type new_pid = old2new[old_pid];
-        if (new_pid == size_type(-1)) {
-          size_type next_pid = points_index().last()+1;
-          base_node pt = msource.points()[old_pid];
-          new_pid = pts.add_node(pt, tol);
-          if (new_pid < next_pid && new_pid >= nbpt) {
-            // do not allow internal merging of nodes in the source mesh
-            new_pid = pts.add_node(pt, -1.);
-            GMM_ASSERT1(new_pid == next_pid, "Internal error");
-          }
-          old2new[old_pid] = new_pid;
-        }
-        ind[i] = new_pid;
-      }
+      for (short_type i = 0; i < nb; ++i) ind[i] = old2new[rct[i]];
       add_convex(pgt, ind.begin());
     }
   }
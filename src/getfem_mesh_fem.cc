@@ -21,10 +21,17 @@
 
 
 #include <queue>
+#include <set>
 #include "getfem/dal_singleton.h"
 #include "getfem/getfem_mesh_fem.h"
 #include "getfem/getfem_torus.h"
 
+#if GETFEM_HAVE_METIS_OLD_API
+extern "C" void METIS_NodeND(int *, int *, int *, int *, int *, int *, int *);
+#elif GETFEM_HAVE_METIS
+#  include <metis.h>
+#endif
+
 namespace getfem {
 
   void mesh_fem::update_from_context() const {
@@ -319,13 +326,23 @@ namespace getfem {
 
   /// Enumeration of dofs
   void mesh_fem::enumerate_dof() const {
+    if (parallel_enumeration && true_thread_policy::num_threads() > 1
+        && !me_is_multithreaded_now())
+      enumerate_dof_parallel();
+    else
+      enumerate_dof_serial();
+  }
+
+  void mesh_fem::enumerate_dof_serial() const {
     bgeot::index_node_pair ipt;
     is_uniform_ = true;
     is_uniformly_vectorized_ = (get_qdim() > 1);
     GMM_ASSERT1(linked_mesh_ != 0, "Uninitialized mesh_fem");
     context_check();
-    if (fe_convex.card() == 0)
-      { dof_enumeration_made = true; nb_total_dof = 0; return; }
+    if (fe_convex.card() == 0) {
+      dof_enumeration_made = true; nb_total_dof = 0; dof_perm.clear();
+      return;
+    }
     pfem first_pf = f_elems[fe_convex.first_true()];
     if (first_pf && first_pf->is_on_real_element()) is_uniform_ = false;
     if (first_pf && first_pf->target_dim() > 1) is_uniformly_vectorized_=false;
@@ -445,6 +462,302 @@ namespace getfem {
 
     dof_enumeration_made = true;
     nb_total_dof = nbdof;
+    apply_dof_ordering();
+  }
+
+  /* The parallel enumeration splits the work of enumerate_dof_serial in
+     three passes. The geometric part (position of the dofs and search of
+     the same dof on the neighbour elements) is done in parallel on
+     chunks of elements. The numbering itself is then a linear serial
+     sweep applying the linking rule of enumerate_dof_serial to the
+     candidates found. The fems defined on the real element compute their
+     dofs element by element, possibly with a non thread-safe state: they
+     are enumerated serially. */
+  void mesh_fem::enumerate_dof_parallel() const {
+    is_uniform_ = true;
+    is_uniformly_vectorized_ = (get_qdim() > 1);
+    GMM_ASSERT1(linked_mesh_ != 0, "Uninitialized mesh_fem");
+    context_check();
+    if (fe_convex.card() == 0) {
+      dof_enumeration_made = true; nb_total_dof = 0; dof_perm.clear();
+      return;
+    }
+    pfem first_pf = f_elems[fe_convex.first_true()];
+    if (first_pf && first_pf->is_on_real_element()) is_uniform_ = false;
+    if (first_pf && first_pf->target_dim() > 1) is_uniformly_vectorized_=false;
+
+    // Elements with a fem, in increasing order, and offsets of their dofs
+    const mesh &m = linked_mesh();
+    std::vector<size_type> cvs, first_ldof(1, 0);
+    std::vector<size_type> rank_of_cv(m.nb_allocated_convex(), size_type(-1));
+    std::set<std::pair<pfem, bgeot::pconvex_structure>> fem_structs;
+    for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv)
+      if (fe_convex.is_in(cv)) {
+        pfem pf = fem_of_element(cv);
+        if (pf->is_on_real_element()) { enumerate_dof_serial(); return; }
+        // The tables built on first use by the fem and by the convex
+        // structure for the neighbour search are built before the threads.
+        if (fem_structs.emplace(pf, m.structure_of_convex(cv)).second) {
+          pf->node_tab(cv);
+          for (size_type i = 0; i < pf->nb_dof(cv); ++i)
+            if (pf->faces_of_dof(cv, i).size() > 1)
+              m.structure_of_convex(cv)->ind_common_points_of_faces
+                (pf->faces_of_dof(cv, i));
+        }
+        if (pf != first_pf) is_uniform_ = false;
+        if (pf->target_dim() > 1) is_uniformly_vectorized_ = false;
+        rank_of_cv[cv] = cvs.size();
+        cvs.push_back(cv);
+        first_ldof.push_back(first_ldof.back() + pf->nb_dof(cv));
+      }
+    size_type nbcv = cvs.size(), N = m.dim();
+    std::vector<scalar_type> elt_car_sizes(nbcv), pos(first_ldof.back()*N);
+    std::vector<std::vector<size_type>> givers(first_ldof.back());
+
+    // Pass 1: characteristic sizes of the elements and position of the dofs
+    parallel_chunks(nbcv, [&](size_type k0, size_type k1) {
+      base_node P(N), bmin(N), bmax(N);
+      bgeot::pstored_point_tab pspt_old = 0;
+      bgeot::pgeometric_trans pgt_old = 0;
+      bgeot::pgeotrans_precomp pgp = 0;
+      for (size_type k = k0; k < k1; ++k) {
+        size_type cv = cvs[k];
+        gmm::copy(m.points_of_convex(cv)[0], bmin);
+        gmm::copy(bmin, bmax);
+        for (size_type i = 0; i < m.nb_points_of_convex(cv); ++i) {
+          const base_node &pt = m.points_of_convex(cv)[i];
+          for (size_type d = 1; d < N; ++d) {
+            bmin[d] = std::min(bmin[d], pt[d]);
+            bmax[d] = std::max(bmax[d], pt[d]);
+          }
+        }
+        elt_car_sizes[k] = gmm::vect_dist2_sqr(bmin, bmax);
+
+        pfem pf = fem_of_element(cv);
+        bgeot::pgeometric_trans pgt = m.trans_of_convex(cv);
+        bgeot::pstored_point_tab pspt = pf->node_tab(cv);
+        if (pgt != pgt_old || pspt != pspt_old)
+          pgp = bgeot::geotrans_precomp(pgt, pspt, pf);
+        pgt_old = pgt; pspt_old = pspt;
+        pdof_description andof = global_dof(pf->dim());
+        for (size_type i = 0; i < pf->nb_dof(cv); ++i) {
+          pdof_description pnd = pf->dof_types()[i];
+          if (pnd == andof || !dof_linkable(pnd)) continue;
+          pgp->transform(m.points_of_convex(cv), i, P);
+          std::copy(P.begin(), P.end(), pos.begin() + (first_ldof[k]+i)*N);
+        }
+      }
+    });
+
+    // Pass 2: in enumerate_dof_serial, an element creating a linkable dof
+    // gives its number to the next elements of its own neighbourhood for
+    // this dof, the last giver overwriting the previous ones. The dofs of
+    // the earlier elements which would give their number to each linkable
+    // dof are listed in the order of the serial sweep.
+    parallel_chunks(nbcv, [&](size_type k0, size_type k1) {
+      bgeot::mesh_structure::ind_set s;
+      std::vector<size_type> kns;
+      for (size_type k = k0; k < k1; ++k) {
+        size_type cv = cvs[k];
+        pfem pf = fem_of_element(cv);
+        pdof_description andof = global_dof(pf->dim());
+        size_type part = get_dof_partition(cv);
+        kns.resize(0); // earlier elements sharing a point with cv
+        for (size_type ip : m.ind_points_of_convex(cv))
+          for (size_type ncv : m.convex_to_point(ip)) {
+            size_type kn = rank_of_cv[ncv];
+            if (kn < k && get_dof_partition(ncv) == part) kns.push_back(kn);
+          }
+        std::sort(kns.begin(), kns.end());
+        kns.erase(std::unique(kns.begin(), kns.end()), kns.end());
+        for (size_type i = 0; i < pf->nb_dof(cv); ++i) {
+          pdof_description pnd = pf->dof_types()[i];
+          if (pnd == andof || !dof_linkable(pnd)) continue;
+          auto itP = pos.begin() + (first_ldof[k]+i)*N;
+          for (size_type kn : kns) {
+            size_type ncv = cvs[kn];
+            pfem npf = fem_of_element(ncv);
+            for (size_type j = 0; j < npf->nb_dof(ncv); ++j)
+              if (dof_description_compare(npf->dof_types()[j], pnd) == 0) {
+                auto itQ = pos.begin() + (first_ldof[kn]+j)*N;
+                scalar_type dist = scalar_type(0);
+                for (size_type d = 0; d < N; ++d)
+                  dist += gmm::sqr(itP[d] - itQ[d]);
+                if (dist > 1e-6*elt_car_sizes[k]) continue;
+                m.neighbours_of_convex(ncv, npf->faces_of_dof(ncv, j), s);
+                if (std::find(s.begin(), s.end(), cv) != s.end())
+                  givers[first_ldof[k]+i].push_back(first_ldof[kn]+j);
+              }
+          }
+        }
+      }
+    });
+
+    // Pass 3: numbering
+    size_type nbdof = 0;
+    dal::bit_vector encountered_global_dof;
+    dal::dynamic_array<size_type> ind_global_dof;
+    std::vector<size_type> itab, num(first_ldof.back());
+    std::vector<bool> created(first_ldof.back(), false);
+    dof_structure.clear();
+    for (size_type k = 0; k < nbcv; ++k) {
+      size_type cv = cvs[k];
+      pfem pf = fem_of_element(cv);
+      size_type nbd = pf->nb_dof(cv);
+      pdof_description andof = global_dof(pf->dim());
+      itab.resize(nbd);
+      for (size_type i = 0; i < nbd; ++i) {
+        size_type ld = first_ldof[k] + i, l = size_type(-1);
+        pdof_description pnd = pf->dof_types()[i];
+        if (pnd == andof) {
+          size_type gnum = pf->index_of_global_dof(cv, i);
+          if (!(encountered_global_dof[gnum])) {
+            ind_global_dof[gnum] = nbdof;
+            nbdof += Qdim / pf->target_dim();
+            encountered_global_dof[gnum] = true;
+          }
+          itab[i] = ind_global_dof[gnum];
+        } else {
+          for (auto it = givers[ld].rbegin(); it != givers[ld].rend(); ++it)
+            if (created[*it]) { l = *it; break; }
+          if (l == size_type(-1)) {
+            itab[i] = nbdof; created[ld] = true;
+            nbdof += Qdim / pf->target_dim();
+          } else
+            itab[i] = num[l];
+        }
+        num[ld] = itab[i];
+      }
+      dof_structure.add_convex_noverif(pf->structure(cv), itab.begin(), cv);
+    }
+
+    dof_enumeration_made = true;
+    nb_total_dof = nbdof;
+    apply_dof_ordering();
+  }
+
+  /* Reverse Cuthill-McKee ordering of a graph given in compressed form.
+     Each connected component is numbered from a pseudo-peripheral node. */
+  static void reverse_cuthill_mckee(const std::vector<size_type> &xadj,
+                                    const std::vector<size_type> &adj,
+                                    std::vector<size_type> &order) {
+    size_type n = xadj.size() - 1;
+    order.resize(0); order.reserve(n);
+    std::vector<size_type> mark(n, 0), level(n);
+    size_type stamp = 0;
+    auto degree = [&](size_type i) { return xadj[i+1] - xadj[i]; };
+
+    // Breadth first search from root (mark[i] = stamp for reached nodes).
+    // Return the eccentricity of root and the node of minimal degree in
+    // the last level.
+    std::vector<size_type> queue;
+    auto bfs = [&](size_type root, size_type &last) {
+      ++stamp; queue.assign(1, root); mark[root] = stamp; level[root] = 0;
+      for (size_type k = 0; k < queue.size(); ++k)
+        for (size_type j = xadj[queue[k]]; j < xadj[queue[k]+1]; ++j)
+          if (mark[adj[j]] != stamp) {
+            mark[adj[j]] = stamp; level[adj[j]] = level[queue[k]] + 1;
+            queue.push_back(adj[j]);
+          }
+      size_type ecc = level[queue.back()];
+      last = queue.back();
+      for (size_type i : queue)
+        if (level[i] == ecc && degree(i) < degree(last)) last = i;
+      return ecc;
+    };
+
+    std::vector<bool> numbered(n, false);
+    std::vector<size_type> nei;
+    for (size_type s = 0; s < n; ++s) {
+      if (numbered[s]) continue;
+      size_type root = s, last;
+      size_type ecc = bfs(root, last);
+      for (size_type it = 0; it < 5 && last != root; ++it) {
+        size_type last2, ecc2 = bfs(last, last2);
+        if (ecc2 <= ecc) break;
+        root = last; ecc = ecc2; last = last2;
+      }
+      size_type k = order.size();
+      order.push_back(root); numbered[root] = true;
+      for (; k < order.size(); ++k) {
+        size_type i = order[k];
+        nei.resize(0);
+        for (size_type j = xadj[i]; j < xadj[i+1]; ++j)
+          if (!numbered[adj[j]])
+            { numbered[adj[j]] = true; nei.push_back(adj[j]); }
+        std::sort(nei.begin(), nei.end(), [&](size_type a, size_type b)
+                  { return degree(a) < degree(b); });
+        order.insert(order.end(), nei.begin(), nei.end());
+      }
+    }
+    std::reverse(order.begin(), order.end());
+  }
+
+  void mesh_fem::apply_dof_ordering() const {
+    dof_perm.clear();
+    if (dof_ordering == DOF_ORDERING_NONE || nb_total_dof == 0) return;
+
+    // The dof nodes are the first dofs of the groups of consecutive dofs
+    // stored in dof_structure. They are numbered here in increasing order.
+    size_type nbd = nb_total_dof;
+    std::vector<size_type> node_of_dof(nbd, size_type(-1)), first_dof;
+    std::vector<bool> is_node(nbd, false);
+    for (dal::bv_visitor cv(dof_structure.convex_index());
+         !cv.finished(); ++cv)
+      for (size_type d : dof_structure.ind_points_of_convex(cv))
+        is_node[d] = true;
+    for (size_type d = 0; d < nbd; ++d)
+      if (is_node[d])
+        { node_of_dof[d] = first_dof.size(); first_dof.push_back(d); }
+    size_type nn = first_dof.size();
+
+    // Graph of the nodes: two nodes are connected if they share an element.
+    std::vector<size_type> xadj(nn+1), adj, mark(nn, size_type(-1));
+    for (size_type i = 0; i < nn; ++i) {
+      xadj[i] = adj.size(); mark[i] = i;
+      for (size_type cv : dof_structure.convex_to_point(first_dof[i]))
+        for (size_type d : dof_structure.ind_points_of_convex(cv)) {
+          size_type j = node_of_dof[d];
+          if (mark[j] != i) { mark[j] = i; adj.push_back(j); }
+        }
+    }
+    xadj[nn] = adj.size();
+
+    std::vector<size_type> order;
+    if (dof_ordering == DOF_ORDERING_NESTED_DISSECTION) {
+#if GETFEM_HAVE_METIS_OLD_API || GETFEM_HAVE_METIS
+      int n = int(nn);
+      std::vector<int> ixadj(xadj.begin(), xadj.end()),
+        iadj(adj.begin(), adj.end()), perm(nn), iperm(nn);
+# if GETFEM_HAVE_METIS_OLD_API
+      int numflag = 0, options[8] = {0,0,0,0,0,0,0,0};
+      METIS_NodeND(&n, &(ixadj[0]), &(iadj[0]), &numflag, options,
+                   &(perm[0]), &(iperm[0]));
+# else
+      int options[METIS_NOPTIONS] = { 0 };
+      METIS_SetDefaultOptions(options);
+      METIS_NodeND(&n, &(ixadj[0]), &(iadj[0]), 0, options,
+                   &(perm[0]), &(iperm[0]));
+# endif
+      order.assign(perm.begin(), perm.end());
+#else
+      GMM_WARNING1("Nested dissection needs the METIS library, "
+                   "the reverse Cuthill-McKee ordering is used instead");
+      reverse_cuthill_mckee(xadj, adj, order);
+#endif
+    } else
+      reverse_cuthill_mckee(xadj, adj, order);
+
+    // New numbering, keeping the dofs of a node contiguous.
+    dof_perm.resize(nbd);
+    size_type nd = 0;
+    for (size_type k = 0; k < nn; ++k) {
+      size_type i = order[k];
+      size_type d0 = first_dof[i];
+      size_type d1 = (i+1 < nn) ? first_dof[i+1] : nbd;
+      for (size_type d = d0; d < d1; ++d) dof_perm[d] = nd++;
+    }
+    dof_structure.permute_points(dof_perm);
   }
 
   void mesh_fem::reduce_to_basic_dof(const dal::bit_vector &kept_dof) {
@@ -487,6 +800,8 @@ namespace getfem {
     mi.resize(1); mi[0] = Q;
     linked_mesh_ = &me;
     use_reduction = false;
+    dof_ordering = DOF_ORDERING_NONE;
+    parallel_enumeration = false;
     this->add_dependency(me);
     v_num = v_num_update = act_counter();
   }
@@ -514,6 +829,9 @@ namespace getfem {
     v_num_update = mf.v_num_update;
     v_num = mf.v_num;
     use_reduction = mf.use_reduction;
+    dof_ordering = mf.dof_ordering;
+    dof_perm = mf.dof_perm;
+    parallel_enumeration = mf.parallel_enumeration;
   }
 
   mesh_fem::mesh_fem(const mesh_fem &mf) : context_dependencies() {
@@ -530,6 +848,8 @@ namespace getfem {
 
   mesh_fem::mesh_fem() {
     linked_mesh_ = 0;
+    dof_ordering = DOF_ORDERING_NONE;
+    parallel_enumeration = false;
     dof_enumeration_made = false;
     is_uniform_ = true;
     set_qdim(1);
@@ -156,7 +156,7 @@ struct Chrono {
 	    if (pgt->convex_ref()->is_in(P) > 1E-8) {
 	      GMM_WARNING1("Projected point outside the reference convex ! "
 			   "Projection canceled. P = " << P);
-	    } else m.points()[ipts[i]] = P;
+	    } else m.points().set_node(ipts[i], P);
 	  }
 	  ptdone[ipts[i]] = true;
 	  // dist(P, new_cts);
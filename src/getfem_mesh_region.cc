@@ -22,6 +22,7 @@
 #include "getfem/getfem_mesh_region.h"
 #include "getfem/getfem_mesh.h"
 #include "getfem/getfem_omp.h"
+#include <algorithm>
 
 namespace getfem {
 
@@ -66,9 +67,98 @@ namespace getfem {
   }
 
   void mesh_region::touch_parent_mesh(){
+    if (p) wp().v_num = act_counter();
     if (parent_mesh) parent_mesh->touch_from_region(id_);
   }
 
+  void mesh_region::sort_entries() const{
+    if (rp().sorted.load(std::memory_order_acquire)) return;
+    GLOBAL_OMP_GUARD
+    rp().sort();
+  }
+
+  void mesh_region::impl::sort() const{
+    if (sorted.load(std::memory_order_acquire)) return;
+    map_t r;
+    r.reserve(m.size() + pending.size());
+    auto it = m.begin();
+    auto itp = pending.begin();
+    while (it != m.end() || itp != pending.end()) {
+      size_type cv = (itp == pending.end()
+                      || (it != m.end() && it->first < itp->first))
+                   ? it->first : itp->first;
+      face_bitset mask;
+      for (; it != m.end() && it->first == cv; ++it) mask |= it->second;
+      for (; itp != pending.end() && itp->first == cv; ++itp)
+        mask |= itp->second;
+      if (mask.any()) r.emplace_back(cv, mask);
+    }
+    m.swap(r);
+    pending.clear();
+    ++generation;
+    sorted.store(true, std::memory_order_release);
+  }
+
+  std::vector<std::weak_ptr<mesh_region::impl>> &
+  mesh_region::unsorted_regions() {
+    static std::vector<std::weak_ptr<impl>> regions;
+    return regions;
+  }
+
+  void mesh_region::mark_unsorted(){
+    if (!wp().sorted.exchange(false)) return;
+#ifdef GETFEM_HAS_OPENMP
+    GLOBAL_OMP_GUARD
+    auto &regions = unsorted_regions();
+    if (regions.size() == regions.capacity()) // drop the ones sorted since
+      regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                   [](const std::weak_ptr<impl> &w) {
+                                     auto q = w.lock();
+                                     return !q || q->sorted.load();
+                                   }), regions.end());
+    regions.push_back(p);
+#endif
+  }
+
+  void mesh_region::compact_unsorted_regions(){
+    GLOBAL_OMP_GUARD
+    for (const auto &w : unsorted_regions())
+      if (auto q = w.lock()) q->sort();
+    unsorted_regions().clear();
+  }
+
+  void mesh_region::append(size_type cv, const face_bitset &mask){
+    map_t &m = wp().m;
+    if (m.empty() || m.back().first < cv)
+      m.emplace_back(cv, mask);
+    else {
+      face_bitset *b = find(cv);
+      if (b) *b |= mask;
+      else { wp().pending[cv] |= mask; mark_unsorted(); }
+    }
+  }
+
+  face_bitset *mesh_region::find(size_type cv) const{
+    map_t &m = rp().m;
+    auto it = std::lower_bound(m.begin(), m.end(), cv,
+                               [](const map_t::value_type &a, size_type i)
+                               { return a.first < i; });
+    return (it != m.end() && it->first == cv) ? &(it->second) : nullptr;
+  }
+
+  face_bitset mesh_region::mask_of(size_type cv) const{
+    if (!rp().sorted.load(std::memory_order_acquire)
+        && me_is_multithreaded_now())
+      sort_entries(); // modified in the parallel section
+    face_bitset *b = find(cv);
+    face_bitset mask = b ? *b : face_bitset();
+    if (!rp().sorted.load(std::memory_order_acquire)) { // in serial code
+      auto itp = rp().pending.find(cv);
+      if (itp != rp().pending.end()) mask |= itp->second;
+    }
+    return mask;
+  }
+
   const mesh_region& mesh_region::from_mesh(const mesh &m) const{
     if (!p)
     {
@@ -94,6 +184,7 @@ namespace getfem {
       partitioning_allowed.store(from.partitioning_allowed.load());
       if (from.p) {
         if (!p) p = std::make_shared<impl>();
+        from.sort_entries(); // so that the copy is sorted
         wp() = from.rp();
       }
       else p = nullptr;
@@ -107,6 +198,7 @@ namespace getfem {
     }
     else {
       if (from.p){
+        from.sort_entries();
         wp() = from.rp();
         type_= from.get_type();
         partitioning_allowed.store(from.partitioning_allowed.load());
@@ -132,15 +224,15 @@ namespace getfem {
     mr.from_mesh(m2);
     if (p && !(mr.p)) return false;
     if (!p && mr.p) return false;
-    if (p)
+    if (p) {
+      sort_entries(); mr.sort_entries();
       if (p->m != mr.p->m) return false;
+    }
     return true;
   }
 
   face_bitset mesh_region::operator[](size_t cv) const{
-    auto it = rp().m.find(cv);
-    if (it != rp().m.end()) return it->second;
-    else return {};
+    return mask_of(cv);
   }
 
   void mesh_region::update_partition_iterators() const{
@@ -151,6 +243,7 @@ namespace getfem {
   }
   mesh_region::const_iterator
     mesh_region::partition_begin( ) const{
+    sort_entries();
     auto region_size = rp().m.size();
     if (region_size < partitions_updated.num_threads()){
       //for small regions: put the whole region into zero thread
@@ -162,14 +255,12 @@ namespace getfem {
        static_cast<scalar_type >(partitions_updated.num_threads())));
     auto index_begin = partition_size * partitions_updated.this_thread();
     if (index_begin >= region_size ) return rp().m.end();
-
-    auto it = rp().m.begin();
-    for (size_type i = 0; i != index_begin; ++i) ++it;
-    return it;
+    return rp().m.begin() + index_begin;
   }
 
   mesh_region::const_iterator
     mesh_region::partition_end( ) const{
+    sort_entries();
     auto region_size = rp().m.size();
     if (region_size< partitions_updated.num_threads()) return rp().m.end();
 
@@ -178,10 +269,7 @@ namespace getfem {
        static_cast<scalar_type >(partitions_updated.num_threads())));
     auto index_end = partition_size * (partitions_updated.this_thread() + 1);
     if (index_end >= region_size ) return  rp().m.end();
-
-    auto it = rp().m.begin();
-    for (size_type i = 0; i < index_end && it != rp().m.end(); ++i) ++it;
-    return it;
+    return rp().m.begin() + index_end;
   }
 
   mesh_region::const_iterator mesh_region::begin() const{
@@ -190,7 +278,8 @@ namespace getfem {
       update_partition_iterators();
       return itbegin;
     }
-    else return rp().m.begin();
+    sort_entries();
+    return rp().m.begin();
   }
 
   mesh_region::const_iterator mesh_region::end() const{
@@ -198,7 +287,8 @@ namespace getfem {
       update_partition_iterators();
       return itend;
     }
-    else return rp().m.end();
+    sort_entries();
+    return rp().m.end();
   }
 
   void mesh_region::allow_partitioning(){
@@ -253,84 +343,101 @@ namespace getfem {
   }
 
   void mesh_region::add(const dal::bit_vector &bv){
-    for (dal::bv_visitor i(bv); !i.finished(); ++i){
-      wp().m[i].set(0, 1);
-    }
+    face_bitset mask; mask.set(0, 1);
+    for (dal::bv_visitor i(bv); !i.finished(); ++i) append(i, mask);
     touch_parent_mesh();
     mark_region_changed();
   }
 
   void mesh_region::add(size_type cv, short_type f){
-    wp().m[cv].set(short_type(f + 1), 1);
+    face_bitset mask; mask.set(short_type(f + 1), 1);
+    append(cv, mask);
     touch_parent_mesh();
     mark_region_changed();
   }
 
   void mesh_region::sup_all(size_type cv){
-    auto it = wp().m.find(cv);
-    if (it != wp().m.end()){
-      wp().m.erase(it);
+    face_bitset *b = find(cv);
+    bool found = (b && b->any());
+    bool in_pending = (wp().pending.erase(cv) != 0);
+    if (found) { b->reset(); mark_unsorted(); }
+    if (found || in_pending) {
       touch_parent_mesh();
       mark_region_changed();
     }
   }
 
   void mesh_region::sup(size_type cv, short_type f){
-    auto it = wp().m.find(cv);
-    if (it != wp().m.end()) {
-      it->second.set(short_type(f + 1), 0);
-      if (it->second.none()) wp().m.erase(it);
+    face_bitset *b = find(cv);
+    bool found = (b && b->any());
+    if (found) {
+      b->set(short_type(f + 1), 0);
+      if (b->none()) mark_unsorted();
+    }
+    auto itp = wp().pending.find(cv);
+    if (itp != wp().pending.end()) {
+      found = true;
+      itp->second.set(short_type(f + 1), 0);
+      if (itp->second.none()) wp().pending.erase(itp);
+    }
+    if (found) {
       touch_parent_mesh();
       mark_region_changed();
     }
   }
 
   void mesh_region::clear(){
-    wp().m.clear();
+    wp().m.clear(); wp().pending.clear(); wp().sorted = true;
+    ++(wp().generation);
     touch_parent_mesh();
     mark_region_changed();
   }
 
   void mesh_region::clean(){
-    for (map_t::iterator it = wp().m.begin(), itn;
-         it != wp().m.end(); it = itn) {
-      itn = it;
-      ++itn;
-      if (!(*it).second.any()) wp().m.erase(it);
-    }
+    wp().sorted = false;
+    wp().sort();
     touch_parent_mesh();
     mark_region_changed();
   }
 
   void mesh_region::swap_convex(size_type cv1, size_type cv2){
-    auto it1 = wp().m.find(cv1);
-    auto it2 = wp().m.find(cv2);
-    auto ite = wp().m.end();
-    face_bitset f1, f2;
-
-    if (it1 != ite) f1 = it1->second;
-    if (it2 != ite) f2 = it2->second;
-    if (!f1.none()) wp().m[cv2] = f1;
-    else if (it2 != ite) wp().m.erase(it2);
-    if (!f2.none()) wp().m[cv1] = f2;
-    else if (it1 != ite) wp().m.erase(it1);
+    if (cv1 == cv2) return;
+    if (!(wp().pending.empty())) sort_entries();
+    face_bitset *b1 = find(cv1), *b2 = find(cv2);
+    if (!b1 && !b2) return;
+    face_bitset f1 = b1 ? *b1 : face_bitset(), f2 = b2 ? *b2 : face_bitset();
+    if ((b1 && f2.none()) || (b2 && f1.none())) mark_unsorted();
+    if (b1) *b1 = f2;
+    if (b2) *b2 = f1;
+    // b1 and b2 may be invalidated by append
+    if (!b2 && f1.any()) append(cv2, f1);
+    if (!b1 && f2.any()) append(cv1, f2);
+    touch_parent_mesh();
+    mark_region_changed();
+  }
+
+  void mesh_region::permute_convexes(const std::vector<size_type> &new_num){
+    sort_entries();
+    map_t &m = wp().m;
+    for (auto &e : m) e.first = new_num[e.first];
+    std::sort(m.begin(), m.end(),
+              [](const map_t::value_type &a, const map_t::value_type &b)
+              { return a.first < b.first; });
+    ++(wp().generation);
     touch_parent_mesh();
     mark_region_changed();
   }
 
   bool mesh_region::is_in(size_type cv, short_type f) const{
     GMM_ASSERT1(p, "Use from mesh on that region before");
-    auto it = rp().m.find(cv);
-    if (it == rp().m.end() || short_type(f+1) >= MAX_FACES_PER_CV) return false;
-    return ((*it).second)[short_type(f+1)];
+    if (short_type(f+1) >= MAX_FACES_PER_CV) return false;
+    return mask_of(cv)[short_type(f+1)];
   }
 
   bool mesh_region::is_in(size_type cv, short_type f, const mesh &m) const{
     if (p) {
-      auto it = rp().m.find(cv);
-      if (it == rp().m.end() || short_type(f+1) >= MAX_FACES_PER_CV)
-        return false;
-      return ((*it).second)[short_type(f+1)];
+      if (short_type(f+1) >= MAX_FACES_PER_CV) return false;
+      return mask_of(cv)[short_type(f+1)];
     }
     else{
       if (id() == size_type(-1)) return true;
@@ -339,7 +446,13 @@ namespace getfem {
   }
 
   bool mesh_region::is_empty() const{
-    return rp().m.empty();
+    if (!rp().sorted.load(std::memory_order_acquire)
+        && me_is_multithreaded_now())
+      sort_entries(); // modified in the parallel section
+    if (rp().sorted.load(std::memory_order_acquire)) return rp().m.empty();
+    if (!(rp().pending.empty())) return false;
+    for (const auto &e : rp().m) if (e.second.any()) return false;
+    return true;
   }
 
   bool mesh_region::is_only_convexes() const{
@@ -352,12 +465,11 @@ namespace getfem {
   }
 
   face_bitset mesh_region::faces_of_convex(size_type cv) const{
-    auto it = rp().m.find(cv);
-    if (it != rp().m.end()) return ((*it).second) >> 1;
-    else return face_bitset();
+    return mask_of(cv) >> 1;
   }
 
   face_bitset mesh_region::and_mask() const{
+    sort_entries();
     face_bitset bs;
     if (rp().m.empty()) return bs;
     bs.set();
@@ -367,6 +479,7 @@ namespace getfem {
   }
 
   face_bitset mesh_region::or_mask() const{
+    sort_entries();
     face_bitset bs;
     if (rp().m.empty()) return bs;
     for (auto it = rp().m.begin(); it != rp().m.end(); ++it)
@@ -382,6 +495,7 @@ namespace getfem {
   }
 
   size_type mesh_region::unpartitioned_size() const{
+    sort_entries();
     size_type sz = 0;
     for (auto it = rp().m.begin(); it != rp().m.end(); ++it)
       sz += (*it).second.count();
@@ -400,11 +514,11 @@ namespace getfem {
                 b.id() != size_type(-1), "the 'all_convexes' regions "
                 "are not supported for set operations");
     if (a.id() == size_type(-1)){
-      for (const_iterator it = b.begin();it != b.end(); ++it) r.wp().m.insert(*it);
+      r.wp().m.assign(b.begin(), b.end());
       return r;
     }
     else if (b.id() == size_type(-1)){
-      for (const_iterator it = a.begin();it != a.end(); ++it) r.wp().m.insert(*it);
+      r.wp().m.assign(a.begin(), a.end());
       return r;
     }
 
@@ -419,7 +533,7 @@ namespace getfem {
         if (maska[0] && !maskb[0]) bs = maskb;
         else if (maskb[0] && !maska[0]) bs = maska;
         else bs = maska & maskb;
-        if (bs.any()) r.wp().m.insert(r.wp().m.end(), std::make_pair(ita->first,bs));
+        if (bs.any()) r.wp().m.emplace_back(ita->first, bs);
         ++ita; ++itb;
       }
     }
@@ -433,11 +547,17 @@ namespace getfem {
     GMM_ASSERT1(a.id() != size_type(-1) &&
       b.id() != size_type(-1), "the 'all_convexes' regions "
       "are not supported for set operations");
-    for (auto it = a.begin();it != a.end(); ++it){
-      r.wp().m.insert(*it);
-    }
-    for (auto it = b.begin();it != b.end(); ++it){
-      r.wp().m[it->first] |= it->second;
+    auto ita = a.begin(), enda = a.end(),
+         itb = b.begin(), endb = b.end();
+    map_t &m = r.wp().m;
+    m.reserve((enda - ita) + (endb - itb));
+    while (ita != enda || itb != endb) {
+      if (itb == endb || (ita != enda && ita->first < itb->first))
+        m.push_back(*ita++);
+      else if (ita == enda || itb->first < ita->first)
+        m.push_back(*itb++);
+      else
+        { m.emplace_back(ita->first, ita->second | itb->second); ++ita; ++itb; }
     }
     return r;
   }
@@ -450,16 +570,14 @@ namespace getfem {
     GMM_ASSERT1(a.id() != size_type(-1) &&
       b.id() != size_type(-1), "the 'all_convexes' regions "
       "are not supported for set operations");
-    for (auto ita = a.begin();ita != a.end(); ++ita)
-      r.wp().m.insert(*ita);
-
-    for (auto itb = b.begin();itb != b.end(); ++itb){
-      auto cv = itb->first;
-      auto it = r.wp().m.find(cv);
-      if (it != r.wp().m.end()){
-                it->second &= ~(itb->second);
-                if (it->second.none()) r.wp().m.erase(it);
-          }
+    auto ita = a.begin(), enda = a.end(),
+         itb = b.begin(), endb = b.end();
+    map_t &m = r.wp().m;
+    for (; ita != enda; ++ita) {
+      while (itb != endb && itb->first < ita->first) ++itb;
+      face_bitset bs = ita->second;
+      if (itb != endb && itb->first == ita->first) bs &= ~(itb->second);
+      if (bs.any()) m.emplace_back(ita->first, bs);
     }
     return r;
   }
@@ -564,12 +682,20 @@ namespace getfem {
       return true;
     }
     while (c.none()){
-      if (it == ite) { finished_=true; return false; }
-      cv_ = it->first;
-      c   = it->second;
+      const map_t &m = pi->m;
+      if (gen_ != pi->generation) { // the entries have been moved
+        gen_ = pi->generation;
+        size_type cv0 = (cv_ == size_type(-1)) ? 0 : cv_ + 1;
+        i_ = std::lower_bound(m.begin(), m.end(), cv0,
+                              [](const map_t::value_type &a, size_type i)
+                              { return a.first < i; }) - m.begin();
+      }
+      if (i_ == m.size() || m[i_].first >= end_cv)
+        { finished_=true; return false; }
+      cv_ = m[i_].first;
+      c   = m[i_].second;
       f_ = short_type(-1);
-      ++it;
-      if (c.none()) continue;
+      ++i_;
     }
     next_face();
     return true;
@@ -589,8 +715,11 @@ namespace getfem {
 
   void mesh_region::visitor::init(const mesh_region &s){
     whole_mesh = false;
-    it  = s.begin();
-    ite = s.end();
+    const_iterator it = s.begin(), ite = s.end();
+    pi = s.p.get();
+    i_ = it - pi->m.begin();
+    end_cv = (ite == pi->m.end()) ? size_type(-1) : ite->first;
+    gen_ = pi->generation;
     next();
   }
 
@@ -1068,8 +1068,9 @@ namespace getfem {
         // dal::bit_vector new_cts;
         for (size_type i=0; i < ipts.size(); ++i) {
           if (ipts[i] >= pts.size() && !ptdone[ipts[i]]) { 
-            base_node &P = m.points()[ipts[i]];
+            base_node P = m.points()[ipts[i]];
             multi_constraint_projection(P, cts);
+            m.points().set_node(ipts[i], P);
             // (*dist)(P, new_cts);
           }
         }
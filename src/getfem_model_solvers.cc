@@ -36,6 +36,89 @@ namespace getfem {
                                  model_complex_plain_vector>(md);
   }
 
+  void rigid_body_modes(const mesh_fem &mf, base_matrix &B) {
+    size_type nbd = mf.nb_basic_dof(), Q = mf.get_qdim();
+    size_type N = mf.linked_mesh().dim();
+    size_type nm = Q;
+    if (Q == N && N == 2) nm = 3;
+    if (Q == N && N == 3) nm = 6;
+    base_matrix Bb(nbd, nm);
+
+    // Rotations around the center of the dofs, for a better conditioning.
+    base_node c(N);
+    for (size_type d = 0; d < nbd; ++d) c += mf.point_of_basic_dof(d);
+    if (nbd) c /= scalar_type(nbd);
+
+    for (size_type d = 0; d < nbd; ++d) {
+      size_type k = mf.basic_dof_qdim(d);
+      Bb(d, k) = scalar_type(1);
+      if (nm > Q) {
+        base_node x = mf.point_of_basic_dof(d) - c;
+        // Rotation around the z axis, (-y, x, 0).
+        if (k == 0) Bb(d, Q) = -x[1]; else if (k == 1) Bb(d, Q) = x[0];
+        if (N == 3) {
+          // Rotations around the x axis, (0, -z, y), and the y axis,
+          // (z, 0, -x).
+          if (k == 1) Bb(d, 4) = -x[2]; else if (k == 2) Bb(d, 4) = x[1];
+          if (k == 0) Bb(d, 5) = x[2]; else if (k == 2) Bb(d, 5) = -x[0];
+        }
+      }
+    }
+
+    gmm::resize(B, mf.nb_dof(), nm);
+    if (mf.is_reduced())
+      for (size_type j = 0; j < nm; ++j)
+        gmm::mult(mf.reduction_matrix(), gmm::mat_col(Bb, j),
+                  gmm::mat_col(B, j));
+    else
+      gmm::copy(Bb, B);
+  }
+
+  void model_near_nullspace(const model &md, base_matrix &B,
+                            size_type &block_size) {
+    size_type nbdof = md.nb_dof(), nm = 1, nbvar = 0;
+    model::varnamelist vl;
+    md.variable_list(vl);
+    std::vector<base_matrix> Bv;
+    std::vector<gmm::sub_interval> Iv;
+    const mesh_fem *mf1 = 0;
+    for (const std::string &name : vl) {
+      if (md.is_true_data(name) || md.is_affine_dependent_variable(name)
+          || md.is_disabled_variable(name)) continue;
+      ++nbvar;
+      const mesh_fem *mf = md.pmesh_fem_of_variable(name);
+      // Multipliers and filtered variables are defined on a
+      // partial_mesh_fem and are left out.
+      if (!mf || dynamic_cast<const partial_mesh_fem *>(mf)) continue;
+      const gmm::sub_interval &I = md.interval_of_variable(name);
+      Bv.push_back(base_matrix());
+      rigid_body_modes(*mf, Bv.back());
+      if (gmm::mat_nrows(Bv.back()) != I.size())
+        { Bv.pop_back(); continue; }
+      Iv.push_back(I);
+      nm = std::max(nm, gmm::mat_ncols(Bv.back()));
+      mf1 = mf;
+    }
+
+    gmm::resize(B, nbdof, nm); gmm::clear(B);
+    for (size_type i = 0; i < Bv.size(); ++i) {
+      gmm::sub_interval J(0, gmm::mat_ncols(Bv[i]));
+      gmm::copy(Bv[i], gmm::sub_matrix(B, Iv[i], J));
+    }
+
+    // Nodal blocks, if the components of the only variable are numbered
+    // node by node.
+    block_size = 1;
+    if (nbvar == 1 && Bv.size() == 1 && Iv[0].size() == nbdof
+        && !(mf1->is_reduced())) {
+      size_type Q = mf1->get_qdim();
+      bool interleaved = (nbdof % Q == 0);
+      for (size_type d = 0; d < nbdof && interleaved; ++d)
+        if (mf1->basic_dof_qdim(d) != d % Q) interleaved = false;
+      if (interleaved) block_size = Q;
+    }
+  }
+
   void default_newton_line_search::init_search(double r, size_t git, double) {
     alpha_min_ratio = 0.9;
     alpha_min = 1e-10;
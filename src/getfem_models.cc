@@ -37,6 +37,10 @@ namespace getfem {
     is_linear_ = is_symmetric_ = is_coercive_ = true;
     leading_dim = 0;
     time_integration = 0; init_step = false; time_step = scalar_type(1);
+    colored_parallel_assembly_ = false;
+    reuse_tangent_matrix_pattern_ = false;
+    atomic_residual_assembly_ = ge_atomic_residual = false;
+    sum_factorization_ = false;
     add_interpolate_transformation
       ("neighbour_elt", interpolate_transformation_neighbour_instance());
   }
@@ -441,7 +445,7 @@ namespace getfem {
                 if (generic_expressions.size()) {
                   GMM_TRACE2("Generic assembly for actualize sizes");
                   {
-                    gmm::clear(rTM);
+                    gmm::clear(rTM); ge_pattern_signature.clear();
                     accumulated_distro<decltype(rTM)>  distro_rTM(rTM);
                     GETFEM_OMP_PARALLEL(
                         ga_workspace workspace(*this);
@@ -883,10 +887,11 @@ namespace getfem {
   void model::add_macro(const std::string &name, const std::string &expr) {
     check_name_validity(name.substr(0, name.find("(")));
     macro_dict.add_macro(name, expr);
+    reset_generic_workspaces();
   }
 
   void model::del_macro(const std::string &name)
-  { macro_dict.del_macro(name); }
+  { macro_dict.del_macro(name); reset_generic_workspaces(); }
 
   void model::delete_brick(size_type ib) {
      GMM_ASSERT1(valid_bricks[ib], "Inexistent brick");
@@ -1973,6 +1978,7 @@ namespace getfem {
       ms.insert(&(mf->linked_mesh()));
     }
     variable_groups[group_name] = nl;
+    reset_generic_workspaces();
   }
 
   void model::add_assembly_assignments(const std::string &varname,
@@ -2264,6 +2270,218 @@ namespace getfem {
 
 
 
+  std::string model::generic_expressions_signature() const {
+    std::stringstream sig;
+    sig << this << ";" << nb_dof() << ";" << ge_workspaces.num_threads()
+        << ";" << colored_parallel_assembly_ << ";";
+    // "timestep" is replaced by its value in the analysed expressions
+    sig.write(reinterpret_cast<const char *>(&time_step), sizeof(scalar_type));
+    sig << ";";
+    for (const auto &v : variables) {
+      const var_description &vd = v.second;
+      sig << v.first << ":" << vd.is_variable << vd.is_disabled
+          << vd.is_affine_dependent << ":" << vd.I.first() << ":"
+          << vd.I.last() << ":" << vd.qdims << ":" << vd.size() << ":";
+      if (vd.is_fem_dofs)
+        sig << vd.passociated_mf() << ":" << vd.mf->version_number();
+      if (vd.imd)
+        sig << vd.imd << ":" << vd.imd->version_number();
+      sig << ";";
+    }
+    for (const auto &ge : generic_expressions) {
+      sig << ge.expr << "|" << &(ge.mim) << ":" << ge.mim.version_number()
+          << ":" << ge.region << ":" << ge.secondary_domain << ":";
+      // The content of the region is captured by the colored assembly.
+      const mesh &m = ge.mim.linked_mesh();
+      if (ge.region != mesh_region::all_convexes().id()
+          && m.has_region(ge.region))
+        sig << m.region(ge.region).version_number();
+      sig << ";";
+    }
+    for (const auto &ad : assignments)
+      sig << ad.varname << "=" << ad.expr << "|" << ad.region << ":"
+          << ad.order << ":" << ad.before << ";";
+    return sig.str();
+  }
+
+  size_type model::nb_generic_expressions_compilations() const {
+    size_type nb = 0;
+    for (size_type i = 0; i < ge_workspaces.num_threads(); ++i) {
+      if (ge_workspaces(i))
+        nb += ge_workspaces(i)->nb_compiled_program_misses();
+      for (const auto &pworkspace : ge_colored_workspaces(i))
+        if (pworkspace) nb += pworkspace->nb_compiled_program_misses();
+    }
+    return nb;
+  }
+
+  // Greedy coloring of the elements of the regions of the generic
+  // expressions such that two elements of the same color do not share any
+  // dof of a test function. Returns false if the colored parallel assembly
+  // cannot be applied to the generic expressions of the model.
+  bool model::color_generic_expressions_elements() const {
+    ge_colored_regions.clear();
+    if (assignments.size() || generic_expressions.empty()) return false;
+
+    const mesh &m = generic_expressions.front().mim.linked_mesh();
+    for (const auto &ge : generic_expressions)
+      if (&(ge.mim.linked_mesh()) != &m || ge.secondary_domain.size())
+        return false;
+
+    // The test functions are known only after the derivation.
+    ga_workspace workspace(*this);
+    for (const auto &ge : generic_expressions)
+      workspace.add_expression(ge.expr, ge.mim, ge.region, 2);
+
+    std::set<std::string> test_vars;
+    for (size_type i = 0; i < workspace.nb_trees(); ++i) {
+      const ga_workspace::tree_description &td = workspace.tree_info(i);
+      if (td.interpolate_name_test1.size() || td.interpolate_name_test2.size()
+          || td.secondary_domain.size() || td.varname_interpolation.size())
+        return false;
+      if (td.name_test1.size()) test_vars.insert(td.name_test1);
+      if (td.name_test2.size()) test_vars.insert(td.name_test2);
+    }
+
+    std::vector<std::pair<const mesh_fem *, size_type> > test_fems;
+    for (const std::string &name : test_vars) {
+      VAR_SET::const_iterator it = variables.find(name);
+      if (it == variables.end()) return false; // group of variables
+      const var_description &vd = it->second;
+      if (vd.is_fem_dofs) {
+        const mesh_fem *mf = vd.passociated_mf();
+        if (mf->is_reduced() || &(mf->linked_mesh()) != &m) return false;
+        test_fems.push_back(std::make_pair(mf,
+                                           interval_of_variable(name).first()));
+      } else if (!(vd.imd)) // The dofs of an im_data are local to an element
+        return false;
+    }
+
+    dal::bit_vector cvs;
+    for (const auto &ge : generic_expressions) {
+      mesh_region rg(ge.region);
+      for (mr_visitor v(rg, m); !v.finished(); ++v) cvs.add(v.cv());
+    }
+
+    std::vector<size_type> cv_color(m.nb_allocated_convex(), 0), dofs;
+    std::vector<dal::bit_vector> color_dofs;
+    for (dal::bv_visitor cv(cvs); !cv.finished(); ++cv) {
+      dofs.resize(0);
+      for (const auto &tf : test_fems)
+        if (tf.first->convex_index().is_in(cv))
+          for (size_type dof : tf.first->ind_basic_dof_of_element(cv))
+            dofs.push_back(dof + tf.second);
+      size_type c = 0;
+      for (; c < color_dofs.size(); ++c) {
+        bool is_free = true;
+        for (size_type dof : dofs)
+          if (color_dofs[c].is_in(dof)) { is_free = false; break; }
+        if (is_free) break;
+      }
+      if (c == color_dofs.size()) color_dofs.push_back(dal::bit_vector());
+      for (size_type dof : dofs) color_dofs[c].add(dof);
+      cv_color[cv] = c;
+    }
+
+    ge_colored_regions.resize(color_dofs.size());
+    for (auto &regions : ge_colored_regions)
+      regions.resize(generic_expressions.size());
+    size_type i = 0;
+    for (const auto &ge : generic_expressions) {
+      mesh_region rg(ge.region);
+      for (mr_visitor v(rg, m); !v.finished(); ++v) {
+        mesh_region &crg = ge_colored_regions[cv_color[v.cv()]][i];
+        if (v.is_face()) crg.add(v.cv(), v.f()); else crg.add(v.cv());
+      }
+      ++i;
+    }
+    return true;
+  }
+
+  // Symbolic assembly: inserts in the tangent matrix, with a zero value, the
+  // entries coupling the dofs of the test functions of each element of the
+  // generic expressions. The rows of each column are obtained by a union
+  // over the elements containing the corresponding dof.
+  void model::add_generic_expressions_pattern() const {
+    ga_workspace workspace(*this);
+    for (const auto &ge : generic_expressions)
+      workspace.add_expression(ge.expr, ge.mim, ge.region, 2,
+                               ge.secondary_domain);
+
+    // Rows, then columns, of the elementary matrices.
+    std::vector<size_type> elt_dofs, elt_start(1, 0), elt_nbrows;
+    for (size_type i = 0; i < workspace.nb_trees(); ++i) {
+      const ga_workspace::tree_description &td = workspace.tree_info(i);
+      if (td.order != 2 || td.interpolate_name_test1.size()
+          || td.interpolate_name_test2.size() || td.secondary_domain.size()
+          || td.varname_interpolation.size())
+        continue; // Learned by the first numeric assembly.
+      VAR_SET::const_iterator it1 = variables.find(td.name_test1);
+      VAR_SET::const_iterator it2 = variables.find(td.name_test2);
+      if (it1 == variables.end() || it2 == variables.end()
+          || !(it1->second.is_fem_dofs) || !(it2->second.is_fem_dofs))
+        continue;
+      const mesh_fem *mf1 = it1->second.passociated_mf();
+      const mesh_fem *mf2 = it2->second.passociated_mf();
+      if (mf1->is_reduced() || mf2->is_reduced()
+          || &(mf1->linked_mesh()) != td.m || &(mf2->linked_mesh()) != td.m)
+        continue;
+      size_type ifirst1 = interval_of_variable(td.name_test1).first();
+      size_type ifirst2 = interval_of_variable(td.name_test2).first();
+
+      for (mr_visitor v(*(td.rg), *(td.m)); !v.finished(); ++v) {
+        size_type cv = v.cv();
+        if (!(mf1->convex_index().is_in(cv)) ||
+            !(mf2->convex_index().is_in(cv))) continue;
+        for (size_type dof : mf1->ind_basic_dof_of_element(cv))
+          elt_dofs.push_back(dof + ifirst1);
+        elt_nbrows.push_back(elt_dofs.size() - elt_start.back());
+        for (size_type dof : mf2->ind_basic_dof_of_element(cv))
+          elt_dofs.push_back(dof + ifirst2);
+        elt_start.push_back(elt_dofs.size());
+      }
+    }
+
+    // Elements containing each column.
+    size_type nbd = gmm::mat_ncols(rTM), nbe = elt_nbrows.size();
+    std::vector<size_type> col_start(nbd+1, 0), col_elts;
+    for (size_type e = 0; e < nbe; ++e)
+      for (size_type k = elt_start[e] + elt_nbrows[e]; k < elt_start[e+1]; ++k)
+        ++(col_start[elt_dofs[k]+1]);
+    for (size_type j = 0; j < nbd; ++j) col_start[j+1] += col_start[j];
+    col_elts.resize(col_start[nbd]);
+    std::vector<size_type> col_pos(col_start.begin(), col_start.end()-1);
+    for (size_type e = 0; e < nbe; ++e)
+      for (size_type k = elt_start[e] + elt_nbrows[e]; k < elt_start[e+1]; ++k)
+        col_elts[col_pos[elt_dofs[k]]++] = e;
+
+    std::vector<size_type> marker(gmm::mat_nrows(rTM), size_type(-1)), rows;
+    std::vector<gmm::elt_rsvector_<scalar_type> > merged;
+    for (size_type j = 0; j < nbd; ++j) {
+      rows.resize(0);
+      for (size_type k = col_start[j]; k < col_start[j+1]; ++k) {
+        size_type e = col_elts[k];
+        for (size_type l = elt_start[e]; l < elt_start[e]+elt_nbrows[e]; ++l)
+          if (marker[elt_dofs[l]] != j)
+            { marker[elt_dofs[l]] = j; rows.push_back(elt_dofs[l]); }
+      }
+      if (rows.empty()) continue;
+      std::sort(rows.begin(), rows.end());
+
+      // Merge with the entries already in the column (other bricks).
+      std::vector<gmm::elt_rsvector_<scalar_type> > &col = rTM[j];
+      merged.resize(0);
+      auto itc = col.begin(), itce = col.end();
+      for (size_type r : rows) {
+        for (; itc != itce && itc->c < r; ++itc) merged.push_back(*itc);
+        if (itc != itce && itc->c == r) merged.push_back(*itc++);
+        else merged.push_back(gmm::elt_rsvector_<scalar_type>(r));
+      }
+      for (; itc != itce; ++itc) merged.push_back(*itc);
+      col.assign(merged.begin(), merged.end());
+    }
+  }
+
   void model::assembly(build_version version) {
 
 #if GETFEM_PARA_LEVEL > 1
@@ -2276,7 +2494,14 @@ namespace getfem {
       if (version & BUILD_RHS) gmm::clear(crhs);
     }
     else {
-      if (version & BUILD_MATRIX) gmm::clear(rTM);
+      if (version & BUILD_MATRIX) {
+        if (reuse_tangent_matrix_pattern_) {
+          for (size_type j = 0; j < gmm::mat_ncols(rTM); ++j)
+            for (gmm::elt_rsvector_<scalar_type> &ev : rTM[j])
+              ev.e = scalar_type(0);
+        } else
+          gmm::clear(rTM);
+      }
       if (version & BUILD_RHS) gmm::clear(rrhs);
     }
     clear_dof_constraints();
@@ -2563,8 +2788,70 @@ namespace getfem {
       model_real_plain_vector residual;
       if (version & BUILD_RHS) gmm::resize(residual, gmm::vect_size(rrhs));
 
+      // The expressions are analysed and derived only once per partition,
+      // the workspaces are reused while the signature is unchanged.
+      std::string signature = generic_expressions_signature();
+      ge_workspaces.on_thread_update();
+      ge_colored_workspaces.on_thread_update();
+      if (signature != ge_workspaces_signature) {
+        for (size_type i = 0; i < ge_workspaces.num_threads(); ++i) {
+          ge_workspaces(i).reset();
+          ge_colored_workspaces(i).clear();
+        }
+        ge_colored_regions.clear();
+        if (colored_parallel_assembly_ && !is_complex()
+            && ge_workspaces.num_threads() > 1)
+          color_generic_expressions_elements();
+        ge_atomic_residual = atomic_residual_assembly_
+          && ge_workspaces.num_threads() > 1;
+        for (const auto &v : variables)
+          if (v.second.is_fem_dofs && v.second.passociated_mf()->is_reduced())
+            ge_atomic_residual = false;
+        ge_workspaces_signature = signature;
+      }
+
+      if (reuse_tangent_matrix_pattern_ && !is_complex()
+          && (version & BUILD_MATRIX) && signature != ge_pattern_signature) {
+        add_generic_expressions_pattern();
+        ge_pattern_signature = signature;
+      }
+
+      // Colored strategy: the threads share the tangent matrix and the
+      // residual, the elements of a same color having no common dof.
+      for (size_type c = 0; c < ge_colored_regions.size(); ++c) {
+        GETFEM_OMP_PARALLEL(
+            std::vector<std::shared_ptr<ga_workspace> > &workspaces
+              = ge_colored_workspaces.thrd_cast();
+            if (workspaces.size() != ge_colored_regions.size())
+              workspaces.resize(ge_colored_regions.size());
+            std::shared_ptr<ga_workspace> &pworkspace = workspaces[c];
+            if (!pworkspace) {
+              pworkspace = std::make_shared<ga_workspace>(*this);
+              pworkspace->set_sum_factorization(sum_factorization_);
+              size_type i = 0;
+              for (const auto &ge : generic_expressions)
+                pworkspace->add_expression(ge.expr, ge.mim,
+                                           ge_colored_regions[c][i++], 2);
+            }
+
+            if (version & BUILD_RHS) {
+              pworkspace->set_assembled_vector(residual);
+              pworkspace->assembly(1);
+            }
+            if (version & BUILD_MATRIX) {
+              pworkspace->set_assembled_matrix(rTM);
+              pworkspace->assembly(2);
+            }
+        )
+      }
+
+      if (ge_colored_regions.empty())
       { //need parentheses for constructor/destructor semantics of distro
-        accumulated_distro<decltype(rrhs)> residual_distributed(residual);
+        std::unique_ptr<accumulated_distro<decltype(rrhs)>>
+          residual_distributed;
+        if (!ge_atomic_residual)
+          residual_distributed
+            = std::make_unique<accumulated_distro<decltype(rrhs)>>(residual);
         accumulated_distro<decltype(rTM)>  tangent_matrix_distributed(rTM);
 
         /*running the assembly in parallel*/
@@ -2574,21 +2861,31 @@ namespace getfem {
             if (version & BUILD_MATRIX)
               GMM_TRACE2("Global generic assembly tangent term");
 
-            ga_workspace workspace(*this);
+            std::shared_ptr<ga_workspace> &pworkspace
+              = ge_workspaces.thrd_cast();
+            if (!pworkspace) {
+              pworkspace = std::make_shared<ga_workspace>(*this);
+              pworkspace->set_sum_factorization(sum_factorization_);
 
-            for (const auto &ad : assignments)
-              workspace.add_assignment_expression
-                (ad.varname, ad.expr, ad.region, ad.order, ad.before);
+              for (const auto &ad : assignments)
+                pworkspace->add_assignment_expression
+                  (ad.varname, ad.expr, ad.region, ad.order, ad.before);
 
-            for (const auto &ge : generic_expressions)
-              workspace.add_expression(ge.expr, ge.mim, ge.region,
-                                       2, ge.secondary_domain);
+              for (const auto &ge : generic_expressions)
+                pworkspace->add_expression(ge.expr, ge.mim, ge.region,
+                                           2, ge.secondary_domain);
+            }
+            ga_workspace &workspace = *pworkspace;
 
             if (version & BUILD_RHS) {
               if (is_complex()) {
                 GMM_ASSERT1(false, "to be done");
               } else {
-                workspace.set_assembled_vector(residual_distributed);
+                workspace.set_atomic_vector_assembly(ge_atomic_residual);
+                if (ge_atomic_residual)
+                  workspace.set_assembled_vector(residual);
+                else
+                  workspace.set_assembled_vector(*residual_distributed);
                 workspace.assembly(1);
               }
             }
@@ -22,6 +22,7 @@
 #include "getfem/dal_singleton.h"
 #include "getfem/getfem_locale.h"
 #include "getfem/getfem_omp.h"
+#include "getfem/getfem_mesh_region.h"
 
 #ifdef GETFEM_HAS_OPENMP
   #include <thread>
@@ -330,6 +331,7 @@ namespace getfem{
     #ifdef GETFEM_ON_WIN
       _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
     #endif
+    mesh_region::compact_unsorted_regions();
   }
 
   void parallel_boilerplate::run_lambda(std::function<void(void)> lambda){
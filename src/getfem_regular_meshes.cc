@@ -219,7 +219,7 @@ namespace getfem
     size_type N = nsubdiv.size();
     for (dal::bv_visitor ip(m.points().index()); !ip.finished(); ++ip) {
       bool is_border = false;
-      base_node& P = m.points()[ip];
+      base_node P = m.points()[ip];
       for (size_type i=0; i < N; ++i) {
         if (gmm::abs(P[i]) < 1e-10 || gmm::abs(P[i]-1.) < 1e-10)
           is_border = true;
@@ -230,6 +230,7 @@ namespace getfem
         for (size_type i=0; i < N; ++i)
           P[i] += 0.*(double(1)/double(nsubdiv[i]* pgt->complexity()))
             * gmm::random(double());
+        m.points().set_node(ip, P);
       }
     }
   }
@@ -427,7 +428,7 @@ namespace getfem
       }
       j = size_type(0);
       for (dal::bv_visitor pt(mm[i].points().index()); !pt.finished(); ++pt, ++j)
-          mm[i].points()[pt] = pts[j];
+          mm[i].points().set_node(pt, pts[j]);
 
       base_small_vector trsl(N);
       trsl[i] = core_ratio;
@@ -473,7 +474,7 @@ namespace getfem
     }
     j = size_type(0);
     for (dal::bv_visitor pt(m.points().index()); !pt.finished(); ++pt, ++j)
-      m.points()[pt] = pts[j];
+      m.points().set_node(pt, pts[j]);
     m.points().resort();
 
     size_type symmetries(PARAM.int_value("SYMMETRIES"));
@@ -576,7 +577,7 @@ namespace getfem
 
     j = size_type(0);
     for (dal::bv_visitor pt(m0.points().index()); !pt.finished(); ++pt, ++j)
-      m0.points()[pt] = pts[j];
+      m0.points().set_node(pt, pts[j]);
     m0.points().resort();
 
     base_matrix M(N,N);
@@ -252,20 +252,35 @@ namespace gmm {
     std::vector<T> rhs;
     std::vector<T> sol;
     void build_with(const gmm::csc_matrix<T> &A, int permc_spec);
+    int factorize(const gmm::csc_matrix<T> &A, int permc_spec,
+                  bool same_pattern, bool cond, double &rcond_);
     void solve(int transp);
   };
 
   template <typename T>
   void SuperLU_factor_impl<T>::build_with(const gmm::csc_matrix<T> &A, int permc_spec) {
+    double rcond;
+    int info = factorize(A, permc_spec, false, false, rcond);
+    GMM_ASSERT1(info == 0, "SuperLU solve failed: info=" << info);
+  }
+
+  template <typename T>
+  int SuperLU_factor_impl<T>::factorize(const gmm::csc_matrix<T> &A,
+                                        int permc_spec, bool same_pattern,
+                                        bool cond, double &rcond_) {
     /*
      * Get column permutation vector perm_c[], according to permc_spec:
      *   permc_spec = 0: use the natural ordering 
      *   permc_spec = 1: use minimum degree ordering on structure of A'*A
      *   permc_spec = 2: use minimum degree ordering on structure of A'+A
      *   permc_spec = 3: use approximate minimum degree column ordering
+     * If same_pattern is true, the column permutation of the previous
+     * factorization is reused (SuperLU SamePattern option).
      */
-    free_supermatrix();
     int n = int(mat_nrows(A)), m = int(mat_ncols(A)), info = 0;
+    same_pattern = same_pattern && is_init && int(perm_c.size()) == n;
+    free_supermatrix();
+    is_init = false;
 
     rhs.resize(m); sol.resize(m);
     gmm::clear(rhs);
@@ -277,12 +292,13 @@ namespace gmm {
     set_default_options(&options);
     options.ColPerm = NATURAL;
     options.PrintStat = NO;
-    options.ConditionNumber = NO;
+    options.ConditionNumber = cond ? YES : NO;
     switch (permc_spec) {
       case 1 : options.ColPerm = MMD_ATA; break;
       case 2 : options.ColPerm = MMD_AT_PLUS_A; break;
       case 3 : options.ColPerm = COLAMD; break;
     }
+    if (same_pattern) options.Fact = SamePattern;
     StatInit(&stat);
     
     Create_CompCol_Matrix(&SA, m, n, nz, const_cast<T*>(&A.pr[0]),
@@ -297,7 +313,7 @@ namespace gmm {
     equed = 'B';
     Rscale.resize(m); Cscale.resize(n); etree.resize(n);
     ferr.resize(1); berr.resize(1);
-    R recip_pivot_gross, rcond;
+    R recip_pivot_gross, rcond(0);
     perm_r.resize(m); perm_c.resize(n);
     memory_used = SuperLU_gssvx(&options, &SA, &perm_c[0], &perm_r[0], 
                                 &etree[0] /* output */, &equed /* output        */, 
@@ -320,16 +336,19 @@ namespace gmm {
     Create_Dense_Matrix(&SB, m, 1, &rhs[0], m);
     Create_Dense_Matrix(&SX, m, 1, &sol[0], m);
     StatFree(&stat);
-    
-    GMM_ASSERT1(info != -333333333, "SuperLU was cancelled.");
-    GMM_ASSERT1(info == 0, "SuperLU solve failed: info=" << info);
     is_init = true;
+    rcond_ = rcond;
+
+    GMM_ASSERT1(info != -333333333, "SuperLU was cancelled.");
+    GMM_ASSERT1(info >= 0, "SuperLU solve failed: info=" << info);
+    return info;
   }
 
   template <typename T> 
   void SuperLU_factor_impl<T>::solve(int transp) {
     options.Fact = FACTORED;
     options.IterRefine = NOREFINE;
+    options.ConditionNumber = NO; // A is not kept after the factorization
     switch (transp) {
       case SuperLU_factor<T>::LU_NOTRANSP: options.Trans = NOTRANS; break;
       case SuperLU_factor<T>::LU_TRANSP: options.Trans = TRANS; break;
@@ -363,6 +382,14 @@ namespace gmm {
     ((SuperLU_factor_impl<T>*)impl.get())->build_with(A,permc_spec);
   }
 
+  template<typename T> int
+  SuperLU_factor<T>::factorize(const gmm::csc_matrix<T> &A,
+                               bool same_pattern, bool cond, double &rcond_,
+                               int permc_spec) {
+    return ((SuperLU_factor_impl<T>*)impl.get())
+      ->factorize(A, permc_spec, same_pattern, cond, rcond_);
+  }
+
   template<typename T> void
   SuperLU_factor<T>::solve(int transp) const {
     ((SuperLU_factor_impl<T>*)impl.get())->solve(transp);
@@ -247,8 +247,9 @@ namespace getfem
     bgeot::node_tab node_tab_copy(pts);
     this->pts.clear();
     for(size_type pt = 0; pt < node_tab_copy.size(); ++pt){
-      node_tab_copy[pt].resize(3);
-      this->pts.add_node(node_tab_copy[pt]);
+      base_node P = node_tab_copy[pt];
+      P.resize(3);
+      this->pts.add_node(P);
     }
 
     for(size_type i = 0; i < this->convex_tab.size(); ++i){
@@ -251,6 +251,105 @@ namespace gmm {
 
 
 
+  /** MUMPS instance keeping the analysis and the factorization of a
+   *  matrix (centralized on the process 0), to solve several systems with
+   *  the same matrix. The analysis is redone only if the sparsity pattern
+   *  of the factorized matrix changes and the factorization is skipped if
+   *  the matrix is unchanged.
+   */
+  template <typename T> class MUMPS_factor {
+    typedef typename mumps_interf<T>::value_type MUMPS_T;
+    typename mumps_interf<T>::MUMPS_STRUC_C id;
+    std::vector<int> irn, jcn;
+    std::vector<T> a, rhs;
+    bool sym, analyzed, factorized;
+    int rank;
+    size_type nb_anal, nb_fact;
+
+  public :
+    /** Factorize A. Returns false if A is singular. */
+    template <typename MAT> bool factorize(const MAT &A) {
+      GMM_ASSERT2(gmm::mat_nrows(A) == gmm::mat_ncols(A), "Non-square matrix");
+      int changes = 2; /* 0: same matrix, 1: same pattern, 2: new pattern */
+      if (rank == 0) {
+        ij_sparse_matrix<T> AA(A, sym);
+        if (analyzed && id.n == int(gmm::mat_nrows(A))
+            && AA.irn == irn && AA.jcn == jcn)
+          changes = (factorized && AA.a == a) ? 0 : 1;
+        irn.swap(AA.irn); jcn.swap(AA.jcn); a.swap(AA.a);
+        id.n = int(gmm::mat_nrows(A));
+        id.nz = int(irn.size());
+        id.irn = &(irn[0]);
+        id.jcn = &(jcn[0]);
+        id.a = (MUMPS_T*)(&(a[0]));
+      }
+#ifdef GMM_USES_MPI
+      MPI_Bcast(&changes, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+      if (changes == 0) return true;
+      factorized = false;
+      if (changes == 2) {
+        id.job = 1;
+        mumps_interf<T>::mumps_c(id);
+        ++nb_anal;
+        analyzed = mumps_error_check(id);
+        if (!analyzed) return false;
+      }
+      id.job = 2;
+      mumps_interf<T>::mumps_c(id);
+      ++nb_fact;
+      factorized = mumps_error_check(id);
+      return factorized;
+    }
+
+    /** Solve with the last factorized matrix. */
+    template <typename VECTX, typename VECTB>
+    bool solve(const VECTX &X_, const VECTB &B) {
+      GMM_ASSERT1(factorized, "No factorized matrix");
+      VECTX &X = const_cast<VECTX &>(X_);
+      gmm::resize(rhs, gmm::vect_size(B)); gmm::copy(B, rhs);
+      if (rank == 0) id.rhs = (MUMPS_T*)(&(rhs[0]));
+      id.job = 3;
+      mumps_interf<T>::mumps_c(id);
+      bool ok = mumps_error_check(id);
+#ifdef GMM_USES_MPI
+      MPI_Bcast(&(rhs[0]),int(rhs.size()),gmm::mpi_type(T()),0,MPI_COMM_WORLD);
+#endif
+      gmm::copy(rhs, X);
+      return ok;
+    }
+
+    bool is_factorized() const { return factorized; }
+    /** Number of analyses and of factorizations performed. */
+    size_type nb_analyses() const { return nb_anal; }
+    size_type nb_factorizations() const { return nb_fact; }
+
+    MUMPS_factor(bool sym_ = false)
+      : sym(sym_), analyzed(false), factorized(false), rank(0),
+        nb_anal(0), nb_fact(0) {
+#ifdef GMM_USES_MPI
+      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+      id.job = -1; // JOB_INIT
+      id.par = 1;
+      id.sym = sym ? 2 : 0;
+      id.comm_fortran = -987654; // USE_COMM_WORLD
+      mumps_interf<T>::mumps_c(id);
+      id.ICNTL(1) = -1; // output stream for error messages
+      id.ICNTL(2) = -1; // output stream for other messages
+      id.ICNTL(3) = -1; // output stream for global information
+      id.ICNTL(4) = 0;  // verbosity level
+      id.ICNTL(14) += 80; // same workspace boost as in MUMPS_solve
+    }
+    ~MUMPS_factor() {
+      id.job = -2; // JOB_END
+      mumps_interf<T>::mumps_c(id);
+    }
+    MUMPS_factor(const MUMPS_factor &) = delete;
+    MUMPS_factor &operator =(const MUMPS_factor &) = delete;
+  };
+
+
   /** MUMPS solve interface for distributed matrices 
    *  Works only with sparse or skyline matrices
    */
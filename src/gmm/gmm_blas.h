@@ -51,6 +51,78 @@ namespace gmm {
   /* ******************************************************************** */
 
 
+  /* ******************************************************************** */
+  /*		Thread partition of the basic kernels          		  */
+  /* ******************************************************************** */
+
+#ifndef GMM_OMP_MIN_SIZE
+# define GMM_OMP_MIN_SIZE 16384
+#endif
+
+  /** Number of slices in which a kernel acting on n rows, columns or
+      vector components is split. It is always 1 when gmm is compiled
+      without GMM_USES_OPENMP, for n < GMM_OMP_MIN_SIZE and inside an
+      already running parallel region.
+  */
+  inline size_type nb_omp_slices(size_type n) {
+#ifdef GMM_USES_OPENMP
+    if (n < GMM_OMP_MIN_SIZE || omp_in_parallel()) return 1;
+    return size_type(omp_get_max_threads());
+#else
+    GMM_NOPERATION(n);
+    return 1;
+#endif
+  }
+
+  /** Call f(s, i0, i1) for each slice s of the interval [0, n) split in
+      ns contiguous slices, one thread per slice. An exception thrown by
+      f is rethrown after the parallel region. */
+  template <typename F>
+  void omp_slices(size_type n, size_type ns, const F &f) {
+#ifdef GMM_USES_OPENMP
+    if (ns > 1) {
+      int nns = int(ns);
+      std::exception_ptr error;
+      #pragma omp parallel for num_threads(nns) schedule(static, 1)
+      for (int s = 0; s < nns; ++s) {
+	try {
+	  f(size_type(s), (n * size_type(s)) / ns, (n * size_type(s+1)) / ns);
+	} catch (...) {
+	  #pragma omp critical(gmm_omp_slices)
+	  if (!error) error = std::current_exception();
+	}
+      }
+      if (error) std::rethrow_exception(error);
+      return;
+    }
+#endif
+    GMM_NOPERATION(ns);
+    f(size_type(0), size_type(0), n);
+  }
+
+  /** The dense vector kernels (vect_sp, vect_norm2 and add) are split
+      between threads only while an omp_vector_kernels object lives in the
+      calling thread, as in the iterative solvers (cg, gmres, bicgstab,
+      qmr). Elsewhere, their sums do not depend on the number of threads.
+  */
+  struct omp_vector_kernels {
+    bool previous;
+    static bool &enabled(void) {
+#ifdef GMM_USES_OPENMP
+      static thread_local bool b = false;
+#else
+      static bool b = false;
+#endif
+      return b;
+    }
+    omp_vector_kernels(void) : previous(enabled()) { enabled() = true; }
+    ~omp_vector_kernels() { enabled() = previous; }
+  };
+
+  /** Number of slices of a dense vector kernel on n components. */
+  inline size_type nb_omp_vector_slices(size_type n)
+  { return omp_vector_kernels::enabled() ? nb_omp_slices(n) : 1; }
+
   /* ******************************************************************** */
   /*		Miscellaneous                           		  */
   /* ******************************************************************** */
@@ -388,9 +460,23 @@ namespace gmm {
   typename strongest_numeric_type<typename std::iterator_traits<IT1>::value_type,
 				  typename std::iterator_traits<IT2>::value_type>::T
   vect_sp_dense_(IT1 it, IT1 ite, IT2 it2) {
-    typename strongest_numeric_type<typename std::iterator_traits<IT1>::value_type,
-      typename std::iterator_traits<IT2>::value_type>::T res(0);
-    for (; it != ite; ++it, ++it2) res += (*it) * (*it2);
+    typedef typename strongest_numeric_type<typename std::iterator_traits<IT1>
+      ::value_type, typename std::iterator_traits<IT2>::value_type>::T T;
+    T res(0);
+    size_type n = size_type(ite - it), ns = nb_omp_vector_slices(n);
+    if (ns > 1) {
+      std::vector<T> part(ns);
+      omp_slices(n, ns, [&](size_type s, size_type i0, size_type i1) {
+	T r(0);
+	IT2 it2s = it2 + i0;
+	for (IT1 it1 = it + i0, ite1 = it + i1; it1 != ite1; ++it1, ++it2s)
+	  r += (*it1) * (*it2s);
+	part[s] = r;
+      });
+      for (size_type s = 0; s < ns; ++s) res += part[s];
+    }
+    else
+      for (; it != ite; ++it, ++it2) res += (*it) * (*it2);
     return res;
   }
   
@@ -541,7 +627,14 @@ namespace gmm {
   template <typename V>
   typename number_traits<typename linalg_traits<V>::value_type>
   ::magnitude_type
-  vect_norm2_sqr(const V &v) {
+  vect_norm2_sqr(const V &v)
+  { return vect_norm2_sqr(v, typename linalg_traits<V>::storage_type()); }
+
+  ///@cond DOXY_SHOW_ALL_FUNCTIONS
+  template <typename V, typename ST>
+  typename number_traits<typename linalg_traits<V>::value_type>
+  ::magnitude_type
+  vect_norm2_sqr(const V &v, ST) {
     typedef typename linalg_traits<V>::value_type T;
     typedef typename number_traits<T>::magnitude_type R;
     auto it = vect_const_begin(v), ite = vect_const_end(v);
@@ -550,6 +643,31 @@ namespace gmm {
     return res;
   }
 
+  template <typename V>
+  typename number_traits<typename linalg_traits<V>::value_type>
+  ::magnitude_type
+  vect_norm2_sqr(const V &v, abstract_dense) {
+    typedef typename linalg_traits<V>::value_type T;
+    typedef typename number_traits<T>::magnitude_type R;
+    auto it = vect_const_begin(v), ite = vect_const_end(v);
+    size_type n = vect_size(v), ns = nb_omp_vector_slices(n);
+    R res(0);
+    if (ns > 1) {
+      std::vector<R> part(ns);
+      omp_slices(n, ns, [&](size_type s, size_type i0, size_type i1) {
+	R r(0);
+	for (auto it1 = it + i0, ite1 = it + i1; it1 != ite1; ++it1)
+	  r += gmm::abs_sqr(*it1);
+	part[s] = r;
+      });
+      for (size_type s = 0; s < ns; ++s) res += part[s];
+    }
+    else
+      for (; it != ite; ++it) res += gmm::abs_sqr(*it);
+    return res;
+  }
+  ///@endcond
+
   /** Euclidean norm of a vector. */
   template <typename V> inline
    typename number_traits<typename linalg_traits<V>::value_type>
@@ -1451,7 +1569,13 @@ namespace gmm {
 
   template <typename IT1, typename IT2, typename IT3>
     void add_full_(IT1 it1, IT2 it2, IT3 it3, IT3 ite) {
-    for (; it3 != ite; ++it3, ++it2, ++it1) *it3 = *it1 + *it2;
+    size_type n = size_type(ite - it3);
+    omp_slices(n, nb_omp_vector_slices(n),
+	       [&](size_type, size_type i0, size_type i1) {
+      IT1 it1s = it1 + i0; IT2 it2s = it2 + i0;
+      for (IT3 it = it3 + i0, ite3 = it3 + i1; it != ite3;
+	   ++it, ++it2s, ++it1s) *it = *it1s + *it2s;
+    });
   }
 
   template <typename IT1, typename IT2, typename IT3>
@@ -1540,8 +1664,14 @@ namespace gmm {
   template <typename L1, typename L2>
   void add(const L1& l1, L2& l2, abstract_dense, abstract_dense) {
     auto it1 = vect_const_begin(l1); 
-    auto it2 = vect_begin(l2), ite = vect_end(l2);
-    for (; it2 != ite; ++it2, ++it1) *it2 += *it1;
+    auto it2 = vect_begin(l2);
+    size_type n = vect_size(l2);
+    omp_slices(n, nb_omp_vector_slices(n),
+	       [&](size_type, size_type i0, size_type i1) {
+      auto it1s = it1 + i0;
+      for (auto it = it2 + i0, ite = it2 + i1; it != ite; ++it, ++it1s)
+	*it += *it1s;
+    });
   }
 
   template <typename L1, typename L2>
@@ -1697,19 +1827,59 @@ namespace gmm {
     }
   }
 
+  // The rows are split in slices, each one computed by a different thread.
   template <typename L1, typename L2, typename L3>
   void mult_by_row(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
-    typename linalg_traits<L3>::iterator it=vect_begin(l3), ite=vect_end(l3);
-    auto itr = mat_row_const_begin(l1); 
-    for (; it != ite; ++it, ++itr)
-      *it = vect_sp(linalg_traits<L1>::row(itr), l2,
-		    typename linalg_traits<L1>::storage_type(),
-		    typename linalg_traits<L2>::storage_type());
+    typename linalg_traits<L3>::iterator it3 = vect_begin(l3);
+    auto itr0 = mat_row_const_begin(l1);
+    size_type nr = mat_nrows(l1);
+    omp_slices(nr, nb_omp_slices(nr),
+	       [&](size_type, size_type i0, size_type i1) {
+      auto itr = itr0 + i0;
+      for (auto it = it3 + i0, ite = it3 + i1; it != ite; ++it, ++itr)
+	*it = vect_sp(linalg_traits<L1>::row(itr), l2,
+		      typename linalg_traits<L1>::storage_type(),
+		      typename linalg_traits<L2>::storage_type());
+    });
+  }
+
+  // Column oriented product l3 += l1*l2 split in slices of columns. Each
+  // thread accumulates the contribution of its columns in a private dense
+  // vector, avoiding write conflicts on l3, and the partial results are
+  // then summed up, again in parallel, by slices of rows. Returns false
+  // when nothing is done, i.e. for a serial execution or a sparse l3.
+  template <typename L1, typename L2, typename L3, typename ST> inline
+  bool mult_add_by_col_omp_(const L1&, const L2&, L3&, ST)
+  { return false; }
+
+  template <typename L1, typename L2, typename L3>
+  bool mult_add_by_col_omp_(const L1& l1, const L2& l2, L3& l3,
+			    abstract_dense) {
+    typedef typename linalg_traits<L3>::value_type T;
+    size_type nc = mat_ncols(l1), nr = mat_nrows(l1), ns = nb_omp_slices(nc);
+    if (ns < 2) return false;
+    std::vector<std::vector<T> > part(ns);
+    omp_slices(nc, ns, [&](size_type s, size_type j0, size_type j1) {
+      part[s].assign(nr, T(0));
+      for (size_type j = j0; j < j1; ++j)
+	add(scaled(mat_const_col(l1, j), l2[j]), part[s]);
+    });
+    typename linalg_traits<L3>::iterator it3 = vect_begin(l3);
+    omp_slices(nr, ns, [&](size_type, size_type i0, size_type i1) {
+      for (size_type s = 0; s < ns; ++s) {
+	auto itp = part[s].cbegin() + i0, itpe = part[s].cbegin() + i1;
+	for (auto it = it3 + i0; itp != itpe; ++itp, ++it) *it += *itp;
+      }
+    });
+    return true;
   }
 
   template <typename L1, typename L2, typename L3>
   void mult_by_col(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
     clear(l3);
+    if (mult_add_by_col_omp_(l1, l2, l3,
+			     typename linalg_traits<L3>::storage_type()))
+      return;
     size_type nc = mat_ncols(l1);
     for (size_type i = 0; i < nc; ++i)
       add(scaled(mat_const_col(l1, i), l2[i]), l3);
@@ -1820,14 +1990,22 @@ namespace gmm {
 
   template <typename L1, typename L2, typename L3>
   void mult_add_by_row(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
-    auto it=vect_begin(l3), ite=vect_end(l3);
-    auto itr = mat_row_const_begin(l1);
-    for (; it != ite; ++it, ++itr)
-      *it += vect_sp(linalg_traits<L1>::row(itr), l2);
+    auto it3 = vect_begin(l3);
+    auto itr0 = mat_row_const_begin(l1);
+    size_type nr = mat_nrows(l1);
+    omp_slices(nr, nb_omp_slices(nr),
+	       [&](size_type, size_type i0, size_type i1) {
+      auto itr = itr0 + i0;
+      for (auto it = it3 + i0, ite = it3 + i1; it != ite; ++it, ++itr)
+	*it += vect_sp(linalg_traits<L1>::row(itr), l2);
+    });
   }
 
   template <typename L1, typename L2, typename L3>
   void mult_add_by_col(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
+    if (mult_add_by_col_omp_(l1, l2, l3,
+			     typename linalg_traits<L3>::storage_type()))
+      return;
     size_type nc = mat_ncols(l1);
     for (size_type i = 0; i < nc; ++i)
       add(scaled(mat_const_col(l1, i), l2[i]), l3);
@@ -0,0 +1,285 @@
+/* -*- c++ -*- (enables emacs c++ mode) */
+/*===========================================================================
+
+ Copyright (C) 2026-2026 the GetFEM++ contributors.
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ As a special exception, you  may use  this file  as it is a part of a free
+ software  library  without  restriction.  Specifically,  if   other  files
+ instantiate  templates  or  use macros or inline functions from this file,
+ or  you compile this  file  and  link  it  with other files  to produce an
+ executable, this file  does  not  by itself cause the resulting executable
+ to be covered  by the GNU Lesser General Public License.  This   exception
+ does not  however  invalidate  any  other  reasons why the executable file
+ might be covered by the GNU Lesser General Public License.
+
+===========================================================================*/
+
+/**@file gmm_bsr_matrix.h
+   @brief Read only block compressed sparse row matrix (gmm::bsr_matrix),
+   dedicated to the matrix-vector product.
+
+   It is built with gmm::copy from any other matrix, for instance a
+   getfem::model_real_sparse_matrix, and only provides gmm::mult and
+   gmm::mult_add, which is all the iterative solvers need.
+
+   The gain over gmm::csr_matrix is limited. On the 3D three field stencil
+   of tests/test_gmm_mult_omp.cc, whose 3x3 blocks are full, a product
+   with bsr_matrix<double, 3> takes about 0.9 times the time of the
+   csr_matrix one. The factor 2 to 3 expected from the smaller index
+   storage cannot be reached: with the 32 bits indices of csr_matrix, the
+   indices are only a third of the memory traffic of the product and the
+   values are unchanged. Moreover, the blocks store the zeros of the
+   components which are not coupled, so that for weakly coupled systems
+   bsr_matrix may be slower than csr_matrix.
+*/
+
+#ifndef GMM_BSR_MATRIX_H__
+#define GMM_BSR_MATRIX_H__
+
+#include "gmm_kernel.h"
+
+namespace gmm {
+
+  /* ******************************************************************** */
+  /*                                                                      */
+  /*             Read only block compressed sparse row matrix             */
+  /*                                                                      */
+  /* ******************************************************************** */
+
+  /** Compressed sparse row matrix of dense BS x BS blocks. A single column
+      index is stored per block instead of one per entry, which suits the
+      systems of vector fields of dimension BS whose components are
+      numbered consecutively for each node (as the dofs of a
+      getfem::mesh_fem with qdim = BS). The blocks of the last block row
+      and column are completed with zeros when the dimensions are not
+      multiples of BS.
+  */
+  template <typename T, int BS, typename IND_TYPE = unsigned int>
+  struct bsr_matrix {
+
+    std::vector<T> pr;        // values, BS*BS per block, row by row.
+    std::vector<IND_TYPE> ir; // block column indices.
+    std::vector<IND_TYPE> jc; // block row repartition on ir.
+    size_type nc, nr;
+
+    typedef T value_type;
+    typedef T& access_type;
+
+    template <typename Matrix> void init_with_good_format(const Matrix &B);
+    void init_with(const row_matrix<wsvector<T> > &B)
+    { init_with_good_format(B); }
+    void init_with(const row_matrix<rsvector<T> > &B)
+    { init_with_good_format(B); }
+    template <typename U, typename IND, int shift>
+    void init_with(const csr_matrix<U, IND, shift>& B)
+    { init_with_good_format(B); }
+    template <typename Matrix> void init_with(const Matrix &A);
+
+    bsr_matrix(void) : nc(0), nr(0) { jc.assign(1, 0); }
+    bsr_matrix(size_type nnr, size_type nnc) : nc(nnc), nr(nnr)
+    { jc.assign(nb_block_rows()+1, 0); }
+
+    size_type nrows(void) const { return nr; }
+    size_type ncols(void) const { return nc; }
+    size_type nb_block_rows(void) const { return (nr + BS - 1) / BS; }
+    size_type nb_block_cols(void) const { return (nc + BS - 1) / BS; }
+    size_type nb_blocks(void) const { return ir.size(); }
+    void do_clear(void)
+    { pr.clear(); ir.clear(); jc.assign(nb_block_rows()+1, 0); }
+    void swap(bsr_matrix<T, BS, IND_TYPE> &m) {
+      std::swap(pr, m.pr);
+      std::swap(ir, m.ir); std::swap(jc, m.jc);
+      std::swap(nc, m.nc); std::swap(nr, m.nr);
+    }
+    value_type operator()(size_type i, size_type j) const {
+      GMM_ASSERT2(i < nr && j < nc, "out of range");
+      const IND_TYPE *b = ir.data() + jc[i/BS], *e = ir.data() + jc[i/BS+1];
+      const IND_TYPE *p = std::lower_bound(b, e, IND_TYPE(j/BS));
+      if (p == e || *p != j/BS) return T(0);
+      return pr[(size_type(p - ir.data())*BS + i%BS)*BS + j%BS];
+    }
+  };
+
+  template <typename T, int BS, typename IND_TYPE> template <typename Matrix>
+  void bsr_matrix<T, BS, IND_TYPE>::init_with_good_format(const Matrix &B) {
+    typedef typename linalg_traits<Matrix>::const_sub_row_type row_type;
+    nc = mat_ncols(B); nr = mat_nrows(B);
+    size_type nbr = nb_block_rows(), nbc = nb_block_cols();
+    std::vector<size_type> pos(nbc, size_type(-1));
+    ir.resize(0); jc.resize(nbr+1); jc[0] = 0;
+
+    // Block columns of each block row.
+    for (size_type I = 0; I < nbr; ++I) {
+      for (size_type i = I*BS; i < std::min(nr, I*BS+BS); ++i) {
+        row_type row = mat_const_row(B, i);
+        auto it = vect_const_begin(row), ite = vect_const_end(row);
+        for (; it != ite; ++it) {
+          size_type J = it.index() / BS;
+          if (pos[J] != I) { pos[J] = I; ir.push_back(IND_TYPE(J)); }
+        }
+      }
+      std::sort(ir.begin() + jc[I], ir.end());
+      jc[I+1] = IND_TYPE(ir.size());
+    }
+
+    // Values.
+    pr.assign(ir.size()*BS*BS, T(0));
+    for (size_type I = 0; I < nbr; ++I) {
+      for (size_type p = jc[I]; p < jc[I+1]; ++p) pos[ir[p]] = p;
+      for (size_type i = I*BS; i < std::min(nr, I*BS+BS); ++i) {
+        row_type row = mat_const_row(B, i);
+        auto it = vect_const_begin(row), ite = vect_const_end(row);
+        for (; it != ite; ++it)
+          pr[(pos[it.index()/BS]*BS + i - I*BS)*BS + it.index()%BS] = *it;
+      }
+    }
+  }
+
+  template <typename T, int BS, typename IND_TYPE> template <typename Matrix>
+  void bsr_matrix<T, BS, IND_TYPE>::init_with(const Matrix &A) {
+    row_matrix<rsvector<T> > B(mat_nrows(A), mat_ncols(A));
+    copy(A, B);
+    init_with_good_format(B);
+  }
+
+  template <typename T, int BS, typename IND_TYPE>
+  struct linalg_traits<bsr_matrix<T, BS, IND_TYPE> > {
+    typedef bsr_matrix<T, BS, IND_TYPE> this_type;
+    typedef linalg_false is_reference;
+    typedef abstract_matrix linalg_type;
+    typedef T value_type;
+    typedef this_type origin_type;
+    typedef T reference;
+    typedef abstract_sparse storage_type;
+    typedef abstract_null_type sub_row_type;
+    typedef abstract_null_type const_sub_row_type;
+    typedef abstract_null_type row_iterator;
+    typedef abstract_null_type const_row_iterator;
+    typedef abstract_null_type sub_col_type;
+    typedef abstract_null_type const_sub_col_type;
+    typedef abstract_null_type col_iterator;
+    typedef abstract_null_type const_col_iterator;
+    typedef abstract_null_type sub_orientation;
+    typedef linalg_true index_sorted;
+    static size_type nrows(const this_type &m) { return m.nrows(); }
+    static size_type ncols(const this_type &m) { return m.ncols(); }
+    static origin_type* origin(this_type &m) { return &m; }
+    static const origin_type* origin(const this_type &m) { return &m; }
+    static void do_clear(this_type &m) { m.do_clear(); }
+  };
+
+  template <typename Matrix, typename T, int BS, typename IND_TYPE>
+  inline void copy(const Matrix &A, bsr_matrix<T, BS, IND_TYPE>& M)
+  { M.init_with(A); }
+
+  // l3 = l1*l2, or l3 += l1*l2 if add is true, for dense l2 and l3.
+  template <typename T, int BS, typename IND_TYPE, typename L2, typename L3>
+  void bsr_mult_(const bsr_matrix<T, BS, IND_TYPE> &l1, const L2 &l2,
+                      L3 &l3, bool add) {
+    typedef typename linalg_traits<L3>::value_type T3;
+    size_type nbr = l1.nb_block_rows(), nr = l1.nr, nc = l1.nc;
+    const T *pr = l1.pr.data();
+    const IND_TYPE *ir = l1.ir.data(), *jc = l1.jc.data();
+    // Index of the incomplete last block column, if any. Being the last
+    // one of its block row, it is treated apart from the main loop.
+    IND_TYPE jtail = IND_TYPE((nc % BS) ? nc / BS : size_type(-1));
+    omp_slices(nbr, nb_omp_slices(nr),
+               [&](size_type, size_type I0, size_type I1) {
+      T3 acc[BS];
+      for (size_type I = I0; I < I1; ++I) {
+        for (int r = 0; r < BS; ++r) acc[r] = T3(0);
+        size_type p = jc[I], pe = jc[I+1];
+        bool tail = (pe > p && ir[pe-1] == jtail);
+        if (tail) --pe;
+        for (const T *b = pr + p*BS*BS; p < pe; ++p) {
+          size_type j0 = size_type(ir[p])*BS;
+          for (int r = 0; r < BS; ++r)
+            for (int c = 0; c < BS; ++c, ++b) acc[r] += (*b) * l2[j0+c];
+        }
+        if (tail) {
+          const T *b = pr + p*BS*BS;
+          size_type j0 = size_type(ir[p])*BS;
+          for (int r = 0; r < BS; ++r)
+            for (size_type c = 0; j0 + c < nc; ++c)
+              acc[r] += b[r*BS+c] * l2[j0+c];
+        }
+        size_type i0 = I*BS, ni = std::min(size_type(BS), nr - i0);
+        for (size_type r = 0; r < ni; ++r)
+          if (add) l3[i0+r] += acc[r]; else l3[i0+r] = acc[r];
+      }
+    });
+  }
+
+  /* ******************************************************************** */
+  /*             Matrix-vector products                                   */
+  /* ******************************************************************** */
+
+  // Entry points of gmm::mult and gmm::mult_add for bsr_matrix, which has
+  // no row or column access. The kernel works on dense vectors, the other
+  // ones are copied.
+  template <typename M, typename L2, typename L3>
+  void bsr_mult_add_(const M &l1, const L2 &l2, L3 &l3, bool add,
+                     abstract_dense, abstract_dense)
+  { bsr_mult_(l1, l2, l3, add); }
+
+  template <typename M, typename L2, typename L3, typename ST2, typename ST3>
+  void bsr_mult_add_(const M &l1, const L2 &l2, L3 &l3, bool add,
+                     ST2, ST3) {
+    typename temporary_dense_vector<L2>::vector_type temp2(vect_size(l2));
+    typename temporary_dense_vector<L3>::vector_type temp3(vect_size(l3));
+    copy(l2, temp2);
+    if (add) copy(l3, temp3);
+    bsr_mult_(l1, temp2, temp3, add);
+    copy(temp3, l3);
+  }
+
+  template <typename T, int BS, typename IND_TYPE, typename L2, typename L3>
+  inline void mult_spec(const bsr_matrix<T, BS, IND_TYPE> &l1, const L2 &l2,
+                        L3 &l3, abstract_null_type) {
+    bsr_mult_add_(l1, l2, l3, false,
+                  typename linalg_traits<L2>::storage_type(),
+                  typename linalg_traits<L3>::storage_type());
+  }
+
+  template <typename T, int BS, typename IND_TYPE, typename L2, typename L3>
+  inline void mult_add_spec(const bsr_matrix<T, BS, IND_TYPE> &l1,
+                            const L2 &l2, L3 &l3, abstract_null_type) {
+    bsr_mult_add_(l1, l2, l3, true,
+                  typename linalg_traits<L2>::storage_type(),
+                  typename linalg_traits<L3>::storage_type());
+  }
+
+  template <typename T, int BS, typename IND_TYPE>
+  std::ostream &operator <<
+    (std::ostream &o, const bsr_matrix<T, BS, IND_TYPE>& m) {
+    o << "block compressed sparse row matrix " << m.nrows() << "x"
+      << m.ncols() << " with " << m.nb_blocks() << " blocks of size "
+      << BS << "x" << BS;
+    return o;
+  }
+
+}
+
+namespace std {
+  template <typename T, int BS, typename IND_TYPE> void
+  swap(gmm::bsr_matrix<T, BS, IND_TYPE> &m1,
+       gmm::bsr_matrix<T, BS, IND_TYPE> &m2)
+  { m1.swap(m2); }
+}
+
+#endif /* GMM_BSR_MATRIX_H__ */
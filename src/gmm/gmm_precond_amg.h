@@ -0,0 +1,770 @@
+/* -*- c++ -*- (enables emacs c++ mode) */
+/*===========================================================================
+
+ Copyright (C) 2026-2026 the GetFEM++ contributors.
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ As a special exception, you  may use  this file  as it is a part of a free
+ software  library  without  restriction.  Specifically,  if   other  files
+ instantiate  templates  or  use macros or inline functions from this file,
+ or  you compile this  file  and  link  it  with other files  to produce an
+ executable, this file  does  not  by itself cause the resulting executable
+ to be covered  by the GNU Lesser General Public License.  This   exception
+ does not  however  invalidate  any  other  reasons why the executable file
+ might be covered by the GNU Lesser General Public License.
+
+===========================================================================*/
+
+/**@file gmm_precond_amg.h
+   @brief Smoothed aggregation algebraic multigrid preconditioner.
+
+   The hierarchy is built from the matrix and from a near nullspace
+   (the constant vector by default, the rigid body modes for elasticity).
+   Each level aggregates the strongly connected nodes (blocks of
+   block_size consecutive unknowns) of the previous one, orthonormalizes
+   the near nullspace on each aggregate to get a tentative prolongation,
+   smoothes it by one damped Jacobi step and computes the coarse matrix
+   by a Galerkin product. The preconditioner applies one V-cycle.
+
+   The matrix products of the setup, the smoothers and the transfers of
+   the V-cycle are shared between threads when gmm uses OpenMP. Only the
+   aggregation itself is sequential.
+*/
+
+#ifndef GMM_PRECOND_AMG_H
+#define GMM_PRECOND_AMG_H
+
+#include "gmm_precond.h"
+#include "gmm_dense_lu.h"
+
+namespace gmm {
+
+  /* ******************************************************************** */
+  /*		Sparse matrix kernels of the setup           		  */
+  /* ******************************************************************** */
+
+  // Sorts the entries of each row of a csr matrix by column index.
+  template <typename T, typename IND>
+  void amg_sort_rows_(csr_matrix<T, IND> &A) {
+    omp_slices(A.nr, nb_omp_slices(A.nr),
+	       [&](size_type, size_type i0, size_type i1) {
+      std::vector<std::pair<IND, T> > row;
+      for (size_type i = i0; i < i1; ++i) {
+	size_type p0 = A.jc[i], p1 = A.jc[i+1];
+	row.resize(p1 - p0);
+	for (size_type p = p0; p < p1; ++p)
+	  row[p-p0] = std::make_pair(A.ir[p], A.pr[p]);
+	std::sort(row.begin(), row.end(),
+		  [](const std::pair<IND, T> &a, const std::pair<IND, T> &b)
+		  { return a.first < b.first; });
+	for (size_type p = p0; p < p1; ++p)
+	  { A.ir[p] = row[p-p0].first; A.pr[p] = row[p-p0].second; }
+      }
+    });
+  }
+
+  // C = A * B. Rows of C are computed concurrently, in two passes: the
+  // first one counts the entries, the second one computes them.
+  template <typename T, typename IND>
+  void amg_csr_mult_(const csr_matrix<T, IND> &A, const csr_matrix<T, IND> &B,
+		     csr_matrix<T, IND> &C) {
+    GMM_ASSERT1(A.nc == B.nr, "dimensions mismatch");
+    size_type nr = A.nr, nc = B.nc, ns = nb_omp_slices(nr);
+    std::vector<size_type> cnt(nr+1, 0);
+    omp_slices(nr, ns, [&](size_type, size_type i0, size_type i1) {
+      std::vector<size_type> mark(nc, size_type(-1));
+      for (size_type i = i0; i < i1; ++i)
+	for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p)
+	  for (size_type q = B.jc[A.ir[p]]; q < B.jc[A.ir[p]+1]; ++q)
+	    if (mark[B.ir[q]] != i) { mark[B.ir[q]] = i; ++(cnt[i+1]); }
+    });
+    for (size_type i = 0; i < nr; ++i) cnt[i+1] += cnt[i];
+
+    C.nr = nr; C.nc = nc;
+    C.jc.resize(nr+1); C.ir.resize(cnt[nr]); C.pr.resize(cnt[nr]);
+    for (size_type i = 0; i <= nr; ++i) C.jc[i] = IND(cnt[i]);
+    omp_slices(nr, ns, [&](size_type, size_type i0, size_type i1) {
+      // pos[j] is the position of column j in C if it is in the current
+      // row, i.e. if it is not before the beginning of the row.
+      std::vector<size_type> pos(nc, size_type(-1));
+      for (size_type i = i0; i < i1; ++i) {
+	size_type p0 = cnt[i], e = p0;
+	for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p) {
+	  T a = A.pr[p];
+	  for (size_type q = B.jc[A.ir[p]]; q < B.jc[A.ir[p]+1]; ++q) {
+	    size_type j = B.ir[q];
+	    if (pos[j] == size_type(-1) || pos[j] < p0) {
+	      pos[j] = e; C.ir[e] = IND(j); C.pr[e] = a * B.pr[q]; ++e;
+	    }
+	    else C.pr[pos[j]] += a * B.pr[q];
+	  }
+	}
+      }
+    });
+    amg_sort_rows_(C);
+  }
+
+  // B = A^H.
+  template <typename T, typename IND>
+  void amg_csr_conj_transpose_(const csr_matrix<T, IND> &A,
+			       csr_matrix<T, IND> &B) {
+    size_type nnz = A.jc[A.nr];
+    B.nr = A.nc; B.nc = A.nr;
+    B.jc.assign(B.nr+1, IND(0)); B.ir.resize(nnz); B.pr.resize(nnz);
+    for (size_type p = 0; p < nnz; ++p) ++(B.jc[A.ir[p]+1]);
+    for (size_type j = 0; j < B.nr; ++j) B.jc[j+1] += B.jc[j];
+    std::vector<IND> pos(B.jc.begin(), B.jc.end() - 1);
+    for (size_type i = 0; i < A.nr; ++i)
+      for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p) {
+	IND q = pos[A.ir[p]]++;
+	B.ir[q] = IND(i); B.pr[q] = gmm::conj(A.pr[p]);
+      }
+  }
+
+  // y = A * x for std::vector's.
+  template <typename T, typename IND>
+  void amg_csr_mult_vect_(const csr_matrix<T, IND> &A,
+			  const std::vector<T> &x, std::vector<T> &y) {
+    omp_slices(A.nr, nb_omp_slices(A.nr),
+	       [&](size_type, size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i) {
+	T t(0);
+	for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p)
+	  t += A.pr[p] * x[A.ir[p]];
+	y[i] = t;
+      }
+    });
+  }
+
+  /* ******************************************************************** */
+  /*		Algebraic multigrid preconditioner             		  */
+  /* ******************************************************************** */
+
+  /** Smoothers of amg_precond. The Gauss-Seidel smoother is a forward
+      sweep before the coarse correction and a backward one after it, so
+      that the V-cycle stays symmetric. When several threads are used,
+      each one sweeps a contiguous range of rows and uses the values of
+      the previous sweep for the unknowns of the other ranges (hybrid
+      Gauss-Seidel). */
+  enum amg_smoother_type
+    { AMG_JACOBI, AMG_GAUSS_SEIDEL, AMG_CHEBYSHEV };
+
+  /** One level of the hierarchy of amg_precond. */
+  template <typename T> struct amg_level {
+    typedef typename number_traits<T>::magnitude_type R;
+
+    csr_matrix<T> A;         // matrix of the level.
+    csr_matrix<T> P, Rt;     // prolongation from the next level and P^H.
+    std::vector<T> dinv;     // inverse of the diagonal of A.
+    R rho;                   // estimate of the spectral radius of D^-1 A.
+    size_type block_size;
+    mutable std::vector<T> x, b, r, w;
+
+    size_type memsize() const {
+      return sizeof(*this)
+	+ (A.pr.size() + P.pr.size() + Rt.pr.size() + dinv.size()
+	   + x.size() + b.size() + r.size() + w.size()) * sizeof(T)
+	+ (A.ir.size() + A.jc.size() + P.ir.size() + P.jc.size()
+	   + Rt.ir.size() + Rt.jc.size()) * sizeof(unsigned int);
+    }
+  };
+
+  // r = b - A x on a level.
+  template <typename T> void amg_residual_(const amg_level<T> &L) {
+    size_type n = L.A.nr;
+    omp_slices(n, nb_omp_slices(n),
+	       [&](size_type, size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i) {
+	T t = L.b[i];
+	for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p)
+	  t -= L.A.pr[p] * L.x[L.A.ir[p]];
+	L.r[i] = t;
+      }
+    });
+  }
+
+  /** Smoothed aggregation algebraic multigrid preconditioner.
+
+      The near nullspace, given by set_near_nullspace before build_with,
+      is a n x k matrix whose columns are the modes the prolongations
+      have to represent exactly (see getfem::rigid_body_modes), with the
+      size of the nodal blocks of unknowns used for the aggregation.
+
+      The parameters are public members to be set before build_with.
+      mult applies one V-cycle with a zero initial guess. It is symmetric
+      for the Jacobi and Chebyshev smoothers and for Gauss-Seidel with
+      the same number of pre and post smoothing steps, hence suitable for
+      gmm::cg on symmetric positive definite (or hermitian) matrices,
+      for which transposed_mult is the same operator. The V-cycle uses
+      work vectors of the preconditioner: mult cannot be called
+      concurrently on the same object.
+  */
+  template <typename Matrix> class amg_precond {
+  public :
+    typedef typename linalg_traits<Matrix>::value_type value_type;
+    typedef typename number_traits<value_type>::magnitude_type magnitude_type;
+    typedef amg_level<value_type> level_type;
+
+    amg_smoother_type smoother;
+    size_type nb_pre_smooth, nb_post_smooth;
+    size_type chebyshev_degree;
+    /* Damping of the Jacobi smoother, divided by the spectral radius of
+       D^-1 A. */
+    magnitude_type jacobi_omega;
+    /* Two nodes are strongly connected when the Frobenius norm of their
+       coupling block is at least strength_threshold times the geometric
+       mean of the norms of their diagonal blocks. */
+    magnitude_type strength_threshold;
+    size_type max_levels, max_coarse_size;
+
+  protected :
+    std::vector<level_type> levels;
+    dense_matrix<value_type> coarse_lu;
+    std::vector<size_type> coarse_ipvt;
+    bool coarse_direct;
+    dense_matrix<value_type> nullspace;
+    size_type nullspace_block_size;
+
+    void tentative_prolongation(level_type &L, const dense_matrix<value_type>
+				&B, dense_matrix<value_type> &Bc,
+				size_type &bsc);
+    void smooth(const level_type &L, size_type nb, bool forward) const;
+    void jacobi(const level_type &L) const;
+    void gauss_seidel(const level_type &L, bool forward) const;
+    void chebyshev(const level_type &L) const;
+    void coarse_solve(const level_type &L) const;
+
+  public :
+    /** Near nullspace B (n x k, k >= 1) and size of the nodal blocks. The
+	default is the constant vector with blocks of size 1. */
+    template <typename Mat>
+    void set_near_nullspace(const Mat &B, size_type block_size = 1) {
+      gmm::resize(nullspace, mat_nrows(B), mat_ncols(B));
+      gmm::copy(B, nullspace);
+      nullspace_block_size = block_size;
+    }
+    void build_with(const Matrix& A);
+    void vcycle(size_type l) const;
+
+    size_type nb_levels(void) const { return levels.size(); }
+    const level_type &level(size_type l) const { return levels[l]; }
+    /** Sum of the number of nonzeros of the matrices of all levels over
+	the one of the fine matrix. */
+    double operator_complexity(void) const;
+    size_type memsize() const {
+      size_type s = sizeof(*this)
+	+ (coarse_lu.size() + nullspace.size()) * sizeof(value_type)
+	+ coarse_ipvt.size() * sizeof(size_type);
+      for (const level_type &L : levels) s += L.memsize();
+      return s;
+    }
+
+    amg_precond(void)
+      : smoother(AMG_GAUSS_SEIDEL), nb_pre_smooth(1), nb_post_smooth(1),
+	chebyshev_degree(3), jacobi_omega(magnitude_type(4)/magnitude_type(3)),
+	strength_threshold(magnitude_type(0.08)), max_levels(20),
+	max_coarse_size(500), coarse_direct(false), nullspace_block_size(1) {}
+    amg_precond(const Matrix& A) : amg_precond() { build_with(A); }
+  };
+
+  // Strong connections between the nodes of A, nodes being blocks of bs
+  // consecutive rows, in the compressed format (gptr, gind).
+  template <typename T, typename IND, typename R>
+  void amg_strength_graph_(const csr_matrix<T, IND> &A, size_type bs,
+			   R theta, std::vector<size_type> &gptr,
+			   std::vector<size_type> &gind) {
+    size_type nn = A.nr / bs, ns = nb_omp_slices(A.nr);
+    std::vector<R> d2(nn, R(0));
+    omp_slices(nn, ns, [&](size_type, size_type I0, size_type I1) {
+      for (size_type I = I0; I < I1; ++I)
+	for (size_type i = I*bs; i < (I+1)*bs; ++i)
+	  for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p)
+	    if (A.ir[p] / bs == I) d2[I] += gmm::abs_sqr(A.pr[p]);
+    });
+
+    std::vector<std::vector<size_type> > slice_ind(ns);
+    gptr.assign(nn+1, 0);
+    R theta2 = theta * theta;
+    omp_slices(nn, ns, [&](size_type s, size_type I0, size_type I1) {
+      std::vector<R> s2(nn, R(0));
+      std::vector<size_type> touched;
+      for (size_type I = I0; I < I1; ++I) {
+	for (size_type i = I*bs; i < (I+1)*bs; ++i)
+	  for (size_type p = A.jc[i]; p < A.jc[i+1]; ++p) {
+	    size_type J = A.ir[p] / bs;
+	    if (J == I || J >= nn) continue;
+	    if (s2[J] == R(0)) touched.push_back(J);
+	    s2[J] += gmm::abs_sqr(A.pr[p]);
+	  }
+	std::sort(touched.begin(), touched.end());
+	for (size_type J : touched) {
+	  if (s2[J] > R(0) && s2[J] >= theta2 * gmm::sqrt(d2[I] * d2[J]))
+	    { slice_ind[s].push_back(J); ++(gptr[I+1]); }
+	  s2[J] = R(0);
+	}
+	touched.resize(0);
+      }
+    });
+    for (size_type I = 0; I < nn; ++I) gptr[I+1] += gptr[I];
+    gind.resize(0); gind.reserve(gptr[nn]);
+    for (size_type s = 0; s < ns; ++s)
+      gind.insert(gind.end(), slice_ind[s].begin(), slice_ind[s].end());
+  }
+
+  // Standard aggregation of the nodes of the strength graph. agg[I] is
+  // the aggregate of node I, or size_type(-1) for the nodes without
+  // strong connection, which are not aggregated. Returns the number of
+  // aggregates.
+  inline size_type amg_aggregate_(const std::vector<size_type> &gptr,
+				  const std::vector<size_type> &gind,
+				  std::vector<size_type> &agg) {
+    const size_type none = size_type(-1);
+    size_type nn = gptr.size() - 1, na = 0;
+    agg.assign(nn, none);
+
+    // Aggregates made of a node and of all its neighbours, all free.
+    for (size_type I = 0; I < nn; ++I) {
+      if (agg[I] != none || gptr[I] == gptr[I+1]) continue;
+      bool is_free = true;
+      for (size_type p = gptr[I]; p < gptr[I+1] && is_free; ++p)
+	if (agg[gind[p]] != none) is_free = false;
+      if (is_free) {
+	agg[I] = na;
+	for (size_type p = gptr[I]; p < gptr[I+1]; ++p) agg[gind[p]] = na;
+	++na;
+      }
+    }
+
+    // The remaining nodes join an aggregate of the first pass.
+    std::vector<size_type> agg1(agg);
+    for (size_type I = 0; I < nn; ++I)
+      if (agg[I] == none)
+	for (size_type p = gptr[I]; p < gptr[I+1]; ++p)
+	  if (agg1[gind[p]] != none) { agg[I] = agg1[gind[p]]; break; }
+
+    // New aggregates with the remaining nodes.
+    for (size_type I = 0; I < nn; ++I)
+      if (agg[I] == none && gptr[I] != gptr[I+1]) {
+	agg[I] = na;
+	for (size_type p = gptr[I]; p < gptr[I+1]; ++p)
+	  if (agg[gind[p]] == none) agg[gind[p]] = na;
+	++na;
+      }
+    return na;
+  }
+
+  // Tentative prolongation L.P: the near nullspace B restricted to each
+  // aggregate is orthonormalized by a modified Gram-Schmidt process. The
+  // columns which are linearly dependent on the previous ones on an
+  // aggregate are dropped, so that an aggregate gives at most k coarse
+  // unknowns. The coefficients of the orthonormalization are the coarse
+  // near nullspace Bc.
+  template <typename Matrix>
+  void amg_precond<Matrix>::tentative_prolongation
+  (level_type &L, const dense_matrix<value_type> &B,
+   dense_matrix<value_type> &Bc, size_type &bsc) {
+    typedef value_type T;
+    typedef magnitude_type R;
+    size_type n = L.A.nr, bs = L.block_size, k = mat_ncols(B);
+    std::vector<size_type> gptr, gind, agg;
+    amg_strength_graph_(L.A, bs, strength_threshold, gptr, gind);
+    size_type na = amg_aggregate_(gptr, gind, agg), nn = agg.size();
+
+    // Unknowns of each aggregate.
+    std::vector<size_type> aptr(na+1, 0), aind;
+    for (size_type I = 0; I < nn; ++I)
+      if (agg[I] != size_type(-1)) aptr[agg[I]+1] += bs;
+    for (size_type a = 0; a < na; ++a) aptr[a+1] += aptr[a];
+    aind.resize(aptr[na]);
+    {
+      std::vector<size_type> pos(aptr.begin(), aptr.end() - 1);
+      for (size_type I = 0; I < nn; ++I)
+	if (agg[I] != size_type(-1))
+	  for (size_type c = 0; c < bs; ++c) aind[pos[agg[I]]++] = I*bs + c;
+    }
+
+    // Local orthonormalizations, Q is column major on each aggregate.
+    std::vector<T> Q(aptr[na] * k), Rl(na * k * k, T(0));
+    std::vector<size_type> ka(na, 0);
+    std::vector<char> kept(na * k, 0);
+    omp_slices(na, nb_omp_slices(n),
+	       [&](size_type, size_type a0, size_type a1) {
+      for (size_type a = a0; a < a1; ++a) {
+	size_type m = aptr[a+1] - aptr[a];
+	T *q = Q.data() + aptr[a] * k, *r = Rl.data() + a * k * k;
+	for (size_type c = 0; c < k; ++c)
+	  for (size_type t = 0; t < m; ++t) q[c*m+t] = B(aind[aptr[a]+t], c);
+	for (size_type c = 0; c < k; ++c) {
+	  R nrm0(0), nrm(0);
+	  for (size_type t = 0; t < m; ++t) nrm0 += gmm::abs_sqr(q[c*m+t]);
+	  for (size_type c2 = 0; c2 < c; ++c2) {
+	    if (!kept[a*k+c2]) continue;
+	    T s(0);
+	    for (size_type t = 0; t < m; ++t)
+	      s += gmm::conj(q[c2*m+t]) * q[c*m+t];
+	    for (size_type t = 0; t < m; ++t) q[c*m+t] -= s * q[c2*m+t];
+	    r[c2*k+c] = s;
+	  }
+	  for (size_type t = 0; t < m; ++t) nrm += gmm::abs_sqr(q[c*m+t]);
+	  nrm = gmm::sqrt(nrm);
+	  if (nrm > R(0) && nrm > R(1E-8) * gmm::sqrt(nrm0)) {
+	    for (size_type t = 0; t < m; ++t) q[c*m+t] /= nrm;
+	    r[c*k+c] = T(nrm); kept[a*k+c] = 1; ++(ka[a]);
+	  }
+	}
+      }
+    });
+
+    std::vector<size_type> coff(na+1, 0);
+    for (size_type a = 0; a < na; ++a) coff[a+1] = coff[a] + ka[a];
+    size_type nc = coff[na];
+    bsc = k;
+    for (size_type a = 0; a < na; ++a) if (ka[a] != k) bsc = 1;
+
+    // Tentative prolongation, row by row, and coarse near nullspace.
+    std::vector<size_type> rowa(n, size_type(-1)), rowt(n);
+    for (size_type a = 0; a < na; ++a)
+      for (size_type t = aptr[a]; t < aptr[a+1]; ++t)
+	{ rowa[aind[t]] = a; rowt[aind[t]] = t - aptr[a]; }
+    L.P.nr = n; L.P.nc = nc;
+    L.P.jc.resize(n+1); L.P.jc[0] = 0;
+    for (size_type i = 0; i < n; ++i)
+      L.P.jc[i+1] = L.P.jc[i]
+	+ ((rowa[i] == size_type(-1)) ? 0 : unsigned(ka[rowa[i]]));
+    L.P.ir.resize(L.P.jc[n]); L.P.pr.resize(L.P.jc[n]);
+    for (size_type i = 0; i < n; ++i) {
+      size_type a = rowa[i], p = L.P.jc[i];
+      if (a == size_type(-1)) continue;
+      size_type m = aptr[a+1] - aptr[a];
+      for (size_type c = 0, rk = 0; c < k; ++c)
+	if (kept[a*k+c]) {
+	  L.P.ir[p] = unsigned(coff[a] + rk++);
+	  L.P.pr[p++] = Q[aptr[a]*k + c*m + rowt[i]];
+	}
+    }
+    gmm::resize(Bc, nc, k); gmm::clear(Bc);
+    for (size_type a = 0; a < na; ++a)
+      for (size_type c2 = 0, rk = 0; c2 < k; ++c2)
+	if (kept[a*k+c2]) {
+	  for (size_type c = c2; c < k; ++c)
+	    Bc(coff[a] + rk, c) = Rl[a*k*k + c2*k + c];
+	  ++rk;
+	}
+  }
+
+  // Power iteration estimate of the spectral radius of D^-1 A.
+  template <typename T, typename IND>
+  typename number_traits<T>::magnitude_type
+  amg_spectral_radius_(const csr_matrix<T, IND> &A,
+		       const std::vector<T> &dinv) {
+    typedef typename number_traits<T>::magnitude_type R;
+    size_type n = A.nr;
+    std::vector<T> x(n), y(n);
+    unsigned long s = 1;  // fixed pseudo-random start, for reproducibility.
+    for (size_type i = 0; i < n; ++i) {
+      s = (s * 1103515245UL + 12345UL) % 2147483648UL;
+      x[i] = T(R(0.5) + R(s) / R(2147483648UL));
+    }
+    R lambda(0), nx = vect_norm2(x);
+    for (size_type it = 0; it < 15 && nx > R(0); ++it) {
+      gmm::scale(x, T(R(1) / nx));
+      amg_csr_mult_vect_(A, x, y);
+      for (size_type i = 0; i < n; ++i) y[i] *= dinv[i];
+      lambda = nx = vect_norm2(y);
+      std::swap(x, y);
+    }
+    return lambda;
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::build_with(const Matrix& A) {
+    typedef value_type T;
+    typedef magnitude_type R;
+    size_type n = mat_nrows(A);
+    GMM_ASSERT1(n == mat_ncols(A), "The matrix should be square");
+    levels.clear(); levels.reserve(max_levels);
+
+    dense_matrix<T> B, Bc;
+    size_type bs = nullspace_block_size;
+    if (mat_nrows(nullspace) == n && mat_ncols(nullspace) > 0) {
+      gmm::resize(B, n, mat_ncols(nullspace)); gmm::copy(nullspace, B);
+    }
+    else {
+      if (mat_nrows(nullspace) != 0)
+	GMM_WARNING2("The near nullspace has a wrong size, the constant "
+		     "vector is used");
+      gmm::resize(B, n, 1); std::fill(B.begin(), B.end(), T(1)); bs = 1;
+    }
+    if (bs == 0 || n % bs != 0) bs = 1;
+
+    levels.push_back(level_type());
+    gmm::copy(A, levels[0].A);
+    levels[0].block_size = bs;
+
+    for (size_type l = 0; ; ++l) {
+      level_type &L = levels[l];
+      size_type nl = L.A.nr;
+      L.dinv.assign(nl, T(1));
+      omp_slices(nl, nb_omp_slices(nl),
+		 [&](size_type, size_type i0, size_type i1) {
+	for (size_type i = i0; i < i1; ++i)
+	  for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p)
+	    if (L.A.ir[p] == i && L.A.pr[p] != T(0))
+	      L.dinv[i] = T(1) / L.A.pr[p];
+      });
+      L.rho = amg_spectral_radius_(L.A, L.dinv);
+      if (L.rho <= R(0)) L.rho = R(1);
+      L.x.resize(nl); L.b.resize(nl); L.r.resize(nl); L.w.resize(nl);
+
+      if (nl <= max_coarse_size || l+1 >= max_levels) break;
+
+      size_type bsc;
+      tentative_prolongation(L, B, Bc, bsc);
+      size_type nc = L.P.nc;
+      if (nc == 0 || nc >= nl) { L.P = csr_matrix<T>(); break; }
+
+      // Smoothed prolongation P = (I - omega D^-1 A) P_tent.
+      R omega = R(4) / (R(3) * L.rho);
+      csr_matrix<T> S, Pt;
+      S.nr = S.nc = nl; S.jc.resize(nl+1); S.jc[0] = 0;
+      for (size_type i = 0; i < nl; ++i) {
+	bool has_diag = false;
+	for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p)
+	  if (L.A.ir[p] == i) has_diag = true;
+	S.jc[i+1] = S.jc[i] + L.A.jc[i+1] - L.A.jc[i] + (has_diag ? 0 : 1);
+      }
+      S.ir.resize(S.jc[nl]); S.pr.resize(S.jc[nl]);
+      omp_slices(nl, nb_omp_slices(nl),
+		 [&](size_type, size_type i0, size_type i1) {
+	for (size_type i = i0; i < i1; ++i) {
+	  size_type q = S.jc[i];
+	  bool has_diag = false;
+	  for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p, ++q) {
+	    S.ir[q] = L.A.ir[p];
+	    S.pr[q] = -T(omega) * L.dinv[i] * L.A.pr[p];
+	    if (L.A.ir[p] == i) { S.pr[q] += T(1); has_diag = true; }
+	  }
+	  if (!has_diag) { S.ir[q] = unsigned(i); S.pr[q] = T(1); }
+	}
+      });
+      amg_csr_mult_(S, L.P, Pt);
+      L.P.swap(Pt);
+      amg_csr_conj_transpose_(L.P, L.Rt);
+
+      // Galerkin coarse matrix.
+      csr_matrix<T> AP;
+      amg_csr_mult_(L.A, L.P, AP);
+      levels.push_back(level_type());
+      amg_csr_mult_(levels[l].Rt, AP, levels[l+1].A);
+      levels[l+1].block_size = bsc;
+      B.swap(Bc);
+    }
+
+    // Direct solver on the coarsest level, if it is small enough.
+    level_type &L = levels.back();
+    size_type nc = L.A.nr;
+    coarse_direct = (nc <= 4 * max_coarse_size);
+    if (coarse_direct) {
+      gmm::resize(coarse_lu, nc, nc); gmm::clear(coarse_lu);
+      for (size_type i = 0; i < nc; ++i)
+	for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p)
+	  coarse_lu(i, L.A.ir[p]) = L.A.pr[p];
+      lapack_ipvt ipvt(nc);
+      size_type info = lu_factor(coarse_lu, ipvt);
+      if (info) {
+	GMM_WARNING2("Singular coarse matrix, the coarsest level of the "
+		     "algebraic multigrid is only smoothed");
+	coarse_direct = false;
+      }
+      coarse_ipvt.resize(nc);
+      for (size_type i = 0; i < nc; ++i) coarse_ipvt[i] = ipvt.get(i);
+    }
+    if (!coarse_direct) { gmm::resize(coarse_lu, 0, 0); coarse_ipvt.clear(); }
+  }
+
+  template <typename Matrix>
+  double amg_precond<Matrix>::operator_complexity(void) const {
+    if (levels.empty() || levels[0].A.pr.empty()) return 0.;
+    double s = 0.;
+    for (const level_type &L : levels) s += double(L.A.jc[L.A.nr]);
+    return s / double(levels[0].A.jc[levels[0].A.nr]);
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::jacobi(const level_type &L) const {
+    size_type n = L.A.nr, ns = nb_omp_slices(n);
+    value_type omega = value_type(jacobi_omega / L.rho);
+    amg_residual_(L);
+    omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i)
+	L.x[i] += omega * L.dinv[i] * L.r[i];
+    });
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::gauss_seidel(const level_type &L,
+					 bool forward) const {
+    size_type n = L.A.nr, ns = nb_omp_slices(n);
+    // Values of the previous sweep for the rows of the other threads.
+    if (ns > 1) std::copy(L.x.begin(), L.x.end(), L.w.begin());
+    const std::vector<value_type> &xo = (ns > 1) ? L.w : L.x;
+    omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+      for (size_type ii = i0; ii < i1; ++ii) {
+	size_type i = forward ? ii : i0 + i1 - 1 - ii;
+	value_type t = L.b[i];
+	for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p) {
+	  size_type j = L.A.ir[p];
+	  if (j != i)
+	    t -= L.A.pr[p] * ((j >= i0 && j < i1) ? L.x[j] : xo[j]);
+	}
+	L.x[i] = t * L.dinv[i];
+      }
+    });
+  }
+
+  // Chebyshev polynomial of D^-1 A of degree chebyshev_degree, on the
+  // interval [rho/30, 1.1 rho].
+  template <typename Matrix>
+  void amg_precond<Matrix>::chebyshev(const level_type &L) const {
+    typedef value_type T;
+    typedef magnitude_type R;
+    size_type n = L.A.nr, ns = nb_omp_slices(n);
+    R lmax = R(1.1) * L.rho, lmin = lmax / R(30);
+    R theta = (lmax + lmin) / R(2), delta = (lmax - lmin) / R(2);
+    R sigma = theta / delta, rk = R(1) / sigma;
+    amg_residual_(L);
+    omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i)
+	L.w[i] = L.dinv[i] * L.r[i] / T(theta);
+    });
+    for (size_type k = 0; k < chebyshev_degree; ++k) {
+      bool last = (k+1 == chebyshev_degree);
+      R rn = R(1) / (R(2) * sigma - rk);
+      T c1 = T(rn * rk), c2 = T(R(2) * rn / delta);
+      omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+	for (size_type i = i0; i < i1; ++i) L.x[i] += L.w[i];
+      });
+      if (last) break;
+      // r -= A w, then w = c1 w + c2 D^-1 r. The update of w waits for
+      // all the rows of r.
+      omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+	for (size_type i = i0; i < i1; ++i) {
+	  T t(0);
+	  for (size_type p = L.A.jc[i]; p < L.A.jc[i+1]; ++p)
+	    t += L.A.pr[p] * L.w[L.A.ir[p]];
+	  L.r[i] -= t;
+	}
+      });
+      omp_slices(n, ns, [&](size_type, size_type i0, size_type i1) {
+	for (size_type i = i0; i < i1; ++i)
+	  L.w[i] = c1 * L.w[i] + c2 * L.dinv[i] * L.r[i];
+      });
+      rk = rn;
+    }
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::smooth(const level_type &L, size_type nb,
+				   bool forward) const {
+    for (size_type k = 0; k < nb; ++k)
+      switch (smoother) {
+      case AMG_JACOBI : jacobi(L); break;
+      case AMG_GAUSS_SEIDEL : gauss_seidel(L, forward); break;
+      case AMG_CHEBYSHEV : chebyshev(L); break;
+      }
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::coarse_solve(const level_type &L) const {
+    if (coarse_direct) {
+      std::copy(L.b.begin(), L.b.end(), L.x.begin());
+      for (size_type i = 0; i < coarse_ipvt.size(); ++i) {
+	size_type perm = coarse_ipvt[i] - 1;
+	if (i != perm) std::swap(L.x[i], L.x[perm]);
+      }
+      lower_tri_solve(coarse_lu, L.x, true);
+      upper_tri_solve(coarse_lu, L.x, false);
+    }
+    else {
+      std::fill(L.x.begin(), L.x.end(), value_type(0));
+      smooth(L, 2 * (nb_pre_smooth + nb_post_smooth), true);
+      smooth(L, 2 * (nb_pre_smooth + nb_post_smooth), false);
+    }
+  }
+
+  /** V-cycle from level l, for the right hand side levels[l].b. The
+      result is in levels[l].x. */
+  template <typename Matrix>
+  void amg_precond<Matrix>::vcycle(size_type l) const {
+    const level_type &L = levels[l];
+    if (l+1 == levels.size()) { coarse_solve(L); return; }
+    const level_type &Lc = levels[l+1];
+    size_type n = L.A.nr;
+
+    std::fill(L.x.begin(), L.x.end(), value_type(0));
+    smooth(L, nb_pre_smooth, true);
+    amg_residual_(L);
+    amg_csr_mult_vect_(L.Rt, L.r, Lc.b);
+    vcycle(l+1);
+    omp_slices(n, nb_omp_slices(n),
+	       [&](size_type, size_type i0, size_type i1) {
+      for (size_type i = i0; i < i1; ++i) {
+	value_type t(0);
+	for (size_type p = L.P.jc[i]; p < L.P.jc[i+1]; ++p)
+	  t += L.P.pr[p] * Lc.x[L.P.ir[p]];
+	L.x[i] += t;
+      }
+    });
+    smooth(L, nb_post_smooth, false);
+  }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void mult(const amg_precond<Matrix>& P, const V1 &v1, V2 &v2) {
+    GMM_ASSERT1(P.nb_levels() > 0, "The preconditioner is not built");
+    const amg_level<typename amg_precond<Matrix>::value_type> &L0
+      = P.level(0);
+    gmm::copy(v1, L0.b);
+    P.vcycle(0);
+    gmm::copy(L0.x, v2);
+  }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void transposed_mult(const amg_precond<Matrix>& P,const V1 &v1,V2 &v2)
+  { mult(P, v1, v2); }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void left_mult(const amg_precond<Matrix>& P, const V1 &v1, V2 &v2)
+  { mult(P, v1, v2); }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void right_mult(const amg_precond<Matrix>&, const V1 &v1, V2 &v2)
+  { copy(v1, v2); }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void transposed_left_mult(const amg_precond<Matrix>& P, const V1 &v1,
+			    V2 &v2)
+  { mult(P, v1, v2); }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void transposed_right_mult(const amg_precond<Matrix>&, const V1 &v1,
+			     V2 &v2)
+  { copy(v1, v2); }
+
+}
+
+#endif
+
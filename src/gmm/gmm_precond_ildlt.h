@@ -98,6 +98,8 @@ namespace gmm {
     typedef csr_matrix_ref<value_type *, size_type *, size_type *, 0> tm_type;
 
     tm_type U;
+    /* Level schedules of the sweeps by U and U^H, built by build_with(). */
+    tri_level_schedule<value_type> sU, sUh;
 
   protected :
     std::vector<value_type> Tri_val;
@@ -117,12 +119,18 @@ namespace gmm {
       Tri_ptr.resize(mat_nrows(A)+1);
       do_ildlt(A, typename principal_orientation_type<typename
 		  linalg_traits<Matrix>::sub_orientation>::potype());
+      build_schedules();
+    }
+    void build_schedules(void) {
+      sUh.build_if_useful(gmm::conjugated(U), true, true);
+      sU.build_if_useful(U, false, true);
     }
     ildlt_precond(const Matrix& A)  { build_with(A); }
     size_type memsize() const { 
       return sizeof(*this) + 
 	Tri_val.size() * sizeof(value_type) + 
-	(Tri_ind.size()+Tri_ptr.size()) * sizeof(size_type); 
+	(Tri_ind.size()+Tri_ptr.size()) * sizeof(size_type) +
+	sU.memsize() + sUh.memsize();
     }
   };
 
@@ -201,9 +209,9 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < mat_nrows(P.U); ++i) v2[i] /= P.D(i);
-    gmm::upper_tri_solve(P.U, v2, true);
+    gmm::upper_tri_solve(P.sU, P.U, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
@@ -213,26 +221,29 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < mat_nrows(P.U); ++i) v2[i] /= P.D(i);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2)
-  { copy(v1, v2); gmm::upper_tri_solve(P.U, v2, true);  }
+  { copy(v1, v2); gmm::upper_tri_solve(P.sU, P.U, v2, true);  }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_left_mult(const ildlt_precond<Matrix>& P, const V1 &v1,
 			    V2 &v2) {
     copy(v1, v2);
-    gmm::upper_tri_solve(P.U, v2, true);
+    gmm::upper_tri_solve(P.sU, P.U, v2, true);
     for (size_type i = 0; i < mat_nrows(P.U); ++i) v2[i] /= P.D(i);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_right_mult(const ildlt_precond<Matrix>& P, const V1 &v1,
 			     V2 &v2)
-  { copy(v1, v2); gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true); }
+  {
+    copy(v1, v2);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
+  }
 
 
 }
@@ -57,6 +57,8 @@ namespace gmm {
 
     row_matrix<svector> U;
     std::vector<magnitude_type> indiag;
+    /* Level schedules of the sweeps by U and U^H, built by build_with(). */
+    tri_level_schedule<value_type> sU, sUh;
 
   protected:
     size_type K;
@@ -73,13 +75,20 @@ namespace gmm {
       indiag.resize(std::min(mat_nrows(A), mat_ncols(A)));
       do_ildltt(A, typename principal_orientation_type<typename
 		linalg_traits<Matrix>::sub_orientation>::potype());
+      build_schedules();
+    }
+    void build_schedules(void) {
+      sUh.build_if_useful(gmm::conjugated(U), true, true);
+      sU.build_if_useful(U, false, true);
     }
     ildltt_precond(const Matrix& A, int k_, double eps_) 
       : U(mat_nrows(A),mat_ncols(A)), K(k_), eps(eps_) { build_with(A); }
     ildltt_precond(void) { K=10; eps = 1E-7; }
     ildltt_precond(size_type k_, double eps_) :  K(k_), eps(eps_) {}
     size_type memsize() const { 
-      return sizeof(*this) + nnz(U)*sizeof(value_type) + indiag.size() * sizeof(magnitude_type);
+      return sizeof(*this) + nnz(U)*sizeof(value_type)
+	+ indiag.size() * sizeof(magnitude_type)
+	+ sU.memsize() + sUh.memsize();
     }    
   };
 
@@ -135,9 +144,9 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void mult(const ildltt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < P.indiag.size(); ++i) v2[i] *= P.indiag[i];
-    gmm::upper_tri_solve(P.U, v2, true);
+    gmm::upper_tri_solve(P.sU, P.U, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
@@ -147,26 +156,29 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ildltt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < P.indiag.size(); ++i) v2[i] *= P.indiag[i];
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ildltt_precond<Matrix>& P, const V1 &v1, V2 &v2)
-  { copy(v1, v2); gmm::upper_tri_solve(P.U, v2, true); }
+  { copy(v1, v2); gmm::upper_tri_solve(P.sU, P.U, v2, true); }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_left_mult(const ildltt_precond<Matrix>& P, const V1 &v1,
 			    V2 &v2) {
     copy(v1, v2);
-    gmm::upper_tri_solve(P.U, v2, true);
+    gmm::upper_tri_solve(P.sU, P.U, v2, true);
     for (size_type i = 0; i < P.indiag.size(); ++i) v2[i] *= P.indiag[i];
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_right_mult(const ildltt_precond<Matrix>& P, const V1 &v1,
 			     V2 &v2)
-  { copy(v1, v2); gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true); }
+  {
+    copy(v1, v2);
+    gmm::lower_tri_solve(P.sUh, gmm::conjugated(P.U), v2, true);
+  }
 
 }
 
@@ -91,6 +91,9 @@ namespace gmm {
 
     tm_type U, L;
     bool invert;
+    /* Level schedules of the sweeps by L, U, L^T and U^T. Only those of
+       mult() are built, by build_with(), the other sweeps are sequential. */
+    tri_level_schedule<value_type> sL, sU, sLt, sUt;
   protected :
     std::vector<value_type> L_val, U_val;
     std::vector<size_type> L_ind, U_ind, L_ptr, U_ptr;
@@ -109,6 +112,18 @@ namespace gmm {
        U_ptr.resize(mat_nrows(A)+1);
        do_ilu(A, typename principal_orientation_type<typename
 	      linalg_traits<Matrix>::sub_orientation>::potype());
+       build_schedules();
+    }
+    void build_schedules(void) {
+      sL.clear(); sU.clear(); sLt.clear(); sUt.clear();
+      if (invert) {
+	sUt.build_if_useful(gmm::transposed(U), true, false);
+	sLt.build_if_useful(gmm::transposed(L), false, true);
+      }
+      else {
+	sL.build_if_useful(L, true, true);
+	sU.build_if_useful(U, false, false);
+      }
     }
     ilu_precond(const Matrix& A) { build_with(A); }
     ilu_precond(void) {}
@@ -116,7 +131,8 @@ namespace gmm {
       return sizeof(*this) + 
 	(L_val.size()+U_val.size()) * sizeof(value_type) + 
 	(L_ind.size()+L_ptr.size()) * sizeof(size_type) +
-	(U_ind.size()+U_ptr.size()) * sizeof(size_type); 
+	(U_ind.size()+U_ptr.size()) * sizeof(size_type) +
+	sL.memsize() + sU.memsize() + sLt.memsize() + sUt.memsize();
     }
   };
 
@@ -221,12 +237,12 @@ namespace gmm {
   void mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
     if (P.invert) {
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
     else {
-      gmm::lower_tri_solve(P.L, v2, true);
-      gmm::upper_tri_solve(P.U, v2, false);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
+      gmm::upper_tri_solve(P.sU, P.U, v2, false);
     }
   }
 
@@ -234,43 +250,43 @@ namespace gmm {
   void transposed_mult(const ilu_precond<Matrix>& P,const V1 &v1,V2 &v2) {
     gmm::copy(v1, v2);
     if (P.invert) {
-      gmm::lower_tri_solve(P.L, v2, true);
-      gmm::upper_tri_solve(P.U, v2, false);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
+      gmm::upper_tri_solve(P.sU, P.U, v2, false);
     }
     else {
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-    else gmm::lower_tri_solve(P.L, v2, true);
+    if (P.invert) gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+    else gmm::lower_tri_solve(P.sL, P.L, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
-    else gmm::upper_tri_solve(P.U, v2, false);
+    if (P.invert) gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
+    else gmm::upper_tri_solve(P.sU, P.U, v2, false);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_left_mult(const ilu_precond<Matrix>& P, const V1 &v1,
 			    V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(P.U, v2, false);
-    else gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+    if (P.invert) gmm::upper_tri_solve(P.sU, P.U, v2, false);
+    else gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_right_mult(const ilu_precond<Matrix>& P, const V1 &v1,
 			     V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(P.L, v2, true);
-    else gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+    if (P.invert) gmm::lower_tri_solve(P.sL, P.L, v2, true);
+    else gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
   }
 
 
@@ -108,6 +108,9 @@ namespace gmm {
 
     bool invert;
     LU_Matrix L, U;
+    /* Level schedules of the sweeps by L, U, L^T and U^T. Only those of
+       mult() are built, by build_with(), the other sweeps are sequential. */
+    tri_level_schedule<value_type> sL, sU, sLt, sUt;
 
   protected:
     size_type K;
@@ -125,6 +128,18 @@ namespace gmm {
       gmm::resize(U, mat_nrows(A), mat_ncols(A));
       do_ilut(A, typename principal_orientation_type<typename
 	      linalg_traits<Matrix>::sub_orientation>::potype());
+      build_schedules();
+    }
+    void build_schedules(void) {
+      sL.clear(); sU.clear(); sLt.clear(); sUt.clear();
+      if (invert) {
+	sUt.build_if_useful(gmm::transposed(U), true, false);
+	sLt.build_if_useful(gmm::transposed(L), false, true);
+      }
+      else {
+	sL.build_if_useful(L, true, true);
+	sU.build_if_useful(U, false, false);
+      }
     }
     ilut_precond(const Matrix& A, int k_, double eps_) 
       : L(mat_nrows(A), mat_ncols(A)), U(mat_nrows(A), mat_ncols(A)),
@@ -132,7 +147,8 @@ namespace gmm {
     ilut_precond(size_type k_, double eps_) :  K(k_), eps(eps_) {}
     ilut_precond(void) { K = 10; eps = 1E-7; }
     size_type memsize() const { 
-      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type);
+      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type) +
+	sL.memsize() + sU.memsize() + sLt.memsize() + sUt.memsize();
     }
   };
 
@@ -205,12 +221,12 @@ namespace gmm {
   void mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
     if (P.invert) {
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
     else {
-      gmm::lower_tri_solve(P.L, v2, true);
-      gmm::upper_tri_solve(P.U, v2, false);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
+      gmm::upper_tri_solve(P.sU, P.U, v2, false);
     }
   }
 
@@ -218,43 +234,43 @@ namespace gmm {
   void transposed_mult(const ilut_precond<Matrix>& P,const V1 &v1,V2 &v2) {
     gmm::copy(v1, v2);
     if (P.invert) {
-      gmm::lower_tri_solve(P.L, v2, true);
-      gmm::upper_tri_solve(P.U, v2, false);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
+      gmm::upper_tri_solve(P.sU, P.U, v2, false);
     }
     else {
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-    else gmm::lower_tri_solve(P.L, v2, true);
+    if (P.invert) gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+    else gmm::lower_tri_solve(P.sL, P.L, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
-    else gmm::upper_tri_solve(P.U, v2, false);
+    if (P.invert) gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
+    else gmm::upper_tri_solve(P.sU, P.U, v2, false);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_left_mult(const ilut_precond<Matrix>& P, const V1 &v1,
 			    V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(P.U, v2, false);
-    else gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+    if (P.invert) gmm::upper_tri_solve(P.sU, P.U, v2, false);
+    else gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_right_mult(const ilut_precond<Matrix>& P, const V1 &v1,
 			     V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(P.L, v2, true);
-    else gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+    if (P.invert) gmm::lower_tri_solve(P.sL, P.L, v2, true);
+    else gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
   }
 
 }
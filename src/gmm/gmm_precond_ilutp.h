@@ -67,6 +67,9 @@ namespace gmm {
     gmm::unsorted_sub_index indperm;
     gmm::unsorted_sub_index indperminv;
     mutable std::vector<value_type> temporary;
+    /* Level schedules of the sweeps by L, U, L^T and U^T. Only those of
+       mult() are built, by build_with(), the other sweeps are sequential. */
+    tri_level_schedule<value_type> sL, sU, sLt, sUt;
 
   protected:
     size_type K;
@@ -84,6 +87,18 @@ namespace gmm {
       gmm::resize(U, mat_nrows(A), mat_ncols(A));
       do_ilutp(A, typename principal_orientation_type<typename
 	      linalg_traits<Matrix>::sub_orientation>::potype());
+      build_schedules();
+    }
+    void build_schedules(void) {
+      sL.clear(); sU.clear(); sLt.clear(); sUt.clear();
+      if (invert) {
+	sUt.build_if_useful(gmm::transposed(U), true, false);
+	sLt.build_if_useful(gmm::transposed(L), false, true);
+      }
+      else {
+	sL.build_if_useful(L, true, true);
+	sU.build_if_useful(U, false, false);
+      }
     }
     ilutp_precond(const Matrix& A, size_type k_, double eps_) 
       : L(mat_nrows(A), mat_ncols(A)), U(mat_nrows(A), mat_ncols(A)),
@@ -91,7 +106,8 @@ namespace gmm {
     ilutp_precond(int k_, double eps_) :  K(k_), eps(eps_) {}
     ilutp_precond(void) { K = 10; eps = 1E-7; }
     size_type memsize() const { 
-      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type);
+      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type) +
+	sL.memsize() + sU.memsize() + sLt.memsize() + sUt.memsize();
     }
   };
 
@@ -200,13 +216,13 @@ namespace gmm {
   void mult(const ilutp_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     if (P.invert) {
       gmm::copy(gmm::sub_vector(v1, P.indperm), v2);
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
     else {
       gmm::copy(v1, P.temporary);
-      gmm::lower_tri_solve(P.L, P.temporary, true);
-      gmm::upper_tri_solve(P.U, P.temporary, false);
+      gmm::lower_tri_solve(P.sL, P.L, P.temporary, true);
+      gmm::upper_tri_solve(P.sU, P.U, P.temporary, false);
       gmm::copy(gmm::sub_vector(P.temporary, P.indperminv), v2);
     }
   }
@@ -215,14 +231,14 @@ namespace gmm {
   void transposed_mult(const ilutp_precond<Matrix>& P,const V1 &v1,V2 &v2) {
     if (P.invert) {
       gmm::copy(v1, P.temporary);
-      gmm::lower_tri_solve(P.L, P.temporary, true);
-      gmm::upper_tri_solve(P.U, P.temporary, false);
+      gmm::lower_tri_solve(P.sL, P.L, P.temporary, true);
+      gmm::upper_tri_solve(P.sU, P.U, P.temporary, false);
       gmm::copy(gmm::sub_vector(P.temporary, P.indperminv), v2);
     }
     else {
       gmm::copy(gmm::sub_vector(v1, P.indperm), v2);
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
   }
 
@@ -230,11 +246,11 @@ namespace gmm {
   void left_mult(const ilutp_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     if (P.invert) {
       gmm::copy(gmm::sub_vector(v1, P.indperm), v2);
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
     }
     else {
       copy(v1, v2);
-      gmm::lower_tri_solve(P.L, v2, true);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
     }
   }
 
@@ -242,11 +258,11 @@ namespace gmm {
   void right_mult(const ilutp_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     if (P.invert) {
       copy(v1, v2);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
     else {
       copy(v1, P.temporary);
-      gmm::upper_tri_solve(P.U, P.temporary, false);
+      gmm::upper_tri_solve(P.sU, P.U, P.temporary, false);
       gmm::copy(gmm::sub_vector(P.temporary, P.indperminv), v2);
     }
   }
@@ -256,12 +272,12 @@ namespace gmm {
 			    V2 &v2) {
     if (P.invert) {
       copy(v1, P.temporary);
-      gmm::upper_tri_solve(P.U, P.temporary, false);
+      gmm::upper_tri_solve(P.sU, P.U, P.temporary, false);
       gmm::copy(gmm::sub_vector(P.temporary, P.indperminv), v2);
     }
     else {
       copy(v1, v2);
-      gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+      gmm::upper_tri_solve(P.sLt, gmm::transposed(P.L), v2, true);
     }
   }
   
@@ -270,11 +286,11 @@ namespace gmm {
 			     V2 &v2) {
     if (P.invert) {
       copy(v1, v2);
-      gmm::lower_tri_solve(P.L, v2, true);
+      gmm::lower_tri_solve(P.sL, P.L, v2, true);
     }
     else {
       gmm::copy(gmm::sub_vector(v1, P.indperm), v2);
-      gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+      gmm::lower_tri_solve(P.sUt, gmm::transposed(P.U), v2, false);
     }
   }
 
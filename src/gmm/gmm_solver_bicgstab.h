@@ -91,6 +91,7 @@ namespace gmm {
     typedef typename number_traits<T>::magnitude_type R;
     typedef typename temporary_dense_vector<Vector>::vector_type temp_vector;
     
+    omp_vector_kernels omp_vk;
     T rho_1, rho_2(0), alpha(0), beta, omega(0);
     temp_vector p(vect_size(x)), phat(vect_size(x)), s(vect_size(x)),
       shat(vect_size(x)), 
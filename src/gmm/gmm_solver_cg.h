@@ -89,6 +89,7 @@ namespace gmm {
     typedef typename temporary_dense_vector<Vector1>::vector_type temp_vector;
     typedef typename linalg_traits<Vector1>::value_type T;
 
+    omp_vector_kernels omp_vk;
     T rho, rho_1(0), a;
     temp_vector p(vect_size(x)), q(vect_size(x)), r(vect_size(x)),
       z(vect_size(x));
@@ -129,6 +130,7 @@ namespace gmm {
     typedef typename temporary_dense_vector<Vector1>::vector_type temp_vector;
     typedef typename linalg_traits<Vector1>::value_type T;
 
+    omp_vector_kernels omp_vk;
     T rho, rho_1(0), a;
     temp_vector p(vect_size(x)), q(vect_size(x)), r(vect_size(x));
     iter.set_rhsnorm(gmm::sqrt(gmm::abs(vect_hp(PS, b, b))));
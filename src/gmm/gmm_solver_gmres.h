@@ -93,6 +93,7 @@ namespace gmm {
     typedef typename linalg_traits<Vec>::value_type T;
     typedef typename number_traits<T>::magnitude_type R;
 
+    omp_vector_kernels omp_vk;
     std::vector<T> w(vect_size(x)), r(vect_size(x)), u(vect_size(x));
     std::vector<T> c_rot(restart+1), s_rot(restart+1), s(restart+1);
     gmm::dense_matrix<T> H(restart+1, restart);
@@ -97,6 +97,7 @@ namespace gmm {
     typedef typename linalg_traits<Vector>::value_type T;
     typedef typename number_traits<T>::magnitude_type R;
 
+    omp_vector_kernels omp_vk;
     T delta(0), ep(0), beta(0), theta_1(0), gamma_1(0);
     T theta(0), gamma(1), eta(-1);
     R rho_1(0), rho, xi;
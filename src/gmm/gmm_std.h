@@ -126,6 +126,16 @@ inline void GMM_NOPERATION_(int) { }
 
 #include <gmm/gmm_arch_config.h>
 
+// With OpenMP, the sparse matrix-vector products and the vector kernels
+// of the iterative solvers are split between threads (see nb_omp_slices
+// and omp_vector_kernels in gmm_blas.h).
+#if defined(GETFEM_HAS_OPENMP) && !defined(GMM_USES_OPENMP)
+# define GMM_USES_OPENMP
+#endif
+#ifdef GMM_USES_OPENMP
+# include <omp.h>
+#endif
+
 namespace std {
 #if defined(__GNUC__) && (__cplusplus <= 201103L)
   template<typename _Tp>
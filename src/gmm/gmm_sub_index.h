@@ -84,9 +84,26 @@ namespace gmm {
     { return new basic_index(begin, end); }
     static pbasic_index create_rindex(pbasic_index pbi)
     { return new basic_index(pbi); }
-    static void attach(pbasic_index pbi) { if (pbi) pbi->nb_ref++; }
-    static void unattach(pbasic_index pbi)
-      { if (pbi && --(pbi->nb_ref) == 0) delete pbi; }
+    // The indices are shared by the copies of a sub_index, which can be
+    // made concurrently by the threads of the parallel gmm kernels.
+    static void attach(pbasic_index pbi) {
+      if (pbi) {
+#ifdef GMM_USES_OPENMP
+#       pragma omp atomic
+#endif
+	pbi->nb_ref++;
+      }
+    }
+    static void unattach(pbasic_index pbi) {
+      if (pbi) {
+	size_type nb;
+#ifdef GMM_USES_OPENMP
+#       pragma omp atomic capture
+#endif
+	nb = --(pbi->nb_ref);
+	if (nb == 0) delete pbi;
+      }
+    }
 
   };
 
@@ -106,8 +123,25 @@ namespace gmm {
 	{ first_ = std::min(first_, *it); last_ = std::max(last_, *it); }
     }
 
-    inline void test_rind(void) const
-    { if (!rind) rind = index_generator::create_rindex(ind); }
+    // The reverse index is built on the first need, possibly by several
+    // threads reading the same sub_index.
+    inline void test_rind(void) const {
+#ifdef GMM_USES_OPENMP
+      pbasic_index r;
+#     pragma omp atomic read seq_cst
+      r = rind;
+      if (!r) {
+#       pragma omp critical(gmm_sub_index_rind)
+	if (!rind) {
+	  r = index_generator::create_rindex(ind);
+#         pragma omp atomic write seq_cst
+	  rind = r;
+	}
+      }
+#else
+      if (!rind) rind = index_generator::create_rindex(ind);
+#endif
+    }
     size_type size(void) const { return ind->size(); }
     size_type first(void) const { return first_; }
     size_type last(void) const { return last_; }
@@ -211,10 +211,294 @@ namespace gmm {
 		      is_unit);
   }
 
+  /* ******************************************************************** */
+  /*		Level scheduled triangular solves               	  */
+  /* ******************************************************************** */
 
- 
+  /** Whether level schedules may be used for triangular systems of size
+      n, i.e. whether nb_omp_slices(n) > 1: gmm is compiled with
+      GMM_USES_OPENMP, several threads are available, n >=
+      GMM_OMP_MIN_SIZE and no parallel region is running.
+  */
+  inline bool tri_level_schedules_enabled(size_type n)
+  { return nb_omp_slices(n) > 1; }
 
+  /** Level schedule of a sparse triangular system, for multithreaded
+      triangular solves.
 
+      The unknowns are grouped in levels such that an unknown only
+      depends on unknowns of the previous levels. The unknowns of a
+      level are computed concurrently, with a barrier between two
+      levels. The analysis is done once by build(), or by
+      build_if_useful() which only builds the schedule if several threads
+      are available and if the levels are wide enough to be used; the
+      preconditioners call the latter in their build_with(), so that a
+      solve only reads the schedule. build() copies the
+      off-diagonal part of the matrix row-wise in level order (the
+      matrix may be accessed by rows or by columns, as
+      gmm::transposed(L) or gmm::conjugated(U)), so that a thread reads
+      a contiguous part of it. Each unknown is computed with the same
+      operations in the same order as in lower_tri_solve and
+      upper_tri_solve, hence the result is identical to the sequential
+      one. The schedule has to be rebuilt when the matrix changes.
+  */
+  template <typename T> class tri_level_schedule {
+  protected :
+    std::vector<size_type> order, level_ptr, ptr, ind;
+    std::vector<T> val, diag;
+    size_type n, nbl;
+
+    void add_entry(std::vector<size_type> &cnt, size_type i, size_type j,
+		   const T &e, bool count) {
+      if (count) ++cnt[i];
+      else { ind[cnt[i]] = j; val[cnt[i]] = e; ++cnt[i]; }
+    }
+    template <typename TriMatrix>
+    void copy_rows(const TriMatrix &M, bool lower, bool is_unit, row_major);
+    template <typename TriMatrix>
+    void copy_rows(const TriMatrix &M, bool lower, bool is_unit, col_major);
+    void compute_levels(bool lower);
+    template <typename TriMatrix>
+    void count_levels(const TriMatrix &M, bool lower, row_major);
+    template <typename TriMatrix>
+    void count_levels(const TriMatrix &M, bool lower, col_major);
+    // Below about 32 rows per thread and per level, the barriers cost
+    // more than the sequential sweep.
+    bool wide_enough(size_type ns) const { return n >= 32 * ns * nbl; }
+
+    template <typename VecX>
+    void solve_rows(VecX &x, size_type r0, size_type r1) const {
+      typename linalg_traits<VecX>::value_type t;
+      for (size_type r = r0; r < r1; ++r) {
+	size_type i = order[r];
+	const size_type *itj = ind.data() + ptr[r], *itje = ind.data()+ptr[r+1];
+	const T *itv = val.data() + ptr[r];
+	for (t = x[i]; itj != itje; ++itj, ++itv) t -= (*itv) * x[*itj];
+	if (diag.empty()) x[i] = t; else x[i] = t / diag[r];
+      }
+    }
+
+  public :
+    size_type nrows(void) const { return n; }
+    size_type nb_levels(void) const { return nbl; }
+    /** true if the schedule has not been built. */
+    bool empty(void) const { return ptr.empty(); }
+    void clear(void) {
+      n = nbl = 0;
+      order.clear(); level_ptr.clear(); ptr.clear(); ind.clear();
+      val.clear(); diag.clear();
+    }
+    size_type memsize() const {
+      return sizeof(*this) + (val.size() + diag.size()) * sizeof(T)
+	+ (order.size() + level_ptr.size() + ptr.size() + ind.size())
+	* sizeof(size_type);
+    }
+
+    /** Analyze the lower (or upper) triangular part of M, whose
+	diagonal is ignored if is_unit is true. */
+    template <typename TriMatrix>
+    void build(const TriMatrix &M, bool lower, bool is_unit = false);
+
+    /** x <-- T^{-1} * x. The levels are computed by several threads if
+	nb_omp_slices(n) > 1 and if they are wide enough. */
+    template <typename VecX> void solve(VecX &x) const;
+
+    /** If nb_omp_slices() gives several threads, counts the levels of
+	M and builds the schedule if they are wide enough. The schedule
+	is left empty otherwise. Returns whether it has been built. */
+    template <typename TriMatrix>
+    bool build_if_useful(const TriMatrix &M, bool lower, bool is_unit);
+
+    tri_level_schedule(void) : n(0), nbl(0) {}
+  };
+
+  template <typename T> template <typename TriMatrix>
+  void tri_level_schedule<T>::copy_rows(const TriMatrix &M, bool lower,
+					bool is_unit, row_major) {
+    typedef typename linalg_traits<TriMatrix>::const_sub_row_type ROW;
+    std::vector<size_type> cnt(n+1);
+    for (int count = 1; count >= 0; --count) {
+      if (!count) {
+	for (size_type i = 0; i < n; ++i) cnt[i+1] += cnt[i];
+	ptr = cnt; ind.resize(cnt[n]); val.resize(cnt[n]);
+      }
+      for (size_type i = 0; i < n; ++i) {
+	ROW c = mat_const_row(M, i);
+	typename linalg_traits<typename org_type<ROW>::t>::const_iterator
+	  it = vect_const_begin(c), ite = vect_const_end(c);
+	for (; it != ite; ++it) {
+	  size_type j = it.index();
+	  if (lower ? j < i : (j > i && j < n))
+	    add_entry(cnt, count ? i+1 : i, j, *it, count != 0);
+	}
+	if (count && !is_unit) diag[i] = c[i];
+      }
+    }
+  }
+
+  template <typename T> template <typename TriMatrix>
+  void tri_level_schedule<T>::copy_rows(const TriMatrix &M, bool lower,
+					bool is_unit, col_major) {
+    // Rows are filled in the order in which the column oriented
+    // lower_tri_solve and upper_tri_solve do their updates.
+    typedef typename linalg_traits<TriMatrix>::const_sub_col_type COL;
+    std::vector<size_type> cnt(n+1);
+    for (int count = 1; count >= 0; --count) {
+      if (!count) {
+	for (size_type i = 0; i < n; ++i) cnt[i+1] += cnt[i];
+	ptr = cnt; ind.resize(cnt[n]); val.resize(cnt[n]);
+      }
+      for (size_type jj = 0; jj < n; ++jj) {
+	size_type j = lower ? jj : n - 1 - jj;
+	COL c = mat_const_col(M, j);
+	typename linalg_traits<typename org_type<COL>::t>::const_iterator
+	  it = vect_const_begin(c), ite = vect_const_end(c);
+	for (; it != ite; ++it) {
+	  size_type i = it.index();
+	  if (lower ? (i > j && i < n) : i < j)
+	    add_entry(cnt, count ? i+1 : i, j, *it, count != 0);
+	}
+	if (count && !is_unit) diag[j] = c[j];
+      }
+    }
+  }
+
+  template <typename T>
+  void tri_level_schedule<T>::compute_levels(bool lower) {
+    std::vector<size_type> level(n), nptr(n+1), nind(ind.size());
+    std::vector<T> nval(val.size()), ndiag(diag.size());
+    size_type nl = 0;
+    for (size_type ii = 0; ii < n; ++ii) {
+      size_type i = lower ? ii : n - 1 - ii, l = 0;
+      for (size_type k = ptr[i]; k < ptr[i+1]; ++k)
+	l = std::max(l, level[ind[k]] + 1);
+      level[i] = l; nl = std::max(nl, l + 1);
+    }
+
+    level_ptr.assign(nl+1, 0);
+    for (size_type i = 0; i < n; ++i) ++(level_ptr[level[i]+1]);
+    for (size_type l = 0; l < nl; ++l) level_ptr[l+1] += level_ptr[l];
+    std::vector<size_type> pos(level_ptr.begin(), level_ptr.end() - 1);
+    order.resize(n);
+    for (size_type i = 0; i < n; ++i) order[pos[level[i]]++] = i;
+
+    for (size_type r = 0; r < n; ++r) {
+      size_type i = order[r], k0 = nptr[r];
+      nptr[r+1] = k0 + ptr[i+1] - ptr[i];
+      std::copy(ind.begin() + ptr[i], ind.begin() + ptr[i+1],
+		nind.begin() + k0);
+      std::copy(val.begin() + ptr[i], val.begin() + ptr[i+1],
+		nval.begin() + k0);
+      if (!diag.empty()) ndiag[r] = diag[i];
+    }
+    ptr.swap(nptr); ind.swap(nind); val.swap(nval); diag.swap(ndiag);
+  }
+
+  template <typename T> template <typename TriMatrix>
+  void tri_level_schedule<T>::build(const TriMatrix &M, bool lower,
+				    bool is_unit) {
+    GMM_ASSERT1(mat_nrows(M) == mat_ncols(M), "dimensions mismatch");
+    clear();
+    n = mat_nrows(M);
+    if (!is_unit) diag.resize(n);
+    copy_rows(M, lower, is_unit, typename principal_orientation_type<
+	      typename linalg_traits<TriMatrix>::sub_orientation>::potype());
+    compute_levels(lower);
+    nbl = level_ptr.size() - 1;
+  }
+
+  template <typename T> template <typename TriMatrix>
+  void tri_level_schedule<T>::count_levels(const TriMatrix &M, bool lower,
+					   row_major) {
+    typedef typename linalg_traits<TriMatrix>::const_sub_row_type ROW;
+    std::vector<size_type> level(n);
+    for (size_type ii = 0; ii < n; ++ii) {
+      size_type i = lower ? ii : n - 1 - ii, l = 0;
+      ROW c = mat_const_row(M, i);
+      typename linalg_traits<typename org_type<ROW>::t>::const_iterator
+	it = vect_const_begin(c), ite = vect_const_end(c);
+      for (; it != ite; ++it) {
+	size_type j = it.index();
+	if (lower ? j < i : (j > i && j < n)) l = std::max(l, level[j] + 1);
+      }
+      level[i] = l; nbl = std::max(nbl, l + 1);
+    }
+  }
+
+  template <typename T> template <typename TriMatrix>
+  void tri_level_schedule<T>::count_levels(const TriMatrix &M, bool lower,
+					   col_major) {
+    // The level of an unknown is final when its column is reached.
+    typedef typename linalg_traits<TriMatrix>::const_sub_col_type COL;
+    std::vector<size_type> level(n);
+    for (size_type jj = 0; jj < n; ++jj) {
+      size_type j = lower ? jj : n - 1 - jj;
+      nbl = std::max(nbl, level[j] + 1);
+      COL c = mat_const_col(M, j);
+      typename linalg_traits<typename org_type<COL>::t>::const_iterator
+	it = vect_const_begin(c), ite = vect_const_end(c);
+      for (; it != ite; ++it) {
+	size_type i = it.index();
+	if (lower ? (i > j && i < n) : i < j)
+	  level[i] = std::max(level[i], level[j] + 1);
+      }
+    }
+  }
+
+  template <typename T> template <typename TriMatrix>
+  bool tri_level_schedule<T>::build_if_useful(const TriMatrix &M,
+					      bool lower, bool is_unit) {
+    clear();
+    size_type ns = nb_omp_slices(mat_nrows(M));
+    if (ns < 2) return false;
+    GMM_ASSERT1(mat_nrows(M) == mat_ncols(M), "dimensions mismatch");
+    n = mat_nrows(M);
+    count_levels(M, lower, typename principal_orientation_type<typename
+		 linalg_traits<TriMatrix>::sub_orientation>::potype());
+    if (!wide_enough(ns)) return false;
+    build(M, lower, is_unit);
+    return true;
+  }
+
+  template <typename T> template <typename VecX>
+  void tri_level_schedule<T>::solve(VecX &x) const {
+    GMM_ASSERT2(vect_size(x) == n, "dimensions mismatch");
+    size_type ns = nb_omp_slices(n);
+    if (ns > 1 && wide_enough(ns)) {
+#ifdef GMM_USES_OPENMP
+      size_type nl = nb_levels();
+      #pragma omp parallel num_threads(int(ns))
+      {
+	size_type s = size_type(omp_get_thread_num());
+	size_type nt = size_type(omp_get_num_threads());
+	for (size_type l = 0; l < nl; ++l) {
+	  size_type r0 = level_ptr[l], m = level_ptr[l+1] - r0;
+	  solve_rows(x, r0 + (m * s) / nt, r0 + (m * (s+1)) / nt);
+	  #pragma omp barrier
+	}
+      }
+#endif
+    }
+    else solve_rows(x, 0, n);
+  }
+
+  /** Triangular solve using the level schedule sched of T if it has
+      been built, the sequential lower_tri_solve otherwise. */
+  template <typename TS, typename TriMatrix, typename VecX> inline
+  void lower_tri_solve(const tri_level_schedule<TS> &sched,
+		       const TriMatrix& T, VecX &x_, bool is_unit) {
+    if (!sched.empty()) sched.solve(const_cast<VecX&>(x_));
+    else lower_tri_solve(T, x_, is_unit);
+  }
+
+  /** Triangular solve using the level schedule sched of T if it has
+      been built, the sequential upper_tri_solve otherwise. */
+  template <typename TS, typename TriMatrix, typename VecX> inline
+  void upper_tri_solve(const tri_level_schedule<TS> &sched,
+		       const TriMatrix& T, VecX &x_, bool is_unit) {
+    if (!sched.empty()) sched.solve(const_cast<VecX&>(x_));
+    else upper_tri_solve(T, x_, is_unit);
+  }
 
 }
 
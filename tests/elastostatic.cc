@@ -213,6 +213,7 @@ struct elastostatic_problem {
   scalar_type residual;       /* max residual for iterative solvers          */
   bool mixed_pressure, refine;
   size_type dirichlet_version;
+  std::string lsolver_name;   /* linear solver, default one if empty       */
 
   std::string datafilename;
   bgeot::md_param PARAM;
@@ -279,6 +280,7 @@ void elastostatic_problem::init(void) {
   dirichlet_version
     = size_type(PARAM.int_value("DIRICHLET_VERSION",
 					       "Dirichlet version"));
+  lsolver_name = PARAM.string_value("LINEAR_SOLVER");
   datafilename = PARAM.string_value("ROOTFILENAME","Base name of data files.");
   scalar_type FT = PARAM.real_value("FT", "parameter for exact solution");
   residual = PARAM.real_value("RESIDUAL");
@@ -430,8 +432,12 @@ bool elastostatic_problem::solve(plain_vector &U) {
   gmm::resize(F, mf_rhs.nb_dof()*N);
   getfem::interpolation_function(mf_rhs, F, sol_u);
   model.add_initialized_fem_data("DirichletData", mf_rhs, F);
-  getfem::add_Dirichlet_condition_with_multipliers
-    (model, mim, "u", mf_u, DIRICHLET_BOUNDARY_NUM, "DirichletData");
+  if (dirichlet_version == 0)
+    getfem::add_Dirichlet_condition_with_multipliers
+      (model, mim, "u", mf_u, DIRICHLET_BOUNDARY_NUM, "DirichletData");
+  else
+    getfem::add_Dirichlet_condition_with_penalization
+      (model, mim, "u", 1E10, DIRICHLET_BOUNDARY_NUM, "DirichletData");
 
   gmm::iteration iter(residual, 1, 40000);
 #if GETFEM_PARA_LEVEL > 1
@@ -460,7 +466,13 @@ bool elastostatic_problem::solve(plain_vector &U) {
     gmm::copy(F, model.set_real_variable("DirichletData"));
     
     iter.init();
-    getfem::standard_solve(model, iter);
+    if (lsolver_name.size())
+      // Selected once the dofs are known, for the near nullspace of the
+      // algebraic multigrid solvers.
+      getfem::standard_solve(model, iter,
+			     getfem::rselect_linear_solver(model, lsolver_name));
+    else
+      getfem::standard_solve(model, iter);
     gmm::resize(U, mf_u.nb_dof());
     gmm::copy(model.real_variable("u"), U);
 
@@ -117,6 +117,21 @@ if ($err2 > $err1 / 4) {
   exit(1);
 }
 
+# 3D elasticity solved with the algebraic multigrid, which has to give the
+# solution of the default linear solver.
+$def3d = ' -d N=3 -d RESIDUAL=1E-12 -d NX=6 -d REFINE=0 -d DIRICHLET_VERSION=1'
+  . ' -d "MESH_FILE=\'structured:GT=\"GT_PK(3,1)\";SIZES=[1,1,1];NOISED=0\'"'
+  . ' -d "FEM_TYPE=\'FEM_PK(3,2)\'" -d "INTEGRATION=\'IM_TETRAHEDRON(6)\'"';
+$err1 = start_program($def3d);
+foreach $solver ("cg/amg", "cg/amg/jacobi", "gmres/amg/chebyshev") {
+  $err2 = start_program($def3d . " -d 'LINEAR_SOLVER=\"$solver\"'");
+  if (abs($err2 - $err1) > 1E-2 * $err1) {
+    print "Wrong solution with $solver: $err1 $err2\n";
+    exit(1);
+  }
+  print ".";
+}
+
 `rm -f $tmp`;
 
 print ".\n";
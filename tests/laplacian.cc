@@ -37,6 +37,7 @@
 #include "getfem/getfem_derivatives.h"
 #include "getfem/getfem_superlu.h"
 #include "gmm/gmm.h"
+#include <chrono>
 using std::endl; using std::cout; using std::cerr;
 using std::ends; using std::cin;
 
@@ -92,9 +93,12 @@ struct laplacian_problem {
 			      * (used if gen_dirichlet is true)
 			      */
   std::string datafilename;
+  std::string precond_name; /* preconditioner for gmres (ILU, ILUT, ...) */
   bgeot::md_param PARAM;
   
   void assembly(void);
+  template <typename PRECOND>
+  void solve_with(const PRECOND &P, gmm::iteration &iter, double time);
   bool solve(void);
   void init(void);
   void compute_error();
@@ -140,6 +144,8 @@ void laplacian_problem::init(void) {
   scalar_type FT = PARAM.real_value("FT", "parameter for exact solution");
   residual = PARAM.real_value("RESIDUAL");
   if (residual == 0.) residual = 1e-10;
+  precond_name = PARAM.string_value("PRECOND");
+  if (precond_name.size() == 0) precond_name = "ILUT";
   sol_K.resize(N);
   for (size_type j = 0; j < N; j++)
     sol_K[j] = ((j & 1) == 0) ? FT : -FT;
@@ -258,6 +264,35 @@ void laplacian_problem::assembly(void) {
 }
 
 
+/* Elapsed time. gmm::uclock_sec() is the processor time of all the
+   threads, which does not show the effect of multithreading. */
+static double wall_clock_sec(void) {
+  return std::chrono::duration<double>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename PRECOND>
+void laplacian_problem::solve_with(const PRECOND &P, gmm::iteration &iter,
+				   double time) {
+  cout << "Time to compute preconditionner : "
+       << gmm::uclock_sec() - time << " seconds\n";
+
+  // Time of an application of the preconditioner, i.e. of the forward
+  // and backward sweeps for the incomplete factorizations.
+  plain_vector V(gmm::vect_size(B));
+  size_type nb_appl = 10;
+  double t = wall_clock_sec();
+  for (size_type i = 0; i < nb_appl; ++i) gmm::mult(P, B, V);
+  cout << precond_name << " preconditioner on " << gmm::vect_size(B)
+       << " dofs, elapsed time per application : "
+       << (wall_clock_sec() - t) / double(nb_appl) << " seconds\n";
+
+  //gmm::HarwellBoeing_IO::write("SM", SM);
+
+  // gmm::cg(SM, U, B, P, iter);
+  gmm::gmres(SM, U, B, P, 50, iter);
+}
+
 bool laplacian_problem::solve(void) {
 
   // see_schmidt(SM, U, B);
@@ -265,23 +300,25 @@ bool laplacian_problem::solve(void) {
   cout << "Compute preconditionner\n";
   gmm::iteration iter(residual, 1, 40000);
   double time = gmm::uclock_sec();
-  if (1) {
+  if (precond_name != "SUPERLU") {
     // gmm::identity_matrix P;
-    // gmm::diagonal_precond<sparse_matrix_type> P(SM);
     // gmm::mr_approx_inverse_precond<sparse_matrix_type> P(SM, 10, 10E-17);
-    // gmm::ildlt_precond<sparse_matrix_type> P(SM);
-    // gmm::ildltt_precond<sparse_matrix_type> P(SM, 20, 1E-6);
-    gmm::ilut_precond<sparse_matrix_type> P(SM, 20, 1E-6);
-    // gmm::ilutp_precond<sparse_matrix_type> P(SM, 20, 1E-6);
-    // gmm::ilu_precond<sparse_matrix_type> P(SM);
-    cout << "Time to compute preconditionner : "
-	 << gmm::uclock_sec() - time << " seconds\n";
-
-  
-    //gmm::HarwellBoeing_IO::write("SM", SM);
-
-    // gmm::cg(SM, U, B, P, iter);
-    gmm::gmres(SM, U, B, P, 50, iter);
+    if (precond_name == "DIAGONAL")
+      solve_with(gmm::diagonal_precond<sparse_matrix_type>(SM), iter, time);
+    else if (precond_name == "ILU")
+      solve_with(gmm::ilu_precond<sparse_matrix_type>(SM), iter, time);
+    else if (precond_name == "ILUT")
+      solve_with(gmm::ilut_precond<sparse_matrix_type>(SM, 20, 1E-6),
+		 iter, time);
+    else if (precond_name == "ILUTP")
+      solve_with(gmm::ilutp_precond<sparse_matrix_type>(SM, 20, 1E-6),
+		 iter, time);
+    else if (precond_name == "ILDLT")
+      solve_with(gmm::ildlt_precond<sparse_matrix_type>(SM), iter, time);
+    else if (precond_name == "ILDLTT")
+      solve_with(gmm::ildltt_precond<sparse_matrix_type>(SM, 20, 1E-6),
+		 iter, time);
+    else GMM_ASSERT1(false, "Unknown preconditioner " << precond_name);
   } else {
     double rcond; 
     gmm::SuperLU_solve(SM, U, B, rcond); 
@@ -298,7 +335,7 @@ bool laplacian_problem::solve(void) {
     gmm::copy(Uaux, U);
   }
 
-  return (iter.converged());
+  return (precond_name == "SUPERLU" || iter.converged());
 }
 
 /* compute the error with respect to the exact solution */
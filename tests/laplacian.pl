@@ -85,6 +85,20 @@ start_program("-d 'MESH_TYPE=\"GT_PK(3,1)\"' -d 'FEM_TYPE=\"FEM_PK(3,2)\"' -d 'I
 print ".";
 start_program("-d 'MESH_TYPE=\"GT_PK(2,1)\"' -d 'FEM_TYPE=\"FEM_PK(2,2)\"' -d 'INTEGRATION=\"IM_TRIANGLE(4)\"' -d NX=5 -d GENERIC_DIRICHLET=0");
 print ".";
+{ local $ENV{OMP_NUM_THREADS} = 3; start_program("-d NX=20"); }
+print ".";
+{ local $ENV{OMP_NUM_THREADS} = 3; start_program("-d 'MESH_TYPE=\"GT_PK(3,1)\"' -d 'FEM_TYPE=\"FEM_PK(3,3)\"' -d 'INTEGRATION=\"IM_TETRAHEDRON(6)\"' -d NX=3 -d FT=0.01"); }
+print ".";
+# 3D Laplacian large enough for the level scheduled triangular solves.
+foreach $precond ("ILU", "ILDLT") {
+  local $ENV{OMP_NUM_THREADS} = 3;
+  start_program("-d 'MESH_TYPE=\"GT_LINEAR_QK(3)\"' -d 'FEM_TYPE=\"FEM_QK(3,1)\"' -d 'INTEGRATION=\"IM_GAUSS_PARALLELEPIPED(3,2)\"' -d NX=26 -d MESH_NOISED=0 -d 'PRECOND=\"$precond\"'");
+  print ".";
+}
+start_program("-d DOF_ORDERING=1");
+print ".";
+start_program("-d 'MESH_TYPE=\"GT_PK(3,1)\"' -d 'FEM_TYPE=\"FEM_PK(3,2)\"' -d 'INTEGRATION=\"IM_TETRAHEDRON(5)\"' -d NX=3 -d FT=0.01 -d DOF_ORDERING=2");
+print ".";
 start_program("-d 'INTEGRATION=\"IM_TRIANGLE(2)\"'");
 print ".";
 start_program("-d 'INTEGRATION=\"IM_TRIANGLE(19)\"'");
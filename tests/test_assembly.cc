@@ -20,6 +20,7 @@
 ===========================================================================*/
 #include "getfem/getfem_assembling.h"
 #include "getfem/getfem_generic_assembly.h"
+#include "getfem/getfem_models.h"
 #include "getfem/getfem_export.h"
 #include "getfem/getfem_regular_meshes.h"
 #include "getfem/getfem_partial_mesh_fem.h"
@@ -882,10 +883,508 @@ static void test_new_assembly(int N, int NX, int pK) {
                  (K, mim2, mf_u, mf_p, lambda2, mu2));
     }
 
+    if (all) { // Reuse of the compiled programs between two assemblies
+      workspace.clear_expressions();
+      workspace.add_expression("a*u.Test_u + Grad_p.Grad_Test_p", mim);
+      size_type nb_hits = workspace.nb_compiled_program_hits();
+      size_type nb_misses = workspace.nb_compiled_program_misses();
+      workspace.assembly(1);
+      base_vector V1 = workspace.assembled_vector();
+      workspace.assembly(1);
+      GMM_ASSERT1(workspace.nb_compiled_program_hits() == nb_hits+1 &&
+                  workspace.nb_compiled_program_misses() == nb_misses+1,
+                  "The compiled program has not been reused");
+      GMM_ASSERT1(gmm::vect_dist2(V1, workspace.assembled_vector()) < 1E-10,
+                  "Error in the reuse of a compiled program");
+
+      gmm::scale(U, scalar_type(2)); gmm::scale(P, scalar_type(2));
+      workspace.assembly(1);
+      GMM_ASSERT1(workspace.nb_compiled_program_hits() == nb_hits+2,
+                  "The compiled program has not been reused");
+      GMM_ASSERT1(gmm::vect_dist2(gmm::scaled(V1, scalar_type(2)),
+                                  workspace.assembled_vector()) < 1E-10,
+                  "Variable values not taken into account by a reused "
+                  "compiled program");
+
+      base_vector V2(gmm::vect_size(V1));
+      workspace.set_assembled_vector(V2);
+      workspace.assembly(1);
+      GMM_ASSERT1(workspace.nb_compiled_program_hits() == nb_hits+3,
+                  "The compiled program has not been reused for a new "
+                  "target vector");
+      GMM_ASSERT1(gmm::vect_dist2(gmm::scaled(V1, scalar_type(2)), V2)
+                  < 1E-10, "Error in the assembly into a new target vector");
+      gmm::clear(V2); // an external target vector is not cleared
+
+      a[0] = 6.0; gmm::scale(U, scalar_type(0.5));
+      workspace.assembly(1);
+      GMM_ASSERT1(workspace.nb_compiled_program_misses() == nb_misses+2,
+                  "Fixed size data change not detected");
+      GMM_ASSERT1(gmm::vect_dist2(gmm::scaled(V1, scalar_type(2)),
+                                  workspace.assembled_vector()) < 1E-10,
+                  "Error in the recompilation of a program");
+      a[0] = 3.0; gmm::scale(P, scalar_type(0.5));
+    }
+
+}
+
+
+// Comparison of the assembly options of the model with the default assembly.
+static void check_model_assembly(getfem::model &md,
+                                 const getfem::model_real_sparse_matrix &K,
+                                 const getfem::model_real_plain_vector &V,
+                                 const char *option) {
+  md.assembly(getfem::model::BUILD_ALL);
+  getfem::model_real_sparse_matrix K2(md.nb_dof(), md.nb_dof());
+  getfem::model_real_plain_vector V2(V);
+  gmm::copy(md.real_tangent_matrix(), K2);
+  gmm::add(gmm::scaled(K, scalar_type(-1)), K2);
+  gmm::add(gmm::scaled(md.real_rhs(), scalar_type(-1)), V2);
+  GMM_ASSERT1(gmm::mat_maxnorm(K2) < 1E-10 && gmm::vect_norminf(V2) < 1E-10,
+              "Assembly with " << option << " differs from the default one");
+}
+
+static void test_model_assembly_options(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {7, 5}, bgeot::simplex_geotrans(2, 1));
+  m.region(1) = getfem::outer_faces_of_mesh(m);
+
+  getfem::mesh_fem mf_u(m, 2), mf_p(m);
+  mf_u.set_classical_finite_element(2);
+  mf_p.set_classical_finite_element(1);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  md.add_fem_variable("p", mf_p);
+  gmm::fill_random(md.set_real_variable("u"));
+  gmm::fill_random(md.set_real_variable("p"));
+  getfem::add_nonlinear_term
+    (md, mim, "Grad_u:Grad_Test_u + p*Div_Test_u + Div_u*Test_p"
+     "+ (1+p*p)*Test_p");
+  getfem::add_nonlinear_term(md, mim, "[1,2].Test_u + p*Test_p", 1);
+
+  md.assembly(getfem::model::BUILD_ALL);
+  getfem::model_real_sparse_matrix K(md.nb_dof(), md.nb_dof());
+  gmm::copy(md.real_tangent_matrix(), K);
+  getfem::model_real_plain_vector V(md.real_rhs());
+
+  // The colored parallel assembly is used only on several threads.
+  md.set_colored_parallel_assembly(true);
+  check_model_assembly(md, K, V, "colored parallel assembly");
+  GMM_ASSERT1(getfem::global_thread_policy::num_threads() == 1
+              || md.nb_assembly_colors() > 1, "Coloring not applied");
+  md.set_colored_parallel_assembly(false);
+
+  md.set_atomic_residual_assembly(true);
+  check_model_assembly(md, K, V, "atomic residual assembly");
+  md.set_atomic_residual_assembly(false);
+
+  md.set_reuse_tangent_matrix_pattern(true);
+  check_model_assembly(md, K, V, "symbolic assembly");
+  gmm::scale(md.set_real_variable("p"), scalar_type(2));
+  md.assembly(getfem::model::BUILD_ALL); // numeric assembly only
+  gmm::copy(md.real_tangent_matrix(), K);
+  gmm::copy(md.real_rhs(), V);
+  md.set_reuse_tangent_matrix_pattern(false);
+  check_model_assembly(md, K, V, "reuse of the matrix pattern");
+
+  // The workspaces kept by the model have to follow the time step to its
+  // last digit.
+  getfem::add_nonlinear_term(md, mim, "1E6*timestep*Test_p");
+  md.set_time_step(1.0);
+  md.assembly(getfem::model::BUILD_RHS);
+  gmm::copy(md.real_rhs(), V);
+  md.set_time_step(1.0+1E-9);
+  md.assembly(getfem::model::BUILD_RHS);
+  gmm::add(gmm::scaled(V, scalar_type(-1)), md.real_rhs(), V);
+  GMM_ASSERT1(gmm::vect_norminf(V) > 1E-8, "Time step change not detected");
+}
+
+// The coloring of the elements follows the changes of the content of the
+// regions of the generic expressions.
+static void test_colored_assembly_region_change(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {8, 8}, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_classical_finite_element(1);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(2);
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv)
+    if (cv % 3 == 0) m.region(2).add(cv);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  gmm::fill_random(md.set_real_variable("u"));
+  getfem::add_nonlinear_term(md, mim, "(1+u*u)*Grad_u.Grad_Test_u", 2);
+  md.set_colored_parallel_assembly(true);
+  md.assembly(getfem::model::BUILD_ALL);
+
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv)
+    if (cv % 3 == 0) m.region(2).sup(cv); else m.region(2).add(cv);
+  md.assembly(getfem::model::BUILD_ALL);
+  getfem::model_real_sparse_matrix K(md.nb_dof(), md.nb_dof());
+  gmm::copy(md.real_tangent_matrix(), K);
+  getfem::model_real_plain_vector V(md.real_rhs());
+
+  md.set_colored_parallel_assembly(false);
+  md.assembly(getfem::model::BUILD_ALL);
+  gmm::add(gmm::scaled(md.real_tangent_matrix(), scalar_type(-1)), K);
+  gmm::add(gmm::scaled(md.real_rhs(), scalar_type(-1)), V);
+  GMM_ASSERT1(gmm::mat_maxnorm(K) < 1E-10 && gmm::vect_norminf(V) < 1E-10,
+              "Colored assembly on an outdated region");
+}
+
+// The atomic residual and the colored parallel assemblies share the tangent
+// matrix and the residual between the threads (two threads are set in
+// main). Several successive assemblies, reusing the compiled programs, have
+// to give the residual of the distributed assembly.
+static void test_shared_target_assembly(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {24, 24}, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_fem mf_u(m, 2);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  gmm::fill_random(md.set_real_variable("u"));
+  getfem::add_nonlinear_term(md, mim, "(1+Norm_sqr(u))*Grad_u:Grad_Test_u"
+                             "+ [1,2].Test_u");
+
+  md.assembly(getfem::model::BUILD_ALL);
+  getfem::model_real_sparse_matrix K(md.nb_dof(), md.nb_dof());
+  gmm::copy(md.real_tangent_matrix(), K);
+  getfem::model_real_plain_vector V(md.real_rhs());
+  scalar_type eps = 1E-12 * gmm::vect_norminf(V);
+
+  md.set_atomic_residual_assembly(true);
+  for (size_type i = 0; i < 5; ++i) {
+    md.assembly(getfem::model::BUILD_RHS);
+    GMM_ASSERT1(gmm::vect_dist2(V, md.real_rhs()) < eps,
+                "Atomic residual differs from the distributed one");
+  }
+  md.set_atomic_residual_assembly(false);
+
+  md.set_colored_parallel_assembly(true);
+  for (size_type i = 0; i < 5; ++i) {
+    md.assembly(getfem::model::BUILD_ALL);
+    GMM_ASSERT1(gmm::vect_dist2(V, md.real_rhs()) < eps,
+                "Colored residual differs from the distributed one");
+    getfem::model_real_sparse_matrix K2(md.nb_dof(), md.nb_dof());
+    gmm::copy(md.real_tangent_matrix(), K2);
+    gmm::add(gmm::scaled(K, scalar_type(-1)), K2);
+    GMM_ASSERT1(gmm::mat_maxnorm(K2) < 1E-12 * gmm::mat_maxnorm(K),
+                "Colored tangent matrix differs from the distributed one");
+  }
+  md.set_colored_parallel_assembly(false);
 }
 
+// The workspaces kept by the model reuse their compiled programs on all the
+// threads (two threads are set in main), although the per-thread copies of
+// the tangent matrix and of the residual change from one assembly to the
+// next.
+static void test_model_compiled_program_reuse(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {6, 6}, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  gmm::fill_random(md.set_real_variable("u"));
+  getfem::add_nonlinear_term(md, mim, "(1+u*u)*Grad_u.Grad_Test_u");
+
+  md.assembly(getfem::model::BUILD_ALL);
+  size_type nb_compilations = md.nb_generic_expressions_compilations();
+  getfem::model_real_sparse_matrix K(md.nb_dof(), md.nb_dof());
+  gmm::copy(md.real_tangent_matrix(), K);
+  getfem::model_real_plain_vector V(md.real_rhs());
+
+  md.assembly(getfem::model::BUILD_ALL);
+  GMM_ASSERT1(md.nb_generic_expressions_compilations() == nb_compilations,
+              "The generic expressions have been recompiled");
+  gmm::add(gmm::scaled(md.real_tangent_matrix(), scalar_type(-1)), K);
+  gmm::add(gmm::scaled(md.real_rhs(), scalar_type(-1)), V);
+  GMM_ASSERT1(gmm::mat_maxnorm(K) < 1E-10 && gmm::vect_norminf(V) < 1E-10,
+              "Error in the reuse of the compiled programs");
+}
+
+// Comparison of the matrix-free product with the assembled matrix.
+static void test_matrix_free_product(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {6, 5}, bgeot::parallelepiped_geotrans(2, 1));
+
+  getfem::mesh_fem mf_u(m, 2), mf_p(m);
+  mf_u.set_classical_finite_element(2);
+  mf_p.set_classical_finite_element(1);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::base_vector U(mf_u.nb_dof()), P(mf_p.nb_dof());
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, U.size()), U);
+  workspace.add_fem_variable("p", mf_p, gmm::sub_interval(U.size(), P.size()),
+                             P);
+  workspace.add_expression("Grad_u:Grad_Test_u + u.Test_u"
+                           "+ Grad_p.Grad_Test_p + (1+X(1))*p*Test_p", mim);
+  workspace.add_expression("0.1*(p*Div_Test_u + Div_u*Test_p)", mim);
+  size_type nbdof = workspace.nb_primary_dof();
+
+  getfem::model_real_sparse_matrix K(nbdof, nbdof);
+  workspace.set_assembled_matrix(K);
+  workspace.assembly(2);
+
+  getfem::ga_matrix_free_operator A(workspace);
+  GMM_ASSERT1(gmm::mat_nrows(A) == nbdof && gmm::mat_ncols(A) == nbdof,
+              "Wrong dimensions of the matrix-free operator");
+  getfem::base_vector X(nbdof), Y1(nbdof), Y2(nbdof);
+  gmm::fill_random(X);
+  gmm::mult(K, X, Y1);
+  gmm::mult(A, X, Y2);
+  gmm::add(gmm::scaled(Y1, scalar_type(-1)), Y2);
+  GMM_ASSERT1(gmm::vect_norminf(Y2) < 1E-10 * gmm::vect_norminf(Y1),
+              "Matrix-free product differs from the assembled matrix one");
+
+  // Resolution with an iterative solver using the operator only.
+  getfem::base_vector X1(nbdof), X2(nbdof);
+  gmm::iteration iter(1E-12);
+  gmm::gmres(K, X1, Y1, gmm::identity_matrix(), 50, iter);
+  iter.init();
+  gmm::gmres(A, X2, Y1, gmm::identity_matrix(), 50, iter);
+  gmm::add(gmm::scaled(X, scalar_type(-1)), X1);
+  gmm::add(gmm::scaled(X, scalar_type(-1)), X2);
+  GMM_ASSERT1(gmm::vect_norminf(X1) < 1E-8 && gmm::vect_norminf(X2) < 1E-8,
+              "Wrong solution with the matrix-free operator");
+}
 
+static void test_sum_factorization(size_type N, size_type K) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(N, 3); nsubdiv[0] = 4;
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::parallelepiped_geotrans(N, 1));
+  m.region(1) = getfem::outer_faces_of_mesh(m);
+
+  getfem::mesh_fem mf_u(m, bgeot::dim_type(N)), mf_p(m);
+  mf_u.set_classical_finite_element(bgeot::dim_type(K));
+  mf_p.set_classical_finite_element(bgeot::dim_type(K));
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(bgeot::dim_type(2*K));
+
+  getfem::base_vector U(mf_u.nb_dof()), P(mf_p.nb_dof());
+  gmm::fill_random(U); gmm::fill_random(P);
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, U.size()), U);
+  workspace.add_fem_variable("p", mf_p, gmm::sub_interval(U.size(), P.size()),
+                             P);
+  workspace.add_expression("(1+X(1))*Grad_u:Grad_Test_u + u.Test_u"
+                           "- p*Div_Test_u/(2+X(2)) + Grad_p.Grad_Test_p*p"
+                           "+ sin(Div_u)*Test_p", mim);
+  workspace.add_expression("u.Test_u + p*Test_p", mim, 1);
+  size_type nbdof = workspace.nb_primary_dof();
+
+  // Residual
+  GMM_ASSERT1(!workspace.sum_factorization(), "Sum factorization is opt-in");
+  workspace.set_sum_factorization(true);
+  workspace.assembly(1);
+  base_vector V1 = workspace.assembled_vector();
+  workspace.set_sum_factorization(false);
+  workspace.assembly(1);
+  base_vector V2 = workspace.assembled_vector();
+  GMM_ASSERT1(gmm::vect_dist2(V1, V2) < 1E-10 * gmm::vect_norm2(V2),
+              "Wrong assembly by sum factorization");
+
+  // Tangent matrix and matrix-free product
+  getfem::model_real_sparse_matrix Kt(nbdof, nbdof);
+  workspace.set_assembled_matrix(Kt);
+  workspace.assembly(2);
+  base_vector X(nbdof), Y1(nbdof), Y2(nbdof), Y3(nbdof);
+  gmm::fill_random(X);
+  gmm::mult(Kt, X, Y1);
+  workspace.matrix_free_product(X, Y2);
+  workspace.set_sum_factorization(true);
+  workspace.matrix_free_product(X, Y3);
+  GMM_ASSERT1(gmm::vect_dist2(Y1, Y2) < 1E-10 * gmm::vect_norm2(Y1) &&
+              gmm::vect_dist2(Y1, Y3) < 1E-10 * gmm::vect_norm2(Y1),
+              "Wrong matrix-free product by sum factorization");
+  GMM_ASSERT1(!workspace.variable_exists(workspace.matrix_free_input_name("u")),
+              "Matrix-free input left in the workspace");
+
+  // Model level switch
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  md.add_fem_variable("p", mf_p);
+  gmm::copy(U, md.set_real_variable("u"));
+  gmm::copy(P, md.set_real_variable("p"));
+  getfem::add_nonlinear_term(md, mim, "(1+X(1))*Grad_u:Grad_Test_u"
+                             "+ sin(Div_u)*Test_p + Grad_p.Grad_Test_p*p");
+  md.assembly(getfem::model::BUILD_RHS);
+  V1 = md.real_rhs();
+  GMM_ASSERT1(!md.sum_factorization(), "Sum factorization is opt-in");
+  md.set_sum_factorization(true);
+  md.assembly(getfem::model::BUILD_RHS);
+  GMM_ASSERT1(gmm::vect_dist2(V1, md.real_rhs()) < 1E-10*gmm::vect_norm2(V1),
+              "Wrong model assembly by sum factorization");
+}
+
+// Assembly with and without the fusion of the element-wise instructions
+// and the folding of the index permutations into the contractions.
+static void test_instruction_optimization(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {4, 5}, bgeot::simplex_geotrans(2, 1));
+
+  getfem::mesh_fem mf_u(m, 2);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(bgeot::dim_type(4));
+
+  getfem::base_vector U(mf_u.nb_dof());
+  gmm::fill_random(U);
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, U.size()), U);
+  workspace.add_expression("(1+X(1))*(Grad_u+Grad_u'):(Grad_u+Grad_u')"
+                           "+ 2*(u-X(2)*u).(u+u/3) - (Grad_u'-Grad_u):Grad_u"
+                           "+ Index_move_last(Grad_u,1):(Grad_u*Grad_u)"
+                           "+ Swap_indices(Grad_u,1,2):Grad_u",
+                           mim);
+  size_type nbdof = workspace.nb_primary_dof();
+
+  getfem::model_real_sparse_matrix K1(nbdof, nbdof), K2(nbdof, nbdof);
+  base_vector V1, V2;
+  scalar_type E1, E2;
+  size_type nb_removed[3];
+  for (size_type order = 0; order < 3; ++order) {
+    workspace.set_instruction_optimization(true);
+    workspace.set_assembled_matrix(K1);
+    workspace.assembly(order);
+    nb_removed[order] = workspace.nb_optimized_instructions();
+    if (order == 0) E1 = workspace.assembled_potential();
+    if (order == 1) V1 = workspace.assembled_vector();
+    workspace.set_instruction_optimization(false);
+    workspace.set_assembled_matrix(K2);
+    workspace.assembly(order);
+    GMM_ASSERT1(workspace.nb_optimized_instructions() == 0, "Internal error");
+    if (order == 0) E2 = workspace.assembled_potential();
+    if (order == 1) V2 = workspace.assembled_vector();
+  }
+  cout << "Instructions removed by the optimization: " << nb_removed[0]
+       << " (order 0), " << nb_removed[1] << " (order 1), "
+       << nb_removed[2] << " (order 2)" << endl;
+  GMM_ASSERT1(nb_removed[0] > 0 && nb_removed[1] > 0 && nb_removed[2] > 0,
+              "No instruction fused");
+  GMM_ASSERT1(gmm::abs(E1-E2) < 1E-10 * gmm::abs(E2),
+              "Wrong potential with optimized instructions");
+  GMM_ASSERT1(gmm::vect_dist2(V1, V2) < 1E-10 * gmm::vect_norm2(V2),
+              "Wrong vector with optimized instructions");
+  gmm::add(gmm::scaled(K2, scalar_type(-1)), K1);
+  GMM_ASSERT1(gmm::mat_maxnorm(K1) < 1E-10 * gmm::mat_maxnorm(K2),
+              "Wrong matrix with optimized instructions");
+}
 
+// Assembly with the integration point instructions in native code. The
+// interpreter is used if no compiler is available.
+static void test_native_code(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {4, 3, 3}, bgeot::simplex_geotrans(3, 1));
+
+  getfem::mesh_fem mf_u(m, 3);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(bgeot::dim_type(4));
+
+  getfem::base_vector U(mf_u.nb_dof()), mu(1, 2.), kappa(1, 5.);
+  gmm::fill_random(U); gmm::scale(U, scalar_type(0.01));
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, U.size()), U);
+  workspace.add_fixed_size_constant("mu", mu);
+  workspace.add_fixed_size_constant("kappa", kappa);
+  workspace.add_expression("(mu*(Id(3)+Grad_u)+(kappa*log(Det(Id(3)+Grad_u))"
+                           "-mu)*Inv(Id(3)+Grad_u')):Grad_Test_u"
+                           "+ (u.u)*(u/3-2*u).Test_u", mim);
+  size_type nbdof = workspace.nb_primary_dof();
+
+  getfem::model_real_sparse_matrix K1(nbdof, nbdof), K2(nbdof, nbdof);
+  base_vector V1, V2;
+  size_type nb_kernels[3] = {0, 0, 0};
+  for (size_type order = 1; order < 3; ++order) {
+    workspace.set_native_code(false);
+    workspace.set_assembled_matrix(K1);
+    workspace.assembly(order);
+    if (order == 1) V1 = workspace.assembled_vector();
+    workspace.set_native_code(true);
+    workspace.set_assembled_matrix(K2);
+    workspace.assembly(order);
+    nb_kernels[order] = workspace.nb_native_kernels();
+    if (order == 1) V2 = workspace.assembled_vector();
+  }
+  cout << "Lists of instructions in native code: " << nb_kernels[1]
+       << " (order 1), " << nb_kernels[2] << " (order 2)" << endl;
+#ifdef GETFEM_HAVE_DLOPEN
+  const char *cxx = getenv("GETFEM_NATIVE_CXX");
+  std::string cmd = std::string(cxx ? cxx : "c++")
+                  + " --version > /dev/null 2>&1";
+  if (std::system(cmd.c_str()) == 0)
+    GMM_ASSERT1(nb_kernels[1] > 0 && nb_kernels[2] > 0,
+                "No native code although a compiler is available");
+#endif
+  GMM_ASSERT1(gmm::vect_dist2(V1, V2) < 1E-10 * gmm::vect_norm2(V1),
+              "Wrong vector with native code");
+  gmm::add(gmm::scaled(K1, scalar_type(-1)), K2);
+  GMM_ASSERT1(gmm::mat_maxnorm(K2) < 1E-10 * gmm::mat_maxnorm(K1),
+              "Wrong matrix with native code");
+}
+
+// Assembly with and without the execution of the arithmetic instructions
+// on chunks of elements, on a domain and on its boundary.
+static void test_element_batching(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {5, 4}, bgeot::simplex_geotrans(2, 1));
+  m.region(1) = getfem::outer_faces_of_mesh(m);
+
+  getfem::mesh_fem mf_u(m, 2);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(bgeot::dim_type(4));
+
+  getfem::base_vector U(mf_u.nb_dof()), mu(1, 2.);
+  gmm::fill_random(U);
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, U.size()), U);
+  workspace.add_fixed_size_constant("mu", mu);
+  workspace.add_expression("(1+X(1))*(Grad_u+Grad_u'):(Grad_u+Grad_u')"
+                           "+ mu*(u-X(2)*u).(u+u/mu) - (Grad_u'-Grad_u):Grad_u"
+                           "+ Index_move_last(Grad_u,1):(Grad_u*Grad_u)"
+                           "+ Swap_indices(Grad_u,1,2):Grad_u", mim);
+  workspace.add_expression("mu*(u.u)*(u.u) + (Grad_u*Normal).u", mim, 1);
+  size_type nbdof = workspace.nb_primary_dof();
+
+  getfem::model_real_sparse_matrix K1(nbdof, nbdof), K2(nbdof, nbdof);
+  base_vector V1, V2;
+  scalar_type E1(0), E2(0);
+  for (size_type order = 0; order < 3; ++order) {
+    workspace.set_element_batching(0);
+    workspace.set_assembled_matrix(K1);
+    workspace.assembly(order);
+    if (order == 0) E1 = workspace.assembled_potential();
+    if (order == 1) V1 = workspace.assembled_vector();
+    workspace.set_element_batching(7);
+    workspace.set_assembled_matrix(K2);
+    workspace.assembly(order);
+    if (order == 0) E2 = workspace.assembled_potential();
+    if (order == 1) V2 = workspace.assembled_vector();
+  }
+  workspace.set_element_batching(0);
+  GMM_ASSERT1(gmm::abs(E1-E2) < 1E-10 * gmm::abs(E1),
+              "Wrong potential with element batching");
+  GMM_ASSERT1(gmm::vect_dist2(V1, V2) < 1E-10 * gmm::vect_norm2(V1),
+              "Wrong vector with element batching");
+  gmm::add(gmm::scaled(K1, scalar_type(-1)), K2);
+  GMM_ASSERT1(gmm::mat_maxnorm(K2) < 1E-10 * gmm::mat_maxnorm(K1),
+              "Wrong matrix with element batching");
+}
 
 int main(int argc, char *argv[]) {
 
@@ -894,6 +1393,19 @@ int main(int argc, char *argv[]) {
   
   test_new_assembly(2, 25, 2);
   test_new_assembly(3, 7, 2);
+  size_type nb_threads = getfem::true_thread_policy::num_threads();
+  getfem::set_num_threads(2); // For the parallel assembly of models.
+  test_model_assembly_options();
+  test_colored_assembly_region_change();
+  test_shared_target_assembly();
+  test_model_compiled_program_reuse();
+  getfem::set_num_threads(int(nb_threads));
+  test_matrix_free_product();
+  test_sum_factorization(2, 3);
+  test_sum_factorization(3, 2);
+  test_instruction_optimization();
+  test_native_code();
+  test_element_batching();
 
 
   // testbug();
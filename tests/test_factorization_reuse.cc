@@ -0,0 +1,168 @@
+/*===========================================================================
+
+ Copyright (C) 2026-2026 the GetFEM++ contributors.
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+===========================================================================*/
+
+/* Checks that the direct linear solvers keep their factorization: it is
+   skipped for an unchanged matrix, the ordering and symbolic analysis are
+   reused for a matrix having the same sparsity pattern, and a modified
+   Newton method reusing the factorization of the tangent matrix converges
+   to the same solution as the full Newton method.
+*/
+
+#include "getfem/getfem_regular_meshes.h"
+#include "getfem/getfem_model_solvers.h"
+
+using bgeot::size_type;
+using bgeot::scalar_type;
+typedef getfem::model_real_sparse_matrix sparse_matrix;
+typedef getfem::model_real_plain_vector plain_vector;
+typedef getfem::abstract_linear_solver<sparse_matrix, plain_vector>
+  linear_solver;
+
+// Tridiagonal matrix -1, d, -1.
+static void tridiagonal_matrix(sparse_matrix &A, scalar_type d) {
+  size_type n = gmm::mat_nrows(A);
+  for (size_type i = 0; i < n; ++i) {
+    A(i, i) = d;
+    if (i > 0) A(i, i-1) = A(i-1, i) = scalar_type(-1);
+  }
+}
+
+static void check_solution(const sparse_matrix &A, const plain_vector &x,
+                           const plain_vector &b, const char *name) {
+  plain_vector r(gmm::vect_size(b));
+  gmm::mult(A, x, gmm::scaled(b, scalar_type(-1)), r);
+  GMM_ASSERT1(gmm::vect_norm2(r) < 1E-10 * gmm::vect_norm2(b),
+              "Wrong solution with " << name);
+}
+
+static void check_factorization_counts(const linear_solver &solver,
+                                       size_type nf, size_type na,
+                                       const char *name, const char *what) {
+  GMM_ASSERT1(solver.nb_factorizations == nf && solver.nb_analyses == na,
+              name << ", " << what << ": " << solver.nb_factorizations
+              << " factorizations and " << solver.nb_analyses
+              << " analyses instead of " << nf << " and " << na);
+}
+
+// symbolic: whether the solver reuses its ordering and symbolic analysis
+// for a matrix having the same sparsity pattern.
+static void test_direct_solver(const linear_solver &solver, bool symbolic,
+                               const char *name) {
+  size_type n = 50;
+  sparse_matrix A(n, n);
+  plain_vector x(n), b(n);
+  tridiagonal_matrix(A, scalar_type(3));
+  gmm::fill_random(b);
+  gmm::iteration iter(1E-12);
+  solver(A, x, b, iter);
+  check_solution(A, x, b, name);
+  check_factorization_counts(solver, 1, 1, name, "first matrix");
+
+  // Unchanged matrix: the factorization is skipped.
+  gmm::fill_random(b);
+  iter.init();
+  solver(A, x, b, iter);
+  check_solution(A, x, b, name);
+  check_factorization_counts(solver, 1, 1, name, "unchanged matrix");
+
+  // Same sparsity pattern, new values: numerical factorization only.
+  tridiagonal_matrix(A, scalar_type(4));
+  iter.init();
+  solver(A, x, b, iter);
+  check_solution(A, x, b, name);
+  check_factorization_counts(solver, 2, symbolic ? 1 : 2, name,
+                             "new values");
+
+  // New sparsity pattern: complete factorization.
+  A(0, n-1) = scalar_type(1);
+  iter.init();
+  solver(A, x, b, iter);
+  check_solution(A, x, b, name);
+  check_factorization_counts(solver, 3, symbolic ? 2 : 3, name,
+                             "new pattern");
+
+  // Solve with the kept factorization of the last matrix.
+  gmm::fill_random(b);
+  iter.init();
+  GMM_ASSERT1(solver.solve_with_last_factorization(x, b, iter)
+              && iter.converged(), "No factorization kept by " << name);
+  check_solution(A, x, b, name);
+}
+
+// Modified Newton on a nonlinear reaction-diffusion problem.
+static void test_modified_newton(void) {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {8, 8}, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_fem mf(m);
+  mf.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf);
+  getfem::add_nonlinear_term
+    (md, mim, "Grad_u.Grad_Test_u + (u+2*u*u*u-10)*Test_u");
+
+  plain_vector U1, U2;
+  std::shared_ptr<linear_solver> solvers[2]
+    = { getfem::rselect_linear_solver(md, "dense_lu"),
+        getfem::rselect_linear_solver(md, "superlu") };
+  for (const auto &solver : solvers) {
+    gmm::iteration iter(1E-10, 0, 100);
+    gmm::clear(md.set_real_variable("u"));
+    getfem::standard_solve(md, iter, solver);
+    GMM_ASSERT1(iter.converged(), "Full Newton did not converge");
+    size_type nf = solver->nb_factorizations, nit = iter.get_iteration();
+    U1 = md.real_variable("u");
+
+    solver->set_factorization_reuse(10);
+    iter.init();
+    gmm::clear(md.set_real_variable("u"));
+    getfem::standard_solve(md, iter, solver);
+    GMM_ASSERT1(iter.converged(), "Modified Newton did not converge");
+    U2 = md.real_variable("u");
+    GMM_ASSERT1(gmm::vect_dist2(U1, U2) < 1E-8 * gmm::vect_norm2(U1),
+                "Modified Newton converged to a different solution");
+    GMM_ASSERT1(solver->nb_factorizations - nf < nit,
+                "The factorization of the tangent matrix was not reused");
+  }
+}
+
+int main(void) {
+
+  GMM_SET_EXCEPTION_DEBUG; // Exceptions make a memory fault, to debug.
+  FE_ENABLE_EXCEPT;        // Enable floating point exception for Nan.
+
+  try {
+    test_direct_solver(getfem::linear_solver_dense_lu<sparse_matrix,
+                       plain_vector>(), false, "dense LU");
+    test_direct_solver(getfem::linear_solver_superlu<sparse_matrix,
+                       plain_vector>(), true, "SuperLU");
+#ifdef GMM_USES_MUMPS
+    test_direct_solver(getfem::linear_solver_mumps<sparse_matrix,
+                       plain_vector>(), true, "MUMPS");
+#endif
+    test_modified_newton();
+  }
+  GMM_STANDARD_CATCH_ERROR;
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*===========================================================================
+
+ Copyright (C) 2026-2026 the GetFEM++ contributors.
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+===========================================================================*/
+
+/* Checks the algebraic multigrid preconditioner of gmm_precond_amg.h with
+   the conjugate gradient on 3D Poisson problems of increasing sizes: the
+   number of iterations has to stay nearly constant, for the three
+   smoothers, for a scalar problem and for a system of 3 fields with a
+   near nullspace of 3 modes.
+
+   Usage: test_gmm_amg [n] [-quick], the finest grid has n^3 nodes.
+*/
+
+#include "gmm/gmm.h"
+#include "gmm/gmm_precond_amg.h"
+#include <cstring>
+#include <iomanip>
+
+using std::endl; using std::cout;
+using gmm::size_type;
+
+typedef gmm::col_matrix<gmm::wsvector<double> > sparse_matrix;
+
+// 7 points Laplacian on a n x n x n grid, with q fields numbered node by
+// node and coupled on each node (the matrix stays positive definite).
+template <typename MAT> void poisson_matrix(MAT &A, size_type n,
+					    size_type q = 1) {
+  size_type N = n*n*n;
+  gmm::resize(A, q*N, q*N);
+  for (size_type k = 0; k < n; ++k)
+    for (size_type j = 0; j < n; ++j)
+      for (size_type i = 0; i < n; ++i) {
+	size_type l = i + n*(j + n*k);
+	size_type nb[6] = { size_type(-1), size_type(-1), size_type(-1),
+			    size_type(-1), size_type(-1), size_type(-1) };
+	if (i > 0) nb[0] = l-1;
+	if (i < n-1) nb[1] = l+1;
+	if (j > 0) nb[2] = l-n;
+	if (j < n-1) nb[3] = l+n;
+	if (k > 0) nb[4] = l-n*n;
+	if (k < n-1) nb[5] = l+n*n;
+	for (size_type a = 0; a < q; ++a) {
+	  // Dirichlet condition on the boundary of the domain.
+	  A(q*l+a, q*l+a) = (q > 1) ? 7.0 : 6.0;
+	  for (size_type b = 0; b < q; ++b)
+	    if (b != a) A(q*l+a, q*l+b) = 0.5;
+	  for (size_type m = 0; m < 6; ++m)
+	    if (nb[m] != size_type(-1)) A(q*l+a, q*nb[m]+a) = -1.0;
+	}
+      }
+}
+
+static const char *smoother_name[3]
+= { "Jacobi", "Gauss-Seidel", "Chebyshev" };
+
+template <typename T>
+size_type amg_iterations(const gmm::col_matrix<gmm::wsvector<T> > &A,
+			 gmm::amg_smoother_type s, size_type q,
+			 bool print) {
+  typedef gmm::col_matrix<gmm::wsvector<T> > MAT;
+  size_type N = gmm::mat_nrows(A);
+  std::vector<T> x(N), b(N), r(N);
+  for (size_type i = 0; i < N; ++i) b[i] = T(double(i % 17) - 8.0);
+
+  gmm::amg_precond<MAT> P;
+  P.smoother = s;
+  if (q > 1) {
+    // The constant of each field.
+    gmm::dense_matrix<double> B(N, q);
+    for (size_type i = 0; i < N; ++i) B(i, i % q) = 1.0;
+    P.set_near_nullspace(B, q);
+  }
+  P.build_with(A);
+  gmm::iteration iter(1E-8, 0, 500);
+  gmm::cg(A, x, b, P, iter);
+  GMM_ASSERT1(iter.converged(), "cg with amg did not converge with the "
+	      << smoother_name[s] << " smoother");
+  gmm::mult(A, gmm::scaled(x, T(-1)), b, r);
+  GMM_ASSERT1(gmm::vect_norm2(r) < 1E-7 * gmm::vect_norm2(b),
+	      "Wrong solution with amg");
+  if (print)
+    cout << std::setw(9) << N << std::setw(14) << smoother_name[s]
+	 << std::setw(8) << P.nb_levels() << std::setw(12)
+	 << std::setprecision(3) << P.operator_complexity()
+	 << std::setw(12) << iter.get_iteration() << endl;
+  return iter.get_iteration();
+}
+
+static void test_amg(size_type n, size_type q) {
+  cout << "cg with amg, " << q << " field(s)" << endl;
+  cout << "     size      smoother  levels  complexity  iterations" << endl;
+  size_type it[2][3];
+  for (size_type k = 0; k < 2; ++k) {
+    sparse_matrix A;
+    poisson_matrix(A, k ? n : n/2, q);
+    for (int s = 0; s < 3; ++s)
+      it[k][s] = amg_iterations(A, gmm::amg_smoother_type(s), q, true);
+  }
+  for (int s = 0; s < 3; ++s)
+    GMM_ASSERT1(it[1][s] <= it[0][s] + it[0][s] / 2 + 2,
+		"The number of iterations grows too much with the size for "
+		"the " << smoother_name[s] << " smoother");
+}
+
+static void test_complex(size_type n) {
+  sparse_matrix A;
+  poisson_matrix(A, n);
+  gmm::col_matrix<gmm::wsvector<std::complex<double> > > C;
+  gmm::resize(C, gmm::mat_nrows(A), gmm::mat_ncols(A));
+  gmm::copy(A, C);
+  amg_iterations(C, gmm::AMG_GAUSS_SEIDEL, 1, false);
+}
+
+int main(int argc, char *argv[]) {
+  size_type n = 40;
+  bool quick = false;
+  for (int i = 1; i < argc; ++i)
+    if (strcmp(argv[i], "-quick") == 0) quick = true;
+    else n = size_type(atoi(argv[i]));
+  if (quick) n = std::min(n, size_type(24));
+
+  try {
+#ifdef GMM_USES_OPENMP
+    // Uneven number of threads, independently of the available cores.
+    int max_threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+    test_amg(n, 1);
+    omp_set_num_threads(max_threads);
+#endif
+    test_amg(n, 1);
+    test_amg(quick ? n/2 : n*2/3, 3);
+    test_complex(n/2);
+  } GMM_STANDARD_CATCH_ERROR;
+
+  return 0;
+}
@@ -0,0 +1,361 @@
+/*===========================================================================
+
+ Copyright (C) 2026-2026 the GetFEM++ contributors.
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+===========================================================================*/
+
+/* Checks the thread partitioned matrix-vector products and vector kernels
+   of gmm_blas.h, the product of the block matrix of gmm_bsr_matrix.h and
+   the level scheduled triangular solves of the incomplete factorization
+   preconditioners against a plain serial computation, and measures their
+   scaling with the number of threads on 3D convection-diffusion stencils.
+
+   Usage: test_gmm_mult_omp [n] [-quick], the matrix has n^3 rows.
+*/
+
+#include "gmm/gmm.h"
+#include "gmm/gmm_bsr_matrix.h"
+#include <cstring>
+#include <iomanip>
+#include <chrono>
+
+using std::endl; using std::cout;
+using gmm::size_type;
+typedef gmm::sub_interval SUBI;
+
+static bool quick = false;
+
+template <typename MAT> void stencil_matrix(MAT &A, size_type n) {
+  size_type N = n*n*n;
+  gmm::resize(A, N, N);
+  for (size_type k = 0; k < n; ++k)
+    for (size_type j = 0; j < n; ++j)
+      for (size_type i = 0; i < n; ++i) {
+	size_type l = i + n*(j + n*k);
+	A(l, l) = 6.1;
+	// non symmetric couplings, to catch a transposition error.
+	if (i > 0)   A(l, l-1) = -1.2;
+	if (i < n-1) A(l, l+1) = -0.8;
+	if (j > 0)   A(l, l-n) = -1.0;
+	if (j < n-1) A(l, l+n) = -1.0;
+	if (k > 0)   A(l, l-n*n) = -1.0;
+	if (k < n-1) A(l, l+n*n) = -1.0;
+      }
+}
+
+// Same stencil for a system of 3 coupled fields, numbered node by node.
+template <typename MAT> void vector_stencil_matrix(MAT &A, size_type n) {
+  gmm::col_matrix<gmm::wsvector<double> > W;
+  stencil_matrix(W, n);
+  size_type N = n*n*n;
+  gmm::resize(A, 3*N, 3*N);
+  for (size_type l = 0; l < N; ++l) {
+    auto it = gmm::vect_const_begin(gmm::mat_const_col(W, l));
+    auto ite = gmm::vect_const_end(gmm::mat_const_col(W, l));
+    for (; it != ite; ++it)
+      for (size_type a = 0; a < 3; ++a)
+	for (size_type b = 0; b < 3; ++b)
+	  A(3*it.index()+a, 3*l+b)
+	    = (a == b) ? *it : 0.1 * double(a+1) * (*it) / 6.1;
+  }
+}
+
+template <typename MAT, typename VEC>
+void check_product(const MAT &A, const char *name, const VEC &x,
+		   const std::vector<double> &yref,
+		   const std::vector<double> &ytref) {
+  size_type N = gmm::vect_size(x);
+  std::vector<double> y(N), z(N, 1.0);
+  gmm::mult(A, x, y);
+  gmm::add(gmm::scaled(yref, -1.0), y);
+  GMM_ASSERT1(gmm::vect_norminf(y) < 1E-10, "Wrong product with " << name);
+
+  gmm::mult_add(A, x, z);
+  for (size_type i = 0; i < N; ++i) z[i] -= 1.0 + yref[i];
+  GMM_ASSERT1(gmm::vect_norminf(z) < 1E-10,
+	      "Wrong product and addition with " << name);
+
+  gmm::mult(gmm::transposed(A), x, y);
+  gmm::add(gmm::scaled(ytref, -1.0), y);
+  GMM_ASSERT1(gmm::vect_norminf(y) < 1E-10,
+	      "Wrong transposed product with " << name);
+}
+
+template <typename MAT>
+void check_solve(const MAT &A, const char *name,
+		 const std::vector<double> &b) {
+  size_type N = gmm::vect_size(b);
+  std::vector<double> x(N), r(N);
+  gmm::iteration iter(1E-10, 0, 10000);
+  gmm::bicgstab(A, x, b, gmm::identity_matrix(), iter);
+  GMM_ASSERT1(iter.converged(), "bicgstab did not converge with " << name);
+  gmm::mult(A, gmm::scaled(x, -1.0), b, r);
+  GMM_ASSERT1(gmm::vect_norm2(r) < 1E-8 * gmm::vect_norm2(b),
+	      "Wrong solution with " << name);
+}
+
+template <typename MAT, typename MAT2>
+void check_format(const MAT2 &W, const char *name) {
+  size_type N = gmm::mat_nrows(W), M = gmm::mat_ncols(W);
+  MAT A; gmm::copy(W, A);
+  GMM_ASSERT1(gmm::mat_nrows(A) == N && gmm::mat_ncols(A) == M,
+	      "Wrong dimensions for " << name);
+  for (size_type k = 0; k < 100; ++k) {
+    size_type i = size_type(rand()) % N, j = size_type(rand()) % M;
+    GMM_ASSERT1(A(i, j) == W(i, j), "Wrong component for " << name);
+  }
+
+  std::vector<double> x(M), y(N), yref(N), z(N);
+  gmm::fill_random(x);
+  gmm::mult(W, x, yref);
+  gmm::mult(A, x, y);
+  gmm::add(gmm::scaled(yref, -1.0), y);
+  GMM_ASSERT1(gmm::vect_norminf(y) < 1E-10, "Wrong product with " << name);
+
+  gmm::mult(A, gmm::scaled(x, -1.0), yref, z);
+  GMM_ASSERT1(gmm::vect_norminf(z) < 1E-10,
+	      "Wrong product and addition with " << name);
+
+  gmm::rsvector<double> ys(N);
+  gmm::mult(A, x, ys);
+  gmm::mult_add(A, gmm::scaled(x, -1.0), ys);
+  GMM_ASSERT1(gmm::vect_norminf(ys) < 1E-10,
+	      "Wrong product on a sparse vector with " << name);
+}
+
+// Elapsed time, gmm::uclock_sec() adds up the time of all the threads.
+static double wall_clock_sec(void) {
+  return std::chrono::duration<double>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename MAT>
+double time_products(const MAT &A, const std::vector<double> &x,
+		     size_type nb) {
+  std::vector<double> y(gmm::vect_size(x));
+  double t = wall_clock_sec();
+  for (size_type i = 0; i < nb; ++i) gmm::mult(A, x, y);
+  return wall_clock_sec() - t;
+}
+
+static void test_mult(size_type n) {
+  size_type N = n*n*n;
+  gmm::col_matrix<gmm::wsvector<double> > W;
+  stencil_matrix(W, n);
+  gmm::csc_matrix<double> Acsc; gmm::copy(W, Acsc);
+  gmm::csr_matrix<double> Acsr; gmm::copy(W, Acsr);
+  gmm::col_matrix<gmm::rsvector<double> > Acol(N, N); gmm::copy(W, Acol);
+  gmm::row_matrix<gmm::rsvector<double> > Arow(N, N); gmm::copy(W, Arow);
+
+  std::vector<double> x(N), yref(N), ytref(N), b(N, 1.0);
+  gmm::fill_random(x);
+
+  // Serial reference, straight on the compressed row storage.
+  for (size_type i = 0; i < N; ++i)
+    for (size_type p = Acsr.jc[i]; p < Acsr.jc[i+1]; ++p) {
+      yref[i] += Acsr.pr[p] * x[Acsr.ir[p]];
+      ytref[Acsr.ir[p]] += Acsr.pr[p] * x[i];
+    }
+
+  check_product(Acsc, "csc_matrix", x, yref, ytref);
+  check_product(Acsr, "csr_matrix", x, yref, ytref);
+  check_product(Acol, "col_matrix<rsvector>", x, yref, ytref);
+  check_product(Arow, "row_matrix<rsvector>", x, yref, ytref);
+  check_product(Acsc, "csc_matrix on a sub vector",
+		gmm::sub_vector(x, SUBI(0, N)), yref, ytref);
+
+  // The threads copy the sub_index, sharing its reference counted indices.
+  std::vector<size_type> ind(N);
+  for (size_type i = 0; i < N; ++i) ind[i] = i;
+  gmm::sub_index SI(ind);
+  SI.rindex(0); // builds the reverse index shared by the copies
+  check_product(gmm::sub_matrix(Acsc, SI, SI), "csc_matrix on a sub_index",
+		x, yref, ytref);
+  check_product(gmm::sub_matrix(Arow, SI, SI), "row_matrix on a sub_index",
+		x, yref, ytref);
+
+  // Vector kernels, on sub vectors to bypass the blas interface, threaded
+  // as in the iterative solvers only.
+  GMM_ASSERT1(gmm::nb_omp_vector_slices(N) == 1,
+	      "Vector kernels threaded outside the iterative solvers");
+  gmm::omp_vector_kernels omp_vk;
+  std::vector<double> z(N), w(N);
+  gmm::fill_random(z);
+  double sp = 0., nrm = 0.;
+  for (size_type i = 0; i < N; ++i) { sp += x[i]*z[i]; nrm += z[i]*z[i]; }
+  GMM_ASSERT1(gmm::abs(gmm::vect_sp(gmm::sub_vector(x, SUBI(0, N)),
+				    gmm::sub_vector(z, SUBI(0, N))) - sp)
+	      < 1E-10 * nrm, "Wrong scalar product");
+  GMM_ASSERT1(gmm::abs(gmm::vect_norm2(gmm::sub_vector(z, SUBI(0, N)))
+		       - sqrt(nrm)) < 1E-10 * sqrt(nrm), "Wrong norm");
+  gmm::copy(z, w);
+  gmm::add(gmm::scaled(gmm::sub_vector(x, SUBI(0, N)), 2.0),
+	   gmm::sub_vector(w, SUBI(0, N)));
+  for (size_type i = 0; i < N; ++i)
+    GMM_ASSERT1(gmm::abs(w[i] - z[i] - 2.0*x[i]) < 1E-12, "Wrong addition");
+  gmm::add(gmm::sub_vector(x, SUBI(0, N)), gmm::sub_vector(z, SUBI(0, N)),
+	   gmm::sub_vector(w, SUBI(0, N)));
+  for (size_type i = 0; i < N; ++i)
+    GMM_ASSERT1(gmm::abs(w[i] - z[i] - x[i]) < 1E-12, "Wrong addition");
+
+  check_solve(Acsc, "csc_matrix", b);
+  check_solve(Acsr, "csr_matrix", b);
+
+#ifdef GMM_USES_OPENMP
+  // An error in one of the threads is raised after the parallel region.
+  bool caught = false;
+  try {
+    gmm::omp_slices(N, 3, [](size_type s, size_type, size_type)
+		    { GMM_ASSERT1(s != 1, "Error in a slice"); });
+  } catch (const gmm::gmm_error &) { caught = true; }
+  GMM_ASSERT1(caught, "Error of a thread not raised");
+#endif
+}
+
+typedef std::vector<gmm::tri_level_schedule<double> *> schedules;
+
+// The level scheduled solves have to give exactly the sequential result.
+// The schedules of mult(), the first two of S, are built with the
+// preconditioner when they are useful, the other ones are never built.
+template <typename PRECOND>
+void check_tri_solve(PRECOND &P, const schedules &S, const char *name,
+		     size_type N) {
+  std::vector<double> x(N), y1(N), y2(N), yt1(N), yt2(N);
+  gmm::fill_random(x);
+  size_type ns = gmm::nb_omp_slices(N);
+  for (size_type i = 0; i < S.size(); ++i)
+    GMM_ASSERT1(S[i]->empty() == (i >= 2 || ns < 2
+				  || N < 32*ns*S[i]->nb_levels()),
+		"Wrong use of the level schedule for " << name);
+  cout << name << ": " << S[0]->nb_levels() << " and "
+       << S[1]->nb_levels() << " levels" << endl;
+  gmm::mult(P, x, y1); gmm::transposed_mult(P, x, yt1);
+
+  for (auto ps : S) ps->clear();
+  gmm::mult(P, x, y2); gmm::transposed_mult(P, x, yt2);
+  GMM_ASSERT1(y1 == y2, "Wrong level scheduled solve with " << name);
+  GMM_ASSERT1(yt1 == yt2,
+	      "Wrong transposed level scheduled solve with " << name);
+}
+
+template <typename PRECOND> schedules lu_schedules(PRECOND &P) {
+  if (P.invert) return schedules{&P.sUt, &P.sLt, &P.sL, &P.sU};
+  return schedules{&P.sL, &P.sU, &P.sLt, &P.sUt};
+}
+
+template <typename PRECOND> schedules ldlt_schedules(PRECOND &P)
+{ return schedules{&P.sUh, &P.sU}; }
+
+template <typename MAT> void test_tri_solve(const MAT &A, const char *name) {
+  size_type N = gmm::mat_nrows(A);
+  cout << "Level scheduled triangular solves on a " << name << endl;
+  gmm::ilu_precond<MAT> P1(A);
+  check_tri_solve(P1, lu_schedules(P1), "ilu_precond", N);
+  gmm::ilut_precond<MAT> P2(A, 10, 1E-7);
+  check_tri_solve(P2, lu_schedules(P2), "ilut_precond", N);
+  gmm::ilutp_precond<MAT> P3(A, 10, 1E-7);
+  check_tri_solve(P3, lu_schedules(P3), "ilutp_precond", N);
+  gmm::ildlt_precond<MAT> P4(A);
+  check_tri_solve(P4, ldlt_schedules(P4), "ildlt_precond", N);
+  gmm::ildltt_precond<MAT> P5(A, 10, 1E-7);
+  check_tri_solve(P5, ldlt_schedules(P5), "ildltt_precond", N);
+}
+
+static void test_tri_solves(size_type n) {
+  gmm::col_matrix<gmm::wsvector<double> > W;
+  stencil_matrix(W, n);
+  gmm::csr_matrix<double> Acsr; gmm::copy(W, Acsr);
+  gmm::csc_matrix<double> Acsc; gmm::copy(W, Acsc);
+  test_tri_solve(Acsr, "csr_matrix");
+  test_tri_solve(Acsc, "csc_matrix");
+}
+
+static void test_block_formats(size_type n) {
+  typedef gmm::col_matrix<gmm::wsvector<double> > model_matrix;
+  model_matrix W;
+  vector_stencil_matrix(W, n);
+  size_type N = gmm::mat_nrows(W);
+  check_format<gmm::bsr_matrix<double, 3> >(W, "bsr_matrix<3>");
+  gmm::sub_interval I1(0, N-1), I2(1, N-2);
+  check_format<gmm::bsr_matrix<double, 4> >
+    (gmm::sub_matrix(W, I1, I2), "bsr_matrix<4> with incomplete blocks");
+
+  gmm::bsr_matrix<double, 3> B; gmm::copy(W, B);
+  std::vector<double> b(N, 1.0);
+  check_solve(B, "bsr_matrix<3>", b);
+}
+
+static void scaling(size_type n) {
+  size_type N = 3*n*n*n, nb = quick ? 5 : 50;
+  gmm::col_matrix<gmm::wsvector<double> > W;
+  vector_stencil_matrix(W, n);
+  gmm::csc_matrix<double> Acsc; gmm::copy(W, Acsc);
+  gmm::csr_matrix<double> Acsr; gmm::copy(W, Acsr);
+  gmm::col_matrix<gmm::rsvector<double> > Acol(N, N); gmm::copy(W, Acol);
+  gmm::bsr_matrix<double, 3> Absr; gmm::copy(Acsr, Absr);
+  std::vector<double> x(N);
+  gmm::fill_random(x);
+
+  cout << "Matrix-vector product, " << N << " rows, " << nb
+       << " products" << endl;
+  cout << "threads   csr_matrix   csc_matrix   col_matrix   bsr_matrix"
+       << endl;
+#ifdef GMM_USES_OPENMP
+  int max_threads = omp_get_max_threads();
+  for (int nt = 1; nt <= std::max(omp_get_num_procs(), 1); nt *= 2) {
+    omp_set_num_threads(nt);
+#else
+  { int nt = 1;
+#endif
+    cout << std::setw(7) << nt << std::setw(13)
+	 << time_products(Acsr, x, nb) << std::setw(13)
+	 << time_products(Acsc, x, nb) << std::setw(13)
+	 << time_products(Acol, x, nb) << std::setw(13)
+	 << time_products(Absr, x, nb) << endl;
+  }
+#ifdef GMM_USES_OPENMP
+  omp_set_num_threads(max_threads);
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  size_type n = 40;
+  for (int i = 1; i < argc; ++i)
+    if (strcmp(argv[i], "-quick") == 0) quick = true;
+    else n = size_type(atoi(argv[i]));
+  if (quick) n = std::min(n, size_type(30));
+  srand(1459);
+
+  try {
+#ifdef GMM_USES_OPENMP
+    // Uneven number of threads, independently of the available cores.
+    int max_threads = omp_get_max_threads();
+    omp_set_num_threads(3);
+    test_mult(n);
+    test_block_formats(n/2);
+    test_tri_solves(n);
+    omp_set_num_threads(max_threads);
+#endif
+    test_mult(n);
+    test_block_formats(n/2);
+    test_tri_solves(n);
+    scaling(n);
+  } GMM_STANDARD_CATCH_ERROR;
+
+  return 0;
+}
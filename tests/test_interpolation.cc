@@ -148,11 +148,12 @@ void build_mesh(mesh& m, int MESH_TYPE, size_type dim, size_type N,
   if (noised) {
     for (dal::bv_visitor ip(m.points().index()); !ip.finished(); ++ip) {
       bool is_border = false;
-      base_node& P = m.points()[ip];
+      base_node P = m.points()[ip];
       for (size_type i=0; i < N; ++i) { if (gmm::abs(P[i]) < 1e-10 || gmm::abs(P[i]-1.) < 1e-10) is_border = true; }
       if (!is_border) { 
 	P = shake_func(P); 
 	for (size_type i=0; i < N; ++i) P[i] += 0.05*(1./double(NX))*gmm::random(double());
+	m.points().set_node(ip, P);
       }
     }
   }
@@ -26,6 +26,7 @@ using std::ends; using std::cin;
 using bgeot::base_node;
 using bgeot::size_type;
 using bgeot::dim_type;
+using bgeot::scalar_type;
 
 bool quick = false;
 
@@ -52,6 +53,11 @@ void verify_points_in_box(const std::vector<base_node>& v, bgeot::kdtree& tree,
   bgeot::kdtree_tab_type ipts;
   tree.points_in_box(ipts,bmin,bmax);
   for (size_type i=0; i < ipts.size(); ++i) bv2.add(ipts[i].i);
+  std::vector<size_type> idx;
+  tree.points_in_box(idx,bmin,bmax);
+  assert(idx.size() == ipts.size());
+  for (size_type i=0; i < idx.size(); ++i)
+    assert(tree.points()[idx[i]].i == ipts[i].i);
   if (bv1 != bv2) {
     cout << "verify_points_in_box: error, brute force gave points\n " << bv1 << ",\nwhile points_in_box returned : " << bv2 << "\n";
   } else { cout << "."; cout.flush(); }
@@ -106,6 +112,62 @@ void check_tree() {
   cout << "\nthe kdtree is ok!\n";
 }
 
+void check_nearest_neighbors() {
+  bgeot::kdtree tree;
+  std::vector<base_node> pts, pos;
+  for (size_type i=0; i < 500; ++i) {
+    base_node pt(3);
+    for (size_type k=0; k < 3; ++k) pt[k] = gmm::random();
+    if (i % 7 == 0) pt[2] = 0.5; /* points on a same plane */
+    pts.push_back(pt);
+    tree.add_point_with_id(pt, 2*i);
+  }
+  pts.push_back(pts[3]); tree.add_point_with_id(pts[3], 2*500);
+  for (size_type i=0; i < 200; ++i) {
+    base_node pt(3);
+    for (size_type k=0; k < 3; ++k) pt[k] = 1.4*gmm::random() - 0.2;
+    pos.push_back(pt);
+  }
+  pos.push_back(pts[10]);
+
+  size_type K = 7;
+  std::vector<size_type> ids, kids;
+  std::vector<scalar_type> dist2, kdist2;
+  tree.nearest_neighbors(pos, ids, dist2);
+  size_type m = tree.k_nearest_neighbors(pos, K, kids, kdist2);
+  assert(m == K && kids.size() == K*pos.size());
+  for (size_type i=0; i < pos.size(); ++i) {
+    std::vector<scalar_type> d(pts.size());
+    for (size_type j=0; j < pts.size(); ++j)
+      d[j] = gmm::vect_dist2_sqr(pos[i], pts[j]);
+    std::vector<scalar_type> ds(d);
+    std::sort(ds.begin(), ds.end());
+
+    bgeot::index_node_pair ipt;
+    scalar_type d2 = tree.nearest_neighbor(ipt, pos[i]);
+    assert(d2 == ds[0] && d[ipt.i/2] == ds[0]);
+    assert(dist2[i] == ds[0] && d[ids[i]/2] == ds[0]);
+
+    std::vector<size_type> ids1;
+    std::vector<scalar_type> dist21;
+    m = tree.k_nearest_neighbors(pos[i], K, ids1, dist21);
+    assert(m == K);
+    for (size_type l=0; l < K; ++l) {
+      assert(dist21[l] == ds[l] && d[ids1[l]/2] == ds[l]);
+      assert(kdist2[i*K+l] == ds[l] && d[kids[i*K+l]/2] == ds[l]);
+    }
+  }
+  /* more neighbors requested than points in the tree */
+  m = tree.k_nearest_neighbors(pos[0], 1000, kids, kdist2);
+  assert(m == pts.size());
+  for (size_type l=1; l < kdist2.size(); ++l)
+    assert(kdist2[l-1] <= kdist2[l]);
+  tree.clear();
+  tree.nearest_neighbors(pos, ids, dist2);
+  assert(ids[0] == size_type(-1) && dist2[0] < 0.);
+  cout << "nearest neighbors are ok!\n";
+}
+
 void speed_test(unsigned N, unsigned NPT, unsigned nrepeat) {
   bgeot::kdtree tree;
   base_node pt(N);
@@ -115,7 +177,9 @@ void speed_test(unsigned N, unsigned NPT, unsigned nrepeat) {
     for (dim_type k = 0; k < N; ++k) 
       pt[k] = gmm::random(double())*2.;
     tree.add_point(pt);
+#if !defined(GETFEM_HAS_OPENMP)
     assert(pt.refcnt()>1);
+#endif
   }
   t = gmm::uclock_sec();
   cout << "point list built in " << gmm::uclock_sec() - t << " seconds.\n";
@@ -144,6 +208,7 @@ void speed_test(unsigned N, unsigned NPT, unsigned nrepeat) {
 int main(int argc, char **argv) {
   if (argc == 2 && strcmp(argv[1],"-quick")==0) quick = true;
   check_tree();
+  check_nearest_neighbors();
   if (!quick)
     speed_test(3,300000,20000);
   else speed_test(2,10000,100);
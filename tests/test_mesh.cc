@@ -23,6 +23,11 @@
 #include "getfem/bgeot_comma_init.h"
 #include "getfem/getfem_export.h"
 #include "getfem/bgeot_node_tab.h"
+#include "getfem/getfem_mesh_fem.h"
+#include "getfem/getfem_mesh_fem_sum.h"
+#include "getfem/getfem_mesh_fem_product.h"
+#include "getfem/getfem_mesh_fem_level_set.h"
+#include "getfem/getfem_mesh_fem_global_function.h"
 using std::endl; using std::cout; using std::cerr;
 using std::ends; using std::cin;
 using getfem::size_type;
@@ -301,6 +306,195 @@ void test_region() {
   b.add(8);
   r = getfem::mesh_region::intersection(a,b);
   cout << "a=" << a << "\nb=" << b << "a inter b=" << r << "\n";
+  assert(r.index().card() == 3);
+  assert(r.is_in(2) && r.is_in(3,7) && !r.is_in(3,3));
+  assert(!r.is_in(9) && r.is_in(9,1) && r.is_in(9,5));
+
+  // entries added out of order are sorted and merged
+  getfem::size_type last = getfem::size_type(-1);
+  for (getfem::mr_visitor i(a); !i.finished(); ++i) {
+    assert(last == getfem::size_type(-1) || i.cv() >= last);
+    last = i.cv();
+  }
+  assert(a.index().card() == 5 && a.size() == 6);
+  assert(a.faces_of_convex(3).count() == 2);
+
+  r = getfem::mesh_region::merge(a,b);
+  assert(r.index().card() == 6 && r.is_in(8) && r.is_in(9,5) && r.is_in(9));
+  assert(r.is_in(3,2) && r.is_in(3,3) && r.is_in(3,7));
+
+  r = getfem::mesh_region::subtract(a,b);
+  assert(r.index().card() == 4 && !r.is_in(2) && r.is_in(3,3));
+  assert(!r.is_in(3,7) && r.is_in(4) && r.is_in(9));
+
+  a.sup(3,3); a.sup(4); a.sup(9);
+  a.swap_convex(5, 7);
+  assert(a.index().card() == 3 && a.is_in(7) && !a.is_in(5));
+  assert(a.is_in(2) && a.is_in(3,7));
+
+  // modifications during an iteration, as done by mesh::sup_convex
+  getfem::mesh_region c;
+  for (size_type i = 0; i < 100; ++i) c.add(2*i);
+  size_type nb = 0;
+  for (getfem::mr_visitor i(c); !i.finished(); ++i, ++nb) {
+    if (i.cv() == 150) c.swap_convex(150, 3);
+    c.sup_all(i.cv());
+    if (i.cv() == 100) { c.add(1); c.add(301); assert(c.is_in(1)); }
+    if (i.cv() == 120) assert(c.index().card() == 41); // compacts c
+  }
+  assert(nb == 101 && c.index().card() == 2 && c.is_in(1) && c.is_in(3));
+  assert(c.size() == 2 && !c.is_in(150) && !c.is_in(301));
+
+  // repeated out of order additions on a same convex
+  getfem::mesh_region d;
+  d.add(10); d.add(4, 1); d.add(4, 2); d.sup(4, 1); d.add(2);
+  assert(d.is_in(4, 2) && !d.is_in(4, 1) && d.index().card() == 3);
+
+  // point queries between removals and out of order additions
+  getfem::mesh_region e;
+  for (size_type i = 0; i < 50; ++i) e.add(2*i);
+  for (size_type i = 0; i < 50; ++i) {
+    e.sup(2*i); e.add(2*(49-i)+1, 3);
+    assert(!e.is_in(2*i) && e[2*i].none() && e.is_in(2*(49-i)+1, 3));
+    assert(e.faces_of_convex(2*(49-i)+1).count() == 1 && !e.is_empty());
+  }
+  e.sup(1, 3); e.sup_all(3);
+  assert(!e.is_in(1, 3) && e.index().card() == 48 && e.size() == 48);
+  for (size_type i = 2; i < 50; ++i) e.sup(2*i+1, 3);
+  assert(e.is_empty() && e.index().card() == 0);
+
+  // out of order additions, compacted before the parallel section
+  getfem::mesh_region f;
+  for (size_type i = 0; i < 50; ++i) f.add(99-2*i);
+  getfem::omp_distribute<size_type> nb_in;
+  GETFEM_OMP_PARALLEL_NO_PARTITION(
+    for (size_type i = 0; i < 100; ++i)
+      if (f.is_in(i)) ++(nb_in.thrd_cast());
+    assert(!f.is_empty());
+  )
+  for (size_type t = 0; t < nb_in.num_threads(); ++t) assert(nb_in(t) == 50);
+}
+
+static void check_frozen_structure(const bgeot::mesh_structure &ms) {
+  std::shared_ptr<const bgeot::mesh_structure_csr> pfs = ms.frozen_structure();
+  const bgeot::mesh_structure_csr &fs = *pfs;
+  GMM_ASSERT1(fs.nb_allocated_convex() == ms.nb_allocated_convex() &&
+              fs.nb_max_points() == ms.nb_max_points(), "Wrong sizes");
+  for (size_type cv = 0; cv < ms.nb_allocated_convex(); ++cv) {
+    if (!ms.convex_index().is_in(cv))
+      { GMM_ASSERT1(fs.nb_points_of_convex(cv) == 0, "Wrong convex"); continue; }
+    const bgeot::mesh_structure::ind_set &ct = ms.ind_points_of_convex(cv);
+    GMM_ASSERT1(fs.nb_points_of_convex(cv) == ct.size(), "Wrong convex");
+    for (size_type i = 0; i < ct.size(); ++i)
+      GMM_ASSERT1(fs.ind_point_of_convex(cv, i) == ct[i], "Wrong point");
+  }
+  for (size_type ip = 0; ip < ms.nb_max_points(); ++ip) {
+    const bgeot::mesh_structure::ind_cv_ct &ct = ms.convex_to_point(ip);
+    GMM_ASSERT1(fs.nb_convex_of_point(ip) == ct.size(), "Wrong point");
+    for (size_type i = 0; i < ct.size(); ++i)
+      GMM_ASSERT1(fs.ind_convex_of_point(ip, i) == ct[i], "Wrong convex");
+  }
+}
+
+void test_frozen_structure() {
+  getfem::mesh m;
+  getfem::regular_unit_mesh(m, {5, 4}, bgeot::parallelepiped_geotrans(2, 1));
+  m.freeze();
+  check_frozen_structure(m);
+  assert(m.frozen_structure()->short_indices());
+
+  bgeot::base_matrix G;
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv) {
+    m.points_of_convex(cv, G);
+    for (size_type i = 0; i < m.nb_points_of_convex(cv); ++i)
+      for (size_type k = 0; k < m.dim(); ++k)
+        assert(G(k, i) == m.points_of_convex(cv)[i][k]);
+  }
+
+  // Contiguous coordinates, kept up to date by the modifications of the
+  // nodes, in place when their number does not change.
+  const bgeot::node_tab &pts = m.points();
+  const getfem::scalar_type *X = pts.coordinates();
+  m.translation(base_small_vector(1., 2.));
+  assert(pts.coordinates() == X);
+  for (dal::bv_visitor ip(pts.index()); !ip.finished(); ++ip)
+    for (size_type k = 0; k < m.dim(); ++k)
+      assert(X[ip*m.dim()+k] == pts[ip][k]);
+  m.points().set_node(4, pts[4] + base_node(1., 0.));
+  assert(pts.coordinates() == X && X[4*m.dim()] == pts[4][0]);
+  assert(m.search_point(pts[4]) == 4);
+  m.points_of_convex(m.first_convex_of_point(4), G);
+  assert(G(0, m.ind_in_convex_of_point(m.first_convex_of_point(4), 4))
+         == pts[4][0]);
+  std::vector<size_type> ind{5, 2, 4};
+  pts.gather_nodes(ind.begin(), ind.end(), G);
+  for (size_type i = 0; i < ind.size(); ++i)
+    for (size_type k = 0; k < m.dim(); ++k)
+      assert(G(k, i) == pts[ind[i]][k]);
+
+  // The compact copy is rebuilt after any modification, the one held
+  // before staying valid.
+  auto fs0 = m.frozen_structure();
+  m.sup_convex(3);
+  check_frozen_structure(m);
+  assert(fs0->nb_points_of_convex(3) == 4 && m.frozen_structure() != fs0);
+  m.add_convex_by_points(bgeot::simplex_geotrans(2, 1),
+                         std::vector<base_node>{base_node(2., 0.),
+                             base_node(3., 0.), base_node(2., 1.)}.begin());
+  check_frozen_structure(m);
+  m.optimize_structure();
+  check_frozen_structure(m);
+  getfem::mesh m2(m);
+  assert(m2.is_frozen());
+  check_frozen_structure(m2);
+
+  // Same dof slicing with a frozen mesh.
+  getfem::mesh_fem mf(m, 2);
+  mf.set_classical_finite_element(2);
+  std::vector<double> U(mf.nb_dof()), c1, c2;
+  for (size_type i = 0; i < U.size(); ++i) U[i] = double(i);
+  assert(mf.frozen_dof_structure() != nullptr);
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv) {
+    getfem::slice_vector_on_basic_dof_of_element(mf, U, cv, c1);
+    std::vector<size_type> dofs(mf.ind_basic_dof_of_element(cv).begin(),
+                                mf.ind_basic_dof_of_element(cv).end());
+    c2.resize(dofs.size());
+    for (size_type i = 0; i < dofs.size(); ++i) c2[i] = U[dofs[i]];
+    assert(c1 == c2);
+  }
+  m.freeze(false);
+  assert(mf.frozen_dof_structure() == nullptr);
+}
+
+void test_bulk_node_insertion() {
+  // Points on a grid with duplicates, slightly perturbed.
+  std::vector<base_node> pts;
+  for (size_type k = 0; k < 3; ++k)
+    for (size_type i = 0; i < 20; ++i)
+      for (size_type j = 0; j < 20; ++j) {
+        base_node P(double(i)*0.1, double(j)*0.1, 0.5);
+        if (k) P[0] += double(k)*1e-14;
+        pts.push_back(P);
+      }
+  bgeot::node_tab nt1, nt2;
+  std::vector<size_type> ind;
+  nt1.add_node(base_node(0.5, 0.5, 0.5));
+  nt2.add_node(base_node(0.5, 0.5, 0.5));
+  nt2.add_nodes(pts, ind);
+  assert(nt2.card() == 400 && ind.size() == pts.size());
+  for (size_type i = 0; i < pts.size(); ++i) {
+    assert(ind[i] == nt1.add_node(pts[i]));
+    assert(gmm::vect_dist2(nt2[ind[i]], pts[i]) < 1e-10);
+  }
+  // Merging radius and no merging between the new points.
+  nt2.add_nodes(std::vector<base_node>{base_node(0.5, 0.5, 0.51),
+        base_node(0.5, 0.5, 0.51)}, ind, 0.02, false);
+  assert(ind[0] == 0 && ind[1] == 0 && nt2.card() == 400);
+  nt2.add_nodes(std::vector<base_node>{base_node(5., 5., 5.),
+        base_node(5., 5., 5.)}, ind, 0., false);
+  assert(ind[0] != ind[1] && nt2.card() == 402);
+  nt2.add_nodes(pts, ind, -1.);
+  assert(nt2.card() == 402 + pts.size());
 }
 
 void test_convex_ref() {
@@ -442,9 +636,12 @@ void test_mesh_building(int dim, int Nsubdiv) {
 
   // shake a little bit the mesh
   getfem::mesh::PT_TAB &pts = m.points();
-  for (size_type i = 0; i < m.nb_points(); ++i)
+  for (size_type i = 0; i < m.nb_points(); ++i) {
+    base_node P = pts[i];
     for (int k = 0; k < dim; ++k)
-      pts[i][k] += gmm::random(double()) * 1e-10;
+      P[k] += gmm::random(double()) * 1e-10;
+    pts.set_node(i, P);
+  }
   getfem::mesh_fem mf2(m);
   mf2.set_finite_element( getfem::classical_fem(pgt, 1) );
   cout << "nb points = " << m.nb_points()
@@ -630,8 +827,135 @@ void test_incomplete_Q2(void) {
 
 
 
-int main(void) {
+void test_renumbering(getfem::mesh::renumbering_method method) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(3, 5);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::simplex_geotrans(3, 1));
+  getfem::mesh_region border_faces;
+  getfem::outer_faces_of_mesh(m, border_faces);
+  for (getfem::mr_visitor i(border_faces); !i.finished(); ++i)
+    if (gmm::abs(m.points_of_face_of_convex(i.cv(), i.f())[0][0]) < 1e-10
+        && gmm::abs(m.points_of_face_of_convex(i.cv(), i.f())[1][0]) < 1e-10
+        && gmm::abs(m.points_of_face_of_convex(i.cv(), i.f())[2][0]) < 1e-10)
+      m.region(1).add(i.cv(), i.f());
+  m.region(2).add(3);
+  base_node c3 = gmm::mean_value(m.points_of_convex(3));
+  size_type nbf = m.region(1).size();
+  getfem::scalar_type vol = 0;
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv)
+    vol += m.convex_area_estimate(cv);
+
+  getfem::mesh m2(m);
+  m2.optimize_structure(method);
+  assert(m2.nb_convex() == m.nb_convex() && m2.nb_points() == m.nb_points());
+  getfem::scalar_type vol2 = 0;
+  for (dal::bv_visitor cv(m2.convex_index()); !cv.finished(); ++cv) {
+    vol2 += m2.convex_area_estimate(cv);
+    for (size_type ip : m2.ind_points_of_convex(cv)) {
+      const auto &cvs = m2.convex_to_point(ip);
+      assert(std::find(cvs.begin(), cvs.end(), cv) != cvs.end());
+    }
+  }
+  assert(gmm::abs(vol - vol2) < 1e-10);
+  assert(m2.region(1).size() == nbf);
+  for (getfem::mr_visitor i(m2.region(1)); !i.finished(); ++i)
+    for (const base_node &pt : m2.points_of_face_of_convex(i.cv(), i.f()))
+      assert(gmm::abs(pt[0]) < 1e-10);
+  assert(m2.region(2).index().card() == 1);
+  size_type cv3 = m2.region(2).index().first_true();
+  assert(gmm::vect_dist2(gmm::mean_value(m2.points_of_convex(cv3)), c3)
+         < 1e-10);
+}
 
+/* The parallel enumeration of the dofs gives the serial numbering, and
+   the dof orderings give a permutation of it. fem2 is set on one convex
+   over three, for non-conforming neighbourhoods. */
+void test_dof_enumeration(bgeot::pgeometric_trans pgt, size_type nsub,
+                          const std::string &fem1, const std::string &fem2,
+                          getfem::dim_type Q) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(pgt->dim(), nsub);
+  getfem::regular_unit_mesh(m, nsubdiv, pgt);
+  getfem::mesh_fem mf(m, Q);
+  mf.set_finite_element(getfem::fem_descriptor(fem1));
+  for (dal::bv_visitor cv(m.convex_index()); !cv.finished(); ++cv)
+    if (cv % 3 == 1) mf.set_finite_element(cv, getfem::fem_descriptor(fem2));
+
+  mf.enumerate_dof_serial();
+  std::vector<size_type> serial_dofs;
+  for (dal::bv_visitor cv(mf.convex_index()); !cv.finished(); ++cv)
+    for (size_type d : mf.ind_basic_dof_of_element(cv))
+      serial_dofs.push_back(d);
+  size_type nbd = mf.nb_basic_dof(), k = 0;
+  mf.enumerate_dof_parallel();
+  assert(mf.nb_basic_dof() == nbd);
+  for (dal::bv_visitor cv(mf.convex_index()); !cv.finished(); ++cv)
+    for (size_type d : mf.ind_basic_dof_of_element(cv))
+      assert(d == serial_dofs[k++]);
+
+  mf.set_parallel_dof_enumeration(true);
+  mf.set_dof_ordering(getfem::mesh_fem::DOF_ORDERING_RCM);
+  assert(mf.nb_basic_dof() == nbd);
+  dal::bit_vector bv;
+  for (size_type d : mf.dof_permutation()) bv.add(d);
+  assert(bv.card() == nbd && bv.last_true()+1 == nbd);
+  k = 0;
+  for (dal::bv_visitor cv(mf.convex_index()); !cv.finished(); ++cv)
+    for (size_type d : mf.ind_basic_dof_of_element(cv))
+      assert(d == mf.dof_permutation()[serial_dofs[k++]]);
+}
+
+static void check_dof_ordering(getfem::mesh_fem &mf) {
+  size_type nbd = mf.nb_basic_dof();
+  assert(nbd > 0 && mf.dof_permutation().empty());
+  mf.set_dof_ordering(getfem::mesh_fem::DOF_ORDERING_RCM);
+  assert(mf.nb_basic_dof() == nbd && mf.dof_permutation().size() == nbd);
+  dal::bit_vector bv;
+  for (size_type d : mf.dof_permutation()) bv.add(d);
+  assert(bv.card() == nbd && bv.last_true()+1 == nbd);
+}
+
+/* The mesh_fem built on other ones are enumerated by mesh_fem and
+   follow the dof ordering. */
+void test_derived_dof_ordering() {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(2, 6);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_fem mf1(m), mf2(m);
+  mf1.set_finite_element(getfem::fem_descriptor("FEM_PK(2,1)"));
+  mf2.set_finite_element(getfem::fem_descriptor("FEM_PK(2,2)"));
+
+  getfem::mesh_fem_sum mfs(m);
+  mfs.set_mesh_fems(mf1, mf2);
+  check_dof_ordering(mfs);
+
+  getfem::mesh_fem_product mfp(mf1, mf2);
+  dal::bit_vector enriched;
+  for (size_type d = 0; d < mf1.nb_basic_dof(); ++d)
+    if (mf1.point_of_basic_dof(d)[0] < 0.5) enriched.add(d);
+  mfp.set_enrichment(enriched);
+  check_dof_ordering(mfp);
+
+  getfem::mesh_fem_global_function mfg(m);
+  std::vector<getfem::pglobal_function> funcs(1);
+  funcs[0] = std::make_shared<getfem::global_function_parser>
+    (2, "X(1)*X(2)", "[X(2);X(1)]");
+  mfg.set_functions(funcs);
+  check_dof_ordering(mfg);
+
+  getfem::level_set ls(m);
+  const getfem::mesh_fem &lsmf = ls.get_mesh_fem();
+  for (size_type d = 0; d < lsmf.nb_basic_dof(); ++d)
+    ls.values()[d] = lsmf.point_of_basic_dof(d)[0] + 1.0; // no cut convex
+  getfem::mesh_level_set mls(m);
+  mls.add_level_set(ls);
+  mls.adapt();
+  getfem::mesh_fem_level_set mfls(mls, mf1);
+  mfls.adapt();
+  check_dof_ordering(mfls);
+}
+
+int main(void) {
   test_mesh_building(2, 100); 
 
   getfem::mesh m1;
@@ -643,6 +967,11 @@ int main(void) {
   test_convex_quality(-0.2,0);
   test_convex_quality(-0.01,-0.2);
   test_region();
+  test_frozen_structure();
+  test_bulk_node_insertion();
+  test_renumbering(getfem::mesh::CUTHILL_MCKEE_RENUMBERING);
+  test_renumbering(getfem::mesh::HILBERT_RENUMBERING);
+  test_renumbering(getfem::mesh::MORTON_RENUMBERING);
 
   test_search_point();
   
@@ -657,6 +986,17 @@ int main(void) {
   test_refinable(3, 3);
 
   test_incomplete_Q2();
+
+  size_type nb_threads = getfem::true_thread_policy::num_threads();
+  getfem::set_num_threads(2); // For the parallel enumeration of the dofs.
+  test_dof_enumeration(bgeot::simplex_geotrans(3, 1), 4,
+                       "FEM_PK(3,2)", "FEM_PK(3,1)", 3);
+  test_dof_enumeration(bgeot::simplex_geotrans(2, 1), 8,
+                       "FEM_PK(2,3)", "FEM_PK_DISCONTINUOUS(2,1)", 1);
+  test_dof_enumeration(bgeot::parallelepiped_geotrans(2, 1), 8,
+                       "FEM_QK(2,2)", "FEM_QK(2,1)", 2);
+  getfem::set_num_threads(int(nb_threads));
+  test_derived_dof_ordering();
   
   return 0;
 }
@@ -113,7 +113,8 @@ static void brute_force_check(const std::vector<base_node>& rmin,
   }
 }
 
-static void verify(const std::vector<base_node>& rmin, const std::vector<base_node>& rmax, bgeot::rtree& tree) {
+template <typename TREE>
+static void verify(const std::vector<base_node>& rmin, const std::vector<base_node>& rmax, TREE& tree) {
   size_type N=rmin.front().size();
   std::vector<size_type> pbset;
   //tree.dump();
@@ -144,6 +145,31 @@ static void verify(const std::vector<base_node>& rmin, const std::vector<base_no
     tree.find_boxes_at_point(max,pbset);
     brute_force_check(rmin,rmax,pbset,has_point_p(max));
   }
+  /* buffer and batched queries against the pbox_set ones */
+  std::vector<base_node> pts;
+  for (size_type i=0; i < rmin.size(); ++i) {
+    pts.push_back(rmin[i]); pts.push_back((rmin[i]+rmax[i])/2.);
+    base_node P(N); for (size_type k=0; k < N; ++k) P[k] = gmm::random(double()*1.3);
+    pts.push_back(P);
+  }
+  std::vector<size_type> ptr;
+  typename TREE::pbox_cont bl, bl1;
+  typename TREE::pbox_set bs;
+  tree.find_boxes_at_points(pts, ptr, bl);
+  assert(ptr.size() == pts.size()+1);
+  for (size_type i=0; i < pts.size(); ++i) {
+    tree.find_boxes_at_point(pts[i], bl1);
+    tree.find_boxes_at_point(pts[i], bs);
+    assert(bl1.size() == bs.size() && bl1.size() == ptr[i+1]-ptr[i]);
+    assert(std::equal(bl1.begin(), bl1.end(), bs.begin()));
+    assert(std::equal(bl1.begin(), bl1.end(), bl.begin()+ptr[i]));
+    base_node max2 = pts[i] + rmax[i/3] - rmin[i/3];
+    tree.find_intersecting_boxes(pts[i], max2, bl1);
+    tree.find_intersecting_boxes(pts[i], max2, bs);
+    assert(bl1.size() == bs.size());
+    assert(std::equal(bl1.begin(), bl1.end(), bs.begin()));
+  }
+
   for (size_type i=0; i < rmin.size(); ++i) {
     base_node min2(rmin[i]); for (size_type k=0; k < N; ++k) { min2[k] -= extent[k]*gmm::random()*0.1; }
     base_node max2(rmax[i]); for (size_type k=0; k < N; ++k) { max2[k] += extent[k]*gmm::random()*0.1; }
@@ -181,8 +207,9 @@ static void verify(const std::vector<base_node>& rmin, const std::vector<base_no
   }
 }
 
+template <typename TREE>
 static void check_tree() {
-  bgeot::rtree tree;
+  TREE tree;
   tree.add_box(base_node(1.0,0.),base_node(1.5,0.));
   tree.add_box(base_node(2.0,0.),base_node(3.0,0.),2);
   tree.add_box(base_node(1.5,0.),base_node(2.2,0.),1);
@@ -236,10 +263,67 @@ static void check_tree() {
   cout << "\nthe rtree is ok!\n";
 }
 
+/* boxes are moved, inserted and removed after the build of the tree */
+static void check_dynamic_tree() {
+  bgeot::dynamic_rtree tree(0., 0.2);
+  std::vector<base_node> rmin, rmax;
+  dal::bit_vector alive;
+  size_type NB = quick ? 300 : 3000;
+  for (size_type i=0; i < NB; ++i) {
+    rmin.push_back(base_node(gmm::random(double()), gmm::random(double())));
+    rmax.push_back(rmin.back() + base_node(1.+gmm::random(), 1.+gmm::random())/50.);
+    assert(tree.add_box(rmin.back(),rmax.back()) == i);
+    alive.add(i);
+  }
+  tree.build_tree();
+  assert(tree.depth() < 4*size_type(log(double(NB))/log(2.)));
+
+  for (int step=0; step < 20; ++step) {
+    size_type nb_moved = 0;
+    for (size_type i=0; i < rmin.size(); ++i) {
+      if (!alive[i]) continue;
+      /* small motions remain in the enlarged leaves, a few are larger */
+      double d = (i % 10 == 0) ? 0.05 : 0.0005;
+      base_node dx(d*(gmm::random()-.5), d*(gmm::random()-.5));
+      rmin[i] += dx; rmax[i] += dx;
+      if (tree.update_box(i, rmin[i], rmax[i])) ++nb_moved;
+    }
+    assert(nb_moved < rmin.size() / 4);
+    for (size_type k=0; k < 10; ++k) {
+      size_type i = size_type(gmm::random()*double(rmin.size()));
+      if (alive[i]) { tree.remove_box(i); alive.sup(i); }
+      rmin.push_back(base_node(gmm::random(double()), gmm::random(double())));
+      rmax.push_back(rmin.back() + base_node(1., 1.)/50.);
+      assert(tree.add_box(rmin.back(),rmax.back()) == rmin.size()-1);
+      alive.add(rmin.size()-1);
+    }
+    if (step == 10) tree.refit();
+    if (step == 15) tree.rebuild_tree();
+    assert(tree.nb_boxes() == alive.card());
+
+    std::vector<size_type> pbset;
+    for (size_type q=0; q < 50; ++q) {
+      base_node min(gmm::random(double()), gmm::random(double()));
+      base_node max = min + base_node(gmm::random(), gmm::random())/10.;
+      tree.find_intersecting_boxes(min,max,pbset);
+      dal::bit_vector found; found.merge_from(pbset);
+      for (size_type i=0; i < rmin.size(); ++i)
+        assert(found[i] == (alive[i] && r1_inter_r2(min,max,rmin[i],rmax[i])));
+      tree.find_boxes_at_point(min,pbset);
+      found.clear(); found.merge_from(pbset);
+      for (size_type i=0; i < rmin.size(); ++i)
+        assert(found[i] == (alive[i] && has_point_p(min)(rmin[i],rmax[i])));
+    }
+  }
+  cout << "the dynamic rtree is ok!\n";
+}
+
 int main(int argc, char **argv) {
   if (argc == 2 && strcmp(argv[1],"-quick")==0) quick = true;
   try {
-    check_tree();
+    check_tree<bgeot::rtree>();
+    check_tree<bgeot::dynamic_rtree>();
+    check_dynamic_tree();
     /*if (!quick)
       speed_test(3,300000,20000);
       else speed_test(2,10000,100);*/